@@ -1,4 +1,5 @@
 #include "led.h"
+#include "oled.h"
 
 //////////////////////////////////////////////////////////////////////////////////	 
 //ֻѧϰʹãδɣκ;
@@ -27,7 +28,11 @@ void LED_Init(void)
 	GPIO_Init(GPIOC, &GPIO_InitStructure);					 //趨ʼ
 	GPIO_SetBits(GPIOC,GPIO_Pin_13);						 //PC13 
 
+#if OLED_HW_I2C
+	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_14|GPIO_Pin_15; // ˿ pb14 pb15PB6/PB7  OLED Ӳ I2C
+#else
 	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_6 | GPIO_Pin_7 | GPIO_Pin_14|GPIO_Pin_15; // ˿ pb6 pb7 pb14 pb15
+#endif
 	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_Out_PP; 		 //
 	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;		 //IOٶΪ50MHz
 	GPIO_Init(GPIOB, &GPIO_InitStructure);					 //趨ʼPB14 PB15
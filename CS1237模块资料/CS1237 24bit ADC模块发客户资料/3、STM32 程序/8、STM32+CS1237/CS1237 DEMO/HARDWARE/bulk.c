@@ -0,0 +1,269 @@
+#include "bulk.h"
+#include "frame.h"
+#include "usart.h"
+#include "delay.h"
+
+#define BULK_SNAP_BYTES   (BULK_SNAP_SAMPLES*3)
+#define BULK_HEADER_LEN   FRAME_BULK_DATA_HEADER_LEN
+
+#define BULK_IDLE     0//ѭ¼
+#define BULK_CAPTURE  1//ɼ count 
+#define BULK_SEND     2//Ϳգֹͣ¼
+
+static u8  snap[BULK_SNAP_BYTES];// 3 ֽڴ˴ţ±갴ѭ
+static u16 snap_head;	//һдλ
+static u16 snap_count;	//еЧ
+static u16 snap_want;	//ɼʱ
+
+static u8  state;
+static u8  xfer;		//ţÿζ¿ռ 1λݴ˶һδĳٵ֡
+static u8  cfg_rate,cfg_pga;
+static u32 first;		//յһֽڻеλ
+static u32 total;		//ֽ
+static u16 blocks;
+static u32 snap_crc;
+static u16 base;		//ǰĿλյ
+static u16 next;		//һ״η͵Ŀ
+static u32 resend;		// base+i λ base+i ط
+static u32 last_ack;	//һյȷϣʼͣʱ̣ms
+
+//CRC-16/CCITTֵ 0xFFFFλ bulk_crc16
+static u16 crc16(const u8 *p,u16 n)
+{
+	u16 crc = 0xFFFF;
+	u8 k;
+
+	while(n--)
+	{
+		crc ^= (u16)(*p++)<<8;
+		for(k=0;k<8;k++)
+			crc = (crc&0x8000) ? (crc<<1)^0x1021 : crc<<1;
+	}
+	return crc;
+}
+
+//CRC-32ͬ zlib.crc32ɷֶۼӣ׶δ 0
+static u32 crc32(u32 crc,const u8 *p,u32 n)
+{
+	u8 k;
+
+	crc = ~crc;
+	while(n--)
+	{
+		crc ^= *p++;
+		for(k=0;k<8;k++)
+			crc = (crc&1) ? (crc>>1)^0xEDB88320UL : crc>>1;
+	}
+	return ~crc;
+}
+
+static void send_error(u8 code)
+{
+	Frame_Send(CMD_ERROR,&code,1);
+}
+
+static void send_info(void)
+{
+	u8 d[FRAME_BULK_INFO_DATA_LEN];
+
+	d[0] = xfer;
+	d[1] = BULK_FMT_S24;
+	d[2] = cfg_rate;
+	d[3] = cfg_pga;
+	d[4] = total>>24;
+	d[5] = total>>16;
+	d[6] = total>>8;
+	d[7] = total;
+	d[8] = blocks>>8;
+	d[9] = blocks;
+	d[10] = BULK_BLOCK_SIZE;
+	d[11] = BULK_WINDOW;
+	d[12] = snap_crc>>24;
+	d[13] = snap_crc>>16;
+	d[14] = snap_crc>>8;
+	d[15] = snap_crc;
+	Frame_Send(CMD_BULK_INFO,d,FRAME_BULK_INFO_DATA_LEN);
+}
+
+//ͷʼ͵ǰ
+static void restart(void)
+{
+	base = 0;
+	next = 0;
+	resend = 0;
+	last_ack = delay_millis();
+	send_info();
+}
+
+// n ÿ CRC  BULK_INFO
+//CRC λ㣬6KB Լ 1msֻڶʱһ
+static void freeze(u16 n)
+{
+	u32 end;
+
+	first = (u32)((snap_head + BULK_SNAP_SAMPLES - n) % BULK_SNAP_SAMPLES) * 3;
+	total = (u32)n * 3;
+	blocks = (total + BULK_BLOCK_SIZE - 1) / BULK_BLOCK_SIZE;
+	end = first + total;
+	if(end <= BULK_SNAP_BYTES)
+		snap_crc = crc32(0,&snap[first],total);
+	else
+		snap_crc = crc32(crc32(0,&snap[first],BULK_SNAP_BYTES-first),snap,end-BULK_SNAP_BYTES);
+	xfer++;
+	state = BULK_SEND;
+	restart();
+}
+
+//ͻŵʱ b 飬ɹ 1
+static u8 send_block(u16 b)
+{
+	u8 d[BULK_HEADER_LEN+BULK_BLOCK_SIZE];
+	u32 off = (u32)b * BULK_BLOCK_SIZE;
+	u32 pos = first + off;
+	u16 len = (total - off > BULK_BLOCK_SIZE) ? BULK_BLOCK_SIZE : total - off;
+	u16 i,crc;
+
+	if(USART1_Free() < 7 + BULK_HEADER_LEN + len)
+		return 0;
+	for(i=0;i<len;i++)
+	{
+		if(pos >= BULK_SNAP_BYTES)
+			pos -= BULK_SNAP_BYTES;
+		d[BULK_HEADER_LEN+i] = snap[pos++];
+	}
+	crc = crc16(&d[BULK_HEADER_LEN],len);
+	d[0] = xfer;
+	d[1] = b>>8;
+	d[2] = b;
+	d[3] = crc>>8;
+	d[4] = crc;
+	return Frame_Send(CMD_BULK_DATA,d,BULK_HEADER_LEN+len);
+}
+
+//֮¼֮ȱڣӿջ¼¼
+static void finish(void)
+{
+	state = BULK_IDLE;
+	snap_count = 0;
+}
+
+void Bulk_Init(u8 rate,u8 pga)
+{
+	cfg_rate = rate;
+	cfg_pga = pga;
+}
+
+void Bulk_Feed(const s32 *samples,u16 n)
+{
+	u16 i;
+	u8 *p;
+
+	if(state == BULK_SEND)
+		return;
+	for(i=0;i<n;i++)
+	{
+		p = &snap[(u32)snap_head*3];
+		p[0] = samples[i]>>16;
+		p[1] = samples[i]>>8;
+		p[2] = samples[i];
+		if(++snap_head == BULK_SNAP_SAMPLES)
+			snap_head = 0;
+		if(snap_count < BULK_SNAP_SAMPLES)
+			snap_count++;
+		if(state == BULK_CAPTURE && --snap_want == 0)
+		{
+			freeze(snap_count);
+			return;//µڿ
+		}
+	}
+}
+
+u8 Bulk_Busy(void)
+{
+	return state == BULK_SEND;
+}
+
+void Bulk_Open(u8 source,u16 count)
+{
+	if(count == 0 || count > BULK_SNAP_SAMPLES)
+		count = BULK_SNAP_SAMPLES;
+	switch(source)
+	{
+		case BULK_SRC_HISTORY:
+			if(state == BULK_CAPTURE || snap_count == 0)
+			{
+				send_error(ERR_DATA_INVALID);//ڲɼûм¼
+				break;
+			}
+			if(count > snap_count)
+				count = snap_count;
+			freeze(count);//յҲǶͬһλ壬ż 1
+			break;
+		case BULK_SRC_CAPTURE:
+			if(state == BULK_SEND)
+				finish();
+			state = BULK_CAPTURE;
+			snap_count = 0;
+			snap_want = count;
+			break;
+		case BULK_SRC_RESEND:
+			if(state == BULK_SEND)
+				restart();
+			else if(state == BULK_IDLE)
+				send_error(ERR_DATA_INVALID);
+			break;//ɼУԻᷢ BULK_INFO
+		default:
+			send_error(ERR_DATA_INVALID);
+			break;
+	}
+}
+
+void Bulk_Ack(u8 x,u16 b,u32 missing)
+{
+	u16 shift;
+
+	//Ĵȷϡ˵ baseظľȷϣԽѷ base 
+	if(state != BULK_SEND || x != xfer || b < base || b > next)
+		return;
+	last_ack = delay_millis();
+	if(b >= blocks)
+	{
+		finish();
+		return;
+	}
+	shift = b - base;
+	resend = (shift >= 32) ? 0 : resend >> shift;
+	base = b;
+	//ֻѷĿ飻δĿ鱾ͻᰴ˳
+	shift = next - base;
+	if(shift < 32)
+		missing &= (1UL<<shift) - 1;
+	resend |= missing;
+}
+
+void Bulk_Poll(void)
+{
+	u8 i;
+
+	if(state != BULK_SEND)
+		return;
+	if(delay_millis() - last_ack > BULK_TIMEOUT_MS)
+	{
+		finish();//λѲڣָ֡
+		return;
+	}
+	//طȣĿԽ粹ϣλ base ԽǰڲῨס
+	while(resend)
+	{
+		for(i=0;!(resend & (1UL<<i));i++);
+		if(!send_block(base + i))
+			return;
+		resend &= ~(1UL<<i);
+	}
+	while(next < blocks && next - base < BULK_WINDOW)
+	{
+		if(!send_block(next))
+			return;
+		next++;
+	}
+}
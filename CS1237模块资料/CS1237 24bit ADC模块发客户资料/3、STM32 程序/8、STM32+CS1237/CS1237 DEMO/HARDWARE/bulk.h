@@ -0,0 +1,30 @@
+#ifndef __BULK_H
+#define __BULK_H
+
+#include "sys.h"
+
+//----------------------------------------------------------------------------------
+// շֿ鴫䣨λ bulk_transfer.py ϣ gui/ЭͨѶ˵.md
+// ʱȡѭ¼ڿջλ BULK_OPEN 󶳽
+// ٲ count ŷÿ CRC-16
+// λ BULK_ACK ۼȷ base ͶλͼֻطλͼеĿ飻
+// ѷ base δԽĿ鲻һڣڳֻĿ飬
+//----------------------------------------------------------------------------------
+#define BULK_SNAP_SAMPLES  2048	//ÿ 3 ֽڣ 6KB
+#define BULK_BLOCK_SIZE    240	//ÿֽ80 ݿ֡ 7+5+240 = 252 ֽڣռһ DMA ͻ
+#define BULK_WINDOW        32	//ڿ BULK_ACK λͼ 32 λ
+#define BULK_TIMEOUT_MS    3000	//ôղȷϾͷδ䣬ָ¼
+
+//ɼñ루ͬ SET_RATE / SET_PGA ֵ BULK_INFO λʱ͵ѹ
+void Bulk_Init(u8 rate,u8 pga);
+//ȡÿȡһһΣʱѭ¼ɼʱ count ʼ
+void Bulk_Feed(const s32 *samples,u16 n);
+//ڷͿʱ 1֡ó
+u8   Bulk_Busy(void);
+//λBULK_OPEN / BULK_ACK
+void Bulk_Open(u8 source,u16 count);
+void Bulk_Ack(u8 xfer,u16 base,u32 missing);
+//ڴڵãȲʧĿ飬ڴڷ¿飬ͻŲ¾͵´
+void Bulk_Poll(void);
+
+#endif
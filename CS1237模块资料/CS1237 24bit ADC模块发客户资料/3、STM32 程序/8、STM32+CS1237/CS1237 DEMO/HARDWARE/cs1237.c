@@ -2,11 +2,11 @@
 #include "sys.h"
 #include "delay.h"
 #include "usart.h"
+#include "frame.h"
 
 //SCK   PA5
 //SDI/O PA7
 
-#define ADC_Bit  20 //ADCЧλλ 24λ
 #define SCK_1  GPIO_SetBits(GPIOA,GPIO_Pin_5)//SCLK = 1
 #define SCK_0  GPIO_ResetBits(GPIOA,GPIO_Pin_5)//SCLK = 0
 #define DAT_1  GPIO_SetBits(GPIOA,GPIO_Pin_7)//DOUT = 1
@@ -51,23 +51,33 @@ void CS1237_SDA_SetOutput(void)
 	GPIO_Init(GPIOA, &GPIO_InitStructure);					 //趨ʼGPIOA.7
 }
 
-//ʱ500US 25MHZ
+//ʱ a*500us
+//ԭĿѭ 25MHz  51 Ƭ궨 72MHz  STM32 ʵֻԼ 1/3 SysTick ʱ
 void delay_500us(unsigned char a)
 {	
-	unsigned char i,j,b;
-	for(b=0;b<a;b++)
-	{
-		i = 13;
-		j = 37;
-		do
-		{
-			while (--j);
-		} while (--i);
-	}
+	while(a--)
+		delay_us(500);
 }
 
 //CS1237оƬ
+static volatile u8 acq_enabled;//ɼǷ
+static volatile u8 acq_busy;//һ DMA ȡڽ
+
+static void Con_CS1237_Raw(unsigned char ConfigDat);
+
+//ڼ PA7 ҪлΪͣɼٻָ
 void Con_CS1237(unsigned char ConfigDat)
+{
+	u8 resume = acq_enabled;
+	
+	if(resume)
+		CS1237_Acq_Stop();
+	Con_CS1237_Raw(ConfigDat);
+	if(resume)
+		CS1237_Acq_Start();
+}
+
+static void Con_CS1237_Raw(unsigned char ConfigDat)
 {
 	unsigned char i;
 	unsigned char dat;
@@ -179,7 +189,7 @@ unsigned long Read_CS1237(void)
 {
 	unsigned char i;
 	unsigned long dat=0;//ȡ
-	unsigned char count_i=0;//ʱ
+	u16 count_i=0;//ʱҪƵ 300 unsigned char
 	DAT_1;//˿151ر
 	SCK_0;//ʱ
 	CS1237_SDA_SetInput();
@@ -219,7 +229,6 @@ unsigned long Read_CS1237(void)
 //	Uart_send_hex_to_txt(dat>>16);
 //	Uart_send_hex_to_txt(dat>>8);
 //	Uart_send_hex_to_txt(dat);
-	printf("ad val=%10X \r\n",dat);//unsigned long 04294967295
 	
 	if((dat&0x800000) == 0x800000)	//λΪ1ʾΪֵ
 	{
@@ -235,9 +244,7 @@ unsigned long Read_CS1237(void)
 //		UART_Send_Byte(0x2B);				//+  
 	}
 		
-	//ȸݺ궨ЧλһЩ
-//	i = 24 - ADC_Bit;//iʾҪλ
-//	dat >>= i;//λ
+	//ЧλĽض frame.c ڴ֡ʱλ趨УFrame_SetBits
 	
 	return dat;
 }
@@ -255,7 +262,251 @@ void CS1237ReadInterlTemp(void)
 	
 	while(1)
 	{
-		Read_CS1237();
+		s32 val = Read_CS1237();
+		u8 dat[4];
+		if(PoolFlag)
+			val = -val;
+		dat[0] = val>>24;//ADC֡4ֽڴ
+		dat[1] = val>>16;
+		dat[2] = val>>8;
+		dat[3] = val;
+		Frame_Send(CMD_ADC_DATA,dat,4);
+		USART1_Flush();
 		delay_ms(1);
 	}
 }
+
+//----------------------------------------------------------------------------------
+// ж+ʱɼ
+//
+// ʱTIM2 ÿ CS1237_SCLK_HALF_US һΣһڣ:
+//    k θ¼ DMA д clk_table[k]  BSRRż PA5 PA5
+//   ÿڵ 3/4  CC2 ¼ DMA  IDR  idr_buf[j]
+//    2i θʱӣİ 2i+1 Ϊߵƽidr_buf[2i+1]  i λ
+// ȫ 2*CS1237_CLOCKS дɺ DMA1_Channel2 жϡ
+//----------------------------------------------------------------------------------
+#define ACQ_STEPS      (CS1237_CLOCKS*2)
+#define ACQ_TIM_ARR    (SystemCoreClock/1000000*CS1237_SCLK_HALF_US-1)
+#define RING_MASK      (CS1237_RING_SIZE-1)
+
+volatile u32 CS1237_Samples;
+volatile u32 CS1237_Overruns;
+
+static u32 clk_table[ACQ_STEPS];//BSRR д
+static u16 idr_buf[ACQ_STEPS];//ÿڲɵ GPIOA->IDR
+
+static s32 ring_buf[CS1237_RING_SIZE];
+static volatile u16 ring_head;//ֻжд
+static volatile u16 ring_tail;//ֻѭд
+
+void CS1237_Acq_Init(void)
+{
+	u8 i;
+	GPIO_InitTypeDef GPIO_InitStructure;
+	EXTI_InitTypeDef EXTI_InitStructure;
+	NVIC_InitTypeDef NVIC_InitStructure;
+	TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+	TIM_OCInitTypeDef TIM_OCInitStructure;
+	DMA_InitTypeDef DMA_InitStructure;
+	
+	for(i=0;i<ACQ_STEPS;i++)
+		clk_table[i] = (i&1) ? ((u32)GPIO_Pin_5<<16) : GPIO_Pin_5;// 16 λΪλ 16 λΪλ
+	
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA|RCC_APB2Periph_AFIO, ENABLE);
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, ENABLE);
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+	
+	//PA5 ʱͣPA7 
+	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_5;
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_Out_PP;
+	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_Init(GPIOA, &GPIO_InitStructure);
+	SCK_0;
+	CS1237_SDA_SetInput();
+	
+	//PA7 ½жϣΣ CS1237_Acq_Start 
+	GPIO_EXTILineConfig(GPIO_PortSourceGPIOA, GPIO_PinSource7);
+	EXTI_InitStructure.EXTI_Line = EXTI_Line7;
+	EXTI_InitStructure.EXTI_Mode = EXTI_Mode_Interrupt;
+	EXTI_InitStructure.EXTI_Trigger = EXTI_Trigger_Falling;
+	EXTI_InitStructure.EXTI_LineCmd = DISABLE;
+	EXTI_Init(&EXTI_InitStructure);
+	
+	NVIC_InitStructure.NVIC_IRQChannel = EXTI9_5_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+	
+	NVIC_InitStructure.NVIC_IRQChannel = DMA1_Channel2_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 1;
+	NVIC_Init(&NVIC_InitStructure);
+	
+	//TIM2 һCC2 ڰڵ 3/4 
+	TIM_TimeBaseStructure.TIM_Prescaler = 0;
+	TIM_TimeBaseStructure.TIM_Period = ACQ_TIM_ARR;
+	TIM_TimeBaseStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+	TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+	TIM_TimeBaseInit(TIM2, &TIM_TimeBaseStructure);
+	TIM_OCStructInit(&TIM_OCInitStructure);
+	TIM_OCInitStructure.TIM_OCMode = TIM_OCMode_Timing;
+	TIM_OCInitStructure.TIM_Pulse = (ACQ_TIM_ARR+1)*3/4;
+	TIM_OC2Init(TIM2, &TIM_OCInitStructure);
+	TIM_ClearFlag(TIM2, 0xFFFF);
+	
+	//DMA1_Channel2 = TIM2_UPclk_table -> GPIOA->BSRR
+	DMA_DeInit(DMA1_Channel2);
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (u32)&GPIOA->BSRR;
+	DMA_InitStructure.DMA_MemoryBaseAddr = (u32)clk_table;
+	DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;
+	DMA_InitStructure.DMA_BufferSize = ACQ_STEPS;
+	DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Word;
+	DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Word;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_VeryHigh;
+	DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+	DMA_Init(DMA1_Channel2, &DMA_InitStructure);
+	DMA_ITConfig(DMA1_Channel2, DMA_IT_TC, ENABLE);
+	
+	//DMA1_Channel7 = TIM2_CH2GPIOA->IDR -> idr_buf
+	DMA_DeInit(DMA1_Channel7);
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (u32)&GPIOA->IDR;
+	DMA_InitStructure.DMA_MemoryBaseAddr = (u32)idr_buf;
+	DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
+	DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+	DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+	DMA_Init(DMA1_Channel7, &DMA_InitStructure);
+	
+	acq_enabled = 0;
+	acq_busy = 0;
+}
+
+//װ DMA  TIM2ʼһ 27 ʱӵĶȡ
+static void acq_kick(void)
+{
+	acq_busy = 1;
+	DMA1_Channel2->CCR &= ~DMA_CCR2_EN;
+	DMA1_Channel7->CCR &= ~DMA_CCR7_EN;
+	DMA1_Channel2->CNDTR = ACQ_STEPS;
+	DMA1_Channel7->CNDTR = ACQ_STEPS;
+	DMA1_Channel2->CCR |= DMA_CCR2_EN;
+	DMA1_Channel7->CCR |= DMA_CCR7_EN;
+	TIM2->CNT = 0;
+	TIM2->SR = 0;
+	TIM2->DIER |= TIM_DMA_Update|TIM_DMA_CC2;
+	TIM2->CR1 |= TIM_CR1_CEN;
+}
+
+void CS1237_Acq_Start(void)
+{
+	SCK_0;
+	CS1237_SDA_SetInput();
+	acq_enabled = 1;
+	EXTI_ClearITPendingBit(EXTI_Line7);
+	EXTI->IMR |= EXTI_Line7;
+	//жǰ DOUT ѾΪͣ˵Ѿһδ
+	if(GPIO_ReadInputDataBit(GPIOA,GPIO_Pin_7) == 0)
+		EXTI_GenerateSWInterrupt(EXTI_Line7);
+}
+
+void CS1237_Acq_Stop(void)
+{
+	acq_enabled = 0;
+	EXTI->IMR &= ~EXTI_Line7;
+	while(acq_busy);//ȴڽеĶȡ
+	EXTI_ClearITPendingBit(EXTI_Line7);
+}
+
+//DOUT ½أݾ
+void EXTI9_5_IRQHandler(void)
+{
+	if(EXTI_GetITStatus(EXTI_Line7) != RESET)
+	{
+		//ȡ DOUT ݷתΣٴ
+		EXTI->IMR &= ~EXTI_Line7;
+		EXTI_ClearITPendingBit(EXTI_Line7);
+		if(!acq_busy)
+			acq_kick();
+	}
+}
+
+//27 ʱȫ
+void DMA1_Channel2_IRQHandler(void)
+{
+	u8 i;
+	u32 dat = 0;
+	u16 head;
+	
+	if(DMA_GetITStatus(DMA1_IT_TC2) != RESET)
+	{
+		DMA_ClearITPendingBit(DMA1_IT_GL2);
+		TIM2->CR1 &= ~TIM_CR1_CEN;
+		//رնʱ DMA 󣬱ͣǰ´ʱӦ
+		TIM2->DIER &= ~(TIM_DMA_Update|TIM_DMA_CC2);
+		
+		for(i=0;i<24;i++)
+		{
+			dat <<= 1;
+			if(idr_buf[2*i+1] & GPIO_Pin_7)
+				dat |= 1;
+		}
+		
+		head = ring_head;
+		if((u16)(head - ring_tail) < CS1237_RING_SIZE)
+		{
+			ring_buf[head & RING_MASK] = (s32)(dat << 8) >> 8;//24 λչ
+			ring_head = head + 1;
+		}
+		else
+			CS1237_Overruns++;
+		CS1237_Samples++;
+		
+		acq_busy = 0;
+		if(acq_enabled)
+		{
+			// 27 ʱӺ DOUT ѱߣһ½ؼһ
+			EXTI_ClearITPendingBit(EXTI_Line7);
+			EXTI->IMR |= EXTI_Line7;
+		}
+	}
+}
+
+u16 CS1237_Ring_Count(void)
+{
+	return (u16)(ring_head - ring_tail);
+}
+
+u16 CS1237_Ring_Read(s32 *buf, u16 max)
+{
+	u16 n = 0;
+	u16 tail = ring_tail;
+	
+	while(n < max && tail != ring_head)
+	{
+		buf[n++] = ring_buf[tail & RING_MASK];
+		tail++;
+	}
+	ring_tail = tail;
+	return n;
+}
+
+u16 CS1237_Ring_Contig(const s32 **p)
+{
+	u16 tail = ring_tail;
+	u16 count = (u16)(ring_head - tail);
+	u16 idx = tail & RING_MASK;
+	
+	*p = &ring_buf[idx];
+	if(count > CS1237_RING_SIZE - idx)
+		count = CS1237_RING_SIZE - idx;
+	return count;
+}
+
+void CS1237_Ring_Consume(u16 n)
+{
+	ring_tail += n;
+}
@@ -1,6 +1,8 @@
 #ifndef __CS1237_H
 #define __CS1237_H
 
+#include "sys.h"
+
 #define RefOut_OFF         0X40//ر REF 
 #define RefOut_ON          0X00//REF 
 
@@ -30,4 +32,27 @@ unsigned long Read_CS1237(void);
 
 void CS1237ReadInterlTemp(void);
 
+//----------------------------------------------------------------------------------
+// ж+ʱɼ
+// DOUT(PA7)½رʾݾ -> EXTI7 ж TIM2
+// TIM2 ¼ DMA1_Channel2 д GPIOA->BSRR  PA5 ʱӣ
+// TIM2_CC2 ¼ DMA1_Channel7 ÿߵƽζȡ GPIOA->IDR
+// 27 ʱӽ DMA жƴװ 24 λд뻷λ塣
+// ÿ CPU ֻжϣʱɶʱѭ޹ء
+//----------------------------------------------------------------------------------
+#define CS1237_SCLK_HALF_US  1     //SCLK /͵ƽ 1us
+#define CS1237_CLOCKS        27    //24 λ + 2526 д״̬λ +  27  DOUT 
+#define CS1237_RING_SIZE     256   //λ峤ȣΪ 2 
+
+extern volatile u32 CS1237_Samples;   //ۼƲ
+extern volatile u32 CS1237_Overruns;  //ʱĲ
+
+void CS1237_Acq_Init(void);     //ʼ EXTI/TIM2/DMA
+void CS1237_Acq_Start(void);    //ʼɼ
+void CS1237_Acq_Stop(void);     //ֹͣɼȴڽеĶȡ
+u16  CS1237_Ring_Count(void);   //еĲ
+u16  CS1237_Ring_Read(s32 *buf, u16 max);  //ȡ max ʵʸ
+u16  CS1237_Ring_Contig(const s32 **p);    //ŵһΣ DMA ֱӰ
+void CS1237_Ring_Consume(u16 n);           //Ѵ n 
+
 #endif
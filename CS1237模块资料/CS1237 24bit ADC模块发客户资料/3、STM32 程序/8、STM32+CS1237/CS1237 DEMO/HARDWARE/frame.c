@@ -0,0 +1,246 @@
+#include "frame.h"
+#include "usart.h"
+#include "bulk.h"
+
+//֡ƴú֡д뷢ͻ壨ֻѭеã룩
+static u8 frame_buf[6+255];
+
+//ѷ frame_buf[4..]֡ͷȡУ֡β
+static u8 frame_finish(u8 cmd,u8 len)
+{
+	u16 i,idx;
+	u8 sum=0;
+	
+	frame_buf[0] = FRAME_HEAD_1;
+	frame_buf[1] = FRAME_HEAD_2;
+	frame_buf[2] = len+1;
+	frame_buf[3] = cmd;
+	idx = 4+len;
+	for(i=2;i<idx;i++)
+		sum ^= frame_buf[i];
+	frame_buf[idx++] = sum;
+	frame_buf[idx++] = FRAME_TAIL_1;
+	frame_buf[idx++] = FRAME_TAIL_2;
+	//֡һд룬Ų¾֡λŷֶ֡
+	return USART1_Write(frame_buf,idx) == idx;
+}
+
+u8 Frame_Send(u8 cmd,const u8 *dat,u8 len)
+{
+	u8 i;
+	
+	if(len > 254)
+		return 0;
+	for(i=0;i<len;i++)
+		frame_buf[4+i] = dat[i];
+	return frame_finish(cmd,len);
+}
+
+//----------------------------------------------------------------------------------
+// Чλ24 λеλ·ʱص 16~20 λͬɶഫ
+//----------------------------------------------------------------------------------
+static u8 out_bits = FRAME_BITS_DEFAULT;
+static u8 out_mode = FRAME_Q_ROUND;
+static s32 q_err;		//ʽһ24 λ̶ȣ
+static u32 q_rand = 0x12345678;
+
+static u32 rand_next(void)//xorshift32
+{
+	q_rand ^= q_rand<<13;
+	q_rand ^= q_rand>>17;
+	q_rand ^= q_rand<<5;
+	return q_rand;
+}
+
+//24 λзֵ out_bits λ out_bits λ̶ȵзֵ
+static s32 quantize(s32 v)
+{
+	u8 sh = 24-out_bits;
+	s32 u,q,d = 0;
+	s32 qmax = (1L<<(out_bits-1))-1;
+	
+	if(sh == 0)
+		return v;
+	u = v;
+	if(out_mode == FRAME_Q_DITHER)
+		d = (s32)(rand_next()>>(32-sh)) - (s32)(rand_next()>>(32-sh));//ȷֲ֮
+	else if(out_mode == FRAME_Q_SHAPE)
+		u = v - q_err;
+	q = (u + d + (1L<<(sh-1))) >> sh;
+	if(q > qmax)
+		q = qmax;
+	else if(q < -qmax-1)
+		q = -qmax-1;
+	if(out_mode == FRAME_Q_SHAPE)
+		q_err = (q<<sh) - u;
+	return q;
+}
+
+u8 Frame_SetBits(u8 bits,u8 mode)
+{
+	if((bits != 16 && bits != 18 && bits != 20 && bits != 24) || mode > FRAME_Q_SHAPE)
+		return 0;
+	out_bits = bits;
+	out_mode = mode;
+	q_err = 0;
+	return 1;
+}
+
+u8 Frame_SendBatch(u16 seq,const s32 *samples,u8 n)
+{
+	u8 *p = &frame_buf[4];
+	u8 i,nb = 0;
+	u32 acc = 0,mask = (1UL<<out_bits)-1;
+	
+	if(n > FRAME_BATCH_MAX)
+		n = FRAME_BATCH_MAX;
+	*p++ = seq>>8;
+	*p++ = seq;
+	*p++ = out_bits;//λ
+	*p++ = n;
+	//λӸλƴӣacc ֻδ nb λ
+	for(i=0;i<n;i++)
+	{
+		acc = (acc<<out_bits) | ((u32)quantize(samples[i]) & mask);
+		nb += out_bits;
+		while(nb >= 8)
+		{
+			nb -= 8;
+			*p++ = acc>>nb;
+		}
+	}
+	if(nb)
+		*p++ = acc<<(8-nb);
+	return frame_finish(CMD_ADC_BATCH,p-&frame_buf[4]);
+}
+
+//----------------------------------------------------------------------------------
+// λ֡USART1 жϰֽڷŽջλ壬ֽڽ
+//----------------------------------------------------------------------------------
+#define RX_DATA_MAX  FRAME_BULK_ACK_DATA_LEN//ǿȷ֡
+
+static u8 rx_state;
+static u8 rx_len,rx_cmd,rx_cnt,rx_sum;
+static u8 rx_dat[RX_DATA_MAX];
+
+static const u32 baud_rates[BAUD_COUNT] = BAUD_RATES_INIT;
+
+u8 Frame_SendHello(void)
+{
+	u8 d[FRAME_HELLO_DATA_LEN];
+	u16 caps = CAP_ADC_BATCH | CAP_SET_BITS | CAP_SET_BAUD | CAP_BULK;
+	
+	d[0] = PROTO_VERSION;
+	d[1] = DEV_STM32;
+	d[2] = FRAME_FW_VERSION>>8;
+	d[3] = FRAME_FW_VERSION&0xFF;
+	d[4] = caps>>8;
+	d[5] = caps;
+	d[6] = FRAME_MAX_BAUD;
+	d[7] = FRAME_BATCH_MAX;
+	return Frame_Send(CMD_HELLO,d,FRAME_HELLO_DATA_LEN);
+}
+
+static void exec_command(void)
+{
+	u8 ack[2];
+	
+	if(rx_cmd == CMD_HELLO && rx_len == 1)
+	{
+		Frame_SendHello();
+		return;
+	}
+	if(rx_cmd == CMD_SET_BAUD && rx_len == 2)
+	{
+		if(rx_dat[0] > FRAME_MAX_BAUD)
+		{
+			ack[0] = ERR_DATA_INVALID;
+			Frame_Send(CMD_ERROR,ack,1);
+			return;
+		}
+		//ȷ֡ԭʷл
+		ack[0] = CMD_SET_BAUD;
+		ack[1] = rx_dat[0];
+		Frame_Send(CMD_CONFIG_ACK,ack,2);
+		USART1_SetBaud(baud_rates[rx_dat[0]]);
+		return;
+	}
+	if(rx_cmd == CMD_SET_BITS && rx_len == 2)
+	{
+		//ݣbit7-6 ʽbit4-0 λ
+		if(!Frame_SetBits(rx_dat[0]&0x1F, rx_dat[0]>>6))
+		{
+			ack[0] = ERR_DATA_INVALID;
+			Frame_Send(CMD_ERROR,ack,1);
+			return;
+		}
+		ack[0] = CMD_SET_BITS;
+		ack[1] = rx_dat[0];
+		Frame_Send(CMD_CONFIG_ACK,ack,2);
+		return;
+	}
+	if(rx_cmd == CMD_BULK_OPEN && rx_len == FRAME_BULK_OPEN_DATA_LEN+1)
+	{
+		//ݣ[Դ BULK_SRC_*][ 2B]
+		Bulk_Open(rx_dat[0], (u16)rx_dat[1]<<8 | rx_dat[2]);
+		return;
+	}
+	if(rx_cmd == CMD_BULK_ACK && rx_len == FRAME_BULK_ACK_DATA_LEN+1)
+	{
+		//ݣ[][base 2B][λͼ 4B]
+		Bulk_Ack(rx_dat[0], (u16)rx_dat[1]<<8 | rx_dat[2],
+			(u32)rx_dat[3]<<24 | (u32)rx_dat[4]<<16 | (u32)rx_dat[5]<<8 | rx_dat[6]);
+	}
+}
+
+void Frame_Poll(void)
+{
+	u8 c;
+	
+	while(USART1_Read(&c))
+	{
+		switch(rx_state)
+		{
+			case 0://֡ͷ1
+				if(c == FRAME_HEAD_1)
+					rx_state = 1;
+				break;
+			case 1://֡ͷ2
+				rx_state = (c == FRAME_HEAD_2) ? 2 : (c == FRAME_HEAD_1 ? 1 : 0);
+				break;
+			case 2://
+				if(c == 0 || c > RX_DATA_MAX+1)
+				{
+					rx_state = 0;
+					break;
+				}
+				rx_len = c;
+				rx_sum = c;
+				rx_state = 3;
+				break;
+			case 3://
+				rx_cmd = c;
+				rx_sum ^= c;
+				rx_cnt = 0;
+				rx_state = (rx_len > 1) ? 4 : 5;
+				break;
+			case 4://
+				rx_dat[rx_cnt++] = c;
+				rx_sum ^= c;
+				if(rx_cnt >= rx_len-1)
+					rx_state = 5;
+				break;
+			case 5://У
+				rx_state = (c == rx_sum) ? 6 : 0;
+				break;
+			case 6://֡β1
+				rx_state = (c == FRAME_TAIL_1) ? 7 : 0;
+				break;
+			default://֡β2
+				rx_state = 0;
+				if(c == FRAME_TAIL_2)
+					exec_command();
+				break;
+		}
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef __FRAME_H
+#define __FRAME_H
+
+#include "sys.h"
+
+//----------------------------------------------------------------------------------
+// ֡Э飨 UNO ̼λһ£ gui/ЭͨѶ˵.md
+// [AA 55] [] [] [] [XORУ] [0D 0A]
+//  =  +  ֽУΪ .. ֽ
+//----------------------------------------------------------------------------------
+#include "cs1237_proto_defs.h"//֡ͷ֡β롢룬 protocol/gen_proto.py 
+
+#define FRAME_BATCH_MAX    80//ÿ֡1+4+3*80 = 245 <= 255
+
+//֡λ 16/18/20/24λصķʽ
+#define FRAME_Q_ROUND      0//
+#define FRAME_Q_DITHER     1// 1LSB Ƿֲ룬Сźŵ̨
+#define FRAME_Q_SHAPE      2//һƵλƽ/˲ɻָλ
+#define FRAME_BITS_DEFAULT 24
+
+//֡ݣ̼汾ֽ汾л߲
+#define FRAME_FW_VERSION   0x0100
+#define FRAME_MAX_BAUD     BAUD_921600//72MHz  BRR  0.16%
+
+//һ֡д USART1 DMA ͻ壬ɹ 1 0
+u8 Frame_Send(u8 cmd,const u8 *dat,u8 len);
+//֡[ 2B][λ 1B][ 1B][]ֽھΪ
+//λӸλУĩֽڲ㲹 0λ 24 ʱÿ 3 ֽ
+u8 Frame_SendBatch(u16 seq,const s32 *samples,u8 n);
+//֡λʽǷ 0
+u8 Frame_SetBits(u8 bits,u8 mode);
+//֡ϵʱյ 0x06 ѯʱͣλݴѡЭͲ
+u8 Frame_SendHello(void);
+//յλ֡ѭڵ
+void Frame_Poll(void);
+
+#endif
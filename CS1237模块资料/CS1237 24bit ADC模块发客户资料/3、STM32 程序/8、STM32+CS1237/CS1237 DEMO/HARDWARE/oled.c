@@ -6,6 +6,200 @@
 
 u8 OLED_GRAM[144][8];
 
+//ÿҳзΧ [dirty_x0, dirty_x1)x0>=x1 ʾҳûиĶ
+static u8 dirty_x0[8]={0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF};
+static u8 dirty_x1[8];
+
+//ˢ¶Уÿҳһ I2C 
+//[0x80 ҳַ][0x80 е4λ][0x80 и4λ][0x40 ...]0x80 ʾ滹пֽ
+#define OLED_TXQ_HDR  7
+static u8 txq[8][OLED_TXQ_HDR+128];
+static u8 txq_len[8];
+static u8 txq_cnt;
+static volatile u8 txq_pos;
+static volatile u8 oled_busy;
+
+static void oled_mark(u8 x,u8 page)
+{
+	if(x>=128)return;//128 Ժֻڹʾʱã
+	if(x<dirty_x0[page])dirty_x0[page]=x;
+	if(x+1>dirty_x1[page])dirty_x1[page]=x+1;
+}
+
+static void oled_mark_all(void)
+{
+	u8 i;
+	for(i=0;i<8;i++)
+	{
+		dirty_x0[i]=0;
+		dirty_x1[i]=128;
+	}
+}
+
+//дһԴֽڣб仯ű
+static void oled_put(u8 x,u8 page,u8 dat)
+{
+	if(OLED_GRAM[x][page]!=dat)
+	{
+		OLED_GRAM[x][page]=dat;
+		oled_mark(x,page);
+	}
+}
+
+//ѰдŵλͼֱдԴ棨y  8 ı
+//w: pages:ռҳ bmp  0ҳwֽ,1ҳwֽ... Уֿʽһ
+static void oled_blit(u8 x,u8 y,const u8 *bmp,u8 w,u8 pages,u8 mode)
+{
+	u8 i,n,page,dat;
+	for(n=0;n<pages;n++)
+	{
+		page=y/8+n;
+		if(page>=8)return;
+		for(i=0;i<w&&x+i<144;i++)
+		{
+			dat=*bmp++;
+			oled_put(x+i,page,mode?dat:~dat);
+		}
+	}
+}
+
+#if OLED_HW_I2C
+#define OLED_I2C_TIMEOUT  20000
+
+//ѯʽһδ䣬ʼʹ
+static void oled_i2c_write(const u8 *buf,u16 len)
+{
+	u32 t;
+	u16 i;
+	while(oled_busy);//Ⱥ̨ˢ½
+	for(t=OLED_I2C_TIMEOUT;I2C_GetFlagStatus(I2C1,I2C_FLAG_BUSY)&&t;t--);
+	I2C_GenerateSTART(I2C1,ENABLE);
+	for(t=OLED_I2C_TIMEOUT;!I2C_CheckEvent(I2C1,I2C_EVENT_MASTER_MODE_SELECT);)
+		if(--t==0)goto stop;
+	I2C_Send7bitAddress(I2C1,0x78,I2C_Direction_Transmitter);
+	for(t=OLED_I2C_TIMEOUT;!I2C_CheckEvent(I2C1,I2C_EVENT_MASTER_TRANSMITTER_MODE_SELECTED);)
+		if(--t==0)goto stop;
+	for(i=0;i<len;i++)
+	{
+		I2C_SendData(I2C1,buf[i]);
+		for(t=OLED_I2C_TIMEOUT;!I2C_CheckEvent(I2C1,I2C_EVENT_MASTER_BYTE_TRANSMITTED);)
+			if(--t==0)goto stop;
+	}
+stop:
+	I2C_GenerateSTOP(I2C1,ENABLE);
+	I2C_ClearFlag(I2C1,I2C_FLAG_AF);//Ӧ(δ)ʱ
+}
+
+//е txq_pos Ĵ䣺װ DMA  STARTж
+static void oled_txq_start(void)
+{
+	DMA1_Channel6->CCR&=~DMA_CCR6_EN;
+	DMA1_Channel6->CMAR=(u32)txq[txq_pos];
+	DMA1_Channel6->CNDTR=txq_len[txq_pos];
+	DMA1_Channel6->CCR|=DMA_CCR6_EN;
+	I2C1->CR1|=I2C_CR1_START;
+}
+
+//з꣺صжϺ DMA ѯʽ oled_i2c_write Ųᱻжϴ
+static void oled_txq_done(void)
+{
+	I2C1->CR2&=~(I2C_CR2_DMAEN|I2C_CR2_ITEVTEN|I2C_CR2_ITERREN);
+	oled_busy=0;
+}
+
+//ǰҳϣ STOP ʼһҳ
+static void oled_txq_next(void)
+{
+	u16 t;
+	I2C1->CR1|=I2C_CR1_STOP;
+	DMA1_Channel6->CCR&=~DMA_CCR6_EN;
+	for(t=1000;(I2C1->CR1&I2C_CR1_STOP)&&t;t--);//STOP ڼ΢Ӳ
+	if(++txq_pos<txq_cnt)
+		oled_txq_start();
+	else
+		oled_txq_done();
+}
+
+//SB:ַ  ADDR:־ DMA ӹ  BTF:DMA һֽƳ
+void I2C1_EV_IRQHandler(void)
+{
+	u16 sr1=I2C1->SR1;
+	if(sr1&I2C_SR1_SB)
+		I2C1->DR=0x78;
+	else if(sr1&I2C_SR1_ADDR)
+		(void)I2C1->SR2;
+	else if(sr1&I2C_SR1_BTF)
+		oled_txq_next();
+}
+
+//Ӧȴ󣺷ˢ£ȫ࣬´ط
+void I2C1_ER_IRQHandler(void)
+{
+	I2C1->SR1=0;
+	I2C1->CR1|=I2C_CR1_STOP;
+	DMA1_Channel6->CCR&=~DMA_CCR6_EN;
+	oled_mark_all();
+	oled_txq_done();
+}
+
+static void oled_i2c_init(void)
+{
+	GPIO_InitTypeDef GPIO_InitStructure;
+	I2C_InitTypeDef I2C_InitStructure;
+	DMA_InitTypeDef DMA_InitStructure;
+	NVIC_InitTypeDef NVIC_InitStructure;
+	
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOB,ENABLE);
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_I2C1,ENABLE);
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1,ENABLE);
+	
+	GPIO_InitStructure.GPIO_Pin=GPIO_Pin_6|GPIO_Pin_7;//PB6 SCL,PB7 SDA
+	GPIO_InitStructure.GPIO_Mode=GPIO_Mode_AF_OD;
+	GPIO_InitStructure.GPIO_Speed=GPIO_Speed_50MHz;
+	GPIO_Init(GPIOB,&GPIO_InitStructure);
+	
+	I2C_DeInit(I2C1);
+	I2C_InitStructure.I2C_Mode=I2C_Mode_I2C;
+	I2C_InitStructure.I2C_DutyCycle=I2C_DutyCycle_2;
+	I2C_InitStructure.I2C_OwnAddress1=0;
+	I2C_InitStructure.I2C_Ack=I2C_Ack_Enable;
+	I2C_InitStructure.I2C_AcknowledgedAddress=I2C_AcknowledgedAddress_7bit;
+	I2C_InitStructure.I2C_ClockSpeed=OLED_I2C_SPEED;
+	I2C_Init(I2C1,&I2C_InitStructure);
+	I2C_Cmd(I2C1,ENABLE);
+	
+	//DMA1_Channel6 = I2C1_TX
+	DMA_DeInit(DMA1_Channel6);
+	DMA_InitStructure.DMA_PeripheralBaseAddr=(u32)&I2C1->DR;
+	DMA_InitStructure.DMA_MemoryBaseAddr=(u32)txq[0];
+	DMA_InitStructure.DMA_DIR=DMA_DIR_PeripheralDST;
+	DMA_InitStructure.DMA_BufferSize=0;
+	DMA_InitStructure.DMA_PeripheralInc=DMA_PeripheralInc_Disable;
+	DMA_InitStructure.DMA_MemoryInc=DMA_MemoryInc_Enable;
+	DMA_InitStructure.DMA_PeripheralDataSize=DMA_PeripheralDataSize_Byte;
+	DMA_InitStructure.DMA_MemoryDataSize=DMA_MemoryDataSize_Byte;
+	DMA_InitStructure.DMA_Mode=DMA_Mode_Normal;
+	DMA_InitStructure.DMA_Priority=DMA_Priority_Low;
+	DMA_InitStructure.DMA_M2M=DMA_M2M_Disable;
+	DMA_Init(DMA1_Channel6,&DMA_InitStructure);
+	
+	//ʾȼͣжֻÿҳֹ
+	NVIC_InitStructure.NVIC_IRQChannel=I2C1_EV_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority=3;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority=0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd=ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+	NVIC_InitStructure.NVIC_IRQChannel=I2C1_ER_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority=1;
+	NVIC_Init(&NVIC_InitStructure);
+}
+#endif
+
+u8 OLED_Busy(void)
+{
+	return oled_busy;
+}
+
 //Ժ
 void OLED_ColorTurn(u8 i)
 {
@@ -99,6 +293,13 @@ void Send_Byte(u8 dat)
 //mode:/־ 0,ʾ;1,ʾ;
 void OLED_WR_Byte(u8 dat,u8 mode)
 {
+#if OLED_HW_I2C
+	u8 buf[2];
+	buf[0]=mode?0x40:0x00;
+	buf[1]=dat;
+	oled_i2c_write(buf,2);
+	return;
+#endif
 	I2C_Start();
 	Send_Byte(0x78);
 	I2C_WaitAck();
@@ -127,26 +328,51 @@ void OLED_DisPlay_Off(void)
 }
 
 //Դ浽OLED	
+//ֻϴˢиĶҳзΧ
+//Ӳ I2C ʱѸҳݸƵͶкأһδ򱾴()
 void OLED_Refresh(void)
 {
-	u8 i,n;
-	for(i=0;i<8;i++)
+	u8 p,x,x0,x1,col;
+	u8 *q;
+	if(oled_busy)return;
+	txq_cnt=0;
+	for(p=0;p<8;p++)
+	{
+		x0=dirty_x0[p];
+		x1=dirty_x1[p];
+		if(x0>=x1)continue;
+		dirty_x0[p]=0xFF;
+		dirty_x1[p]=0;
+		col=x0+OLED_COL_OFFSET;
+		q=txq[txq_cnt];
+		*q++=0x80;*q++=0xB0+p;			//ҳַ
+		*q++=0x80;*q++=col&0x0F;		//е4λ
+		*q++=0x80;*q++=0x10|(col>>4);	//и4λ
+		*q++=0x40;						//ȫ
+		for(x=x0;x<x1;x++)*q++=OLED_GRAM[x][p];
+		txq_len[txq_cnt]=OLED_TXQ_HDR+x1-x0;
+		txq_cnt++;
+	}
+	if(txq_cnt==0)return;
+#if OLED_HW_I2C
+	oled_busy=1;
+	txq_pos=0;
+	I2C1->CR2|=I2C_CR2_DMAEN|I2C_CR2_ITEVTEN|I2C_CR2_ITERREN;
+	oled_txq_start();
+#else
+	for(p=0;p<txq_cnt;p++)
 	{
-		OLED_WR_Byte(0xb0+i,OLED_CMD); //ʼַ
-		OLED_WR_Byte(0x02,OLED_CMD);   //õʼַ
-		OLED_WR_Byte(0x10,OLED_CMD);   //øʼַ
 		I2C_Start();
 		Send_Byte(0x78);
 		I2C_WaitAck();
-		Send_Byte(0x40);
-		I2C_WaitAck();
-		for(n=0;n<128;n++)
+		for(x=0;x<txq_len[p];x++)
 		{
-			Send_Byte(OLED_GRAM[n][i]);
+			Send_Byte(txq[p][x]);
 			I2C_WaitAck();
 		}
 		I2C_Stop();
-  }
+	}
+#endif
 }
 //
 void OLED_Clear(void)
@@ -159,6 +385,7 @@ void OLED_Clear(void)
 			 OLED_GRAM[n][i]=0;//
 			}
   }
+	oled_mark_all();
 	OLED_Refresh();//ʾ
 }
 
@@ -169,16 +396,12 @@ void OLED_Clear(void)
 void OLED_DrawPoint(u8 x,u8 y,u8 t)
 {
 	u8 i,m,n;
+	if(x>=144||y>=64)return;
 	i=y/8;
 	m=y%8;
 	n=1<<m;
-	if(t){OLED_GRAM[x][i]|=n;}
-	else
-	{
-		OLED_GRAM[x][i]=~OLED_GRAM[x][i];
-		OLED_GRAM[x][i]|=n;
-		OLED_GRAM[x][i]=~OLED_GRAM[x][i];
-	}
+	if(t)oled_put(x,i,OLED_GRAM[x][i]|n);
+	else oled_put(x,i,OLED_GRAM[x][i]&~n);
 }
 
 //
@@ -261,6 +484,14 @@ void OLED_ShowChar(u8 x,u8 y,u8 chr,u8 size1,u8 mode)
 	if(size1==8)size2=6;
 	else size2=(size1/8+((size1%8)?1:0))*(size1/2);  //õһַӦռֽ
 	chr1=chr-' ';  //ƫƺֵ
+	if(y%8==0)//ҳʱֽд룬㻭
+	{
+		if(size1==8)oled_blit(x,y,asc2_0806[chr1],6,1,mode);
+		else if(size1==12)oled_blit(x,y,asc2_1206[chr1],6,2,mode);
+		else if(size1==16)oled_blit(x,y,asc2_1608[chr1],8,2,mode);
+		else if(size1==24)oled_blit(x,y,asc2_2412[chr1],12,3,mode);
+		return;
+	}
 	for(i=0;i<size2;i++)
 	{
 		if(size1==8)
@@ -347,6 +578,14 @@ void OLED_ShowChinese(u8 x,u8 y,u8 num,u8 size1,u8 mode)
 	u8 m,temp;
 	u8 x0=x,y0=y;
 	u16 i,size3=(size1/8+((size1%8)?1:0))*size1;  //õһַӦռֽ
+	if(y%8==0)//ҳʱֽд
+	{
+		if(size1==16)oled_blit(x,y,Hzk1[num],16,2,mode);
+		else if(size1==24)oled_blit(x,y,Hzk2[num],24,3,mode);
+		else if(size1==32)oled_blit(x,y,Hzk3[num],32,4,mode);
+		else if(size1==64)oled_blit(x,y,Hzk4[num],64,8,mode);
+		return;
+	}
 	for(i=0;i<size3;i++)
 	{
 		if(size1==16)
@@ -396,6 +635,7 @@ void OLED_ScrollDisplay(u8 num,u8 space,u8 mode)
 								OLED_GRAM[i-1][n]=OLED_GRAM[i][n];
 							}
 						}
+           oled_mark_all();
            OLED_Refresh();
 				 }
         t=0;
@@ -409,6 +649,7 @@ void OLED_ScrollDisplay(u8 num,u8 space,u8 mode)
 				OLED_GRAM[i-1][n]=OLED_GRAM[i][n];
 			}
 		}
+		oled_mark_all();
 		OLED_Refresh();
 	}
 }
@@ -423,6 +664,11 @@ void OLED_ShowPicture(u8 x,u8 y,u8 sizex,u8 sizey,u8 BMP[],u8 mode)
 	u8 i,n,temp,m;
 	u8 x0=x,y0=y;
 	sizey=sizey/8+((sizey%8)?1:0);
+	if(y%8==0)//ҳʱֽд
+	{
+		oled_blit(x,y,BMP,sizex,sizey,mode);
+		return;
+	}
 	for(n=0;n<sizey;n++)
 	{
 		 for(i=0;i<sizex;i++)
@@ -450,12 +696,16 @@ void OLED_ShowPicture(u8 x,u8 y,u8 sizex,u8 sizey,u8 BMP[],u8 mode)
 void OLED_Init(void)
 {
 	GPIO_InitTypeDef  GPIO_InitStructure;
+#if OLED_HW_I2C
+	oled_i2c_init();
+#else
  	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOB, ENABLE);	 //ʹA˿ʱ
 	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_11|GPIO_Pin_12;	 
  	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_Out_OD; 		 //
 	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;//ٶ50MHz
  	GPIO_Init(GPIOB, &GPIO_InitStructure);	  //ʼPA0,1
  	GPIO_SetBits(GPIOB,GPIO_Pin_11|GPIO_Pin_12);
+#endif
 
 	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_2;	 
  	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_Out_PP; 		 //
@@ -556,17 +806,30 @@ void OLED_Init(void)
 //	OLED_Set_Pos(0,0); 
 }
 
+//ʾʽ "+a.bbbbbb V"סÿַλһλַֻػ仯λ
 void OLED_ShowDianya(unsigned long dat)
 {
-	uint32_t a,b;
-	a = dat/1000000;
+	static u8 shown[9];//ַλõǰʾַ0 ʾδ
+	u8 str[9];
+	u8 i;
+	uint32_t b;
+	str[0] = (PoolFlag == 1) ? '-' : '+';
+	str[1] = '0'+(dat/1000000)%10;
+	str[2] = '.';
 	b = dat%1000000;
-	if(PoolFlag == 1)
-		OLED_ShowChar(0,40,'-',16,1);
-	else OLED_ShowChar(0,40,'+',16,1);
-	OLED_ShowNum(8,40,a,1,16,1);
-	OLED_ShowChar(16,40,'.',16,1);
-	OLED_ShowNum(24,40,b,6,16,1);
+	for(i=8;i>=3;i--)
+	{
+		str[i] = '0'+b%10;
+		b /= 10;
+	}
+	for(i=0;i<9;i++)
+	{
+		if(str[i] != shown[i])
+		{
+			OLED_ShowChar(i*8,40,str[i],16,1);
+			shown[i] = str[i];
+		}
+	}
 	OLED_ShowChar(78,40,'V',16,1);
 }
 
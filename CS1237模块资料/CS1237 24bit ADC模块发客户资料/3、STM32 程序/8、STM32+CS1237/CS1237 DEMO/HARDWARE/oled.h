@@ -5,6 +5,15 @@
 #include "stdlib.h"	
 
 //-----------------OLED˿ڶ---------------- 
+//OLED_HW_I2C=0Ĭϣʾԭ PB11(SCL)/PB12(SDA) ģ I2Cͬˢ
+//OLED_HW_I2C=1Ӳ I2C1 + DMA1_Channel6 첽ˢ£SCL  PB6SDA  PB7
+//              PB11/PB12 Ӳ I2C ţҪߣPB6/PB7  LED_Init 
+#ifndef OLED_HW_I2C
+#define OLED_HW_I2C      0
+#endif
+#define OLED_I2C_SPEED   400000	//Ӳ I2C ʱ(Hz)
+#define OLED_COL_OFFSET  2		//SH1106 Ϊ 132 Уʾӵ 2 пʼ
+
 
 #define OLED_SDA_Clr() GPIO_ResetBits(GPIOB,GPIO_Pin_12)//SCL
 #define OLED_SDA_Set() GPIO_SetBits(GPIOB,GPIO_Pin_12)
@@ -29,7 +38,8 @@ void Send_Byte(u8 dat);
 void OLED_WR_Byte(u8 dat,u8 mode);
 void OLED_DisPlay_On(void);
 void OLED_DisPlay_Off(void);
-void OLED_Refresh(void);
+void OLED_Refresh(void);//ֻ͸ĶӲ I2C ʱأж+DMA ں̨
+u8   OLED_Busy(void);//̨ˢǷڽ
 void OLED_Clear(void);
 void OLED_DrawPoint(u8 x,u8 y,u8 t);
 void OLED_DrawLine(u8 x1,u8 y1,u8 x2,u8 y2,u8 mode);
@@ -54,17 +54,21 @@ void I2CStart(void) //1637 
 }
 
 ///=============================================
-void I2Cask(void) //1637 Ӧ
+u8 I2Cask(void) //1637 Ӧ𣬷 1 ʾյӦ
 {
+	u8 t=100,ack;
 	TM1637_CLK_L;//clk = 0;
 	delay_us(5); //ڵڰ˸ʱ½֮ʱ5usʼжACK ź
 	TM1637_DIO_SetInput();////while(dio);
-	while(GPIO_ReadInputDataBit(GPIOB,GPIO_Pin_14));
+	while(GPIO_ReadInputDataBit(GPIOB,GPIO_Pin_14)&&--t)//ģδʱ
+		delay_us(1);
+	ack=(t!=0);
 	TM1637_CLK_H;//clk = 1;
 	delay_us(2);
 	TM1637_CLK_L;//clk=0;
 	
 	TM1637_DIO_SetOutput();
+	return ack;
 }
 
 ///========================================
@@ -165,45 +169,119 @@ void SmgDisplay(void) //д
 	I2CStop();
 }
 
-void TM1637_SHOW(unsigned long dat)
+//----------------------------------------------------------------------------------
+// ˢ
+// want[] ΪӦʾĶ룬dirty ĵ i λʾ i λҪд
+// ÿ TM1637_Tick ֻһ£Ϊһ START..STOP 䣩
+//   1. ù̶ַģʽ 0x44ϵͨѶ
+//   2. ʾ TM1637_DISPLAY_CTRL
+//   3. дһб仯λ[0xC0+λַ][]
+//----------------------------------------------------------------------------------
+#define TM_STATE_MODE  0
+#define TM_STATE_CTRL  1
+#define TM_STATE_RUN   2
+
+static u8 want[TM1637_DIGITS];
+static u8 dirty;
+static u8 tm_state=TM_STATE_MODE;
+static u8 pending;//ֵȴ
+static unsigned long pending_val;
+static u32 last_apply;
+
+//һߴ䣺STARTֽڡSTOPȫӦ𷵻 1
+static u8 tm_transfer(const u8 *dat,u8 len)
 {
-	unsigned char a,b,c,d,e,f;
-	unsigned long tem;
-	
-	tem = dat/10;
-	
-	a = tem%1000000/100000;
-	b = tem%100000/10000;
-	c = tem%10000/1000;
-	d = tem%1000/100;
-	e = tem%100/10;
-	f = tem%10;
-	
+	u8 i,ok=1;
 	I2CStart();
-	I2CWrByte(0x40); // 40H ַԶ1 ģʽ,44H ̶ַģʽ,Լ1 ģʽ
-	I2Cask();
+	for(i=0;i<len;i++)
+	{
+		I2CWrByte(dat[i]);
+		ok&=I2Cask();
+	}
 	I2CStop();
-	I2CStart();
-	I2CWrByte(0xc0); //׵ַ
-	I2Cask();
-	I2CWrByte(table1[a]); //
-	I2Cask();
-	I2CWrByte(table[b]); //
-	I2Cask();
-	I2CWrByte(table[c]); //
-	I2Cask();
-	I2CWrByte(table[d]); //
-	I2Cask();
-	I2CWrByte(table[e]); //
-	I2Cask();
-	I2CWrByte(table[f]); //
-	I2Cask();
+	return ok;
+}
+
+void TM1637_Init(void)
+{
+	GPIO_InitTypeDef  GPIO_InitStructure;
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOB, ENABLE);
+	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_14|GPIO_Pin_15;	//PB14 DIO,PB15 CLK
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_Out_PP;
+	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_Init(GPIOB, &GPIO_InitStructure);
+	TM1637_CLK_H;
+	TM1637_DIO_H;
+	tm_state = TM_STATE_MODE;
+	dirty = (1<<TM1637_DIGITS)-1;//ϵδ֪ȫдһ
+	pending = 0;
+	last_apply = delay_millis()-TM1637_MIN_UPDATE_MS;
+}
+
+void TM1637_SHOW(unsigned long dat)
+{
+	pending_val = dat;
+	pending = 1;
+}
+
+//ֵɶ룬¼仯λλuVʾ a.bcdef VλС㣩
+static void tm_apply(unsigned long dat)
+{
+	u8 i,seg;
+	unsigned long tem = dat/10;
+	for(i=TM1637_DIGITS;i>0;i--)
+	{
+		seg = (i==1) ? table1[tem%10] : table[tem%10];
+		if(want[i-1] != seg)
+		{
+			want[i-1] = seg;
+			dirty |= 1<<(i-1);
+		}
+		tem /= 10;
+	}
+}
+
+void TM1637_Tick(void)
+{
+	u8 buf[2];
+	u8 i;
+	u32 now = delay_millis();
 	
-	I2CStop();
-	I2CStart();
-	I2CWrByte(0x8A); //ʾ  8ȿɵ
-	I2Cask();
-	I2CStop();
+	if(pending && now-last_apply >= TM1637_MIN_UPDATE_MS)
+	{
+		pending = 0;
+		last_apply = now;
+		tm_apply(pending_val);
+	}
+	
+	if(tm_state == TM_STATE_MODE)
+	{
+		buf[0] = 0x44;//̶ַģʽԵдĳһλ
+		if(tm_transfer(buf,1))
+			tm_state = TM_STATE_CTRL;
+		return;
+	}
+	if(tm_state == TM_STATE_CTRL)
+	{
+		buf[0] = TM1637_DISPLAY_CTRL;
+		tm_state = tm_transfer(buf,1) ? TM_STATE_RUN : TM_STATE_MODE;
+		return;
+	}
+	if(dirty == 0)
+		return;//ûб仯
+	for(i=0;i<TM1637_DIGITS;i++)
+		if(dirty & (1<<i))
+			break;
+	buf[0] = 0xC0+i;
+	buf[1] = want[i];
+	if(tm_transfer(buf,2))
+		dirty &= ~(1<<i);
+	else
+	{
+		//Ӧģܶϵϣģʽȫд
+		tm_state = TM_STATE_MODE;
+		dirty = (1<<TM1637_DIGITS)-1;
+	}
 }
 ///==============================================
 //void init() //ʼӳ
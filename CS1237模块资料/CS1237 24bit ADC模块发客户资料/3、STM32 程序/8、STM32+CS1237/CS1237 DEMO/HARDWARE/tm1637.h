@@ -14,7 +14,18 @@ void SmgDisplay(void); //д
 
 void SmgDisplay(void); //дʾĴ
 
-void TM1637_SHOW(unsigned long dat);
+void TM1637_SHOW(unsigned long dat);//ֻ¼Ҫʾֵ(λuV) TM1637_Tick ں̨д
+
+//----------------------------------------------------------------------------------
+// ˢ£TM1637_Tick ɶʱڵãÿһߴ
+// (һ START..STOP)ֻдб仯λֵˢٶۿɶΧ
+//----------------------------------------------------------------------------------
+#define TM1637_DIGITS        6		//λ
+#define TM1637_MIN_UPDATE_MS 250	//λ̼֮(ms)
+#define TM1637_DISPLAY_CTRL  0x8A	//ʾ 8 еĵ 3 
+
+void TM1637_Init(void);
+void TM1637_Tick(void);
 
 #endif
 
@@ -41,6 +41,9 @@
 //UCOSIII֧ʱ2bug
 //delay_tickspersecΪdelay_ostickspersec
 //delay_intnestingΪdelay_osintnesting
+//V1.9޸˵
+//OSʱSysTickΪ1msж(delay_millis),SYSTEM/schedʹ.
+//delay_us/delay_msΪSysTickۼӵķʽ,ٸдLOAD,жϹ.
 //////////////////////////////////////////////////////////////////////////////////  
 
 static u8  fac_us=0;							//usʱ			   
@@ -144,6 +147,10 @@ void delay_init()
 
 #else
 	fac_ms=(u16)fac_us*1000;					//OS,ÿmsҪsystickʱ   
+	SysTick->LOAD=fac_ms-1;						//1msһ
+	SysTick->VAL=0;
+	SysTick->CTRL|=SysTick_CTRL_TICKINT_Msk;   	//SYSTICKж
+	SysTick->CTRL|=SysTick_CTRL_ENABLE_Msk;   	//SYSTICK    
 #endif
 }								    
 
@@ -187,39 +194,47 @@ void delay_ms(u16 nms)
 	delay_us((u32)(nms*1000));					//ͨʽʱ  
 }
 #else //OSʱ
+static volatile u32 sys_ms=0;					//SysTick 1msļ
+
+//systickжϷ,OSʱΪ1ms
+void SysTick_Handler(void)
+{
+	sys_ms++;
+}
+
+//ϵĺ(Լ49.7,Ƚʱòֵ)
+u32 delay_millis(void)
+{
+	return sys_ms;
+}
+
 //ʱnus
-//nusΪҪʱus.		    								   
+//nusΪҪʱus.
+//SysTickһֱ1ms,ֵֻۼ,Ӱ,жҲȫ
 void delay_us(u32 nus)
 {		
-	u32 temp;	    	 
-	SysTick->LOAD=nus*fac_us; 					//ʱ	  		 
-	SysTick->VAL=0x00;        					//ռ
-	SysTick->CTRL|=SysTick_CTRL_ENABLE_Msk ;	//ʼ	  
-	do
+	u32 ticks;
+	u32 told,tnow,tcnt=0;
+	u32 reload=SysTick->LOAD;					//LOADֵ	    	 
+	ticks=nus*fac_us; 							//ҪĽ	  		 
+	told=SysTick->VAL;        					//սʱļֵ
+	while(1)
 	{
-		temp=SysTick->CTRL;
-	}while((temp&0x01)&&!(temp&(1<<16)));		//ȴʱ䵽   
-	SysTick->CTRL&=~SysTick_CTRL_ENABLE_Msk;	//رռ
-	SysTick->VAL =0X00;      					 //ռ	 
+		tnow=SysTick->VAL;	
+		if(tnow!=told)
+		{	    
+			if(tnow<told)tcnt+=told-tnow;		//SYSTICKһݼļ
+			else tcnt+=reload-tnow+told;	    
+			told=tnow;
+			if(tcnt>=ticks)break;				//ʱ䳬/Ҫӳٵʱ,˳.
+		}  
+	};
 }
 //ʱnms
-//עnmsķΧ
-//SysTick->LOADΪ24λĴ,,ʱΪ:
-//nms<=0xffffff*8*1000/SYSCLK
-//SYSCLKλΪHz,nmsλΪms
-//72M,nms<=1864 
+//nms:Ҫʱms
 void delay_ms(u16 nms)
 {	 		  	  
-	u32 temp;		   
-	SysTick->LOAD=(u32)nms*fac_ms;				//ʱ(SysTick->LOADΪ24bit)
-	SysTick->VAL =0x00;							//ռ
-	SysTick->CTRL|=SysTick_CTRL_ENABLE_Msk ;	//ʼ  
-	do
-	{
-		temp=SysTick->CTRL;
-	}while((temp&0x01)&&!(temp&(1<<16)));		//ȴʱ䵽   
-	SysTick->CTRL&=~SysTick_CTRL_ENABLE_Msk;	//رռ
-	SysTick->VAL =0X00;       					//ռ	  	    
+	delay_us((u32)nms*1000);
 } 
 #endif 
 
@@ -38,11 +38,16 @@
 //UCOSIII֧ʱ2bug
 //delay_tickspersecΪdelay_ostickspersec
 //delay_intnestingΪdelay_osintnesting
+//V1.9޸˵
+//OSʱSysTickΪ1msж(delay_millis),SYSTEM/schedʹ.
 ////////////////////////////////////////////////////////////////////////////////// 
 	 
 void delay_init(void);
 void delay_ms(u16 nms);
 void delay_us(u32 nus);
+#if SYSTEM_SUPPORT_OS==0
+u32 delay_millis(void);			//ϵĺ
+#endif
 
 #endif
 
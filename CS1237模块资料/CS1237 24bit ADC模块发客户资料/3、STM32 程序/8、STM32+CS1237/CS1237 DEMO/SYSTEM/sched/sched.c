@@ -0,0 +1,55 @@
+#include "sched.h"
+#include "delay.h"
+
+typedef struct
+{
+	sched_task_fn fn;
+	u16 period;			//(ms)
+	u16 max_run;		//һִʱ(ms)
+	u32 next;			//´ʱ(delay_millis)
+}sched_task_t;
+
+static sched_task_t tasks[SCHED_MAX_TASKS];
+static u8 task_num=0;
+
+u8 Sched_Add(sched_task_fn fn,u16 period_ms,u16 offset_ms)
+{
+	if(task_num>=SCHED_MAX_TASKS||period_ms==0)return 0xFF;
+	tasks[task_num].fn=fn;
+	tasks[task_num].period=period_ms;
+	tasks[task_num].max_run=0;
+	tasks[task_num].next=delay_millis()+offset_ms;
+	return task_num++;
+}
+
+u16 Sched_MaxRunMs(u8 id)
+{
+	return id<task_num?tasks[id].max_run:0;
+}
+
+void Sched_Run(void)
+{
+	u8 i,ran;
+	u32 now,start;
+	sched_task_t *t;
+	
+	while(1)
+	{
+		ran=0;
+		for(i=0;i<task_num;i++)
+		{
+			t=&tasks[i];
+			now=delay_millis();
+			if((s32)(now-t->next)<0)continue;	//δ(òֵȽ,Ҳȷ)
+			t->next+=t->period;
+			if((s32)(now-t->next)>=0)			//󳬹һ,,¼
+				t->next=now+t->period;
+			start=now;
+			t->fn();
+			now=delay_millis()-start;
+			if(now>t->max_run)t->max_run=now>0xFFFF?0xFFFF:now;
+			ran=1;
+		}
+		if(!ran)__WFI();						//û,˯һж
+	}
+}
@@ -0,0 +1,22 @@
+#ifndef __SCHED_H
+#define __SCHED_H
+#include "sys.h"
+//////////////////////////////////////////////////////////////////////////////////
+//SysTick 1msĵЭʽ
+//ÿ񰴸,ܿ췵(ܵóʱ),
+//ûʱCPUWFI˯,һж(Ļɼ/DMA).
+//////////////////////////////////////////////////////////////////////////////////
+
+#define SCHED_MAX_TASKS		8		//
+
+typedef void (*sched_task_fn)(void);
+
+//:period_msΪ,offset_msΪ״ڵӳ()
+//ɹ,0xFF
+u8 Sched_Add(sched_task_fn fn,u16 period_ms,u16 offset_ms);
+//ѭ,
+void Sched_Run(void);
+//һִʱ(ms),ڼĸռù
+u16 Sched_MaxRunMs(u8 id);
+
+#endif
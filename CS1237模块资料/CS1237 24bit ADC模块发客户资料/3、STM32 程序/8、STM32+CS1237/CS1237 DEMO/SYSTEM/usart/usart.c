@@ -49,11 +49,19 @@ _sys_exit(int x)
 { 
 	x = x; 
 } 
+static u8 tx_dma_ready=0;	//USART1_DMA_Init ֮ printf Ҳ DMA 
 //ضfputc 
 int fputc(int ch, FILE *f)
 {      
+	u8 c = (u8)ch;
+	if(tx_dma_ready)
+	{
+		USART1_Write(&c,1);//ȴͣ֡û壬֡м
+		if(c=='\n')USART1_Flush();
+		return ch;
+	}
 	while((USART1->SR&0X40)==0);//ѭ,ֱ   
-    USART1->DR = (u8) ch;      
+    USART1->DR = c;      
 	return ch;
 }
 #endif 
@@ -85,6 +93,19 @@ u8 USART_RX_BUF[USART_REC_LEN];     //
 //bit14	յ0x0d
 //bit13~0	յЧֽĿ
 u16 USART_RX_STA=0;       //״̬	  
+//ͬʱÿֽڷŽλ壬 Frame_Poll ֡
+//ܳ 0x0dܿİнգ
+static u8 rx_ring[USART_RX_RING_LEN];
+static volatile u8 rx_head=0,rx_tail=0;
+
+u8 USART1_Read(u8 *c)
+{
+	if(rx_tail == rx_head)
+		return 0;
+	*c = rx_ring[rx_tail];
+	rx_tail = (rx_tail+1)&(USART_RX_RING_LEN-1);
+	return 1;
+}
   
 void uart_init(u32 bound){
   //GPIO˿
@@ -135,6 +156,11 @@ void USART1_IRQHandler(void)                	//
 	if(USART_GetITStatus(USART1, USART_IT_RXNE) != RESET)  //ж(յݱ0x0d 0x0aβ)
 		{
 		Res =USART_ReceiveData(USART1);	//ȡյ
+		if(((rx_head+1)&(USART_RX_RING_LEN-1)) != rx_tail)
+		{
+			rx_ring[rx_head] = Res;
+			rx_head = (rx_head+1)&(USART_RX_RING_LEN-1);
+		}
 		
 		if((USART_RX_STA&0x8000)==0)//δ
 			{
@@ -161,3 +187,137 @@ void USART1_IRQHandler(void)                	//
 } 
 #endif	
 
+//////////////////////////////////////////////////////////////////
+//DMA ˫巢
+//tx_buf[tx_fill]  CPU ׷ӣһ tx_busy ʱ DMA1_Channel4 ͡
+//DMA жݣŷͣ·С
+volatile u32 USART_TX_Dropped=0;
+static u8 tx_buf[2][USART_TX_BUF_LEN];
+static volatile u16 tx_len[2];
+static volatile u8 tx_fill=0;
+static volatile u8 tx_busy=0;
+
+// DMA 鲢ǰ뱣֤ DMA ǿ
+static void tx_kick(void)
+{
+	u8 idx = tx_fill;
+	DMA1_Channel4->CCR &= ~DMA_CCR4_EN;
+	DMA1_Channel4->CMAR = (u32)tx_buf[idx];
+	DMA1_Channel4->CNDTR = tx_len[idx];
+	tx_busy = 1;
+	tx_fill = idx^1;
+	tx_len[tx_fill] = 0;
+	DMA1_Channel4->CCR |= DMA_CCR4_EN;
+}
+
+void USART1_DMA_Init(void)
+{
+	DMA_InitTypeDef DMA_InitStructure;
+	NVIC_InitTypeDef NVIC_InitStructure;
+	
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+	DMA_DeInit(DMA1_Channel4);//DMA1_Channel4 = USART1_TX
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (u32)&USART1->DR;
+	DMA_InitStructure.DMA_MemoryBaseAddr = (u32)tx_buf[0];
+	DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;
+	DMA_InitStructure.DMA_BufferSize = 0;
+	DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
+	DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+	DMA_Init(DMA1_Channel4, &DMA_InitStructure);
+	DMA_ITConfig(DMA1_Channel4, DMA_IT_TC, ENABLE);
+	
+	NVIC_InitStructure.NVIC_IRQChannel = DMA1_Channel4_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 2;//ڲɼж
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+	
+	while((USART1->SR&0X40)==0);//ȴ printf ͵һֽ
+	tx_len[0] = tx_len[1] = 0;
+	tx_fill = 0;
+	tx_busy = 0;
+	USART_DMACmd(USART1, USART_DMAReq_Tx, ENABLE);
+	tx_dma_ready = 1;
+}
+
+u16 USART1_Write(const u8 *dat,u16 len)
+{
+	u16 i,n;
+	u8 *dst;
+	
+	//ʱرշжϣֹƹжϽ壻
+	//ڼλ TCIF ´򿪺ж
+	DMA1_Channel4->CCR &= ~DMA_CCR4_TCIE;
+	if(tx_len[tx_fill] + len > USART_TX_BUF_LEN && !tx_busy && tx_len[tx_fill])
+		tx_kick();//ǰŲ£DMA ֿУȰȥ
+	n = tx_len[tx_fill];
+	if(n + len > USART_TX_BUF_LEN)
+	{
+		USART_TX_Dropped += len;
+		len = 0;
+	}
+	else
+	{
+		dst = &tx_buf[tx_fill][n];
+		for(i=0;i<len;i++)
+			dst[i] = dat[i];
+		tx_len[tx_fill] = n + len;
+	}
+	DMA1_Channel4->CCR |= DMA_CCR4_TCIE;
+	return len;
+}
+
+u16 USART1_Free(void)
+{
+	//DMA ʱȷȥãж󽻻ֻÿռ
+	if(!tx_busy)
+		return USART_TX_BUF_LEN;
+	return USART_TX_BUF_LEN - tx_len[tx_fill];
+}
+
+void USART1_Flush(void)
+{
+	DMA1_Channel4->CCR &= ~DMA_CCR4_TCIE;
+	if(!tx_busy && tx_len[tx_fill])
+		tx_kick();
+	DMA1_Channel4->CCR |= DMA_CCR4_TCIE;
+}
+
+//׷ӵȫٸĲʣ򻺳֡ᰴ²ʷȥ
+void USART1_SetBaud(u32 bound)
+{
+	USART_InitTypeDef USART_InitStructure;
+	
+	USART1_Flush();
+	while(tx_busy || tx_len[tx_fill])
+	{
+		if(!tx_busy)
+			USART1_Flush();
+	}
+	while(USART_GetFlagStatus(USART1, USART_FLAG_TC) == RESET) {}
+	USART_Cmd(USART1, DISABLE);
+	USART_InitStructure.USART_BaudRate = bound;
+	USART_InitStructure.USART_WordLength = USART_WordLength_8b;
+	USART_InitStructure.USART_StopBits = USART_StopBits_1;
+	USART_InitStructure.USART_Parity = USART_Parity_No;
+	USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
+	USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx;
+	USART_Init(USART1, &USART_InitStructure);//ֻ CR1/CR2/BRR λжϺ DMA ʹܱ
+	USART_Cmd(USART1, ENABLE);
+}
+
+void DMA1_Channel4_IRQHandler(void)
+{
+	if(DMA_GetITStatus(DMA1_IT_TC4) != RESET)
+	{
+		DMA_ClearITPendingBit(DMA1_IT_GL4);
+		tx_busy = 0;
+		if(tx_len[tx_fill])
+			tx_kick();//һݣŷ
+	}
+}
@@ -31,8 +31,19 @@
 	  	
 extern u8  USART_RX_BUF[USART_REC_LEN]; //ջ,USART_REC_LENֽ.ĩֽΪз 
 extern u16 USART_RX_STA;         		//״̬	
+#define USART_RX_RING_LEN		64		//֡ջλ壬 2 
+u8 USART1_Read(u8 *c);					//ȡһֽڣûݷ 0
 //봮жϽգ벻Ҫעº궨
 void uart_init(u32 bound);
+
+//DMA ͣ黺ʹãCPU ֻһ׷ݣһ DMA1_Channel4 
+#define USART_TX_BUF_LEN		256		//ÿ鷢ͻֽ
+extern volatile u32 USART_TX_Dropped;	//ʱֽ
+void USART1_DMA_Init(void);
+u16  USART1_Write(const u8 *dat,u16 len);	//׷ӣŲζдֽ
+u16  USART1_Free(void);						//׷ʱŵµֽ붪֡ķͷȲ
+void USART1_Flush(void);					//DMA ʱ׷ӵ
+void USART1_SetBaud(u32 bound);				//껺еݺлʣ
 #endif
 
 
@@ -6,6 +6,16 @@
 #include "oled.h"
 #include "bmp.h"
 #include "cs1237.h"
+#include "frame.h"
+#include "bulk.h"
+#include "sched.h"
+
+#define STREAM_BATCH       32	//ÿ֡1280Hz ÿ 40 ֡
+#define STREAM_PERIOD_MS   5	//ȡ֡
+#define UART_PERIOD_MS     2	//ڷ
+#define DISPLAY_PERIOD_MS  200	//OLED/ˢ
+#define LED_PERIOD_MS      300	//ָʾƷת
+#define TM1637_PERIOD_MS   2	//߽ģÿһδ
  
 /************************************************
  ALIENTEKսSTM32ʵ1
@@ -16,53 +26,107 @@
  ӿƼ޹˾  
  ߣԭ @ALIENTEK
 ************************************************/
+
+static s32 disp_sum;	//ϴˢʾĲۼӣ 8 λ
+static u16 disp_count;
+static u16 batch_seq;
+
+// EXTI+TIM2+DMA ں̨ ODR Уѻλݰ
+static void task_stream(void)
+{
+	s32 samples[STREAM_BATCH];
+	u16 n,i;
+	
+	while(CS1237_Ring_Count() >= STREAM_BATCH)
+	{
+		n = CS1237_Ring_Read(samples, STREAM_BATCH);
+		Bulk_Feed(samples, n);
+		//ʱøݿ飬ճλ֪ûʵʱ
+		if(!Bulk_Busy())
+			Frame_SendBatch(batch_seq, samples, n);
+		batch_seq++;
+		for(i=0;i<n;i++)
+			disp_sum += samples[i] >> 8;//Ʒֹۼʾ㹻
+		disp_count += n;
+	}
+}
+
+static void task_uart(void)
+{
+	Frame_Poll();//λ֡λմȣ
+	Bulk_Poll();
+	USART1_Flush();
+}
+
+//ʾϴˢƽѹ
+static void task_display(void)
+{
+	float dianya;
+	
+	if(disp_count == 0)
+		return;
+	dianya = (float)disp_sum/disp_count*256*1.25/8388608;
+	disp_sum = 0;
+	disp_count = 0;
+	PoolFlag = dianya < 0;
+	if(PoolFlag)
+		dianya = -dianya;
+	TM1637_SHOW(dianya*1000000);
+	OLED_ShowDianya(dianya*1000000);
+	OLED_Refresh();
+}
+
+static void task_tm1637(void)
+{
+	TM1637_Tick();
+}
+
+static void task_led(void)
+{
+	LED0 = !LED0;
+}
+
  int main(void)
  {	
-	 unsigned int tempA;
-	 float dianya;
-	 
-	delay_init();	    //ʱʼ	  
+	NVIC_PriorityGroupConfig(NVIC_PriorityGroup_2);//2λռȼ2λӦȼ
+	delay_init();	    //ʱʼSysTick ʼ 1ms 
 	LED_Init();		  	//ʼLEDӵӲӿ
 	 uart_init(115200);
+	 USART1_DMA_Init();//֮󴮿 DMA ͣ
+	TM1637_Init();
 	 
 	OLED_Init();
 	OLED_ColorTurn(0);//0ʾ1 ɫʾ
 	OLED_DisplayTurn(0);//0ʾ 1 Ļתʾ
+	//̶ıֻһ
+	OLED_ShowChinese(0,0,0,16,1);//
+	OLED_ShowChinese(16,0,1,16,1);//
+	OLED_ShowChinese(32,0,2,16,1);//
+	OLED_ShowChinese(48,0,3,16,1);//
+	OLED_ShowChinese(64,0,4,16,1);//
+	OLED_ShowChinese(80,0,5,16,1);//
+	OLED_ShowChinese(10,18,6,16,1);//
+	OLED_ShowChinese(26,18,7,16,1);//
+	OLED_ShowChinese(42,18,8,16,1);//
+	OLED_ShowString(60,18,"CS1237",16,1);
+	OLED_Refresh();
+	
 	CS1237_GPIO_Init();
 	delay_ms(100);
 	Con_CS1237(RefOut_ON | SpeedSelct_1280HZ | PGA_1 | CH_A);//CS1237оƬ
-	while(1)
-	{
-		LED0=0;
-		delay_ms(300);	 //ʱ300ms
-		LED0=1;
-		delay_ms(300);	//ʱ300ms
-		
-		OLED_ShowChinese(0,0,0,16,1);//
-		OLED_ShowChinese(16,0,1,16,1);//
-		OLED_ShowChinese(32,0,2,16,1);//
-		OLED_ShowChinese(48,0,3,16,1);//
-		OLED_ShowChinese(64,0,4,16,1);//
-		OLED_ShowChinese(80,0,5,16,1);//
-		OLED_ShowChinese(10,18,6,16,1);//
-		OLED_ShowChinese(26,18,7,16,1);//0000
-		OLED_ShowChinese(42,18,8,16,1);//
-		OLED_ShowString(60,18,"CS1237",16,1);
-		OLED_Refresh();
-		
-//		CS1237ReadInterlTemp();  //ȡڲ¶
-		
-		tempA =  Read_CS1237();
-		dianya = tempA*1.25/8388608;
-		if(PoolFlag == 1)
-			printf("ѹ dianya=-%10f v\r\n",dianya);//unsigned long 04294967295
-		else
-			printf("ѹ dianya=+%10f v\r\n",dianya);//unsigned long 04294967295
-		TM1637_SHOW(dianya*1000000);
-		OLED_ShowDianya(dianya*1000000);
-		
-//		delay_ms(100);	
-	}
+//	CS1237ReadInterlTemp();  //ȡڲ¶ȣʽأ
+	Bulk_Init(3, 0);//һ£1280HzPGA=1
+	CS1237_Acq_Init();
+	CS1237_Acq_Start();//֮ EXTI+TIM2+DMA ں̨ɼ
+	Frame_SendHello();
+	
+	//Уʼʱ̴ͬһ
+	Sched_Add(task_stream, STREAM_PERIOD_MS, 0);
+	Sched_Add(task_uart, UART_PERIOD_MS, 1);
+	Sched_Add(task_display, DISPLAY_PERIOD_MS, 3);
+	Sched_Add(task_led, LED_PERIOD_MS, 4);
+	Sched_Add(task_tm1637, TM1637_PERIOD_MS, 0);
+	Sched_Run();
  }
 
 
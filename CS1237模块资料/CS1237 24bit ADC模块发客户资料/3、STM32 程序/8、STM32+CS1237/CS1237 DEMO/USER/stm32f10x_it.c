@@ -75,9 +75,7 @@ void PendSV_Handler(void)
 {
 }
  
-void SysTick_Handler(void)
-{
-}
+/* SysTick_Handler is implemented in SYSTEM/delay/delay.c (1 ms tick). */
 
 /******************************************************************************/
 /*                 STM32F10x Peripherals Interrupt Handlers                   */
@@ -22,6 +22,7 @@
 #define MAIN_Fosc		11059200L	//ʱ
 #define FOSC   11059200L  //ϵͳʱƵʣƵʡ12
 #define	BRT	   (256 - MAIN_Fosc / 115200 / 32)
+#define FRAME_DEVICE DEV_STC15	//֡е豸
 
 
 /* ͨͷļ */
@@ -31,6 +32,7 @@
 #include "delay.h"
 #include "uart.h"
 #include "cs1237.h"
+#include "frame.h"
 
 /* Ͷ */
 typedef  signed    char    int8;    // 8λз
@@ -1,6 +1,5 @@
 #include "cs1237.h"
 
-#define ADC_Bit  20 //ADCЧλλ 24λ
 #define SCK_1  SCLK = 1
 #define SCK_0  SCLK = 0
 #define DAT_1  DOUT = 1
@@ -12,6 +11,10 @@
 sbit DOUT = P1^0;//ݶӦIO
 sbit SCLK = P1^1;//ʱӶӦIO
 
+unsigned char CS1237_Config = CS_CON;
+unsigned long CS1237_Reads;
+bit CS1237_Timeout;
+
 //ʱ500US 25MHZ
 void delay_500us(unsigned char a)
 {	
@@ -34,7 +37,7 @@ void Con_CS1237(void)
 	unsigned char dat;
 	unsigned char count_i=0;//ʱ
 
-	dat = CS_CON;// 0100 1000
+	dat = CS1237_Config;// 0100 1000
 	SCLK = 0;//SCK_0;//ʱ
 	while(DOUT)//оƬ׼  ʱѾΪ0ҲҪCS1237ȫΪ0㶼׼
 	{
@@ -127,20 +130,23 @@ unsigned long Read_CS1237(void)
 {
 	unsigned char i;
 	unsigned long dat=0;//ȡ
-	unsigned char count_i=0;//ʱ
+	unsigned int count_i=0;//ʱԭ unsigned char Զ 300
 	DOUT = 1;//˿151ر
 	SCK_0;//ʱ
 	while(DOUT)//оƬ׼  ʱѾΪ0ҲҪCS1237Ϊ0㶼׼
 	{
-		delay_500us(10);
+		//̼ѯ1280Hz ʱһֻ 781usһε 5ms
+		Delay140us();
 		count_i++;
-		if(count_i > 300)
+		if(count_i > 10000)//Լ1.4s
 		{
 			SCK_1;
 			DAT_1;
+			CS1237_Timeout = 1;
 			return 0;//ʱֱ˳
 		}
 	}
+	CS1237_Timeout = 0;
 	DOUT = 1;//˿151ر
 	dat=0;
 	for(i=0;i<24;i++)//ȡ24λЧת
@@ -158,24 +164,8 @@ unsigned long Read_CS1237(void)
 		One_CLK;
 	}
 	DAT_1;
-	
-	Uart_send_hex_to_txt(dat>>16);
-	Uart_send_hex_to_txt(dat>>8);
-	Uart_send_hex_to_txt(dat);
-	
-	if((dat&0x800000) == 0x800000)	//λΪ1ʾΪֵ
-	{
-		dat = ~dat;
-		UartSend(0x2D);				// - 
-	}
-	else 
-		UartSend(0x2B);				//+  
-		
-	//ȸݺ궨ЧλһЩ
-//	i = 24 - ADC_Bit;//iʾҪλ
-//	dat >>= i;//λ
-	
-
+	CS1237_Reads++;
+	//ԭʼֱӷأ֡ڴӡʮı
 	return dat;
 }
 //
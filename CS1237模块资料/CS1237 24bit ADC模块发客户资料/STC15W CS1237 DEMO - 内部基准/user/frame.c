@@ -0,0 +1,305 @@
+#include "frame.h"
+
+unsigned int Frame_Dropped;
+
+static uint8 sum;	//ǰڷ֡У
+
+static void frame_begin(uint8 cmd,uint8 len)
+{
+	UartSend(FRAME_HEAD_1);
+	UartSend(FRAME_HEAD_2);
+	UartSend(len+1);
+	UartSend(cmd);
+	sum = (len+1) ^ cmd;
+}
+
+static void frame_put(uint8 dat)
+{
+	UartSend(dat);
+	sum ^= dat;
+}
+
+static void frame_end(void)
+{
+	UartSend(sum);
+	UartSend(FRAME_TAIL_1);
+	UartSend(FRAME_TAIL_2);
+}
+
+//ͻŵ֡ŷ֡òѭȴ
+static bit frame_room(uint8 len)
+{
+	if(UartTxFree() < len+7)
+	{
+		Frame_Dropped++;
+		return 0;
+	}
+	return 1;
+}
+
+bit Frame_Send(uint8 cmd,uint8 *dat,uint8 len)
+{
+	uint8 i;
+
+	if(!frame_room(len))
+		return 0;
+	frame_begin(cmd,len);
+	for(i=0;i<len;i++)
+		frame_put(dat[i]);
+	frame_end();
+	return 1;
+}
+
+//----------------------------------------------------------------------------------
+// Чλλλ趨ص 16~20 λͬ¿ɶഫ
+//----------------------------------------------------------------------------------
+static uint8 out_bits = FRAME_BITS_DEFAULT;
+static uint8 out_mode = FRAME_Q_ROUND;
+static int32 q_err;		//ʽһ
+static uint32 q_rand = 0x12345678;
+
+static uint32 rand_next(void)//xorshift32
+{
+	q_rand ^= q_rand<<13;
+	q_rand ^= q_rand>>17;
+	q_rand ^= q_rand<<5;
+	return q_rand;
+}
+
+//24 λзֵ out_bits λ
+static int32 quantize(int32 v)
+{
+	uint8 sh = 24-out_bits;
+	int32 u,q,d = 0;
+	int32 qmax = (1L<<(out_bits-1))-1;
+
+	u = v;
+	if(out_mode == FRAME_Q_DITHER)
+		d = (int32)(rand_next()>>(32-sh)) - (int32)(rand_next()>>(32-sh));
+	else if(out_mode == FRAME_Q_SHAPE)
+		u = v - q_err;
+	q = (u + d + (1L<<(sh-1))) >> sh;
+	if(q > qmax)
+		q = qmax;
+	else if(q < -qmax-1)
+		q = -qmax-1;
+	if(out_mode == FRAME_Q_SHAPE)
+		q_err = (q<<sh) - u;
+	return q;
+}
+
+bit Frame_SetBits(uint8 bits,uint8 mode)
+{
+	if((bits != 16 && bits != 18 && bits != 20 && bits != 24) || mode > FRAME_Q_SHAPE)
+		return 0;
+	out_bits = bits;
+	out_mode = mode;
+	q_err = 0;
+	return 1;
+}
+
+//packed ÿ 3 ֽڣ24 λзŴˣ CS1237 ԭʼ˳
+//ʱ out_bits ӸλУĩֽڲ㲹 0
+bit Frame_SendBatch(uint16 seq,uint8 xdata *packed,uint8 n)
+{
+	uint8 i,len,nb = 0;
+	uint32 v,acc = 0,mask;
+
+	if(n > FRAME_BATCH_MAX)
+		n = FRAME_BATCH_MAX;
+	len = 4+((uint16)n*out_bits+7)/8;
+	if(!frame_room(len))
+		return 0;
+	frame_begin(CMD_ADC_BATCH,len);
+	frame_put(seq>>8);
+	frame_put(seq);
+	frame_put(out_bits);//λ
+	frame_put(n);
+	if(out_bits == 24)
+	{
+		for(i=0;i<3*n;i++)
+			frame_put(packed[i]);
+		frame_end();
+		return 1;
+	}
+	mask = (1UL<<out_bits)-1;
+	for(i=0;i<n;i++,packed+=3)
+	{
+		v = ((uint32)packed[0]<<16) | ((uint16)packed[1]<<8) | packed[2];
+		if(v & 0x800000)
+			v |= 0xFF000000;//չ
+		acc = (acc<<out_bits) | ((uint32)quantize((int32)v) & mask);
+		nb += out_bits;
+		while(nb >= 8)
+		{
+			nb -= 8;
+			frame_put(acc>>nb);
+		}
+	}
+	if(nb)
+		frame_put(acc<<(8-nb));
+	frame_end();
+	return 1;
+}
+
+//----------------------------------------------------------------------------------
+// գֽ״̬֡Уִͨ
+//----------------------------------------------------------------------------------
+#define RX_DATA_MAX  4	//λܶ
+
+#define ST_HEAD1  0
+#define ST_HEAD2  1
+#define ST_LEN    2
+#define ST_CMD    3
+#define ST_DATA   4
+#define ST_SUM    5
+#define ST_TAIL1  6
+#define ST_TAIL2  7
+
+static uint8 rx_state;
+static uint8 rx_len,rx_cmd,rx_cnt,rx_sum;
+static uint8 rx_dat[RX_DATA_MAX];
+
+static void send_ack(uint8 type,uint8 val)
+{
+	uint8 d[2];
+	d[0] = type;
+	d[1] = val;
+	Frame_Send(CMD_CONFIG_ACK,d,2);
+}
+
+static void send_error(uint8 err)
+{
+	Frame_Send(CMD_ERROR,&err,1);
+}
+
+//״̬֡[PGA][Rate][ͨ][ɹȡ 4 ֽڴ]
+static void send_status(void)
+{
+	uint8 d[FRAME_STATUS_DATA_LEN];
+	uint32 cnt = CS1237_Reads;
+	d[0] = (CS1237_Config>>2)&0x03;
+	d[1] = (CS1237_Config>>4)&0x03;
+	d[2] = CS1237_Config&0x03;
+	d[3] = cnt>>24;
+	d[4] = cnt>>16;
+	d[5] = cnt>>8;
+	d[6] = cnt;
+	Frame_Send(CMD_STATUS,d,FRAME_STATUS_DATA_LEN);
+}
+
+//֡ϵʱյ 0x06 ѯʱͣFRAME_DEVICE ڸ config.h ж
+bit Frame_SendHello(void)
+{
+	uint8 d[FRAME_HELLO_DATA_LEN];
+	uint16 caps = CAP_ADC_BATCH | CAP_STATUS | CAP_CONFIG | CAP_SET_BITS;
+
+	d[0] = PROTO_VERSION;
+	d[1] = FRAME_DEVICE;
+	d[2] = FRAME_FW_VERSION>>8;
+	d[3] = FRAME_FW_VERSION;
+	d[4] = caps>>8;
+	d[5] = caps;
+	d[6] = FRAME_MAX_BAUD;
+	d[7] = FRAME_BATCH_MAX;
+	return Frame_Send(CMD_HELLO,d,FRAME_HELLO_DATA_LEN);
+}
+
+// 1 ʾоƬѸı
+static bit exec_command(void)
+{
+	uint8 shift,val = rx_dat[0];
+
+	if(rx_cmd == CMD_HELLO)
+	{
+		Frame_SendHello();
+		return 0;
+	}
+	if(rx_cmd == CMD_STATUS)
+	{
+		send_status();
+		return 0;
+	}
+	if(rx_cmd == CMD_SET_BITS)
+	{
+		if(rx_len != 2 || !Frame_SetBits(val&0x1F,val>>6))
+			send_error(ERR_DATA_INVALID);
+		else
+			send_ack(CMD_SET_BITS,val);
+		return 0;
+	}
+	switch(rx_cmd)
+	{
+		case CMD_SET_PGA:     shift = 2; break;
+		case CMD_SET_RATE:    shift = 4; break;
+		case CMD_SET_CHANNEL: shift = 0; break;
+		default: return 0;//δ֪
+	}
+	if(rx_len != 2 || val > 3)
+	{
+		send_error(ERR_DATA_INVALID);
+		return 0;
+	}
+	CS1237_Config = (CS1237_Config & ~(0x03<<shift)) | (val<<shift);
+	Con_CS1237();
+	send_ack(rx_cmd,val);
+	return 1;
+}
+
+//ѭеãյȫֽڣ 1 ʾоƬѸı
+bit Frame_Poll(void)
+{
+	uint8 c;
+	bit changed = 0;
+
+	while(UartRead(&c))
+	{
+		switch(rx_state)
+		{
+			case ST_HEAD1:
+				if(c == FRAME_HEAD_1)
+					rx_state = ST_HEAD2;
+				break;
+			case ST_HEAD2:
+				rx_state = (c == FRAME_HEAD_2) ? ST_LEN : (c == FRAME_HEAD_1 ? ST_HEAD2 : ST_HEAD1);
+				break;
+			case ST_LEN:
+				if(c == 0 || c > RX_DATA_MAX+1)
+				{
+					rx_state = ST_HEAD1;
+					break;
+				}
+				rx_len = c;
+				rx_sum = c;
+				rx_state = ST_CMD;
+				break;
+			case ST_CMD:
+				rx_cmd = c;
+				rx_sum ^= c;
+				rx_cnt = 0;
+				rx_state = (rx_len > 1) ? ST_DATA : ST_SUM;
+				break;
+			case ST_DATA:
+				rx_dat[rx_cnt++] = c;
+				rx_sum ^= c;
+				if(rx_cnt >= rx_len-1)
+					rx_state = ST_SUM;
+				break;
+			case ST_SUM:
+				rx_state = (c == rx_sum) ? ST_TAIL1 : ST_HEAD1;
+				break;
+			case ST_TAIL1:
+				rx_state = (c == FRAME_TAIL_1) ? ST_TAIL2 : ST_HEAD1;
+				break;
+			case ST_TAIL2:
+				rx_state = ST_HEAD1;
+				if(c == FRAME_TAIL_2 && exec_command())
+					changed = 1;
+				break;
+			default:
+				rx_state = ST_HEAD1;
+				break;
+		}
+	}
+	return changed;
+}
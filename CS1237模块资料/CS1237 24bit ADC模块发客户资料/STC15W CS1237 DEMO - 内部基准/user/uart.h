@@ -3,9 +3,15 @@
 
 #include "config.h"
 
+#define UART_RX_SIZE  32	//ջС 2 
+
+extern volatile unsigned char Uart_Rx_Overrun;
+
 void Uart1_Init();
 void UartSend(char dat);
 void UartSendStr(char *p);
+unsigned char UartTxFree(void);
+bit UartRead(unsigned char *dat);
 void UART_Send_dat(unsigned long dat);
 void Uart_send_hex_to_txt(unsigned char dat);
 
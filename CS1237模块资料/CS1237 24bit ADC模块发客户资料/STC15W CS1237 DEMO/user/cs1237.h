@@ -4,11 +4,17 @@
 #include "config.h"
 
 
+//֣bit6 REFOأbit5-4 ʣbit3-2 PGAbit1-0 ͨ
+//Con_CS1237 дľֵλд
+extern unsigned char CS1237_Config;
+extern unsigned long CS1237_Reads;	//ɹȡ
+extern bit CS1237_Timeout;			//һζȡȴʱ
+
 //CS1237оƬ
 void Con_CS1237(void);
 //ȡоƬ
 unsigned char Read_CON(void);
-//ȡADC
+//ȡADCݣ24λԭʼ루룩ʱ0 CS1237_Timeout
 unsigned long Read_CS1237(void);
 
 
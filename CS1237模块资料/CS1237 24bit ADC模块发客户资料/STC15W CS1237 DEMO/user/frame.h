@@ -0,0 +1,31 @@
+#ifndef _FRAME_H
+#define _FRAME_H
+
+#include "config.h"
+
+//֡ AA 55 [] [] [] [XOR] 0D 0A STM32/UNO ͬ
+// = 1() + ֽXOR ӳȵݣ gui/ЭͨѶ˵.md
+//֡ͷ֡β롢 protocol/gen_proto.py 
+#include "cs1237_proto_defs.h"
+
+#define FRAME_BATCH_MAX 32	//֡֡ 107 ֽڣŵýͻ
+
+//֡λ 16/18/20/24صλķʽ
+#define FRAME_Q_ROUND   0	//
+#define FRAME_Q_DITHER  1	// 1LSB Ƿֲ
+#define FRAME_Q_SHAPE   2	//һΣ
+#define FRAME_BITS_DEFAULT 24
+
+//̼֡汾ֽ汾ɶʱװ̶ֵ֧л
+#define FRAME_FW_VERSION 0x0100
+#define FRAME_MAX_BAUD   BAUD_115200	// config.h  BRT һ
+
+extern unsigned int Frame_Dropped;	//ͻŲ¶֡
+
+bit Frame_Send(unsigned char cmd,unsigned char *dat,unsigned char len);
+bit Frame_SendBatch(unsigned int seq,unsigned char xdata *packed,unsigned char n);
+bit Frame_Poll(void);
+bit Frame_SendHello(void);
+bit Frame_SetBits(unsigned char bits,unsigned char mode);
+
+#endif
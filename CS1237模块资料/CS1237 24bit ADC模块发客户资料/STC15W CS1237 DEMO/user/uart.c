@@ -1,8 +1,13 @@
 #include "uart.h"
 
-bit busy;
-uint8 dat,a;
-uint8 str[]={"Uart Test !\r\n"};
+///ջλ壬 UartIsr 
+//ͻ 256 ֽڣuint8 ±Ȼƣȡģ
+static uint8 xdata tx_buf[256];
+static volatile uint8 tx_head,tx_tail;	//head дλãtail жȡλ
+static volatile bit tx_busy;			//SBUF ڷ
+static uint8 xdata rx_buf[UART_RX_SIZE];
+static volatile uint8 rx_head,rx_tail;
+volatile uint8 Uart_Rx_Overrun;			//ջֽ
 
 void Uart1_Init()
 {
@@ -12,52 +17,75 @@ void Uart1_Init()
     TH1 = BRT;
     TR1 = 1;
     AUXR = 0x40;
-    busy = 0;
+    tx_head = tx_tail = 0;
+    rx_head = rx_tail = 0;
+    tx_busy = 0;
 
 	ES = 1;
 	EA = 1;
 }
 
-void ISP_Check(unsigned char tmp)
-{
-  unsigned char a;
-	if(tmp==0xAA) 
-	{
-		 ES= 0;
-		 a=0;
-		while(str[a]!= '\0')
-		{
-			SBUF = str[a];	        //SUBF/ͻ(ֽдͨ⹦ܼĴ)
-			while(!TI);				// ݴ	(TIжϱ־)
-			TI = 0;					// ݴͱ־
-			
-			a++;					    // һַ
-		} 
-		
-		ES= 1;
-	 }
-} 
-
 void UartIsr() interrupt 4 using 1
 {
+	uint8 next;
+
     if (TI)
     {
         TI = 0;
-        busy = 0;
+		if(tx_tail != tx_head)
+		{
+			SBUF = tx_buf[tx_tail];
+			tx_tail++;
+		}
+		else
+			tx_busy = 0;
     }
-    else if (RI)
+    if (RI)
     {
         RI = 0;
-		dat = SBUF;
-		ISP_Check(dat);
+		next = (rx_head+1) & (UART_RX_SIZE-1);
+		if(next != rx_tail)
+		{
+			rx_buf[rx_head] = SBUF;
+			rx_head = next;
+		}
+		else
+			Uart_Rx_Overrun++;
     }
 }
 
+//뷢ͻ壬ֻлʱŵȴ
 void UartSend(char dat)
 {
-    while (busy);
-    busy = 1;
-    SBUF = dat;
+	uint8 next = tx_head+1;
+
+	while (next == tx_tail);	//жȡһֽ
+	tx_buf[tx_head] = dat;
+	ES = 0;
+	tx_head = next;
+	if(!tx_busy)				//У﷢һֽڣ֮жϽ
+	{
+		tx_busy = 1;
+		SBUF = tx_buf[tx_tail];
+		tx_tail++;
+	}
+	ES = 1;
+}
+
+//ͻʣռ
+uint8 UartTxFree(void)
+{
+	return tx_tail - tx_head - 1;
+}
+
+//ȡһֽڣûݷ 0
+bit UartRead(uint8 *dat)
+{
+	if(rx_tail == rx_head)
+		return 0;
+	*dat = rx_buf[rx_tail];
+	rx_tail = (rx_tail+1) & (UART_RX_SIZE-1);
+	return 1;
 }
 
 void UartSendStr(char *p)
@@ -96,7 +124,7 @@ void Uart_send_hex_to_txt(uint8 dat)
 	L_val = dat%16;
 	if(L_val >= 10)
 		UartSend(L_val+0x37);
-	else 
+	else
 		UartSend(L_val+0x30);
 
 	UartSend(' ');
@@ -25,6 +25,7 @@
 #include "delay.h"
 #include "uart.h"
 #include "cs1237.h"
+#include "frame.h"
 
 /* Ͷ */
 typedef  signed    char    int8;    // 8λз
@@ -37,6 +38,7 @@ typedef  unsigned  long    uint32;  //32λ
 /* ȫв */
 #define FOSC   11059200L  //ϵͳʱƵʣƵʡ12
 #define	BRT	   (256 - FOSC / 115200 / 32)
+#define FRAME_DEVICE DEV_STC8	//֡е豸
 
 /* IOŷ䶨 */
 
@@ -0,0 +1,200 @@
+/*  protocol/gen_proto.py  protocol/schema.json ɣֹ޸ */
+/* 궨壬 stdint.hKeil C51 / ARMCC ֱӰ */
+#ifndef CS1237_PROTO_DEFS_H
+#define CS1237_PROTO_DEFS_H
+
+#define FRAME_HEAD_1       0xAA
+#define FRAME_HEAD_2       0x55
+#define FRAME_TAIL_1       0x0D
+#define FRAME_TAIL_2       0x0A
+
+/* ֡: AA 55 [=1+] [] [] [XOR(..)] 0D 0A */
+#define CMD_ADC_DATA       0x01	/* ADCֵֽڲ 0 */
+#define CMD_ERROR          0x03	/* 󱨸 */
+#define CMD_STATUS         0x04	/* ״̬Ϣλݵ 0x04 ֡ѯ */
+#define CMD_ADC_BATCH      0x05	/* ADC̶ֵͷ֮Ϊλе */
+#define CMD_HELLO          0x06	/* /֡ϵʱյݵ 0x06 ѯʱ */
+#define CMD_TRACE          0x07	/* ׷֡ĵѹ֡׷ٺţԼͿʼʱλʱ䣨΢룩 */
+#define CMD_VOLTAGE_PGA    0x08	/* ѹ֡֡ʽCOBS ֡ʽ´ѹ֡ѹ PGA ѹ֡ͬ־ QFLAG_* */
+#define CMD_BULK_INFO      0x09	/* մ俪ʼšݸʽ BULK_FMT_*ɼʱ/PGA 롢ֽ鳤ڿյ CRC-32 */
+#define CMD_BULK_DATA      0x0A	/* ݿ飺̶ͷ֮Ϊ block ݣĩܽ϶̣crc Ϊݵ CRC-16/CCITT */
+#define CMD_SET_PGA        0xA1	/* PGA0=1, 1=2, 2=64, 3=128 */
+#define CMD_SET_RATE       0xA2	/* ʣ0=10Hz, 1=40Hz, 2=640Hz, 3=1280Hz */
+#define CMD_SET_CHANNEL    0xA3	/* ͨ0=A, 1=, 2=¶, 3=ڶ */
+#define CMD_POWER_DOWN     0xA4	/* Դ״̬1=ʡ, 0=˳UNO ֻȷ֡ʹã */
+#define CMD_SET_BITS       0xA5	/* ֡λbit4-0 λbit7-6 ʽ */
+#define CMD_SET_BAUD       0xA6	/* лʣBAUD_* 룻λԭʻȷ֡лλյȷл */
+#define CMD_SET_FRAMING    0xA7	/* лλ֡ʽFRAMING_*ԭʽȷ֡лλʼ AA 55 ֡ */
+#define CMD_BULK_OPEN      0xA8	/* /ɼղʼ䣺BULK_SRC_*0 = λ 0x09 󰴴ڷݿ */
+#define CMD_BULK_ACK       0xA9	/* մȷϣbase ֮ǰĿ鶼յmissing ĵ i λʾ base+i 鶪ʧطbase ڿ */
+#define CMD_CONFIG_ACK     0xB1	/* ȷϣ + Чֵ */
+
+#define ERR_SPI_READ       0x01	/* ȡʧܣδ */
+#define ERR_DATA_INVALID   0x02	/* ݻЧ */
+#define ERR_TIMEOUT        0x03	/* ȴоƬʱ */
+#define ERR_TEMP_PGA       0x04	/* ģʽPGA=1 */
+
+#define PROTO_VERSION      1	/* ֡ proto ֶ */
+
+/* ֡ device豸 */
+#define DEV_UNO            0x01	/* Arduino UNO11.18gai */
+#define DEV_STM32          0x02	/* STM32F103  */
+#define DEV_STC8           0x03	/* STC8X  */
+#define DEV_STC15          0x04	/* STC15W  */
+
+/* ֡ capsֵ֧֡빦 */
+#define CAP_VOLTAGE        0x0001	/* ѹ֡ */
+#define CAP_ADC_DATA       0x0002	/* ADC֡ 0x01 */
+#define CAP_ADC_BATCH      0x0004	/* ADC֡ 0x05 */
+#define CAP_STATUS         0x0008	/* ״̬ѯ 0x04 */
+#define CAP_CONFIG         0x0010	/*  0xA1-0xA3 */
+#define CAP_SET_BITS       0x0020	/* ֡λѹ 0xA5 */
+#define CAP_SET_BAUD       0x0040	/* л 0xA6 */
+#define CAP_TIMESTAMP      0x0080	/* ׷֡ 0x07׷ٺźʱ */
+#define CAP_TEXT           0x0100	/* ͬһڻı˵/Ϣ */
+#define CAP_COBS           0x0200	/* ֧ COBS ֡ʽ 0xA7 */
+#define CAP_FLAGS          0x0400	/* 0x08 ѹ֡־ */
+#define CAP_BULK           0x0800	/* շֿ鴫 0xA8/0xA9/0x09/0x0A鰴λͼѡط */
+
+/* SET_FRAMING ֵλ֡ʽ */
+#define FRAMING_AA55       0x00	/* AA 55 ֡ͷ + 0D 0A ֡βϵĬϣ */
+#define FRAMING_COBS       0x01	/* 00 + COBS(..У) + 000x00 Ψһķָ */
+
+/* BULK_OPEN  sourceԴ */
+#define BULK_SRC_HISTORY   0x00	/*  count ʱλһֱѭ¼ */
+#define BULK_SRC_CAPTURE   0x01	/* ɼ count 󶳽 */
+#define BULK_SRC_RESEND    0x02	/* ȡط 0x09 ͷǰգλûյ 0x09 ʱã */
+
+/* BULK_INFO  formatݸʽ */
+#define BULK_FMT_S24       0x00	/* ÿ 3 ֽڴзֵʱ˳ */
+
+/* 0x08 ѹ֡ flags־λڶʱж */
+#define QFLAG_SATURATED    0x01	/* ֵ̣0x7FFFFF / 0x800000볬 */
+#define QFLAG_SETTLING     0x02	/* û˳ʡĽڣ˲δȶ */
+#define QFLAG_DRDY_TIMEOUT 0x04	/* ǰȴ DRDY ʱһ֮ȱ */
+#define QFLAG_SPI_GLITCH   0x08	/* ʼλʱ DOUT ѲΪͣλܴλ0xFFF??? 쳣ֵ */
+#define QFLAG_DECIMATED    0x10	/* һ֮©˶ϵµȣ */
+#define QFLAG_BAD          0x0B	/* ֵõı־ϣ͡ڡλ쳣ΰλ */
+
+/* ʱ루֡ max_baudSET_BAUD ֵBAUD_RATES_INIT  */
+#define BAUD_9600          0
+#define BAUD_19200         1
+#define BAUD_38400         2
+#define BAUD_57600         3
+#define BAUD_115200        4
+#define BAUD_230400        5
+#define BAUD_460800        6
+#define BAUD_921600        7
+#define BAUD_COUNT         8
+#define BAUD_RATES_INIT    {9600UL,19200UL,38400UL,57600UL,115200UL,230400UL,460800UL,921600UL}
+
+/* ֡ȡ֡ȡֶ֡еƫ */
+#define FRAME_VOLTAGE_DATA_LEN 6
+#define FRAME_VOLTAGE_LEN 10
+#define FRAME_VOLTAGE_OFF_VOLTAGE 2
+#define FRAME_VOLTAGE_OFF_PGA 6
+
+#define FRAME_ADC_DATA_DATA_LEN 4
+#define FRAME_ADC_DATA_LEN 11
+#define FRAME_ADC_DATA_OFF_PAD 4
+#define FRAME_ADC_DATA_OFF_ADC 5
+
+#define FRAME_ERROR_DATA_LEN 1
+#define FRAME_ERROR_LEN 8
+#define FRAME_ERROR_OFF_CODE 4
+
+#define FRAME_STATUS_DATA_LEN 7
+#define FRAME_STATUS_LEN 14
+#define FRAME_STATUS_OFF_PGA 4
+#define FRAME_STATUS_OFF_RATE 5
+#define FRAME_STATUS_OFF_CHANNEL 6
+#define FRAME_STATUS_OFF_READS 7
+
+#define FRAME_ADC_BATCH_HEADER_LEN 4
+#define FRAME_ADC_BATCH_OFF_SEQ 4
+#define FRAME_ADC_BATCH_OFF_BITS 6
+#define FRAME_ADC_BATCH_OFF_COUNT 7
+
+#define FRAME_HELLO_DATA_LEN 8
+#define FRAME_HELLO_LEN 15
+#define FRAME_HELLO_OFF_PROTO 4
+#define FRAME_HELLO_OFF_DEVICE 5
+#define FRAME_HELLO_OFF_FW 6
+#define FRAME_HELLO_OFF_CAPS 8
+#define FRAME_HELLO_OFF_MAX_BAUD 10
+#define FRAME_HELLO_OFF_BATCH_MAX 11
+
+#define FRAME_TRACE_DATA_LEN 10
+#define FRAME_TRACE_LEN 17
+#define FRAME_TRACE_OFF_ID 4
+#define FRAME_TRACE_OFF_ADC_US 6
+#define FRAME_TRACE_OFF_TX_US 10
+
+#define FRAME_VOLTAGE_PGA_DATA_LEN 7
+#define FRAME_VOLTAGE_PGA_LEN 14
+#define FRAME_VOLTAGE_PGA_OFF_VOLTAGE 4
+#define FRAME_VOLTAGE_PGA_OFF_PGA 8
+#define FRAME_VOLTAGE_PGA_OFF_FLAGS 10
+
+#define FRAME_BULK_INFO_DATA_LEN 16
+#define FRAME_BULK_INFO_LEN 23
+#define FRAME_BULK_INFO_OFF_XFER 4
+#define FRAME_BULK_INFO_OFF_FORMAT 5
+#define FRAME_BULK_INFO_OFF_RATE 6
+#define FRAME_BULK_INFO_OFF_PGA 7
+#define FRAME_BULK_INFO_OFF_TOTAL 8
+#define FRAME_BULK_INFO_OFF_BLOCKS 12
+#define FRAME_BULK_INFO_OFF_BLOCK_SIZE 14
+#define FRAME_BULK_INFO_OFF_WINDOW 15
+#define FRAME_BULK_INFO_OFF_CRC32 16
+
+#define FRAME_BULK_DATA_HEADER_LEN 5
+#define FRAME_BULK_DATA_OFF_XFER 4
+#define FRAME_BULK_DATA_OFF_BLOCK 5
+#define FRAME_BULK_DATA_OFF_CRC 7
+
+#define FRAME_SET_PGA_DATA_LEN 1
+#define FRAME_SET_PGA_LEN 8
+#define FRAME_SET_PGA_OFF_VALUE 4
+
+#define FRAME_SET_RATE_DATA_LEN 1
+#define FRAME_SET_RATE_LEN 8
+#define FRAME_SET_RATE_OFF_VALUE 4
+
+#define FRAME_SET_CHANNEL_DATA_LEN 1
+#define FRAME_SET_CHANNEL_LEN 8
+#define FRAME_SET_CHANNEL_OFF_VALUE 4
+
+#define FRAME_POWER_DOWN_DATA_LEN 1
+#define FRAME_POWER_DOWN_LEN 8
+#define FRAME_POWER_DOWN_OFF_VALUE 4
+
+#define FRAME_SET_BITS_DATA_LEN 1
+#define FRAME_SET_BITS_LEN 8
+#define FRAME_SET_BITS_OFF_VALUE 4
+
+#define FRAME_SET_BAUD_DATA_LEN 1
+#define FRAME_SET_BAUD_LEN 8
+#define FRAME_SET_BAUD_OFF_VALUE 4
+
+#define FRAME_SET_FRAMING_DATA_LEN 1
+#define FRAME_SET_FRAMING_LEN 8
+#define FRAME_SET_FRAMING_OFF_VALUE 4
+
+#define FRAME_BULK_OPEN_DATA_LEN 3
+#define FRAME_BULK_OPEN_LEN 10
+#define FRAME_BULK_OPEN_OFF_SOURCE 4
+#define FRAME_BULK_OPEN_OFF_COUNT 5
+
+#define FRAME_BULK_ACK_DATA_LEN 7
+#define FRAME_BULK_ACK_LEN 14
+#define FRAME_BULK_ACK_OFF_XFER 4
+#define FRAME_BULK_ACK_OFF_BASE 5
+#define FRAME_BULK_ACK_OFF_MISSING 7
+
+#define FRAME_CONFIG_ACK_DATA_LEN 2
+#define FRAME_CONFIG_ACK_LEN 9
+#define FRAME_CONFIG_ACK_OFF_TYPE 4
+#define FRAME_CONFIG_ACK_OFF_VALUE 5
+
+#endif
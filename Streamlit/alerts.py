@@ -0,0 +1,296 @@
+"""
+流式告警规则引擎
+
+- 挂在时序存储的写入路径上：每个新采样点写入后立即增量评估，不在页面渲染时计算
+- 每条规则对每个序列只保存常数大小的状态，评估代价与规则数成正比，与历史长度无关
+- 支持阈值、变化率、数值卡死、无数据四类规则，带滞回 (hysteresis) 与去抖 (for_s)
+- 无数据规则由后台定时器每秒检查一次
+- 告警事件（触发/恢复）写入 SQLite，供控制台展示
+
+规则文件 (JSON) 示例:
+    [
+      {"name": "电压过高", "type": "threshold", "series": "*/voltage",
+       "op": "above", "limit": 3.0, "hysteresis": 0.05, "for_s": 2},
+      {"name": "电压突变", "type": "rate", "series": "*/voltage", "limit": 0.5},
+      {"name": "数值卡死", "type": "stuck", "series": "*/voltage", "duration": 600, "epsilon": 1e-6},
+      {"name": "无数据",   "type": "nodata", "series": "*/voltage", "timeout": 300}
+    ]
+"""
+import fnmatch
+import json
+import os
+import sqlite3
+import threading
+import time
+
+DEFAULT_RULES_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "alert_rules.json")
+DEFAULT_LOG_PATH = os.environ.get(
+    "SAMPLING_ALERT_DB_PATH",
+    os.path.join(os.path.dirname(os.path.abspath(__file__)), "data", "alerts.sqlite"),
+)
+
+FIRING = "firing"
+RESOLVED = "resolved"
+
+
+# ==========================================
+# 规则
+# ==========================================
+
+class Rule:
+    """
+    规则基类。check() 返回:
+        True  - 处于异常条件
+        False - 条件已解除
+        None  - 处于滞回区间，保持当前状态
+    for_s: 异常条件需持续多少秒才触发（去抖），0 表示立即触发
+    """
+    kind = None
+
+    def __init__(self, name, series="*", for_s=0.0, severity="warning"):
+        self.name = name
+        self.series = series
+        self.for_s = float(for_s)
+        self.severity = severity
+
+    def matches(self, series):
+        return fnmatch.fnmatchcase(series, self.series)
+
+    def check(self, state, ts, value):
+        raise NotImplementedError
+
+    def describe(self, value):
+        return f"{self.name}: {value:.6g}"
+
+
+class ThresholdRule(Rule):
+    kind = "threshold"
+
+    def __init__(self, name, limit, op="above", hysteresis=0.0, **kw):
+        super().__init__(name, **kw)
+        if op not in ("above", "below"):
+            raise ValueError(f"未知比较方式: {op}")
+        self.limit = float(limit)
+        self.op = op
+        self.hysteresis = abs(float(hysteresis))
+
+    def check(self, state, ts, value):
+        if self.op == "above":
+            if value > self.limit:
+                return True
+            return False if value <= self.limit - self.hysteresis else None
+        if value < self.limit:
+            return True
+        return False if value >= self.limit + self.hysteresis else None
+
+    def describe(self, value):
+        sign = ">" if self.op == "above" else "<"
+        return f"{self.name}: {value:.6g} {sign} {self.limit:.6g}"
+
+
+class RateRule(Rule):
+    """|dv/dt| 超过 limit（单位/秒）"""
+    kind = "rate"
+
+    def __init__(self, name, limit, hysteresis=0.0, **kw):
+        super().__init__(name, **kw)
+        self.limit = abs(float(limit))
+        self.hysteresis = abs(float(hysteresis))
+
+    def check(self, state, ts, value):
+        prev = state.get("prev")
+        state["prev"] = (ts, value)
+        if prev is None or ts <= prev[0]:
+            return None
+        rate = abs(value - prev[1]) / (ts - prev[0])
+        state["rate"] = rate
+        if rate > self.limit:
+            return True
+        return False if rate <= self.limit - self.hysteresis else None
+
+    def describe(self, value):
+        return f"{self.name}: 变化率超过 {self.limit:.6g}/s (当前值 {value:.6g})"
+
+
+class StuckRule(Rule):
+    """数值在 duration 秒内变化不超过 epsilon"""
+    kind = "stuck"
+
+    def __init__(self, name, duration, epsilon=0.0, **kw):
+        super().__init__(name, **kw)
+        self.duration = float(duration)
+        self.epsilon = abs(float(epsilon))
+
+    def check(self, state, ts, value):
+        ref = state.get("ref")
+        if ref is None or abs(value - ref[1]) > self.epsilon:
+            state["ref"] = (ts, value)
+            return False
+        return ts - ref[0] >= self.duration
+
+    def describe(self, value):
+        return f"{self.name}: {self.duration:.0f} 秒内数值未变化 ({value:.6g})"
+
+
+class NoDataRule(Rule):
+    """超过 timeout 秒没有新数据（由定时器检查）"""
+    kind = "nodata"
+
+    def __init__(self, name, timeout, **kw):
+        super().__init__(name, **kw)
+        self.timeout = float(timeout)
+
+    def check(self, state, ts, value):
+        # 收到数据即恢复
+        return False
+
+    def check_idle(self, last_ts, now):
+        return now - last_ts > self.timeout
+
+    def describe(self, value):
+        return f"{self.name}: 超过 {self.timeout:.0f} 秒无数据"
+
+
+RULE_TYPES = {cls.kind: cls for cls in (ThresholdRule, RateRule, StuckRule, NoDataRule)}
+
+
+def load_rules(path=DEFAULT_RULES_PATH):
+    if not os.path.exists(path):
+        return []
+    with open(path, "r", encoding="utf-8") as f:
+        specs = json.load(f)
+    rules = []
+    for spec in specs:
+        spec = dict(spec)
+        cls = RULE_TYPES[spec.pop("type")]
+        rules.append(cls(**spec))
+    return rules
+
+
+# ==========================================
+# 事件记录
+# ==========================================
+
+class AlertLog:
+    def __init__(self, path=DEFAULT_LOG_PATH):
+        if path != ":memory:":
+            os.makedirs(os.path.dirname(path) or ".", exist_ok=True)
+        self._lock = threading.Lock()
+        self._conn = sqlite3.connect(path, check_same_thread=False)
+        self._conn.execute("PRAGMA journal_mode=WAL")
+        self._conn.execute(
+            "CREATE TABLE IF NOT EXISTS alert_events ("
+            " id INTEGER PRIMARY KEY,"
+            " ts REAL NOT NULL,"
+            " series TEXT NOT NULL,"
+            " rule TEXT NOT NULL,"
+            " severity TEXT NOT NULL,"
+            " state TEXT NOT NULL,"
+            " value REAL,"
+            " message TEXT)"
+        )
+        self._conn.execute("CREATE INDEX IF NOT EXISTS alert_events_ts ON alert_events (ts)")
+
+    def record(self, ts, series, rule, state, value, message):
+        with self._lock:
+            self._conn.execute(
+                "INSERT INTO alert_events (ts, series, rule, severity, state, value, message)"
+                " VALUES (?, ?, ?, ?, ?, ?, ?)",
+                (ts, series, rule.name, rule.severity, state, value, message),
+            )
+            self._conn.commit()
+
+    def recent(self, limit=100, series=None):
+        """最近的事件，按时间倒序，返回 dict 列表"""
+        sql = "SELECT ts, series, rule, severity, state, value, message FROM alert_events"
+        args = []
+        if series is not None:
+            sql += " WHERE series = ?"
+            args.append(series)
+        sql += " ORDER BY id DESC LIMIT ?"
+        args.append(limit)
+        with self._lock:
+            rows = self._conn.execute(sql, args).fetchall()
+        keys = ("ts", "series", "rule", "severity", "state", "value", "message")
+        return [dict(zip(keys, row)) for row in rows]
+
+
+# ==========================================
+# 引擎
+# ==========================================
+
+class AlertEngine:
+    def __init__(self, rules, log=None):
+        self.rules = list(rules)
+        self.log = log
+        self._lock = threading.Lock()
+        self._rules_for = {}   # series -> [rule, ...]（匹配结果缓存）
+        self._state = {}       # (rule index, series) -> dict
+        self._last_seen = {}   # series -> (ts, value)
+        self._stop = threading.Event()
+
+    def _matching(self, series):
+        rules = self._rules_for.get(series)
+        if rules is None:
+            rules = [(i, r) for i, r in enumerate(self.rules) if r.matches(series)]
+            self._rules_for[series] = rules
+        return rules
+
+    def _transition(self, idx, rule, series, state, bad, ts, value):
+        """根据条件更新告警状态（含去抖），必要时记录事件"""
+        if bad is None:
+            return
+        if bad:
+            if state.get("active"):
+                return
+            since = state.setdefault("pending_since", ts)
+            if ts - since >= rule.for_s:
+                state["active"] = True
+                state.pop("pending_since", None)
+                self._emit(ts, series, rule, FIRING, value, rule.describe(value))
+        else:
+            state.pop("pending_since", None)
+            if state.get("active"):
+                state["active"] = False
+                self._emit(ts, series, rule, RESOLVED, value, f"{rule.name}: 已恢复")
+
+    def _emit(self, ts, series, rule, state, value, message):
+        if self.log is not None:
+            self.log.record(ts, series, rule, state, value, message)
+
+    def on_samples(self, series, points):
+        """存储写入回调：对新采样点逐个评估匹配的规则"""
+        with self._lock:
+            rules = self._matching(series)
+            for ts, value in points:
+                for idx, rule in rules:
+                    state = self._state.setdefault((idx, series), {})
+                    self._transition(idx, rule, series, state, rule.check(state, ts, value), ts, value)
+                self._last_seen[series] = (ts, value)
+
+    def tick(self, now=None):
+        """定时检查无数据规则"""
+        now = time.time() if now is None else now
+        with self._lock:
+            for series, (last_ts, value) in self._last_seen.items():
+                for idx, rule in self._matching(series):
+                    if isinstance(rule, NoDataRule):
+                        state = self._state.setdefault((idx, series), {})
+                        bad = rule.check_idle(last_ts, now)
+                        self._transition(idx, rule, series, state, bad, now, value)
+
+    def active(self):
+        """当前处于触发状态的告警 [(series, rule), ...]"""
+        with self._lock:
+            return [(series, self.rules[idx]) for (idx, series), state in self._state.items()
+                    if state.get("active")]
+
+    def start_ticker(self, interval=1.0):
+        def run():
+            while not self._stop.wait(interval):
+                self.tick()
+        threading.Thread(target=run, name="alert-ticker", daemon=True).start()
+        return self
+
+    def stop(self):
+        self._stop.set()
@@ -0,0 +1,50 @@
+"""
+图表数据服务
+
+按图表宽度（像素列数）从时序存储取数：每个像素列一个汇总桶，
+每个桶输出 M4 四个点（首值/最小/最大/末值），折线形状与逐点绘制一致，
+而传给浏览器的点数最多为 4 × 宽度，与区间内的原始点数无关。
+区间统计（最高/最低/平均）由存储的分层汇总精确计算，不在前端重算。
+"""
+
+# 默认图表宽度（像素）。layout="wide" 下主区域大约 1200px
+DEFAULT_CHART_WIDTH = 1200
+
+
+def m4_rows(points, step):
+    """
+    将汇总桶转换为 M4 点列表 [(t, value), ...]。
+    step 为 0 时 points 为原始数据，原样输出。
+    """
+    if not step:
+        return [(p[0], p[3]) for p in points]
+
+    rows = []
+    for t, mn, mx, mean, count, first, last in points:
+        if count == 1:
+            rows.append((t, mean))
+            continue
+        # 桶内最小/最大值的确切时刻未保存，放在桶的 1/3、2/3 处；
+        # 同一像素列内的顺序不影响折线的外形
+        first = mean if first is None else first
+        last = mean if last is None else last
+        rows.append((t, first))
+        rows.append((t + step / 3.0, mn))
+        rows.append((t + step * 2 / 3.0, mx))
+        rows.append((t + step, last))
+    return rows
+
+
+def chart_payload(store, series, start, end, width=DEFAULT_CHART_WIDTH):
+    """
+    返回图表所需的全部数据:
+        rows  - [(t, value), ...] M4 降采样后的点（不超过 4 × width 个）
+        step  - 每个汇总桶的时长（秒），0 表示原始数据
+        stats - 区间统计 dict(count, min, max, mean)
+    """
+    result = store.query(series, start, end, max_points=width)
+    return {
+        "rows": m4_rows(result["points"], result["step"]),
+        "step": result["step"],
+        "stats": store.stats(series, start, end),
+    }
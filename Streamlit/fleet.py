@@ -0,0 +1,243 @@
+"""
+设备群轮询调度
+
+- 定期通过 /device/list 发现产品下的全部设备
+- 单一后台调度线程按固定周期批量查询属性，并发数受限，所有请求共用一个连接池
+- 每台设备每周期只发 1 个请求（一次取回全部属性），结果写入时序存储
+- 页面渲染只读取内存快照，不发网络请求，页面耗时与设备数量无关
+"""
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import requests
+
+from cs1237_proto import QFLAG_BAD
+
+# 超过该时长未更新视为离线（秒）
+ONLINE_THRESHOLD = 300
+
+
+class OneNetError(Exception):
+    pass
+
+
+def query_device_properties(session, base_url, product_id, device_name, token, timeout=5):
+    """
+    一次请求取回设备全部属性，返回 {identifier: (value, time_ms)}
+    API: /thingmodel/query-device-property
+    """
+    response = session.get(
+        f"{base_url}/thingmodel/query-device-property",
+        headers={"Authorization": token},
+        params={"product_id": product_id, "device_name": device_name},
+        timeout=timeout,
+    )
+    response.raise_for_status()
+    data = response.json()
+    if data.get("code") != 0:
+        raise OneNetError(data.get("msg"))
+    return {prop.get("identifier"): (prop.get("value"), prop.get("time"))
+            for prop in data.get("data") or []}
+
+
+def list_devices(session, base_url, product_id, token, timeout=5, page_size=100):
+    """
+    分页获取产品下的设备名列表
+    API: /device/list
+    """
+    names = []
+    offset = 0
+    while True:
+        response = session.get(
+            f"{base_url}/device/list",
+            headers={"Authorization": token},
+            params={"product_id": product_id, "offset": offset, "limit": page_size},
+            timeout=timeout,
+        )
+        response.raise_for_status()
+        data = response.json()
+        if data.get("code") != 0:
+            raise OneNetError(data.get("msg"))
+        page = (data.get("data") or {}).get("list") or []
+        names.extend(item.get("name") for item in page if item.get("name"))
+        total = (data.get("data") or {}).get("total", len(names))
+        offset += len(page)
+        if not page or offset >= total:
+            return names
+
+
+def sample_flags(props):
+    """
+    当前样本的质量标志 (QFLAG_*)。ESP32 只在标志不为 0 时上报属性 flags，
+    所以只有与 voltage 同一次上报（时间相同）的 flags 才属于当前样本，否则为 0
+    """
+    flags, flags_ms = props.get("flags", (None, None))
+    _, voltage_ms = props.get("voltage", (None, None))
+    if flags is None or flags_ms is None or str(flags_ms) != str(voltage_ms):
+        return 0
+    try:
+        return int(flags)
+    except (TypeError, ValueError):
+        return 0
+
+
+class FleetPoller:
+    """
+    后台批量轮询。token_fn(res) 返回资源 res 对应的 Token，
+    store 非空时每个新的 voltage 值写入序列 "{pid}/{dev}/voltage"（下位机标为不可用的样本跳过），
+    质量标志不为 0 时写入 "{pid}/{dev}/flags"，
+    trace_log 非空时属性 trace（追踪号）入库后记一次 ingest。
+    devices 中的设备无论 /device/list 是否返回（或获取失败）都会轮询。
+    """
+
+    def __init__(self, base_url, product_id, token_fn, store=None, interval=3.0,
+                 max_workers=8, discover_interval=60.0, timeout=5.0, trace_log=None,
+                 devices=()):
+        self.base_url = base_url
+        self.product_id = product_id
+        self.token_fn = token_fn
+        self.store = store
+        self.trace_log = trace_log
+        self.interval = interval
+        self.discover_interval = discover_interval
+        self.timeout = timeout
+
+        self._session = requests.Session()
+        # 连接池大小与并发数一致，避免每个请求重新握手
+        adapter = requests.adapters.HTTPAdapter(pool_connections=1, pool_maxsize=max_workers)
+        self._session.mount("http://", adapter)
+        self._session.mount("https://", adapter)
+        self._executor = ThreadPoolExecutor(max_workers=max_workers, thread_name_prefix="fleet")
+
+        self._lock = threading.Lock()
+        self._fixed = list(devices)
+        self._devices = sorted(set(self._fixed))
+        self._latest = {}        # dev -> {"props": {...}, "polled": ts, "error": str|None}
+        self._last_discover = 0.0
+        self.last_cycle_seconds = None
+        self.discover_error = None
+        self.cycle_error = None
+
+        self._stop = threading.Event()
+        self._thread = threading.Thread(target=self._run, name="fleet-poller", daemon=True)
+
+    def start(self):
+        self._thread.start()
+        return self
+
+    def stop(self):
+        self._stop.set()
+        self._executor.shutdown(wait=False)
+
+    # ------------------------------------------------------------------
+    def _discover(self):
+        try:
+            names = list_devices(self._session, self.base_url, self.product_id,
+                                 self.token_fn(f"products/{self.product_id}"), self.timeout)
+            with self._lock:
+                self._devices = sorted(set(names) | set(self._fixed))
+            self.discover_error = None
+        except Exception as e:
+            self.discover_error = str(e)
+        self._last_discover = time.time()
+
+    def _poll_one(self, device_name):
+        try:
+            token = self.token_fn(f"products/{self.product_id}/devices/{device_name}")
+            props = query_device_properties(self._session, self.base_url, self.product_id,
+                                            device_name, token, self.timeout)
+            error = None
+        except Exception as e:
+            props, error = None, str(e)
+
+        with self._lock:
+            entry = self._latest.setdefault(device_name, {"props": {}, "polled": None, "error": None})
+            if props is not None:
+                entry["props"] = props
+            entry["polled"] = time.time()
+            entry["error"] = error
+
+        # 入库或告警回调（存储监听器）出错只记到这台设备上，不能让调度线程退出
+        try:
+            self._ingest(device_name, props)
+        except Exception as e:
+            with self._lock:
+                entry["error"] = f"入库失败: {e}"
+
+    def _ingest(self, device_name, props):
+        if self.store is not None and props and "voltage" in props:
+            value, time_ms = props["voltage"]
+            flags = sample_flags(props)
+            try:
+                ts = int(time_ms) / 1000.0
+                if flags:
+                    self.store.append(f"{self.product_id}/{device_name}/flags", ts, float(flags))
+                if not flags & QFLAG_BAD:
+                    self.store.append(f"{self.product_id}/{device_name}/voltage", ts, float(value))
+            except (TypeError, ValueError):
+                pass
+        if self.trace_log is not None and props and "trace" in props:
+            self.trace_log.mark("ingest", device_name, props["trace"][0])
+
+    def _run(self):
+        while not self._stop.is_set():
+            started = time.time()
+            # 这是唯一的入库线程：任何意外都只记下来，下一周期照常轮询
+            try:
+                if started - self._last_discover >= self.discover_interval:
+                    self._discover()
+                with self._lock:
+                    devices = list(self._devices)
+                # 所有设备共用一个受限线程池，等待本周期全部完成后再进入下一周期
+                list(self._executor.map(self._poll_one, devices))
+                self.cycle_error = None
+            except Exception as e:
+                self.cycle_error = str(e)
+            self.last_cycle_seconds = time.time() - started
+            self._stop.wait(max(0.0, self.interval - self.last_cycle_seconds))
+
+    # ------------------------------------------------------------------
+    def latest(self, device_name):
+        """
+        单台设备最近一次轮询结果（纯内存读取）：
+        {"props": {identifier: (value, time_ms)}, "polled": ts, "error": str|None}，尚未轮询到时 props 为空
+        """
+        with self._lock:
+            entry = self._latest.get(device_name, {"props": {}, "polled": None, "error": None})
+            return {"props": dict(entry["props"]), "polled": entry["polled"], "error": entry["error"]}
+
+    def snapshot(self, now=None):
+        """返回设备表格行（纯内存读取）"""
+        now = time.time() if now is None else now
+        rows = []
+        with self._lock:
+            devices = list(self._devices)
+            latest = {k: dict(v) for k, v in self._latest.items()}
+        for name in devices:
+            entry = latest.get(name, {"props": {}, "polled": None, "error": None})
+            voltage, time_ms = entry["props"].get("voltage", (None, None))
+            pga, _ = entry["props"].get("pga", (None, None))
+            trace, _ = entry["props"].get("trace", (None, None))
+            flags = sample_flags(entry["props"])
+            staleness = None
+            if time_ms:
+                try:
+                    staleness = max(0.0, now - int(time_ms) / 1000.0)
+                except (TypeError, ValueError):
+                    pass
+            try:
+                voltage = float(voltage) if voltage is not None else None
+            except (TypeError, ValueError):
+                pass
+            rows.append({
+                "device": name,
+                "voltage": voltage,
+                "pga": pga,
+                "online": staleness is not None and staleness < ONLINE_THRESHOLD,
+                "staleness_s": staleness,
+                "error": entry["error"],
+                "trace": trace,
+                "flags": flags,
+            })
+        return rows
@@ -1,3 +1,4 @@
+import os
 import streamlit as st
 import requests
 import time
@@ -9,6 +10,13 @@ import hashlib
 import altair as alt
 from urllib.parse import quote
 
+from tsdb import TimeSeriesStore
+from chart_data import chart_payload, DEFAULT_CHART_WIDTH
+from fleet import FleetPoller, sample_flags
+from cs1237_proto import QFLAG_BAD, QFLAG_NAMES, QFLAG_TEXT, bit_names
+from alerts import AlertEngine, AlertLog, load_rules
+from tracelog import TraceLog
+
 # ==========================================
 # 配置区域
 # ==========================================
@@ -18,8 +26,34 @@ PRODUCT_ID = "6R9kiumZF1"
 DEVICE_NAME = "ESP32"
 ACCESS_KEY = "GdFdkQGP1YsRv129daPTa+nV07XtGSmjQ0ERl91jIRk="  # 用户提供的 AccessKey
 
-# OneNET Studio API 地址
-BASE_URL = "https://iot-api.heclouds.com"
+# OneNET Studio API 地址（压测时可用环境变量指向本地模拟服务 mock_onenet.py）
+BASE_URL = os.environ.get("ONENET_BASE_URL", "https://iot-api.heclouds.com")
+
+# 后台轮询参数：周期（秒）与最大并发请求数。
+# 告警在样本入库时评估，周期决定了样本上报到告警触发的最大延迟，不超过 1 秒
+FLEET_POLL_INTERVAL = 1.0
+FLEET_MAX_WORKERS = 8
+
+def voltage_series(device_name):
+    """本地历史数据序列名"""
+    return f"{PRODUCT_ID}/{device_name}/voltage"
+
+def flags_series(device_name):
+    """样本质量标志序列名（只记录标志不为 0 的样本）"""
+    return f"{PRODUCT_ID}/{device_name}/flags"
+
+# 历史数据显示范围（秒）
+HISTORY_RANGES = {
+    "最近 5 分钟": 300,
+    "最近 1 小时": 3600,
+    "最近 24 小时": 86400,
+    "最近 7 天": 7 * 86400,
+    "最近 30 天": 30 * 86400,
+}
+# 数据明细表最多显示的行数
+MAX_TABLE_ROWS = 500
+# 概览图（刷选缩放）的像素宽度，明细图按整页宽度取数
+OVERVIEW_CHART_WIDTH = 300
 
 # ==========================================
 # 核心逻辑函数
@@ -29,17 +63,22 @@ BASE_URL = "https://iot-api.heclouds.com"
 # 注意：这个 Token 有效期到 2030 年 (et=1923202207)
 FIXED_TOKEN = "version=2018-10-31&res=products%2F6R9kiumZF1%2Fdevices%2FESP32&et=1923202207&method=md5&sign=S9SRMkTDgNQcH9lEVh%2Bnew%3D%3D"
 
+FIXED_TOKEN_RES = f"products/{PRODUCT_ID}/devices/{DEVICE_NAME}"
+
 def get_token(res):
     """
-    直接返回已知的可用 Token，跳过本地计算，避免 Key 或算法不匹配的问题
+    默认设备直接返回已知可用的 Token，避免 Key 或算法不匹配的问题；
+    其他资源（设备群中的其他设备、产品级接口）按 AccessKey 动态生成
     """
-    return FIXED_TOKEN
+    if res == FIXED_TOKEN_RES:
+        return FIXED_TOKEN
+    return get_token_dynamic(res)
 
-# def get_token_dynamic(res):
-#     """
-#     (已禁用) 动态生成 Token
-#     """
-#     version = "2018-10-31"
+def get_token_dynamic(res):
+    """
+    动态生成 Token
+    """
+    version = "2018-10-31"
     # 过期时间：当前时间 + 100天 (简单起见)
     et = int(time.time()) + 3600 * 24 * 100
     method = "md5" # 改为 md5 以匹配 ESP32 的配置
@@ -58,53 +97,20 @@ def get_token(res):
     token = f"version={version}&res={res_encoded}&et={et}&method={method}&sign={sign_encoded}"
     return token
 
-def get_device_property(property_name):
-    """
-    查询设备属性最新值
-    API: /thingmodel/query-device-property
-    """
-    url = f"{BASE_URL}/thingmodel/query-device-property"
-    
-    # 资源标识符
-    res = f"products/{PRODUCT_ID}/devices/{DEVICE_NAME}"
-    token = get_token(res)
-    
-    headers = {
-        "Authorization": token
-    }
-    
-    params = {
-        "product_id": PRODUCT_ID,
-        "device_name": DEVICE_NAME
-    }
-    
-    try:
-        response = requests.get(url, headers=headers, params=params, timeout=5)
-        response.raise_for_status()
-        data = response.json()
-        
-        if data.get("code") == 0:
-            # 解析属性列表
-            properties = data.get("data", [])
-            for prop in properties:
-                if prop.get("identifier") == property_name:
-                    return prop.get("value"), prop.get("time")
-            return None, None
-        else:
-            st.error(f"API 错误: {data.get('msg')}")
-            return None, None
-    except Exception as e:
-        st.error(f"请求失败: {e}")
-        return None, None
+@st.cache_resource
+def get_http_session():
+    """共享 HTTP 连接池"""
+    return requests.Session()
 
 def set_device_property(params_dict):
     """
-    下发设备属性设置指令
+    下发设备属性设置指令（当前选中的设备）
     API: /thingmodel/set-device-property
     """
     url = f"{BASE_URL}/thingmodel/set-device-property"
+    device_name = st.session_state.device_name
     
-    res = f"products/{PRODUCT_ID}/devices/{DEVICE_NAME}"
+    res = f"products/{PRODUCT_ID}/devices/{device_name}"
     token = get_token(res)
     
     headers = {
@@ -114,12 +120,12 @@ def set_device_property(params_dict):
     
     body = {
         "product_id": PRODUCT_ID,
-        "device_name": DEVICE_NAME,
+        "device_name": device_name,
         "params": params_dict
     }
     
     try:
-        response = requests.post(url, headers=headers, json=body, timeout=5)
+        response = get_http_session().post(url, headers=headers, json=body, timeout=5)
         response.raise_for_status()
         data = response.json()
         
@@ -144,6 +150,35 @@ def set_device_property(params_dict):
         st.session_state.cmd_logs.insert(0, f"[{timestamp}] ❌ 异常: {params_dict} - {e}")
         return False, f"请求失败: {e}"
 
+@st.cache_resource
+def get_store():
+    """本地时序存储（所有会话共享，刷新页面不丢失）"""
+    store = TimeSeriesStore()
+    store.prune()
+    return store
+
+@st.cache_resource
+def get_alert_engine():
+    """告警引擎挂在存储写入路径上，每个新采样点写入时即评估"""
+    engine = AlertEngine(load_rules(), AlertLog())
+    get_store().add_listener(engine.on_samples)
+    return engine.start_ticker()
+
+@st.cache_resource
+def get_trace_log():
+    """延迟追踪记录（环境变量 SAMPLING_TRACE_PATH 指定输出文件）"""
+    return TraceLog()
+
+@st.cache_resource
+def get_fleet_poller():
+    """
+    后台轮询（所有会话共享一个调度线程）：默认设备和产品下发现的全部设备都在这里入库，
+    与打开哪个视图、是否有页面打开无关；页面只读取存储和内存快照
+    """
+    return FleetPoller(BASE_URL, PRODUCT_ID, get_token, store=get_store(),
+                       interval=FLEET_POLL_INTERVAL, max_workers=FLEET_MAX_WORKERS,
+                       trace_log=get_trace_log(), devices=[DEVICE_NAME]).start()
+
 # ==========================================
 # Streamlit 页面逻辑
 # ==========================================
@@ -154,6 +189,11 @@ st.set_page_config(
     layout="wide",
     initial_sidebar_state="expanded"
 )
+
+# 服务启动后的第一次运行即拉起告警引擎和后台轮询（先注册告警，再开始写入）
+alert_engine = get_alert_engine()
+get_fleet_poller()
+
 # --- 登录认证 ---
 if 'logged_in' not in st.session_state:
     st.session_state.logged_in = False
@@ -194,17 +234,24 @@ st.markdown("""
     </style>
     """, unsafe_allow_html=True)
 
-st.title("☁️ 控制台 ")
-st.caption(f"Product ID: {PRODUCT_ID} | Device: {DEVICE_NAME}")
-
 # 初始化 Session State
+if 'device_name' not in st.session_state:
+    st.session_state.device_name = DEVICE_NAME
+if 'view_mode' not in st.session_state:
+    st.session_state.view_mode = "单设备"
 if 'auto_refresh' not in st.session_state:
     st.session_state.auto_refresh = False
-if 'history_data' not in st.session_state:
-    st.session_state.history_data = []
+if 'history_range' not in st.session_state:
+    st.session_state.history_range = "最近 5 分钟"
 if 'cmd_logs' not in st.session_state:
     st.session_state.cmd_logs = []
 
+st.title("☁️ 控制台 ")
+if st.session_state.view_mode == "设备群":
+    st.caption(f"Product ID: {PRODUCT_ID} | 设备群")
+else:
+    st.caption(f"Product ID: {PRODUCT_ID} | Device: {st.session_state.device_name}")
+
 # --- 侧边栏：控制面板 ---
 with st.sidebar:
     # 用户信息与注销
@@ -218,7 +265,11 @@ with st.sidebar:
                 st.rerun()
     st.divider()
 
+    st.radio("视图", ["单设备", "设备群"], key="view_mode", horizontal=True)
+    st.divider()
+
     st.header("🎮 远程控制")
+    st.caption(f"当前设备: {st.session_state.device_name}")
     
     # 1. 采集控制
     with st.expander("📡 采集控制", expanded=True):
@@ -269,35 +320,93 @@ with st.sidebar:
     else:
         st.session_state.auto_refresh = False
         
+    st.selectbox("历史数据范围", list(HISTORY_RANGES.keys()), key="history_range")
+
     if st.button("🗑️ 清空历史数据", use_container_width=True):
-        st.session_state.history_data = []
+        get_store().clear(voltage_series(st.session_state.device_name))
         st.rerun()
         
     if st.button("🧹 清空操作日志", use_container_width=True):
         st.session_state.cmd_logs = []
         st.rerun()
 
+def active_alerts_by_series():
+    result = {}
+    for series_name, rule in alert_engine.active():
+        result.setdefault(series_name, []).append(rule.name)
+    return result
+
+# --- 设备群视图 ---
+
+def open_device(name):
+    """从设备群表格进入单设备详情"""
+    st.session_state.device_name = name
+    st.session_state.view_mode = "单设备"
+
+if st.session_state.view_mode == "设备群":
+    # 数据由后台调度线程批量轮询，这里只读取内存快照
+    poller = get_fleet_poller()
+    rows = poller.snapshot()
+    alerts_by_series = active_alerts_by_series()
+    for r in rows:
+        r["alerts"] = "、".join(alerts_by_series.get(voltage_series(r["device"]), []))
+
+    f1, f2, f3, f4 = st.columns(4)
+    f1.metric("📟 设备总数", len(rows))
+    f2.metric("🟢 在线", sum(1 for r in rows if r["online"]))
+    f3.metric("🚨 告警设备", sum(1 for r in rows if r["alerts"]))
+    f4.metric("⏱️ 轮询周期耗时",
+              f"{poller.last_cycle_seconds:.2f} 秒" if poller.last_cycle_seconds is not None else "--")
+    if poller.discover_error:
+        st.warning(f"设备列表获取失败: {poller.discover_error}")
+    if poller.cycle_error:
+        st.warning(f"上一轮轮询出错: {poller.cycle_error}")
+
+    if rows:
+        df = pd.DataFrame(rows)
+        df["status"] = df["online"].map({True: "🟢 在线", False: "🔴 离线/未知"})
+        df["quality"] = df["flags"].map(lambda f: "、".join(bit_names(f, QFLAG_NAMES)) if f else "")
+        df = df[["device", "voltage", "pga", "quality", "status", "staleness_s", "alerts", "error"]].rename(columns={
+            "device": "设备", "voltage": "电压 (V)", "pga": "PGA", "quality": "样本标志",
+            "status": "状态", "staleness_s": "未更新 (秒)", "alerts": "告警", "error": "错误",
+        })
+        # 表头可点击排序
+        st.dataframe(df, use_container_width=True, hide_index=True,
+                     column_config={"电压 (V)": st.column_config.NumberColumn(format="%.4f"),
+                                    "未更新 (秒)": st.column_config.NumberColumn(format="%.0f")})
+        for r in rows:
+            get_trace_log().mark("render", r["device"], r["trace"])
+
+        col_sel, col_btn = st.columns([3, 1])
+        with col_sel:
+            selected = st.selectbox("查看设备详情", [r["device"] for r in rows], label_visibility="collapsed")
+        with col_btn:
+            st.button("🔍 查看详情", use_container_width=True, on_click=open_device, args=(selected,))
+    else:
+        st.info("正在获取设备列表...")
+
+    if st.session_state.auto_refresh:
+        time.sleep(3)
+        st.rerun()
+    st.stop()
+
 # --- 主页面逻辑 ---
 
-# 获取最新数据
-voltage_val, voltage_time = get_device_property("voltage")
-pga_val, _ = get_device_property("pga")
+# 最新数据取自后台轮询的内存快照，入库与告警评估都在轮询线程中完成，这里不发网络请求
+series = voltage_series(st.session_state.device_name)
+latest = get_fleet_poller().latest(st.session_state.device_name)
+props = latest["props"]
+if latest["error"]:
+    st.error(f"请求失败: {latest['error']}")
+voltage_val, voltage_time = props.get("voltage", (None, None))
+pga_val, _ = props.get("pga", (None, None))
+trace_val, _ = props.get("trace", (None, None))
+flags_val = sample_flags(props)
 
-# 数据处理与缓存
-if voltage_val is not None:
-    try:
-        v_float = float(voltage_val)
-        current_entry = {"time": time.strftime("%H:%M:%S"), "voltage": v_float}
-        
-        # 简单去重：如果时间和数值都一样，或者时间非常接近（这里只判断时间字符串）
-        if not st.session_state.history_data or st.session_state.history_data[-1]["time"] != current_entry["time"]:
-            st.session_state.history_data.append(current_entry)
-    except:
-        pass
-    
-    # 保持最近 50 个点
-    if len(st.session_state.history_data) > 50:
-        st.session_state.history_data.pop(0)
+store = get_store()
+range_end = time.time()
+range_start = range_end - HISTORY_RANGES[st.session_state.history_range]
+history = store.query(series, range_start, range_end, max_points=MAX_TABLE_ROWS)
 
 # 顶部指标栏
 m1, m2, m3, m4 = st.columns(4)
@@ -342,49 +451,97 @@ with m4:
     status = "🟢 在线" if is_online else "🔴 离线/未知"
     st.metric("📡 设备状态", status)
 
+if flags_val:
+    notes = "；".join(QFLAG_TEXT[bit] for bit in QFLAG_NAMES if bit & (bit - 1) == 0 and flags_val & bit)
+    if flags_val & QFLAG_BAD:
+        st.warning(f"当前样本已由下位机标为不可用，未计入历史：{notes}")
+    else:
+        st.info(f"当前样本：{notes}")
+
+# 指标栏已输出，记为该样本的渲染时间
+get_trace_log().mark("render", st.session_state.device_name, trace_val)
+
 # 页面主体 Tabs
-tab1, tab2, tab3 = st.tabs(["📈 实时监控", "📊 数据明细", "📝 操作日志"])
+tab1, tab2, tab3, tab4 = st.tabs(["📈 实时监控", "📊 数据明细", "📝 操作日志", "🚨 告警"])
+
+def to_chart_df(rows):
+    df = pd.DataFrame(rows, columns=["ts", "voltage"])
+    df["time"] = pd.to_datetime(df["ts"], unit="s", utc=True).dt.tz_convert("Asia/Shanghai")
+    return df
 
 with tab1:
-    if st.session_state.history_data:
-        df = pd.DataFrame(st.session_state.history_data)
-        
-        # 统计信息
+    overview = chart_payload(store, series, range_start, range_end, width=OVERVIEW_CHART_WIDTH)
+    if overview["rows"]:
+        # 概览图：拖动刷选时间段，明细图只重新查询该时间段
+        brush = alt.selection_interval(encodings=['x'], name='brush')
+        overview_chart = alt.Chart(to_chart_df(overview["rows"])).mark_line(color='#FF4B4B').encode(
+            x=alt.X('time:T', title=None),
+            y=alt.Y('voltage', title=None, scale=alt.Scale(zero=False)),
+        ).properties(
+            height=80
+        ).add_params(brush)
+        event = st.altair_chart(overview_chart, use_container_width=True,
+                                on_select="rerun", key="overview_chart")
+
+        zoom_start, zoom_end = range_start, range_end
+        selected = event.selection.get("brush", {}) if event else {}
+        if selected.get("time"):
+            # 时间轴的刷选范围可能是毫秒时间戳或 ISO 字符串
+            lo, hi = [pd.to_datetime(v, unit="ms", utc=True) if isinstance(v, (int, float))
+                      else pd.to_datetime(v, utc=True) for v in selected["time"]]
+            zoom_start = max(range_start, lo.timestamp())
+            zoom_end = min(range_end, hi.timestamp())
+
+        detail = chart_payload(store, series, zoom_start, zoom_end, width=DEFAULT_CHART_WIDTH)
+        stats = detail["stats"]
+
+        # 统计信息（由存储的分层汇总精确计算，与点数无关）
         c1, c2, c3 = st.columns(3)
-        c1.info(f"最高: {df['voltage'].max():.4f} V")
-        c2.info(f"最低: {df['voltage'].min():.4f} V")
-        c3.info(f"平均: {df['voltage'].mean():.4f} V")
-        
+        if stats["count"]:
+            c1.info(f"最高: {stats['max']:.4f} V")
+            c2.info(f"最低: {stats['min']:.4f} V")
+            c3.info(f"平均: {stats['mean']:.4f} V")
+        caption = f"区间内 {stats['count']} 个采样点"
+        if detail["step"]:
+            caption += f"，按 {detail['step']} 秒分桶 (M4) 显示 {len(detail['rows'])} 个点"
+        if (zoom_start, zoom_end) != (range_start, range_end):
+            caption += "（已缩放，在概览图空白处单击可还原）"
+        st.caption(caption)
+
         # 图表
-        y_min = df['voltage'].min() * 0.95
-        y_max = df['voltage'].max() * 1.05
-        if y_min == y_max:
-            y_min -= 0.1
-            y_max += 0.1
-
-        chart = alt.Chart(df).mark_area(
-            line={'color':'#FF4B4B'},
-            color=alt.Gradient(
-                gradient='linear',
-                stops=[alt.GradientStop(color='#FF4B4B', offset=0),
-                       alt.GradientStop(color='white', offset=1)],
-                x1=1, x2=1, y1=1, y2=0
+        if detail["rows"]:
+            df = to_chart_df(detail["rows"])
+            y_min = df['voltage'].min() * 0.95
+            y_max = df['voltage'].max() * 1.05
+            if y_min == y_max:
+                y_min -= 0.1
+                y_max += 0.1
+
+            chart = alt.Chart(df).mark_area(
+                line={'color':'#FF4B4B'},
+                color=alt.Gradient(
+                    gradient='linear',
+                    stops=[alt.GradientStop(color='#FF4B4B', offset=0),
+                           alt.GradientStop(color='white', offset=1)],
+                    x1=1, x2=1, y1=1, y2=0
+                )
+            ).encode(
+                x=alt.X('time:T', title='时间'),
+                y=alt.Y('voltage', title='电压 (V)', scale=alt.Scale(domain=[y_min, y_max])),
+                tooltip=['time', 'voltage']
+            ).properties(
+                height=400
             )
-        ).encode(
-            x=alt.X('time', title='时间'),
-            y=alt.Y('voltage', title='电压 (V)', scale=alt.Scale(domain=[y_min, y_max])),
-            tooltip=['time', 'voltage']
-        ).properties(
-            height=400
-        ).interactive()
-        
-        st.altair_chart(chart, use_container_width=True)
+
+            st.altair_chart(chart, use_container_width=True)
     else:
         st.info("暂无历史数据，请等待数据刷新...")
 
 with tab2:
-    if st.session_state.history_data:
-        df = pd.DataFrame(st.session_state.history_data)
+    if history["points"]:
+        df = pd.DataFrame(history["points"], columns=["ts", "min", "max", "voltage", "count", "first", "last"])
+        df.insert(0, "time", pd.to_datetime(df["ts"], unit="s", utc=True).dt.tz_convert("Asia/Shanghai"))
+        df = df.drop(columns=["ts"])
         st.dataframe(df, use_container_width=True)
         
         csv = df.to_csv(index=False).encode('utf-8')
@@ -405,6 +562,25 @@ with tab3:
     else:
         st.caption("暂无操作日志")
 
+with tab4:
+    active = active_alerts_by_series().get(series, [])
+    if active:
+        st.error("当前告警: " + "、".join(active))
+    else:
+        st.success("当前无告警")
+
+    events = alert_engine.log.recent(limit=200, series=series)
+    if events:
+        df = pd.DataFrame(events)
+        df["ts"] = pd.to_datetime(df["ts"], unit="s", utc=True).dt.tz_convert("Asia/Shanghai")
+        df["state"] = df["state"].map({"firing": "🔴 触发", "resolved": "🟢 恢复"})
+        df = df[["ts", "state", "rule", "severity", "message"]].rename(columns={
+            "ts": "时间", "state": "状态", "rule": "规则", "severity": "级别", "message": "说明",
+        })
+        st.dataframe(df, use_container_width=True, hide_index=True)
+    else:
+        st.caption("暂无告警事件")
+
 # 自动刷新触发
 if st.session_state.auto_refresh:
     time.sleep(3)
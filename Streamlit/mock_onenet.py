@@ -0,0 +1,637 @@
+"""
+本地 OneNET 模拟服务（用于压测控制台和 ESP32 桥接，不访问真实平台）
+
+实现我们用到的接口子集:
+- HTTP  GET  /thingmodel/query-device-property
+- HTTP  POST /thingmodel/set-device-property   (经 MQTT 下发 property/set，等待 set_reply)
+- HTTP  GET  /device/list                       (产品下的设备列表，分页)
+- MQTT  CONNECT (username=产品ID, client_id=设备名, password=Token)
+        $sys/{pid}/{dev}/thing/property/post       -> 更新属性并回复 post/reply
+        $sys/{pid}/{dev}/thing/property/set        <- 由 set-device-property 下发
+        $sys/{pid}/{dev}/thing/property/set_reply  -> 完成对应的下发请求
+- Token 校验（res / et，配置了 AccessKey 时同时校验签名）
+
+测试辅助接口:
+- GET  /mock/requests  返回记录的全部请求（HTTP 与 MQTT）
+- POST /mock/reset     清空记录
+- POST /mock/config    运行时修改延迟/错误注入参数，例如 {"latency_ms": 50, "error_rate": 0.1}
+
+上报消息带追踪号（params.trace）时，mqtt_publish 与 PUBACK 之后的 mqtt_puback 记录带 trace 字段，
+--record 的输出可交给 trace_merge.py 计算各环节延迟。
+
+没有真实设备时可用 --fake-device 生成虚拟设备：按 --fake-rate 周期更新 voltage/pga 属性，
+属性下发直接应用并返回成功。
+
+用法:
+    python mock_onenet.py --http-port 8080 --mqtt-port 1883 --latency-ms 30 --error-rate 0.01
+控制台通过环境变量 ONENET_BASE_URL=http://127.0.0.1:8080 指向本服务，
+ESP32 固件编译时定义 ONENET_MQTT_URI="mqtt://<主机IP>:1883"。
+"""
+import argparse
+import base64
+import hashlib
+import hmac
+import json
+import random
+import socket
+import socketserver
+import struct
+import threading
+import time
+import uuid
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, quote, unquote, urlparse
+
+# MQTT 报文类型
+MQTT_CONNECT = 1
+MQTT_CONNACK = 2
+MQTT_PUBLISH = 3
+MQTT_PUBACK = 4
+MQTT_SUBSCRIBE = 8
+MQTT_SUBACK = 9
+MQTT_UNSUBSCRIBE = 10
+MQTT_UNSUBACK = 11
+MQTT_PINGREQ = 12
+MQTT_PINGRESP = 13
+MQTT_DISCONNECT = 14
+
+# CONNACK 返回码
+CONNACK_ACCEPTED = 0
+CONNACK_BAD_CREDENTIALS = 4
+CONNACK_NOT_AUTHORIZED = 5
+
+# 模拟服务的 HTTP 错误码（code 字段，0 表示成功）
+CODE_OK = 0
+CODE_AUTH_FAILED = 1001
+CODE_BAD_PARAMS = 1002
+CODE_DEVICE_OFFLINE = 1003
+CODE_TIMEOUT = 1004
+CODE_INJECTED = 1099
+
+
+# ==========================================
+# Token 校验
+# ==========================================
+
+def parse_token(token):
+    """解析 'version=..&res=..&et=..&method=..&sign=..'，返回 dict（值已 URL 解码）"""
+    fields = {}
+    for part in (token or "").split("&"):
+        if "=" in part:
+            k, v = part.split("=", 1)
+            fields[k] = unquote(v)
+    return fields
+
+
+def sign_token(fields, access_key):
+    """按 OneNET 规则计算签名: base64(hmac(key, et\\nmethod\\nres\\nversion))"""
+    digest = {"md5": hashlib.md5, "sha1": hashlib.sha1, "sha256": hashlib.sha256}.get(fields.get("method"))
+    if digest is None:
+        return None
+    sign_str = f"{fields['et']}\n{fields['method']}\n{quote(fields['res'], safe='')}\n{fields['version']}"
+    key = base64.b64decode(access_key)
+    return base64.b64encode(hmac.new(key, sign_str.encode("utf-8"), digest).digest()).decode("utf-8")
+
+
+class TokenChecker:
+    def __init__(self, access_key=None, accepted_tokens=()):
+        self.access_key = access_key
+        self.accepted_tokens = set(accepted_tokens)
+
+    def check(self, token, product_id, device_name=None):
+        """返回 None 表示通过，否则返回失败原因"""
+        if token in self.accepted_tokens:
+            return None
+        fields = parse_token(token)
+        for key in ("version", "res", "et", "method", "sign"):
+            if key not in fields:
+                return f"token 缺少字段 {key}"
+        allowed = {f"products/{product_id}"}
+        if device_name:
+            allowed.add(f"products/{product_id}/devices/{device_name}")
+        if fields["res"] not in allowed:
+            return f"token res 不匹配: {fields['res']}"
+        try:
+            if int(fields["et"]) < time.time():
+                return "token 已过期"
+        except ValueError:
+            return "token et 无效"
+        if self.access_key and sign_token(fields, self.access_key) != fields["sign"]:
+            return "token 签名错误"
+        return None
+
+
+# ==========================================
+# 共享状态
+# ==========================================
+
+class MockState:
+    def __init__(self, token_checker, latency_ms=0.0, jitter_ms=0.0, error_rate=0.0,
+                 set_timeout=5.0, record_path=None):
+        self.lock = threading.Lock()
+        self.tokens = token_checker
+        self.latency_ms = latency_ms
+        self.jitter_ms = jitter_ms
+        self.error_rate = error_rate
+        self.set_timeout = set_timeout
+
+        self.properties = {}     # (pid, dev) -> {identifier: (value, time_ms)}
+        self.sessions = {}       # (pid, dev) -> MqttSession
+        self.pending_sets = {}   # request id -> [threading.Event, reply dict]
+        self.fake_devices = set()  # (pid, dev)
+        self.records = []
+        self.record_file = open(record_path, "a", encoding="utf-8") if record_path else None
+
+    # --- 延迟与错误注入 ---
+    def delay(self):
+        if self.latency_ms or self.jitter_ms:
+            t = self.latency_ms + random.uniform(-self.jitter_ms, self.jitter_ms)
+            if t > 0:
+                time.sleep(t / 1000.0)
+
+    def inject_error(self):
+        return self.error_rate > 0 and random.random() < self.error_rate
+
+    # --- 请求记录 ---
+    def record(self, kind, **fields):
+        entry = {"t": time.time(), "kind": kind}
+        entry.update(fields)
+        with self.lock:
+            self.records.append(entry)
+            if self.record_file:
+                self.record_file.write(json.dumps(entry, ensure_ascii=False) + "\n")
+                self.record_file.flush()
+
+    # --- 设备属性 ---
+    def update_properties(self, pid, dev, params, time_ms):
+        with self.lock:
+            props = self.properties.setdefault((pid, dev), {})
+            for identifier, item in params.items():
+                value = item.get("value") if isinstance(item, dict) else item
+                props[identifier] = (value, item.get("time", time_ms) if isinstance(item, dict) else time_ms)
+
+    def get_properties(self, pid, dev):
+        with self.lock:
+            return dict(self.properties.get((pid, dev), {}))
+
+    def list_devices(self, pid):
+        """产品下出现过的设备（上报过属性、在线或虚拟设备），返回 [(name, online)]"""
+        with self.lock:
+            names = {d for p, d in self.properties if p == pid}
+            names.update(d for p, d in self.sessions if p == pid)
+            names.update(d for p, d in self.fake_devices if p == pid)
+            online = {d for p, d in self.sessions if p == pid}
+            online.update(d for p, d in self.fake_devices if p == pid)
+        return [(name, name in online) for name in sorted(names)]
+
+
+# ==========================================
+# MQTT Broker（3.1.1 子集：QoS0/1 收，QoS0 发）
+# ==========================================
+
+def _encode_remaining_length(n):
+    out = bytearray()
+    while True:
+        byte = n % 128
+        n //= 128
+        if n:
+            byte |= 0x80
+        out.append(byte)
+        if not n:
+            return bytes(out)
+
+
+def _mqtt_str(s):
+    data = s.encode("utf-8")
+    return struct.pack("!H", len(data)) + data
+
+
+def _read_str(buf, pos):
+    (n,) = struct.unpack_from("!H", buf, pos)
+    pos += 2
+    return buf[pos:pos + n].decode("utf-8", errors="replace"), pos + n
+
+
+def trace_id_of(payload):
+    """上报消息中的追踪号 params.trace，没有时返回 None"""
+    try:
+        item = json.loads(payload)["params"]["trace"]
+        return int(item["value"] if isinstance(item, dict) else item)
+    except (ValueError, TypeError, KeyError):
+        return None
+
+
+def topic_matches(pattern, topic):
+    """支持 '+' 与 '#' 通配符的主题匹配"""
+    p_parts = pattern.split("/")
+    t_parts = topic.split("/")
+    for i, p in enumerate(p_parts):
+        if p == "#":
+            return True
+        if i >= len(t_parts) or (p != "+" and p != t_parts[i]):
+            return False
+    return len(p_parts) == len(t_parts)
+
+
+class MqttSession:
+    def __init__(self, sock, product_id, device_name):
+        self.sock = sock
+        self.product_id = product_id
+        self.device_name = device_name
+        self.subscriptions = set()
+        self.send_lock = threading.Lock()
+
+    def send(self, packet_type, flags, body):
+        header = bytes([(packet_type << 4) | flags]) + _encode_remaining_length(len(body))
+        with self.send_lock:
+            self.sock.sendall(header + body)
+
+    def publish(self, topic, payload):
+        if isinstance(payload, str):
+            payload = payload.encode("utf-8")
+        self.send(MQTT_PUBLISH, 0, _mqtt_str(topic) + payload)
+
+
+class MqttHandler(socketserver.BaseRequestHandler):
+    state = None  # 由 serve() 注入
+
+    def _recv_exact(self, n):
+        data = bytearray()
+        while len(data) < n:
+            chunk = self.request.recv(n - len(data))
+            if not chunk:
+                raise ConnectionError("closed")
+            data.extend(chunk)
+        return bytes(data)
+
+    def _read_packet(self):
+        first = self._recv_exact(1)[0]
+        multiplier, length = 1, 0
+        while True:
+            byte = self._recv_exact(1)[0]
+            length += (byte & 0x7F) * multiplier
+            if not byte & 0x80:
+                break
+            multiplier *= 128
+        body = self._recv_exact(length) if length else b""
+        return first >> 4, first & 0x0F, body
+
+    def handle(self):
+        state = self.state
+        session = None
+        try:
+            ptype, _, body = self._read_packet()
+            if ptype != MQTT_CONNECT:
+                return
+            session = self._handle_connect(body)
+            if session is None:
+                return
+            while True:
+                ptype, flags, body = self._read_packet()
+                if ptype == MQTT_PUBLISH:
+                    self._handle_publish(session, flags, body)
+                elif ptype == MQTT_SUBSCRIBE:
+                    (pid,) = struct.unpack_from("!H", body, 0)
+                    pos, granted = 2, bytearray()
+                    while pos < len(body):
+                        topic, pos = _read_str(body, pos)
+                        pos += 1  # 请求的 QoS，统一授予 QoS0
+                        session.subscriptions.add(topic)
+                        granted.append(0)
+                        state.record("mqtt_subscribe", device=session.device_name, topic=topic)
+                    session.send(MQTT_SUBACK, 0, struct.pack("!H", pid) + bytes(granted))
+                elif ptype == MQTT_UNSUBSCRIBE:
+                    (pid,) = struct.unpack_from("!H", body, 0)
+                    pos = 2
+                    while pos < len(body):
+                        topic, pos = _read_str(body, pos)
+                        session.subscriptions.discard(topic)
+                    session.send(MQTT_UNSUBACK, 0, struct.pack("!H", pid))
+                elif ptype == MQTT_PINGREQ:
+                    session.send(MQTT_PINGRESP, 0, b"")
+                elif ptype == MQTT_DISCONNECT:
+                    break
+        except (ConnectionError, OSError, struct.error):
+            pass
+        finally:
+            if session is not None:
+                key = (session.product_id, session.device_name)
+                with state.lock:
+                    if state.sessions.get(key) is session:
+                        del state.sessions[key]
+                state.record("mqtt_disconnect", device=session.device_name)
+
+    def _handle_connect(self, body):
+        state = self.state
+        _, pos = _read_str(body, 0)          # 协议名 "MQTT"
+        pos += 1                             # 协议级别
+        flags = body[pos]
+        pos += 3                             # flags + keepalive
+        client_id, pos = _read_str(body, pos)
+        if flags & 0x04:                     # will topic / will message
+            _, pos = _read_str(body, pos)
+            _, pos = _read_str(body, pos)
+        username = password = ""
+        if flags & 0x80:
+            username, pos = _read_str(body, pos)
+        if flags & 0x40:
+            password, pos = _read_str(body, pos)
+
+        state.delay()
+        reason = state.tokens.check(password, username, client_id)
+        state.record("mqtt_connect", product_id=username, device=client_id, ok=reason is None, reason=reason)
+        if reason is not None:
+            self.request.sendall(bytes([MQTT_CONNACK << 4, 2, 0, CONNACK_NOT_AUTHORIZED]))
+            return None
+
+        session = MqttSession(self.request, username, client_id)
+        with state.lock:
+            old = state.sessions.get((username, client_id))
+            state.sessions[(username, client_id)] = session
+        if old is not None:
+            # 同一设备重复登录，踢掉旧连接
+            try:
+                old.sock.shutdown(socket.SHUT_RDWR)
+            except OSError:
+                pass
+        session.send(MQTT_CONNACK, 0, bytes([0, CONNACK_ACCEPTED]))
+        return session
+
+    def _handle_publish(self, session, flags, body):
+        state = self.state
+        qos = (flags >> 1) & 0x03
+        topic, pos = _read_str(body, 0)
+        packet_id = None
+        if qos:
+            (packet_id,) = struct.unpack_from("!H", body, pos)
+            pos += 2
+        payload = body[pos:]
+        trace = trace_id_of(payload)
+        traced = {"trace": trace} if trace is not None else {}
+        state.record("mqtt_publish", device=session.device_name, topic=topic,
+                     payload=payload.decode("utf-8", errors="replace"), **traced)
+
+        state.delay()
+        if state.inject_error():
+            # 模拟平台丢弃消息：不回 PUBACK，不处理
+            state.record("mqtt_dropped", device=session.device_name, topic=topic)
+            return
+        if qos:
+            session.send(MQTT_PUBACK, 0, struct.pack("!H", packet_id))
+            if traced:
+                state.record("mqtt_puback", device=session.device_name, **traced)
+
+        prefix = f"$sys/{session.product_id}/{session.device_name}/thing/property/"
+        if topic == prefix + "post":
+            try:
+                msg = json.loads(payload)
+                state.update_properties(session.product_id, session.device_name,
+                                        msg.get("params", {}), int(time.time() * 1000))
+                code, text = 200, "success"
+            except (ValueError, AttributeError):
+                msg, code, text = {}, 400, "invalid json"
+            reply = json.dumps({"id": str(msg.get("id", "")), "code": code, "msg": text})
+            if any(topic_matches(s, prefix + "post/reply") for s in session.subscriptions):
+                session.publish(prefix + "post/reply", reply)
+        elif topic == prefix + "set_reply":
+            try:
+                msg = json.loads(payload)
+            except ValueError:
+                return
+            with state.lock:
+                pending = state.pending_sets.get(str(msg.get("id")))
+            if pending:
+                pending[1] = msg
+                pending[0].set()
+
+
+# ==========================================
+# HTTP API
+# ==========================================
+
+class HttpHandler(BaseHTTPRequestHandler):
+    state = None  # 由 serve() 注入
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, format, *args):
+        pass
+
+    def _reply(self, status, obj):
+        body = json.dumps(obj, ensure_ascii=False).encode("utf-8")
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def _reply_code(self, code, msg, data=None):
+        self._reply(200, {"code": code, "msg": msg, "data": data, "request_id": uuid.uuid4().hex})
+
+    def _body(self):
+        length = int(self.headers.get("Content-Length") or 0)
+        raw = self.rfile.read(length) if length else b""
+        try:
+            return json.loads(raw) if raw else {}
+        except ValueError:
+            return None
+
+    def do_GET(self):
+        state = self.state
+        url = urlparse(self.path)
+        query = {k: v[0] for k, v in parse_qs(url.query).items()}
+
+        if url.path == "/mock/requests":
+            with state.lock:
+                records = list(state.records)
+            self._reply(200, records)
+            return
+
+        state.record("http", method="GET", path=url.path, params=query)
+        state.delay()
+        if state.inject_error():
+            self._reply(500, {"code": CODE_INJECTED, "msg": "injected error"})
+            return
+
+        if url.path == "/thingmodel/query-device-property":
+            pid, dev = query.get("product_id"), query.get("device_name")
+            if not pid or not dev:
+                self._reply_code(CODE_BAD_PARAMS, "缺少 product_id/device_name")
+                return
+            reason = state.tokens.check(self.headers.get("Authorization"), pid, dev)
+            if reason:
+                self._reply_code(CODE_AUTH_FAILED, reason)
+                return
+            data = [{"identifier": k, "value": str(v), "time": t}
+                    for k, (v, t) in sorted(state.get_properties(pid, dev).items())]
+            self._reply_code(CODE_OK, "succ", data)
+        elif url.path == "/device/list":
+            pid = query.get("product_id")
+            if not pid:
+                self._reply_code(CODE_BAD_PARAMS, "缺少 product_id")
+                return
+            reason = state.tokens.check(self.headers.get("Authorization"), pid)
+            if reason:
+                self._reply_code(CODE_AUTH_FAILED, reason)
+                return
+            offset = int(query.get("offset", 0))
+            limit = int(query.get("limit", 10))
+            devices = state.list_devices(pid)
+            page = [{"name": name, "status": 1 if online else 0}
+                    for name, online in devices[offset:offset + limit]]
+            self._reply_code(CODE_OK, "succ",
+                             {"offset": offset, "limit": limit, "total": len(devices), "list": page})
+        else:
+            self._reply(404, {"code": CODE_BAD_PARAMS, "msg": "not found"})
+
+    def do_POST(self):
+        state = self.state
+        url = urlparse(self.path)
+        body = self._body()
+
+        if url.path == "/mock/reset":
+            with state.lock:
+                state.records.clear()
+            self._reply(200, {"ok": True})
+            return
+        if url.path == "/mock/config":
+            for key in ("latency_ms", "jitter_ms", "error_rate", "set_timeout"):
+                if body and key in body:
+                    setattr(state, key, float(body[key]))
+            self._reply(200, {"ok": True})
+            return
+
+        state.record("http", method="POST", path=url.path, body=body)
+        state.delay()
+        if state.inject_error():
+            self._reply(500, {"code": CODE_INJECTED, "msg": "injected error"})
+            return
+        if body is None:
+            self._reply_code(CODE_BAD_PARAMS, "invalid json")
+            return
+
+        if url.path == "/thingmodel/set-device-property":
+            self._set_device_property(body)
+        else:
+            self._reply(404, {"code": CODE_BAD_PARAMS, "msg": "not found"})
+
+    def _set_device_property(self, body):
+        state = self.state
+        pid, dev, params = body.get("product_id"), body.get("device_name"), body.get("params")
+        if not pid or not dev or not isinstance(params, dict):
+            self._reply_code(CODE_BAD_PARAMS, "缺少 product_id/device_name/params")
+            return
+        reason = state.tokens.check(self.headers.get("Authorization"), pid, dev)
+        if reason:
+            self._reply_code(CODE_AUTH_FAILED, reason)
+            return
+
+        if (pid, dev) in state.fake_devices:
+            state.update_properties(pid, dev, params, int(time.time() * 1000))
+            self._reply_code(CODE_OK, "succ")
+            return
+
+        with state.lock:
+            session = state.sessions.get((pid, dev))
+        topic = f"$sys/{pid}/{dev}/thing/property/set"
+        if session is None or not any(topic_matches(s, topic) for s in session.subscriptions):
+            self._reply_code(CODE_DEVICE_OFFLINE, "设备不在线")
+            return
+
+        request_id = str(random.randint(1, 2**31 - 1))
+        pending = [threading.Event(), None]
+        with state.lock:
+            state.pending_sets[request_id] = pending
+        try:
+            session.publish(topic, json.dumps({"id": request_id, "version": "1.0", "params": params}))
+            if not pending[0].wait(state.set_timeout):
+                self._reply_code(CODE_TIMEOUT, "设备响应超时")
+                return
+        finally:
+            with state.lock:
+                state.pending_sets.pop(request_id, None)
+
+        reply = pending[1]
+        if reply.get("code") == 200:
+            self._reply_code(CODE_OK, "succ", reply.get("data"))
+        else:
+            self._reply_code(reply.get("code", -1), reply.get("msg", "设备返回错误"))
+
+
+# ==========================================
+# 启动
+# ==========================================
+
+def serve(state, host="0.0.0.0", http_port=8080, mqtt_port=1883):
+    """启动 HTTP 与 MQTT 服务（后台线程），返回 (http_server, mqtt_server)"""
+    http_handler = type("BoundHttpHandler", (HttpHandler,), {"state": state})
+    mqtt_handler = type("BoundMqttHandler", (MqttHandler,), {"state": state})
+
+    http_server = ThreadingHTTPServer((host, http_port), http_handler)
+    socketserver.ThreadingTCPServer.allow_reuse_address = True
+    mqtt_server = socketserver.ThreadingTCPServer((host, mqtt_port), mqtt_handler)
+    mqtt_server.daemon_threads = True
+    http_server.daemon_threads = True
+
+    threading.Thread(target=http_server.serve_forever, daemon=True).start()
+    threading.Thread(target=mqtt_server.serve_forever, daemon=True).start()
+    return http_server, mqtt_server
+
+
+def run_fake_devices(state, devices, rate_hz):
+    """虚拟设备：随机游走的电压值，按固定频率写入属性"""
+    values = {key: random.uniform(0.5, 2.5) for key in devices}
+    state.fake_devices.update(devices)
+    for pid, dev in devices:
+        state.update_properties(pid, dev, {"pga": 128}, int(time.time() * 1000))
+    period = 1.0 / rate_hz
+    while True:
+        now_ms = int(time.time() * 1000)
+        for key in devices:
+            values[key] += random.gauss(0, 0.002)
+            state.update_properties(key[0], key[1], {"voltage": round(values[key], 6)}, now_ms)
+        time.sleep(period)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="本地 OneNET 模拟服务")
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--http-port", type=int, default=8080)
+    parser.add_argument("--mqtt-port", type=int, default=1883)
+    parser.add_argument("--latency-ms", type=float, default=0.0, help="每个请求的平均附加延迟")
+    parser.add_argument("--jitter-ms", type=float, default=0.0, help="延迟抖动（均匀分布 ±jitter）")
+    parser.add_argument("--error-rate", type=float, default=0.0, help="错误注入概率 0~1")
+    parser.add_argument("--set-timeout", type=float, default=5.0, help="等待 set_reply 的超时（秒）")
+    parser.add_argument("--access-key", default=None, help="配置后校验 Token 签名")
+    parser.add_argument("--accept-token", action="append", default=[], help="无条件接受的 Token（可多次指定）")
+    parser.add_argument("--record", default=None, help="请求记录输出文件（JSON Lines）")
+    parser.add_argument("--fake-device", action="append", default=[], metavar="PID/DEV",
+                        help="虚拟设备（可多次指定），DEV 可写成 前缀*数量，如 6R9kiumZF1/NODE*100")
+    parser.add_argument("--fake-rate", type=float, default=1.0, help="虚拟设备属性更新频率（Hz）")
+    args = parser.parse_args()
+
+    state = MockState(TokenChecker(args.access_key, args.accept_token),
+                      latency_ms=args.latency_ms, jitter_ms=args.jitter_ms,
+                      error_rate=args.error_rate, set_timeout=args.set_timeout,
+                      record_path=args.record)
+    serve(state, args.host, args.http_port, args.mqtt_port)
+
+    fake = []
+    for spec in args.fake_device:
+        pid, dev = spec.split("/", 1)
+        if "*" in dev:
+            prefix, count = dev.split("*", 1)
+            fake.extend((pid, f"{prefix}{i:03d}") for i in range(1, int(count) + 1))
+        else:
+            fake.append((pid, dev))
+    if fake:
+        threading.Thread(target=run_fake_devices, args=(state, fake, args.fake_rate), daemon=True).start()
+    print(f"OneNET 模拟服务已启动: HTTP :{args.http_port}  MQTT :{args.mqtt_port}")
+    try:
+        while True:
+            time.sleep(3600)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,79 @@
+"""alerts.AlertEngine 的滞回、去抖和无数据检查"""
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+
+import alerts
+import tsdb
+
+
+def make_engine(*rules):
+    log = alerts.AlertLog(":memory:")
+    return alerts.AlertEngine(rules, log), log
+
+
+def states(log, series="dev/v"):
+    return [(e["ts"], e["state"]) for e in reversed(log.recent(series=series))]
+
+
+def feed(engine, samples, series="dev/v"):
+    for ts, value in samples:
+        engine.on_samples(series, [(ts, value)])
+
+
+def test_threshold_hysteresis_holds_state_inside_band():
+    engine, log = make_engine(alerts.ThresholdRule("过高", limit=3.0, hysteresis=0.5))
+    feed(engine, [(0, 2.0), (1, 3.1), (2, 2.9), (3, 2.6), (4, 3.2), (5, 2.5), (6, 3.0)])
+    # 2.9、2.6 在滞回带内不恢复，4 秒再次越限也不重复触发；2.5 恢复，恰好等于限值不算越限
+    assert states(log) == [(1, alerts.FIRING), (5, alerts.RESOLVED)]
+    assert engine.active() == []
+
+
+def test_below_threshold_hysteresis():
+    engine, log = make_engine(alerts.ThresholdRule("过低", limit=1.0, op="below", hysteresis=0.2))
+    feed(engine, [(0, 0.9), (1, 1.1), (2, 1.2)])
+    assert states(log) == [(0, alerts.FIRING), (2, alerts.RESOLVED)]
+
+
+def test_for_s_debounces_and_resets_on_recovery():
+    engine, log = make_engine(alerts.ThresholdRule("过高", limit=3.0, for_s=2))
+    feed(engine, [(0, 3.5), (1, 3.5), (1.5, 2.0), (2, 3.5), (3, 3.5)])
+    assert states(log) == []        # 中途恢复过，重新计时
+    feed(engine, [(4, 3.5)])
+    assert states(log) == [(4, alerts.FIRING)]
+    assert [(s, r.name) for s, r in engine.active()] == [("dev/v", "过高")]
+
+
+def test_for_s_pending_survives_hysteresis_band():
+    engine, log = make_engine(alerts.ThresholdRule("过高", limit=3.0, hysteresis=0.5, for_s=2))
+    feed(engine, [(0, 3.5), (1, 2.8), (2, 3.5)])
+    # 滞回带内的点既不触发也不打断计时
+    assert states(log) == [(2, alerts.FIRING)]
+
+
+def test_rules_only_apply_to_matching_series():
+    engine, log = make_engine(alerts.ThresholdRule("过高", limit=3.0, series="*/voltage"))
+    feed(engine, [(0, 5.0)], series="dev/temperature")
+    feed(engine, [(0, 5.0)], series="dev/voltage")
+    assert states(log, "dev/temperature") == []
+    assert states(log, "dev/voltage") == [(0, alerts.FIRING)]
+
+
+def test_nodata_fires_on_tick_and_resolves_on_new_sample():
+    engine, log = make_engine(alerts.NoDataRule("无数据", timeout=10))
+    feed(engine, [(100, 1.0)])
+    engine.tick(now=105)
+    assert states(log) == []
+    engine.tick(now=111)
+    feed(engine, [(112, 1.0)])
+    assert states(log) == [(111, alerts.FIRING), (112, alerts.RESOLVED)]
+
+
+def test_engine_evaluates_on_store_writes():
+    store = tsdb.TimeSeriesStore(":memory:")
+    engine, log = make_engine(alerts.ThresholdRule("过高", limit=3.0))
+    store.add_listener(engine.on_samples)
+    store.append_many("dev/v", [(1, 1.0), (2, 4.0), (2, 0.0)])   # 重复时间戳不写入，也不评估
+    assert states(log) == [(2, alerts.FIRING)]
+    store.close()
@@ -0,0 +1,87 @@
+"""tsdb.TimeSeriesStore 的写入与回滚行为"""
+import math
+import os
+import sys
+import time
+
+import pytest
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+
+import tsdb
+
+DAY = 86400
+T0 = 1_700_000_000.0 // DAY * DAY   # 某天 UTC 零点
+
+
+@pytest.fixture
+def store():
+    s = tsdb.TimeSeriesStore(":memory:")
+    yield s
+    s.close()
+
+
+def raw_values(store, series, start, end):
+    return [p[1] for p in store.query(series, start, end, max_points=10_000)["points"]]
+
+
+def test_append_many_skips_duplicates_and_out_of_order(store):
+    assert store.append_many("dev/v", [(T0 + 1, 1.0), (T0 + 2, 2.0), (T0 + 2, 9.0), (T0 + 1.5, 9.0)]) == 2
+    assert store.append("dev/v", T0 + 2, 3.0) is False
+    assert store.latest("dev/v") == (T0 + 2, 2.0)
+
+
+def test_non_finite_batch_is_rejected_whole(store):
+    store.append("dev/v", T0, 1.0)
+    for bad in (math.nan, math.inf):
+        with pytest.raises(ValueError):
+            store.append_many("dev/v", [(T0 + 1, 2.0), (T0 + 2, bad)])
+    assert store.latest("dev/v") == (T0, 1.0)
+    assert raw_values(store, "dev/v", T0, T0 + 10) == [1.0]
+
+
+def test_rollback_restores_last_ts_and_segment_cache(store, monkeypatch):
+    store.append("dev/v", T0, 1.0)
+    original = store._append_locked
+    calls = []
+
+    def failing(entry, ts, value):
+        calls.append(ts)
+        if len(calls) == 2:
+            raise RuntimeError("模拟写入失败")
+        return original(entry, ts, value)
+
+    monkeypatch.setattr(store, "_append_locked", failing)
+    # 批次跨到新的一天：第二天的分段表在这批里第一次用到
+    with pytest.raises(RuntimeError):
+        store.append_many("dev/v", [(T0 + DAY + 1, 2.0), (T0 + DAY + 2, 3.0)])
+    monkeypatch.undo()
+
+    # 整批回滚：last_ts 退回，回滚掉的时间戳可以重新写入
+    assert store.latest("dev/v") == (T0, 1.0)
+    assert raw_values(store, "dev/v", T0, T0 + 2 * DAY) == [1.0]
+    assert store.stats("dev/v", T0, T0 + 2 * DAY)["count"] == 1
+
+    # 分段缓存与库一致：新一天的表仍然可写
+    assert store.append_many("dev/v", [(T0 + DAY + 1, 2.0), (T0 + DAY + 2, 3.0)]) == 2
+    assert raw_values(store, "dev/v", T0, T0 + 2 * DAY) == [1.0, 2.0, 3.0]
+
+
+def test_query_and_stats_use_half_open_range(store):
+    store.append_many("dev/v", [(T0 + i, float(i)) for i in range(10)])
+    assert [p[0] for p in store.query("dev/v", T0 + 2, T0 + 5)["points"]] == [T0 + 2, T0 + 3, T0 + 4]
+    assert store.stats("dev/v", T0 + 2, T0 + 5) == {"count": 3, "min": 2.0, "max": 4.0, "mean": 3.0}
+    assert store.query("dev/v", T0 + 5, T0 + 5)["points"] == []
+
+
+def test_rollup_query_respects_max_points_and_counts(store):
+    # 汇总层级只在保留期内可用，用当前时间附近的数据
+    start = int(time.time() // 3600) * 3600 - 3600
+    store.append_many("dev/v", [(start + i, float(i % 7)) for i in range(3000)])
+    end = start + 2400          # 区间终点正好落在一个采样点上，该点不计入
+    for max_points in (1, 7, 50, 499):
+        result = store.query("dev/v", start, end, max_points=max_points)
+        assert result["step"] > 0
+        assert 0 < len(result["points"]) <= max_points
+        assert sum(p[4] for p in result["points"]) == 2400
+    assert store.stats("dev/v", start, end)["count"] == 2400
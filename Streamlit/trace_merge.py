@@ -0,0 +1,268 @@
+"""
+延迟追踪汇总：把各环节的记录按追踪号合并，输出每一跳的延迟分布
+
+输入（都可多次指定）:
+  --device [NAME=]LOG   ESP32 串口日志或 virtual_device.py 的输出，取其中的 TRACE 行（设备名默认 ESP32）
+  --broker JSONL        mock_onenet.py --record 的记录（带 trace 字段的 mqtt_publish / mqtt_puback）
+  --dashboard JSONL     控制台 SAMPLING_TRACE_PATH 的记录（ingest / render）
+
+环节:
+  uno     adc -> tx         UNO 上读出样本到开始发送（UNO 时钟）
+  uart    tx -> dec         串口传输 + ESP32 解码（以追踪帧首字节到达近似发送时刻）
+  bridge  dec -> pub        ESP32 组包交给 MQTT 客户端
+  uplink  pub -> broker     设备到服务端（对齐时钟后的估计值）
+  broker  broker -> puback  服务端收到到回 PUBACK
+  poll    broker -> ingest  控制台轮询取到并入库
+  render  ingest -> render  入库到页面输出
+  total   adc -> render     端到端
+
+设备时间是 esp_timer（上电起的微秒），与主机时间不同源。每条追踪有设备侧 pub/ack 和服务端
+publish/puback 四个时间，按 NTP 的算法估计偏移 ((broker - pub) + (puback - ack)) / 2；
+每个 --align-window 时间窗取往返最短的一条，窗口之间线性插值，吸收晶振漂移。
+
+追踪号 16 位，同一设备同一追踪号出现多次（回绕或设备重启）时，设备与服务端记录按先后顺序配对，
+控制台记录配给它之前最近的一次服务端接收。
+
+用法:
+    python trace_merge.py --device device.log --broker broker.jsonl --dashboard trace.jsonl
+"""
+import argparse
+import bisect
+import csv
+import json
+import re
+import sys
+from collections import defaultdict
+
+TRACE_LINE = re.compile(r"TRACE id=(\d+) adc_tx=(\d+) rx=(-?\d+) dec=(-?\d+) pub=(-?\d+) ack=(-?\d+)")
+
+# (名称, 起点, 终点, 说明)
+HOPS = [
+    ("uno", "adc", "tx", "UNO 读出 -> 发送"),
+    ("uart", "tx", "dec", "串口 + ESP32 解码"),
+    ("bridge", "dec", "pub", "ESP32 组包发布"),
+    ("uplink", "pub", "broker", "设备 -> 服务端（估计）"),
+    ("broker", "broker", "puback", "服务端处理"),
+    ("poll", "broker", "ingest", "控制台轮询入库"),
+    ("render", "ingest", "render", "入库 -> 页面"),
+    ("total", "adc", "render", "端到端"),
+]
+
+# 直方图桶上界（毫秒），1-2-5 序列
+BUCKETS_MS = [b * 10 ** e for e in range(-1, 5) for b in (1, 2, 5)]
+BAR_WIDTH = 40
+
+
+def read_device_logs(specs):
+    """返回 {(device, id): [设备侧记录, ...]}，时间单位秒（设备时钟）"""
+    traces = defaultdict(list)
+    for spec in specs:
+        name, path = spec.split("=", 1) if "=" in spec else ("ESP32", spec)
+        with open(path, encoding="utf-8", errors="replace") as f:
+            for line in f:
+                m = TRACE_LINE.search(line)
+                if not m:
+                    continue
+                tid, adc_tx, rx, dec, pub, ack = (int(x) for x in m.groups())
+                traces[(name, tid)].append({
+                    "id": tid, "device": name, "adc_tx": adc_tx / 1e6,
+                    "rx": rx / 1e6, "dec": dec / 1e6, "pub": pub / 1e6, "ack": ack / 1e6,
+                })
+    return traces
+
+
+def read_jsonl(paths):
+    for path in paths:
+        with open(path, encoding="utf-8") as f:
+            for line in f:
+                line = line.strip()
+                if line:
+                    try:
+                        yield json.loads(line)
+                    except ValueError:
+                        pass
+
+
+def read_broker(paths):
+    """返回 ({(device, id): [接收时间]}, {(device, id): [PUBACK 时间]})"""
+    received, acked = defaultdict(list), defaultdict(list)
+    for entry in read_jsonl(paths):
+        if "trace" not in entry:
+            continue
+        key = (entry.get("device"), int(entry["trace"]))
+        if entry.get("kind") == "mqtt_publish":
+            received[key].append(entry["t"])
+        elif entry.get("kind") == "mqtt_puback":
+            acked[key].append(entry["t"])
+    return received, acked
+
+
+def read_dashboard(paths):
+    """返回 {hop: {(device, id): [时间]}}"""
+    hops = defaultdict(lambda: defaultdict(list))
+    for entry in read_jsonl(paths):
+        hops[entry.get("hop")][(entry.get("device"), int(entry["id"]))].append(entry["t"])
+    return hops
+
+
+class ClockAlign:
+    """设备时钟 -> 主机时钟，按时间窗内往返最短的样本分段线性插值"""
+
+    def __init__(self, samples, window):
+        # samples: [(设备时间, 偏移, 往返)]
+        best = {}
+        for t, offset, delay in samples:
+            slot = int(t // window)
+            if slot not in best or delay < best[slot][2]:
+                best[slot] = (t, offset, delay)
+        points = sorted(best.values())
+        self.times = [p[0] for p in points]
+        self.offsets = [p[1] for p in points]
+
+    def __bool__(self):
+        return bool(self.times)
+
+    def offset(self, t):
+        i = bisect.bisect_left(self.times, t)
+        if i == 0:
+            return self.offsets[0]
+        if i == len(self.times):
+            return self.offsets[-1]
+        t0, t1 = self.times[i - 1], self.times[i]
+        o0, o1 = self.offsets[i - 1], self.offsets[i]
+        return o0 + (o1 - o0) * (t - t0) / (t1 - t0)
+
+
+def merge(device_traces, received, acked, dashboard, window):
+    """返回每条追踪的各环节时间（主机时钟，秒），缺失的环节不出现"""
+    rows = []
+    align_samples = defaultdict(list)
+    for key, entries in device_traces.items():
+        for i, d in enumerate(entries):
+            row = {"device": key[0], "id": key[1], "_dev": d}
+            if i < len(received.get(key, ())):
+                row["broker"] = received[key][i]
+            if i < len(acked.get(key, ())):
+                row["puback"] = acked[key][i]
+            if "broker" in row and "puback" in row:
+                offset = ((row["broker"] - d["pub"]) + (row["puback"] - d["ack"])) / 2
+                delay = (d["ack"] - d["pub"]) - (row["puback"] - row["broker"])
+                align_samples[key[0]].append((d["pub"], offset, delay))
+            rows.append(row)
+
+    aligners = {dev: ClockAlign(s, window) for dev, s in align_samples.items()}
+    for row in rows:
+        d = row.pop("_dev")
+        aligner = aligners.get(row["device"])
+        if aligner:
+            offset = aligner.offset(d["pub"])
+            row["tx"] = d["rx"] + offset
+            row["adc"] = row["tx"] - d["adc_tx"]
+            row["dec"] = d["dec"] + offset
+            row["pub"] = d["pub"] + offset
+        else:
+            # 没有服务端记录时只能算设备内部的环节，以 pub 为零点
+            row["tx"] = d["rx"] - d["pub"]
+            row["adc"] = row["tx"] - d["adc_tx"]
+            row["dec"] = d["dec"] - d["pub"]
+            row["pub"] = 0.0
+
+        # 控制台记录配给此前最近一次服务端接收的那条追踪
+        if "broker" in row:
+            key = (row["device"], row["id"])
+            later = [t for t in received[key] if t > row["broker"]]
+            limit = min(later) if later else float("inf")
+            for hop in ("ingest", "render"):
+                times = [t for t in dashboard.get(hop, {}).get(key, ()) if row["broker"] <= t < limit]
+                if times:
+                    row[hop] = min(times)
+    return rows
+
+
+def latencies(rows):
+    """返回 {环节名: [毫秒, ...]}"""
+    result = {name: [] for name, *_ in HOPS}
+    for row in rows:
+        for name, start, end, _ in HOPS:
+            if start in row and end in row:
+                result[name].append((row[end] - row[start]) * 1000.0)
+    return result
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return None
+    k = (len(sorted_values) - 1) * p / 100.0
+    lo = int(k)
+    hi = min(lo + 1, len(sorted_values) - 1)
+    return sorted_values[lo] + (sorted_values[hi] - sorted_values[lo]) * (k - lo)
+
+
+def histogram(values):
+    """按 BUCKETS_MS 计数，最后一个桶收容更大的值；返回 [(上界, 计数)]"""
+    counts = [0] * (len(BUCKETS_MS) + 1)
+    for v in values:
+        counts[bisect.bisect_left(BUCKETS_MS, v)] += 1
+    edges = BUCKETS_MS + [float("inf")]
+    nonzero = [i for i, c in enumerate(counts) if c]
+    if not nonzero:
+        return []
+    return [(edges[i], counts[i]) for i in range(nonzero[0], nonzero[-1] + 1)]
+
+
+def fmt_ms(v):
+    return "--" if v is None else f"{v:.2f}"
+
+
+def report(lat, out=sys.stdout):
+    out.write(f"{'环节':<8}{'说明':<22}{'条数':>6}{'p50':>10}{'p90':>10}{'p99':>10}{'最大':>10}  (ms)\n")
+    for name, _, _, desc in HOPS:
+        values = sorted(lat[name])
+        out.write(f"{name:<8}{desc:<22}{len(values):>6}"
+                  f"{fmt_ms(percentile(values, 50)):>10}{fmt_ms(percentile(values, 90)):>10}"
+                  f"{fmt_ms(percentile(values, 99)):>10}{fmt_ms(values[-1] if values else None):>10}\n")
+
+    for name, start, end, desc in HOPS:
+        hist = histogram(lat[name])
+        if not hist:
+            continue
+        out.write(f"\n[{name}] {start} -> {end}  {desc}\n")
+        peak = max(c for _, c in hist)
+        for edge, count in hist:
+            label = f"<= {edge:g} ms" if edge != float("inf") else f"> {BUCKETS_MS[-1]:g} ms"
+            bar = "#" * (round(count * BAR_WIDTH / peak) if count else 0)
+            out.write(f"  {label:>14} |{bar:<{BAR_WIDTH}} {count}\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="合并延迟追踪记录，输出各环节延迟分布")
+    parser.add_argument("--device", action="append", default=[], metavar="[NAME=]LOG",
+                        help="ESP32 串口日志 / virtual_device.py 输出")
+    parser.add_argument("--broker", action="append", default=[], help="mock_onenet.py --record 的输出")
+    parser.add_argument("--dashboard", action="append", default=[], help="控制台 SAMPLING_TRACE_PATH 文件")
+    parser.add_argument("--align-window", type=float, default=60.0, help="时钟对齐的时间窗（秒）")
+    parser.add_argument("--csv", default=None, help="另存每条追踪各环节延迟（毫秒）")
+    args = parser.parse_args()
+    if not args.device:
+        parser.error("至少需要一个 --device")
+
+    received, acked = read_broker(args.broker)
+    rows = merge(read_device_logs(args.device), received, acked,
+                 read_dashboard(args.dashboard), args.align_window)
+    if not rows:
+        print("没有找到 TRACE 记录（UNO 是否开启了 TRACE_EVERY？）")
+        return
+    report(latencies(rows))
+
+    if args.csv:
+        with open(args.csv, "w", newline="", encoding="utf-8") as f:
+            writer = csv.writer(f)
+            writer.writerow(["device", "id"] + [name for name, *_ in HOPS])
+            for row in sorted(rows, key=lambda r: r.get("adc", 0.0)):
+                writer.writerow([row["device"], row["id"]] + [
+                    f"{(row[end] - row[start]) * 1000.0:.3f}" if start in row and end in row else ""
+                    for _, start, end, _ in HOPS])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,54 @@
+"""
+样本级延迟追踪记录（控制台一侧）
+
+UNO 开启 TRACE_EVERY 后，被抽中的样本带着追踪号经 ESP32 上报为属性 trace，
+控制台在入库 (ingest) 和页面渲染 (render) 时把 (追踪号, 环节, 时间) 记到这里：
+- 内存中保留最近 TRACE_BUFFER 条
+- 设置环境变量 SAMPLING_TRACE_PATH 时同时追加写入 JSON Lines 文件，
+  与 ESP32 串口日志、mock_onenet.py --record 的记录一起交给 trace_merge.py 汇总
+"""
+import collections
+import json
+import os
+import threading
+import time
+
+TRACE_BUFFER = 4096
+
+DEFAULT_TRACE_PATH = os.environ.get("SAMPLING_TRACE_PATH")
+
+
+class TraceLog:
+    """线程安全，同一设备同一环节的同一追踪号只记第一次（页面每次刷新都会重复看到同一个值）"""
+
+    def __init__(self, path=DEFAULT_TRACE_PATH, maxlen=TRACE_BUFFER):
+        self.path = path
+        self.entries = collections.deque(maxlen=maxlen)
+        self._last = {}          # (hop, device) -> 最近记录的追踪号
+        self._lock = threading.Lock()
+        if path:
+            os.makedirs(os.path.dirname(path) or ".", exist_ok=True)
+        self._file = open(path, "a", encoding="utf-8") if path else None
+
+    def mark(self, hop, device, trace_value, t=None):
+        """trace_value 为属性 trace 的值（可为字符串或 None），返回是否新记录了一条"""
+        try:
+            trace_id = int(trace_value)
+        except (TypeError, ValueError):
+            return False
+        entry = {"t": time.time() if t is None else t, "id": trace_id, "hop": hop, "device": device}
+        with self._lock:
+            if self._last.get((hop, device)) == trace_id:
+                return False
+            self._last[(hop, device)] = trace_id
+            self.entries.append(entry)
+            if self._file:
+                self._file.write(json.dumps(entry) + "\n")
+                self._file.flush()
+        return True
+
+    def close(self):
+        with self._lock:
+            if self._file:
+                self._file.close()
+                self._file = None
@@ -0,0 +1,358 @@
+"""
+本地时序存储 (SQLite)
+
+- 原始数据按天分段存放在 raw_YYYYMMDD 表中，只追加不修改，过期分段整表删除
+- 写入时同步维护 1 秒 / 1 分钟 / 1 小时三级汇总 (count/sum/min/max/first/last)
+- 查询时按时间跨度选择合适的汇总层级，返回点数不超过 max_points
+- 区间统计按层级拆分（整小时 + 整分钟 + 整秒 + 原始数据边角），结果精确且与点数无关
+"""
+import os
+import math
+import sqlite3
+import threading
+import time
+
+# 汇总层级（秒）
+ROLLUP_LEVELS = (1, 60, 3600)
+
+# 各层级保留时长（秒），None 表示永久保留
+RAW_RETENTION = 30 * 86400
+ROLLUP_RETENTION = {
+    1: 2 * 86400,
+    60: 90 * 86400,
+    3600: None,
+}
+
+DEFAULT_DB_PATH = os.environ.get(
+    "SAMPLING_TSDB_PATH",
+    os.path.join(os.path.dirname(os.path.abspath(__file__)), "data", "history.sqlite"),
+)
+
+
+def _segment_name(ts):
+    """原始数据分段表名（按 UTC 日期）"""
+    return "raw_" + time.strftime("%Y%m%d", time.gmtime(ts))
+
+
+class TimeSeriesStore:
+    """追加写入的时序存储，线程安全（单连接 + 锁）"""
+
+    def __init__(self, path=DEFAULT_DB_PATH):
+        if path != ":memory:":
+            os.makedirs(os.path.dirname(path) or ".", exist_ok=True)
+        self.path = path
+        self._lock = threading.Lock()
+        self._conn = sqlite3.connect(path, check_same_thread=False, isolation_level=None)
+        self._conn.execute("PRAGMA journal_mode=WAL")
+        self._conn.execute("PRAGMA synchronous=NORMAL")
+
+        self._conn.execute(
+            "CREATE TABLE IF NOT EXISTS series ("
+            " id INTEGER PRIMARY KEY,"
+            " name TEXT UNIQUE NOT NULL,"
+            " last_ts REAL)"
+        )
+        for level in ROLLUP_LEVELS:
+            self._conn.execute(
+                f"CREATE TABLE IF NOT EXISTS rollup_{level} ("
+                " series_id INTEGER NOT NULL,"
+                " bucket INTEGER NOT NULL,"
+                " count INTEGER NOT NULL,"
+                " sum REAL NOT NULL,"
+                " min REAL NOT NULL,"
+                " max REAL NOT NULL,"
+                " first REAL,"
+                " last REAL,"
+                " PRIMARY KEY (series_id, bucket)) WITHOUT ROWID"
+            )
+            columns = [row[1] for row in self._conn.execute(f"PRAGMA table_info(rollup_{level})")]
+            if "first" not in columns:
+                # 旧版本数据库没有 first/last 列，补齐后旧数据以 NULL 表示未知
+                self._conn.execute(f"ALTER TABLE rollup_{level} ADD COLUMN first REAL")
+                self._conn.execute(f"ALTER TABLE rollup_{level} ADD COLUMN last REAL")
+
+        self._series = {}   # name -> (id, last_ts)
+        for sid, name, last_ts in self._conn.execute("SELECT id, name, last_ts FROM series"):
+            self._series[name] = [sid, last_ts]
+        self._listeners = []
+        self._segments = set(
+            row[0] for row in self._conn.execute(
+                "SELECT name FROM sqlite_master WHERE type='table' AND name LIKE 'raw_%'")
+        )
+
+    # ------------------------------------------------------------------
+    # 写入
+    # ------------------------------------------------------------------
+    def _series_entry(self, name):
+        entry = self._series.get(name)
+        if entry is None:
+            cur = self._conn.execute("INSERT INTO series (name, last_ts) VALUES (?, NULL)", (name,))
+            entry = [cur.lastrowid, None]
+            self._series[name] = entry
+        return entry
+
+    def _ensure_segment(self, table):
+        if table not in self._segments:
+            self._conn.execute(
+                f"CREATE TABLE IF NOT EXISTS {table} ("
+                " series_id INTEGER NOT NULL,"
+                " ts REAL NOT NULL,"
+                " value REAL NOT NULL,"
+                " PRIMARY KEY (series_id, ts)) WITHOUT ROWID"
+            )
+            self._segments.add(table)
+
+    def _append_locked(self, entry, ts, value):
+        sid, last_ts = entry
+        # 只追加：时间戳不晚于上一条的数据视为重复/乱序，直接丢弃
+        if last_ts is not None and ts <= last_ts:
+            return False
+
+        table = _segment_name(ts)
+        self._conn.execute(f"INSERT INTO {table} (series_id, ts, value) VALUES (?, ?, ?)", (sid, ts, value))
+        for level in ROLLUP_LEVELS:
+            bucket = int(ts // level) * level
+            self._conn.execute(
+                f"INSERT INTO rollup_{level} (series_id, bucket, count, sum, min, max, first, last)"
+                " VALUES (?, ?, 1, ?, ?, ?, ?, ?)"
+                " ON CONFLICT (series_id, bucket) DO UPDATE SET"
+                " count = count + 1,"
+                " sum = sum + excluded.sum,"
+                " min = MIN(min, excluded.min),"
+                " max = MAX(max, excluded.max),"
+                " last = excluded.last",
+                (sid, bucket, value, value, value, value, value),
+            )
+        entry[1] = ts
+        return True
+
+    def add_listener(self, callback):
+        """注册写入回调 callback(series, [(ts, value), ...])，在数据提交后同步调用"""
+        self._listeners.append(callback)
+
+    def append(self, series, ts, value):
+        """写入单个采样点，返回是否写入（重复/乱序返回 False）"""
+        return self.append_many(series, [(ts, value)]) == 1
+
+    def append_many(self, series, points):
+        """
+        批量写入 [(ts, value), ...]（单事务），返回实际写入的点数。
+        含 NaN / inf 的批次整批拒绝（ValueError），不写入任何点
+        """
+        points = [(float(ts), float(value)) for ts, value in points]
+        for ts, value in points:
+            if not (math.isfinite(ts) and math.isfinite(value)):
+                raise ValueError(f"时间戳和数值必须是有限值: ({ts}, {value})")
+        written = []
+        with self._lock:
+            entry = self._series_entry(series)
+            # 分段表在事务之外建好：批次回滚不会把表一起撤销，_segments 缓存始终与库一致
+            for table in {_segment_name(ts) for ts, _ in points}:
+                self._ensure_segment(table)
+            self._conn.execute("BEGIN")
+            try:
+                for ts, value in points:
+                    if self._append_locked(entry, ts, value):
+                        written.append((ts, value))
+                self._conn.execute("UPDATE series SET last_ts = ? WHERE id = ?", (entry[1], entry[0]))
+                self._conn.execute("COMMIT")
+            except Exception:
+                self._conn.execute("ROLLBACK")
+                # 回滚后重新读取 last_ts，保持缓存与数据库一致
+                row = self._conn.execute("SELECT last_ts FROM series WHERE id = ?", (entry[0],)).fetchone()
+                entry[1] = row[0] if row else None
+                raise
+        if written:
+            for callback in self._listeners:
+                callback(series, written)
+        return len(written)
+
+    # ------------------------------------------------------------------
+    # 查询
+    # ------------------------------------------------------------------
+    def latest(self, series):
+        """返回 (ts, value)，无数据时返回 (None, None)"""
+        with self._lock:
+            entry = self._series.get(series)
+            if entry is None or entry[1] is None:
+                return None, None
+            table = _segment_name(entry[1])
+            row = self._conn.execute(
+                f"SELECT ts, value FROM {table} WHERE series_id = ? AND ts = ?", (entry[0], entry[1])
+            ).fetchone()
+        return (row[0], row[1]) if row else (entry[1], None)
+
+    def _raw_tables(self, start, end):
+        day = 86400
+        tables = []
+        d = math.floor(start / day) * day
+        while d <= end:
+            name = _segment_name(d)
+            if name in self._segments:
+                tables.append(name)
+            d += day
+        return tables
+
+    def _raw_count_locked(self, sid, start, end, limit):
+        total = 0
+        for table in self._raw_tables(start, end):
+            total += self._conn.execute(
+                f"SELECT COUNT(*) FROM (SELECT 1 FROM {table}"
+                " WHERE series_id = ? AND ts >= ? AND ts < ? LIMIT ?)",
+                (sid, start, end, limit + 1 - total),
+            ).fetchone()[0]
+            if total > limit:
+                break
+        return total
+
+    def query(self, series, start, end, max_points=500):
+        """
+        查询 [start, end) 区间的数据（与 stats 相同），返回 dict:
+            step   - 每个点代表的时长（秒），0 表示原始数据
+            points - [(t, min, max, mean, count, first, last), ...]，按时间升序
+        点数不超过 max_points。
+        """
+        max_points = max(1, int(max_points))
+        with self._lock:
+            entry = self._series.get(series)
+            if entry is None or end <= start:
+                return {"step": 0, "points": []}
+            sid = entry[0]
+
+            # 原始点数足够少时直接返回原始数据
+            if self._raw_count_locked(sid, start, end, max_points) <= max_points:
+                points = []
+                for table in self._raw_tables(start, end):
+                    for ts, value in self._conn.execute(
+                        f"SELECT ts, value FROM {table}"
+                        " WHERE series_id = ? AND ts >= ? AND ts < ? ORDER BY ts",
+                        (sid, start, end),
+                    ):
+                        points.append((ts, value, value, value, 1, value, value))
+                return {"step": 0, "points": points}
+
+            # 目标步长：满足点数上限，且为所选层级的整数倍
+            # （只考虑保留期覆盖查询起点的层级）
+            target = (end - start) / max_points
+            now = time.time()
+            covered = [lv for lv in ROLLUP_LEVELS
+                       if ROLLUP_RETENTION[lv] is None or start >= now - ROLLUP_RETENTION[lv]]
+            finer = [lv for lv in covered if lv <= target]
+            level = finer[-1] if finer else covered[0]
+            step = max(level, int(math.ceil(target / level)) * level)
+            # 合并桶按 step 的整数倍对齐，首尾各可能多出半个桶：点数超限时再放大一级
+            lo = int(start // level) * level
+            hi = int(math.ceil(end / level)) * level - level
+            while hi // step - lo // step + 1 > max_points:
+                step += level
+
+            # first/last 取合并区间内最早/最晚汇总桶的值
+            rows = self._conn.execute(
+                "SELECT b, SUM(count), SUM(sum), MIN(min), MAX(max), MIN(f), MIN(l) FROM ("
+                " SELECT (bucket / ?) * ? AS b, count, sum, min, max,"
+                "  FIRST_VALUE(first) OVER w AS f,"
+                "  LAST_VALUE(last) OVER w AS l"
+                f" FROM rollup_{level}"
+                " WHERE series_id = ? AND bucket >= ? AND bucket <= ?"
+                " WINDOW w AS (PARTITION BY bucket / ? ORDER BY bucket"
+                "  ROWS BETWEEN UNBOUNDED PRECEDING AND UNBOUNDED FOLLOWING))"
+                " GROUP BY b ORDER BY b",
+                (step, step, sid, lo, hi, step),
+            ).fetchall()
+        points = [(b, mn, mx, s / c, c, f, l) for b, c, s, mn, mx, f, l in rows]
+        return {"step": step, "points": points}
+
+    def _level_covers(self, level, ts, now):
+        retention = ROLLUP_RETENTION[level]
+        return retention is None or ts >= now - retention
+
+    def _stats_range_locked(self, sid, start, end, idx, acc, now):
+        """累加 [start, end) 区间统计到 acc = [count, sum, min, max]，idx 为当前汇总层级下标"""
+        if end <= start:
+            return
+        if idx < 0:
+            for table in self._raw_tables(start, end):
+                c, s, mn, mx = self._conn.execute(
+                    f"SELECT COUNT(*), SUM(value), MIN(value), MAX(value) FROM {table}"
+                    " WHERE series_id = ? AND ts >= ? AND ts < ?",
+                    (sid, start, end),
+                ).fetchone()
+                self._merge_stats(acc, c, s, mn, mx)
+            return
+
+        level = ROLLUP_LEVELS[idx]
+        a = int(math.ceil(start / level)) * level
+        b = int(math.floor(end / level)) * level
+        if a < b and self._level_covers(level, a, now):
+            c, s, mn, mx = self._conn.execute(
+                f"SELECT SUM(count), SUM(sum), MIN(min), MAX(max) FROM rollup_{level}"
+                " WHERE series_id = ? AND bucket >= ? AND bucket < ?",
+                (sid, a, b),
+            ).fetchone()
+            self._merge_stats(acc, c, s, mn, mx)
+            self._stats_range_locked(sid, start, a, idx - 1, acc, now)
+            self._stats_range_locked(sid, b, end, idx - 1, acc, now)
+        else:
+            self._stats_range_locked(sid, start, end, idx - 1, acc, now)
+
+    @staticmethod
+    def _merge_stats(acc, c, s, mn, mx):
+        if not c:
+            return
+        acc[0] += c
+        acc[1] += s
+        acc[2] = mn if acc[2] is None else min(acc[2], mn)
+        acc[3] = mx if acc[3] is None else max(acc[3], mx)
+
+    def stats(self, series, start, end):
+        """
+        [start, end) 区间精确统计，返回 dict(count, min, max, mean)，无数据时 count=0。
+        扫描行数与区间跨度的对数相当，与采样点数无关。
+        """
+        acc = [0, 0.0, None, None]
+        with self._lock:
+            entry = self._series.get(series)
+            if entry is not None:
+                self._stats_range_locked(entry[0], start, end, len(ROLLUP_LEVELS) - 1, acc, time.time())
+        count, total, mn, mx = acc
+        return {
+            "count": count,
+            "min": mn,
+            "max": mx,
+            "mean": total / count if count else None,
+        }
+
+    # ------------------------------------------------------------------
+    # 维护
+    # ------------------------------------------------------------------
+    def prune(self, now=None):
+        """删除超出保留期的原始分段和汇总数据"""
+        now = time.time() if now is None else now
+        with self._lock:
+            oldest = _segment_name(now - RAW_RETENTION)
+            for table in sorted(self._segments):
+                if table < oldest:
+                    self._conn.execute(f"DROP TABLE IF EXISTS {table}")
+                    self._segments.discard(table)
+            for level, retention in ROLLUP_RETENTION.items():
+                if retention is not None:
+                    self._conn.execute(f"DELETE FROM rollup_{level} WHERE bucket < ?", (int(now - retention),))
+
+    def clear(self, series):
+        """删除某个序列的全部数据"""
+        with self._lock:
+            entry = self._series.pop(series, None)
+            if entry is None:
+                return
+            sid = entry[0]
+            self._conn.execute("BEGIN")
+            for table in self._segments:
+                self._conn.execute(f"DELETE FROM {table} WHERE series_id = ?", (sid,))
+            for level in ROLLUP_LEVELS:
+                self._conn.execute(f"DELETE FROM rollup_{level} WHERE series_id = ?", (sid,))
+            self._conn.execute("DELETE FROM series WHERE id = ?", (sid,))
+            self._conn.execute("COMMIT")
+
+    def close(self):
+        with self._lock:
+            self._conn.close()
@@ -0,0 +1,184 @@
+"""
+虚拟采集节点（UNO + ESP32 桥接），用于在没有硬件时跑通延迟追踪
+
+按 --rate 产生样本，模拟 UNO 读出、串口传输（追踪帧 + 电压帧，按 --baud 计算线上时间）
+和 ESP32 解码，然后像 ESP32 固件一样以 QoS1 发布到 property/post，每 --trace-every 个样本
+带一个追踪号。收到 PUBACK 后输出与 ESP32 相同格式的 TRACE 日志行（时间为本进程的单调时钟，
+与主机时间不同源，trace_merge.py 按 PUBACK 往返时间对齐）。
+
+用法（配合 mock_onenet.py --record broker.jsonl 与设置了 SAMPLING_TRACE_PATH 的控制台）:
+    python virtual_device.py --mqtt 127.0.0.1:1883 --rate 10 --log device.log --duration 60
+"""
+import argparse
+import json
+import random
+import socket
+import struct
+import sys
+import threading
+import time
+
+from mock_onenet import (MQTT_CONNACK, MQTT_CONNECT, MQTT_PINGREQ, MQTT_PUBACK, MQTT_PUBLISH,
+                         _encode_remaining_length, _mqtt_str)
+
+PRODUCT_ID = "6R9kiumZF1"
+DEVICE_NAME = "ESP32"
+# 与 ESP32 固件相同的设备 Token
+DEVICE_TOKEN = "version=2018-10-31&res=products%2F6R9kiumZF1%2Fdevices%2FESP32&et=1923202207&method=md5&sign=S9SRMkTDgNQcH9lEVh%2Bnew%3D%3D"
+
+VOLTAGE_FRAME_LEN = 10
+TRACE_FRAME_LEN = 17
+UNO_READ_US = (300, 600)       # UNO 位操作读 24 位 + 换算电压的耗时范围
+ESP32_PARSE_US = (50, 300)     # ESP32 串口驱动交付 + 逐字节状态机
+
+
+def now_us():
+    """模拟 esp_timer_get_time()：单调时钟，微秒"""
+    return time.monotonic_ns() // 1000
+
+
+def sleep_until(t_us):
+    delay = (t_us - now_us()) / 1e6
+    if delay > 0:
+        time.sleep(delay)
+
+
+class MqttClient:
+    """最小 MQTT 3.1.1 客户端：CONNECT、QoS1 PUBLISH，后台线程接收 PUBACK"""
+
+    def __init__(self, host, port, product_id, device_name, token, on_puback):
+        self.sock = socket.create_connection((host, port))
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.on_puback = on_puback
+        self._packet_id = 0
+        self._send_lock = threading.Lock()
+
+        body = (_mqtt_str("MQTT") + bytes([4, 0xC2]) + struct.pack("!H", 60)
+                + _mqtt_str(device_name) + _mqtt_str(product_id) + _mqtt_str(token))
+        self._send(MQTT_CONNECT, 0, body)
+        ptype, body = self._read_packet()
+        if ptype != MQTT_CONNACK or body[1] != 0:
+            raise ConnectionError(f"CONNACK 拒绝: {body[1] if len(body) > 1 else '?'}")
+        threading.Thread(target=self._reader, daemon=True).start()
+
+    def _send(self, ptype, flags, body):
+        with self._send_lock:
+            self.sock.sendall(bytes([(ptype << 4) | flags]) + _encode_remaining_length(len(body)) + body)
+
+    def _recv_exact(self, n):
+        data = bytearray()
+        while len(data) < n:
+            chunk = self.sock.recv(n - len(data))
+            if not chunk:
+                raise ConnectionError("closed")
+            data.extend(chunk)
+        return bytes(data)
+
+    def _read_packet(self):
+        first = self._recv_exact(1)[0]
+        multiplier, length = 1, 0
+        while True:
+            byte = self._recv_exact(1)[0]
+            length += (byte & 0x7F) * multiplier
+            if not byte & 0x80:
+                break
+            multiplier *= 128
+        return first >> 4, self._recv_exact(length) if length else b""
+
+    def _reader(self):
+        try:
+            while True:
+                ptype, body = self._read_packet()
+                if ptype == MQTT_PUBACK:
+                    self.on_puback(struct.unpack("!H", body[:2])[0], now_us())
+        except (ConnectionError, OSError):
+            pass
+
+    def next_packet_id(self):
+        self._packet_id = self._packet_id % 0xFFFF + 1
+        return self._packet_id
+
+    def publish(self, topic, payload, packet_id):
+        """QoS1 发布"""
+        self._send(MQTT_PUBLISH, 0x02, _mqtt_str(topic) + struct.pack("!H", packet_id) + payload.encode())
+
+    def ping(self):
+        self._send(MQTT_PINGREQ, 0, b"")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="虚拟采集节点（带延迟追踪）")
+    parser.add_argument("--mqtt", default="127.0.0.1:1883", help="MQTT 服务地址 host:port")
+    parser.add_argument("--product-id", default=PRODUCT_ID)
+    parser.add_argument("--device", default=DEVICE_NAME)
+    parser.add_argument("--token", default=DEVICE_TOKEN)
+    parser.add_argument("--rate", type=float, default=10.0, help="采样率（Hz）")
+    parser.add_argument("--baud", type=int, default=9600, help="UNO 到 ESP32 的串口波特率")
+    parser.add_argument("--trace-every", type=int, default=1, help="每 N 个样本追踪一个（同 UNO 的 TRACE_EVERY）")
+    parser.add_argument("--duration", type=float, default=0.0, help="运行时长（秒），0 表示一直运行")
+    parser.add_argument("--log", default=None, help="TRACE 日志输出文件（默认标准输出）")
+    args = parser.parse_args()
+
+    out = open(args.log, "a", encoding="utf-8") if args.log else sys.stdout
+    out_lock = threading.Lock()
+    pending = {}          # 报文 ID -> 追踪记录
+    byte_us = 10e6 / args.baud
+
+    def on_puback(packet_id, ack):
+        t = pending.pop(packet_id, None)
+        if t is None:
+            return
+        with out_lock:
+            out.write(f"I ({ack // 1000}) mqtt_example: TRACE id={t['id']} adc_tx={t['adc_tx']} "
+                      f"rx={t['rx']} dec={t['dec']} pub={t['pub']} ack={ack}\n")
+            out.flush()
+
+    host, port = args.mqtt.rsplit(":", 1)
+    client = MqttClient(host, int(port), args.product_id, args.device, args.token, on_puback)
+    topic = f"$sys/{args.product_id}/{args.device}/thing/property/post"
+
+    period_us = int(1e6 / args.rate)
+    voltage = random.uniform(0.5, 2.5)
+    trace_id = 0
+    count = 0
+    next_adc = now_us()
+    end = time.time() + args.duration if args.duration else None
+    last_ping = time.time()
+
+    while end is None or time.time() < end:
+        sleep_until(next_adc)
+        adc = now_us()
+        next_adc += period_us
+        count += 1
+        voltage += random.gauss(0, 0.002)
+        traced = args.trace_every > 0 and count % args.trace_every == 0
+
+        # UNO：读出、换算后写入串口（追踪帧在电压帧之前）
+        tx = adc + random.randint(*UNO_READ_US)
+        frame_bytes = VOLTAGE_FRAME_LEN + (TRACE_FRAME_LEN if traced else 0)
+        # ESP32：首字节一个字节时间后到达，收完整帧再加上驱动与状态机耗时
+        rx = tx + int(byte_us)
+        sleep_until(tx + int(frame_bytes * byte_us) + random.randint(*ESP32_PARSE_US))
+        dec = now_us()
+
+        params = {"voltage": {"value": round(voltage, 4)}, "pga": {"value": 128}}
+        if traced:
+            trace_id = trace_id % 0xFFFF + 1
+            params["trace"] = {"value": trace_id}
+        payload = json.dumps({"id": str(count), "version": "1.0", "params": params}, separators=(",", ":"))
+        packet_id = client.next_packet_id()
+        pub = now_us()
+        if traced:
+            # 先登记再发布，避免本机回环时 PUBACK 先于登记到达
+            pending[packet_id] = {"id": trace_id, "adc_tx": tx - adc, "rx": rx, "dec": dec, "pub": pub}
+        client.publish(topic, payload, packet_id)
+
+        if time.time() - last_ping > 30:
+            client.ping()
+            last_ping = time.time()
+
+    time.sleep(1.0)  # 等最后几个 PUBACK
+
+
+if __name__ == "__main__":
+    main()
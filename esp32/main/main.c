@@ -15,6 +15,7 @@
 #include "esp_system.h"
 #include "nvs_flash.h"
 #include "esp_event.h"
+#include "esp_timer.h"
 #include "esp_netif.h"
 // #include "protocol_examples_common.h"
 
@@ -33,19 +34,29 @@
 #include "esp_log.h"
 #include "mqtt_client.h"
 #include "cJSON.h"
+#include "cs1237_proto.h"
 
 static const char *TAG = "mqtt_example";
 
 #define UART_PORT_NUM      UART_NUM_2
-#define UART_BAUD_RATE     9600
+#define UART_BAUD_RATE     9600  // 上电/握手时的波特率，所有固件都支持
+#define UART_MAX_BAUD_CODE CS1237_BAUD_115200  // 握手后最高切换到的波特率（杜邦线连接）
+#define HELLO_TIMEOUT_MS   500
 #define TEST_TXD           4   // Arduino RX 接到了 ESP32 的 4，所以 4 是 ESP32 的发送端
 #define TEST_RXD           5   // Arduino TX 接到了 ESP32 的 5，所以 5 是 ESP32 的接收端
 #define RX_BUF_SIZE        1024
+#define TRACE_SLOTS        16  // 已发布、等待 PUBACK 的追踪样本数
+#define TRACE_LEN_FIELD    (CS1237_TRACE_FRAME_SIZE - 6)  // 追踪帧长度字节 = 命令 + 数据
+#define USE_COBS           1   // 对方支持时切换到 COBS 帧格式（0x00 分隔，出错后一个包内重新同步）
+#define COBS_CHUNK         64  // COBS 模式下一次从串口驱动取的字节数上限
 
 // 全局控制变量 (添加 volatile 确保多任务可见性)
 static volatile bool g_collection_enable = true; // 默认开启采集
 static volatile bool g_is_configuring = false;   // 是否正在配置参数
 
+static const uint32_t s_baud_rates[CS1237_BAUD_COUNT] = CS1237_BAUD_RATES_INIT;
+static bool s_cobs = false;  // 握手后是否已切换到 COBS 帧格式
+
 esp_mqtt_client_handle_t mqtt_client = NULL;
 
 /* FreeRTOS event group to signal when we are connected*/
@@ -61,6 +72,11 @@ static EventGroupHandle_t s_wifi_event_group;
 #define ESP_WIFI_PASS      "wsh051123"
 #define ESP_MAXIMUM_RETRY  5
 
+// MQTT 服务器地址，压测时可在编译选项中覆盖为本地模拟服务 (Streamlit/mock_onenet.py)
+#ifndef ONENET_MQTT_URI
+#define ONENET_MQTT_URI    "mqtt://mqtts.heclouds.com:1883"
+#endif
+
 static int s_retry_num = 0;
 
 static void event_handler(void* arg, esp_event_base_t event_base,
@@ -154,6 +170,63 @@ static const char test_data[] = "{"
     "}"
 "}";
 
+// ---------- 延迟追踪 ----------
+// UNO 开启 TRACE_EVERY 后，被抽中的样本前面多一个追踪帧。各环节的 esp_timer 时间（微秒）
+// 记在下面的环形缓冲里，收到该条消息的 PUBACK 后打印一行
+//   TRACE id=.. adc_tx=.. rx=.. dec=.. pub=.. ack=..
+// 串口日志交给 Streamlit/trace_merge.py 与模拟服务、控制台的记录合并成各环节延迟分布。
+// adc_tx 是 UNO 上从读出样本到开始发送的时间（UNO 时钟），其余都是本机时钟。
+typedef struct {
+    int msg_id;       // 发布返回的消息号，用于匹配 PUBACK；-1 表示空闲
+    uint16_t id;
+    uint32_t adc_tx;
+    int64_t rx;       // 收到追踪帧首字节
+    int64_t dec;      // 电压帧解码完成
+    int64_t pub;      // 交给 MQTT 客户端
+} trace_slot_t;
+
+static trace_slot_t s_trace[TRACE_SLOTS];
+static int s_trace_next;
+static portMUX_TYPE s_trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void trace_init(void)
+{
+    for (int i = 0; i < TRACE_SLOTS; i++) {
+        s_trace[i].msg_id = -1;
+    }
+}
+
+// 来不及应答的旧记录直接被覆盖
+static void trace_published(const trace_slot_t *t)
+{
+    taskENTER_CRITICAL(&s_trace_lock);
+    s_trace[s_trace_next] = *t;
+    s_trace_next = (s_trace_next + 1) % TRACE_SLOTS;
+    taskEXIT_CRITICAL(&s_trace_lock);
+}
+
+static void trace_acked(int msg_id)
+{
+    int64_t ack = esp_timer_get_time();
+    trace_slot_t t = {0};
+    bool found = false;
+
+    taskENTER_CRITICAL(&s_trace_lock);
+    for (int i = 0; i < TRACE_SLOTS; i++) {
+        if (s_trace[i].msg_id == msg_id) {
+            t = s_trace[i];
+            s_trace[i].msg_id = -1;
+            found = true;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&s_trace_lock);
+    if (found) {
+        ESP_LOGI(TAG, "TRACE id=%u adc_tx=%" PRIu32 " rx=%" PRId64 " dec=%" PRId64 " pub=%" PRId64 " ack=%" PRId64,
+                 t.id, t.adc_tx, t.rx, t.dec, t.pub, ack);
+    }
+}
+
 static void log_error_if_nonzero(const char *message, int error_code)
 {
     if (error_code != 0) {
@@ -204,6 +277,7 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
         break;
     case MQTT_EVENT_PUBLISHED:
         ESP_LOGI(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+        trace_acked(event->msg_id);
         break;
     case MQTT_EVENT_DATA:
         // 过滤掉 post/reply 的日志，防止刷屏
@@ -331,7 +405,7 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
 static void mqtt_app_start(void)
 {
     esp_mqtt_client_config_t mqtt_cfg = {
-        .broker.address.uri = "mqtt://mqtts.heclouds.com:1883",
+        .broker.address.uri = ONENET_MQTT_URI,
         .credentials.username = "6R9kiumZF1", // 替换为你的产品ID
         .credentials.client_id = "ESP32",      // 替换为你的设备名称
         .credentials.authentication.password = // 替换为你的Token
@@ -384,38 +458,245 @@ void init_uart(void) {
     printf("UART2 initialized on TX=%d, RX=%d\n", TEST_TXD, TEST_RXD);
 }
 
+typedef int (*frame_decoder_t)(const uint8_t *in, void *out);
+
+static int decode_hello(const uint8_t *in, void *out) { return cs1237_decode_hello(in, out); }
+static int decode_config_ack(const uint8_t *in, void *out) { return cs1237_decode_config_ack(in, out); }
+
+// 在串口输入中查找 size 字节、能通过 decode 校验的帧，超时返回 0：
+// AA 55 帧格式下滑动查找；已切换到 COBS 时按 0x00 切包，还原出命令帧再校验
+static int uart_wait_frame(int size, frame_decoder_t decode, void *out, int timeout_ms)
+{
+    uint8_t win[CS1237_HELLO_FRAME_SIZE];  // 等待的帧中最长的是握手帧
+    uint8_t pkt[CS1237_COBS_SIZE(CS1237_HELLO_FRAME_SIZE)];
+    int have = 0;
+    TickType_t end = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
+
+    while (xTaskGetTickCount() < end) {
+        uint8_t b;
+        if (uart_read_bytes(UART_PORT_NUM, &b, 1, pdMS_TO_TICKS(20)) <= 0) continue;
+        if (s_cobs) {
+            if (b != 0) {
+                if (have < (int)sizeof(pkt)) pkt[have] = b;
+                have++;  // 超长的包（电压帧之外的杂包）整包丢弃
+                continue;
+            }
+            if (have > 0 && have <= (int)sizeof(pkt) &&
+                cs1237_cobs_unwrap(pkt, have, win, sizeof(win)) == size && decode(win, out)) return 1;
+            have = 0;
+            continue;
+        }
+        if (have == size) {
+            memmove(win, win + 1, size - 1);
+            have--;
+        }
+        win[have++] = b;
+        if (have == size && decode(win, out)) return 1;
+    }
+    return 0;
+}
+
+// 握手：按 9600 查询能力帧，对方支持切换波特率时升到双方都支持的最高值，
+// 支持 COBS 时再切换帧格式（两次确认帧都还是 AA 55 帧）；
+// 旧固件没有应答，保持 9600 和电压帧解析。
+// 已协商过时先按当前波特率和帧格式探测：对方没有复位（只是停采或数据中断）就保持现有设置，
+// 没有应答才认为对方已复位，回到 9600 重新握手
+static void negotiate_link(void)
+{
+    uint8_t buf[CS1237_SET_BAUD_FRAME_SIZE];
+    cs1237_hello_t hello;
+    cs1237_config_ack_t ack;
+    cs1237_set_baud_t set_baud;
+    cs1237_set_framing_t set_framing;
+    uint32_t baud = UART_BAUD_RATE;
+
+    uart_wait_tx_done(UART_PORT_NUM, pdMS_TO_TICKS(100));
+    uart_get_baudrate(UART_PORT_NUM, &baud);
+    if (baud != UART_BAUD_RATE || s_cobs) {
+        uart_flush_input(UART_PORT_NUM);
+        uart_write_bytes(UART_PORT_NUM, (const char *)buf, cs1237_encode_hello_query(buf));
+        if (uart_wait_frame(CS1237_HELLO_FRAME_SIZE, decode_hello, &hello, HELLO_TIMEOUT_MS)) {
+            ESP_LOGI(TAG, "Link still up @%" PRIu32 "%s", baud, s_cobs ? " (COBS)" : "");
+            return;
+        }
+        ESP_LOGW(TAG, "No hello @%" PRIu32 ", peer reset assumed", baud);
+    }
+
+    s_cobs = false;  // 对方复位后回到 AA 55 帧
+    uart_set_baudrate(UART_PORT_NUM, UART_BAUD_RATE);
+    uart_flush_input(UART_PORT_NUM);
+    uart_write_bytes(UART_PORT_NUM, (const char *)buf, cs1237_encode_hello_query(buf));
+    if (!uart_wait_frame(CS1237_HELLO_FRAME_SIZE, decode_hello, &hello, HELLO_TIMEOUT_MS)) {
+        ESP_LOGW(TAG, "No hello frame, legacy firmware assumed @%d", UART_BAUD_RATE);
+        return;
+    }
+    ESP_LOGI(TAG, "Hello: proto=%d device=%d fw=%04X caps=%04X max_baud=%d batch=%d",
+             hello.proto, hello.device, hello.fw, hello.caps, hello.max_baud, hello.batch_max);
+
+    set_baud.value = hello.max_baud < UART_MAX_BAUD_CODE ? hello.max_baud : UART_MAX_BAUD_CODE;
+    if ((hello.caps & CS1237_CAP_SET_BAUD) && s_baud_rates[set_baud.value] > UART_BAUD_RATE) {
+        uart_write_bytes(UART_PORT_NUM, (const char *)buf, cs1237_encode_set_baud(buf, &set_baud));
+        if (uart_wait_frame(CS1237_CONFIG_ACK_FRAME_SIZE, decode_config_ack, &ack, HELLO_TIMEOUT_MS) &&
+            ack.type == CS1237_CMD_SET_BAUD && ack.value == set_baud.value) {
+            uart_set_baudrate(UART_PORT_NUM, s_baud_rates[set_baud.value]);
+            ESP_LOGI(TAG, "UART switched to %" PRIu32 " baud", s_baud_rates[set_baud.value]);
+        } else {
+            ESP_LOGW(TAG, "No ack for baud change, staying @%d", UART_BAUD_RATE);
+        }
+    }
+
+    if (!USE_COBS || !(hello.caps & CS1237_CAP_COBS)) {
+        return;
+    }
+    set_framing.value = CS1237_FRAMING_COBS;
+    uart_write_bytes(UART_PORT_NUM, (const char *)buf, cs1237_encode_set_framing(buf, &set_framing));
+    if (uart_wait_frame(CS1237_CONFIG_ACK_FRAME_SIZE, decode_config_ack, &ack, HELLO_TIMEOUT_MS) &&
+        ack.type == CS1237_CMD_SET_FRAMING && ack.value == CS1237_FRAMING_COBS) {
+        s_cobs = true;
+        ESP_LOGI(TAG, "UART framing switched to COBS");
+    } else {
+        ESP_LOGW(TAG, "No ack for framing change, staying with AA 55 frames");
+    }
+}
+
+// 发布一个样本；trace 非空时带上追踪号，并记录解码/发布时间；
+// flags 为下位机给的样本质量标志 (CS1237_QFLAG_*)，不为 0 时作为属性 flags 一起上报，由下游按位判断取舍
+static void publish_sample(const cs1237_voltage_t *v, uint8_t flags, trace_slot_t *trace)
+{
+    char payload[224];
+    char trace_param[32] = "";
+    char flags_param[24] = "";
+
+    ESP_LOGI(TAG, "UART Recv: %.4f V (PGA=%d, flags=%02X)", v->voltage, v->pga, flags);
+    if (!mqtt_client) {
+        return;
+    }
+    if (trace) {
+        trace->dec = esp_timer_get_time();
+        // 真实平台需要在物模型中添加整数属性 trace
+        snprintf(trace_param, sizeof(trace_param), ",\"trace\":{\"value\":%u}", trace->id);
+    }
+    if (flags) {
+        // 真实平台同样需要在物模型中添加整数属性 flags
+        snprintf(flags_param, sizeof(flags_param), ",\"flags\":{\"value\":%u}", flags);
+    }
+    // OneNet standard format - identifiers updated to lowercase 'voltage' and 'pga'
+    snprintf(payload, sizeof(payload),
+        "{\"id\":\"%d\",\"version\":\"1.0\",\"params\":{\"voltage\":{\"value\":%.4f},\"pga\":{\"value\":%d}%s%s}}",
+        (int)xTaskGetTickCount(), v->voltage, v->pga, flags_param, trace_param);
+
+    int64_t pub = esp_timer_get_time();
+    int msg_id = esp_mqtt_client_publish(mqtt_client, "$sys/6R9kiumZF1/ESP32/thing/property/post", payload, 0, 1, 0);
+    if (trace && msg_id > 0) {
+        trace->pub = pub;
+        trace->msg_id = msg_id;
+        trace_published(trace);
+    }
+}
+
+// 处理一个 COBS 包（两个 0x00 之间的字节），start 为包首字节的到达时间；
+// 还原不出命令帧的（混入的文本、线路错误）直接丢弃，下一个 0x00 即重新同步
+static void handle_cobs_packet(const uint8_t *pkt, int n, int64_t start,
+                               trace_slot_t *trace, bool *trace_pending)
+{
+    uint8_t frame[CS1237_TRACE_FRAME_SIZE];  // 电压帧（0x08）或追踪帧，追踪帧最长
+    cs1237_voltage_pga_t vp;
+    cs1237_trace_t t;
+
+    if (!cs1237_cobs_unwrap(pkt, n, frame, sizeof(frame))) {
+        ESP_LOGD(TAG, "Dropped COBS packet (%d bytes)", n);
+        return;
+    }
+    if (cs1237_decode_voltage_pga(frame, &vp)) {
+        cs1237_voltage_t v = { .voltage = vp.voltage, .pga = vp.pga };
+        publish_sample(&v, vp.flags, *trace_pending ? trace : NULL);
+        *trace_pending = false;
+    } else if (cs1237_decode_trace(frame, &t)) {
+        trace->id = t.id;
+        trace->adc_tx = t.tx_us - t.adc_us;
+        trace->rx = start;
+        *trace_pending = true;
+    }
+}
+
 static void rx_task(void *arg)
 {
     uint8_t byte_in;
     int state = 0; // 0: wait AA, 1: wait 55, 2: read data
-    uint8_t frame_buffer[10];
+    uint8_t frame_buffer[CS1237_TRACE_FRAME_SIZE];  // 电压帧或追踪帧
     int data_idx = 0;
+    int64_t frame_start = 0;         // 当前帧首字节的到达时间
+    trace_slot_t trace = {0};        // 最近收到、还没配上电压帧的追踪帧
+    bool trace_pending = false;
+    uint8_t chunk[COBS_CHUNK];
+    uint8_t cobs_pkt[CS1237_COBS_SIZE(CS1237_TRACE_FRAME_SIZE)];
+    int cobs_len = 0;                // 当前包已收字节数，超过缓冲区的包整包丢弃
     
     printf("UART RX Task Started!\n"); // 确认任务启动
+    trace_init();
 
     // 记录最后一次收到数据的时间
     TickType_t last_data_time = xTaskGetTickCount();
 
+    negotiate_link();
+
     // 初始发送一次 'A'
     printf("Sending start command 'A' to Arduino...\n");
     uart_write_bytes(UART_PORT_NUM, "A", 1);
 
     while (1) {
-        // 如果采集被禁用，暂停任务
+        // 如果采集被禁用，暂停任务；暂停期间没有数据不算超时，恢复后从头计时
         if (!g_collection_enable) {
             vTaskDelay(1000 / portTICK_PERIOD_MS);
+            last_data_time = xTaskGetTickCount();
             continue;
         }
 
         // 如果超过 2 秒没有收到任何数据，重发 'A' 指令
         if ((xTaskGetTickCount() - last_data_time) > (2000 / portTICK_PERIOD_MS)) {
             if (!g_is_configuring) {
-                printf("Timeout! No data from Arduino. Resending 'A'...\n");
+                // 先按当前设置探测，Arduino 复位（回到 9600）时才重新握手
+                printf("Timeout! No data from Arduino. Renegotiating and resending 'A'...\n");
+                negotiate_link();
                 uart_write_bytes(UART_PORT_NUM, "A", 1);
+                state = 0;
+                cobs_len = 0;
             }
             last_data_time = xTaskGetTickCount(); 
         }
 
+        if (s_cobs) {
+            // 有多少取多少（至少等 1 字节），按 0x00 切包
+            size_t avail = 0;
+            uart_get_buffered_data_len(UART_PORT_NUM, &avail);
+            int n = uart_read_bytes(UART_PORT_NUM, chunk, avail ? (avail < sizeof(chunk) ? avail : sizeof(chunk)) : 1,
+                                    100 / portTICK_PERIOD_MS);
+            if (n <= 0) continue;
+            last_data_time = xTaskGetTickCount();
+
+            const uint8_t *p = chunk, *end = chunk + n;
+            while (p < end) {
+                const uint8_t *zero = memchr(p, 0, end - p);
+                int run = (zero ? zero : end) - p;
+                if (run > 0) {
+                    if (cobs_len == 0) frame_start = esp_timer_get_time();
+                    if (cobs_len + run <= (int)sizeof(cobs_pkt)) {
+                        memcpy(cobs_pkt + cobs_len, p, run);
+                        cobs_len += run;
+                    } else {
+                        cobs_len = sizeof(cobs_pkt) + 1;
+                    }
+                }
+                if (!zero) break;
+                if (cobs_len > 0 && cobs_len <= (int)sizeof(cobs_pkt)) {
+                    handle_cobs_packet(cobs_pkt, cobs_len, frame_start, &trace, &trace_pending);
+                }
+                cobs_len = 0;
+                p = zero + 1;
+            }
+            continue;
+        }
+
         // 读取串口数据
         int len = uart_read_bytes(UART_PORT_NUM, &byte_in, 1, 100 / portTICK_PERIOD_MS);
         if (len > 0) {
@@ -429,6 +710,7 @@ static void rx_task(void *arg)
                 case 0:
                     if (byte_in == 0xAA) {
                         frame_buffer[0] = byte_in;
+                        frame_start = esp_timer_get_time();
                         state = 1;
                     }
                     break;
@@ -444,29 +726,31 @@ static void rx_task(void *arg)
                     break;
                 case 2:
                     frame_buffer[data_idx++] = byte_in;
-                    if (data_idx == 10) {
-                        // Frame complete, verify tail
-                        if (frame_buffer[8] == 0x0D && frame_buffer[9] == 0x0A) {
-                            // Valid frame
-                            float voltage;
-                            memcpy(&voltage, &frame_buffer[2], 4);
-                            uint16_t pga;
-                            memcpy(&pga, &frame_buffer[6], 2);
-
-                            ESP_LOGI(TAG, "UART Recv: %.4f V (PGA=%d)", voltage, pga);
-
-                            if (mqtt_client) {
-                                char payload[200];
-                                // OneNet standard format - identifiers updated to lowercase 'voltage' and 'pga'
-                                snprintf(payload, sizeof(payload), 
-                                    "{\"id\":\"%d\",\"version\":\"1.0\",\"params\":{\"voltage\":{\"value\":%.4f},\"pga\":{\"value\":%d}}}", 
-                                    (int)xTaskGetTickCount(), voltage, pga);
-                                
-                                esp_mqtt_client_publish(mqtt_client, "$sys/6R9kiumZF1/ESP32/thing/property/post", payload, 0, 1, 0);
-                            }
+                    // 电压帧没有长度/命令字节，凭 [长度][0x07] 认出追踪帧，收满 17 字节再解析
+                    if (data_idx == CS1237_VOLTAGE_FRAME_SIZE &&
+                        !(frame_buffer[2] == TRACE_LEN_FIELD && frame_buffer[3] == CS1237_CMD_TRACE)) {
+                        // Frame complete, verify head/tail and unpack
+                        cs1237_voltage_t v;
+                        if (cs1237_decode_voltage(frame_buffer, &v)) {
+                            publish_sample(&v, 0, trace_pending ? &trace : NULL);
                         } else {
                             ESP_LOGW(TAG, "Invalid Frame Tail: %02X %02X", frame_buffer[8], frame_buffer[9]);
                         }
+                        trace_pending = false;
+                        state = 0;
+                    } else if (data_idx == CS1237_TRACE_FRAME_SIZE) {
+                        cs1237_trace_t t;
+                        cs1237_voltage_t v;
+                        if (cs1237_decode_trace(frame_buffer, &t)) {
+                            trace.id = t.id;
+                            trace.adc_tx = t.tx_us - t.adc_us;
+                            trace.rx = frame_start;
+                            trace_pending = true;
+                        } else if (cs1237_decode_voltage(frame_buffer, &v)) {
+                            // 电压值的低字节碰巧像追踪帧头，多读的 7 字节丢弃
+                            publish_sample(&v, 0, NULL);
+                            trace_pending = false;
+                        }
                         state = 0;
                     }
                     break;
@@ -1,7 +1,6 @@
 import sys
 import time
 import re
-import struct
 from collections import deque
 from datetime import datetime
 import threading
@@ -10,7 +9,7 @@ from PyQt6.QtWidgets import (QApplication, QMainWindow, QWidget, QVBoxLayout,
                              QHBoxLayout, QLabel, QComboBox, QPushButton, 
                              QTextEdit, QGroupBox, QGridLayout, QMessageBox,
                              QFileDialog, QLineEdit, QDialog, QCheckBox, QScrollArea)
-from PyQt6.QtCore import QThread, pyqtSignal, Qt
+from PyQt6.QtCore import QThread, pyqtSignal, Qt, QTimer
 from PyQt6.QtGui import QFont, QCursor
 
 import serial
@@ -47,6 +46,35 @@ CS1237 GUI 控制程序 V3.0
 
 
 
+# 协议帧常量与编解码由 protocol/gen_proto.py 生成（cs1237_proto.py），与下位机同源
+from cs1237_proto import (CMD_ADC_DATA, CMD_ERROR, CMD_STATUS, CMD_ADC_BATCH, CMD_HELLO, CMD_SET_BITS,
+                          CMD_SET_BAUD, CMD_CONFIG_ACK, MAX_FRAME_LEN, BATCH_BITS, ERROR_TEXT,
+                          STATUS_FIELDS, HELLO_FIELDS, VOLTAGE_FIELDS, VOLTAGE_FRAME_LEN,
+                          CAP_VOLTAGE, CAP_SET_BITS, CAP_SET_BAUD, CAP_COBS, DEV_TEXT, BAUD_RATES,
+                          CMD_VOLTAGE_PGA, CMD_SET_FRAMING, FRAMING_COBS, FRAMING_TEXT,
+                          VOLTAGE_PGA_FIELDS, QFLAG_BAD, QFLAG_NAMES,
+                          CMD_BULK_INFO, CMD_BULK_DATA, CAP_BULK, BULK_SRC_HISTORY,
+                          encode_frame, parse_fields, unpack_batch, unwrap_cobs, bit_names)
+import session
+import bulk_transfer
+from changepoint import StepDetector, segment as segment_steps
+
+HOST_MAX_BAUD = 921600   # 本机串口（USB 转串口）可用的最高波特率
+HELLO_TIMEOUT_MS = 800   # 连接后等待握手帧的时间，超时按旧固件处理
+SNAPSHOT_POLL_MS = 10    # 快照传输中检查超时、补发确认的间隔
+USE_COBS = True          # 设备支持时切换到 COBS 帧格式（0x00 分隔，帧内不会出现假帧头帧尾）
+COBS_TEXT_IDLE = 0.1     # COBS 模式下串口空闲这么久，缓冲里没等到 0x00 的字节按文本输出
+
+# 位宽截断方式（与下位机 frame.h 中 FRAME_Q_* 一致）
+QUANT_MODES = {0: "四舍五入", 1: "抖动", 2: "噪声整形"}
+
+
+def decode_adc_batch(data):
+    """解析批量ADC帧数据区，返回 (序号, [ADC码值, ...])，格式不符时抛出 ValueError"""
+    seq, _bits, values = unpack_batch(data)
+    return seq, values
+
+
 class SerialThread(QThread):
     """串口读取线程 - 健壮的状态机模式，处理两种帧格式"""
     data_received = pyqtSignal(str)
@@ -60,19 +88,35 @@ class SerialThread(QThread):
         self.buffer = bytearray()
         self.FRAME_HEAD = b'\xaa\x55'
         self.FRAME_TAIL = b'\x0d\x0a'
+        # 握手帧表明设备不发电压帧时关掉电压帧猜测，只按协议帧解析
+        self.voltage_frames = True
+        # 收到 0xA7 的确认帧后由本线程切换，确认帧之后的字节即按 COBS 切包
+        self.cobs = False
 
     def run(self):
         text_buffer = bytearray()
+        last_rx = time.time()
         while self.running and self.serial_port and self.serial_port.is_open:
             try:
                 if self.serial_port.in_waiting > 0:
                     new_data = self.serial_port.read(self.serial_port.in_waiting)
                     self.buffer.extend(new_data)
+                    last_rx = time.time()
                 else:
+                    if self.cobs and self.buffer and time.time() - last_rx > COBS_TEXT_IDLE:
+                        # 空闲时还没等到 0x00 的只能是文本（包在 0x00 之后紧接着发完）
+                        text_buffer.extend(self.buffer)
+                        self.buffer.clear()
+                        self.emit_text(text_buffer)
+                        text_buffer.clear()
                     time.sleep(0.01)
                     continue
 
-                while len(self.buffer) > 0:
+                if self.cobs:
+                    self.split_cobs_packets(text_buffer)
+                    continue
+
+                while len(self.buffer) > 0 and not self.cobs:
                     # 检查是否可能是帧头
                     if self.buffer.startswith(self.FRAME_HEAD):
                         # 1. 如果数据太短，无法判断是哪种帧，先等待
@@ -86,12 +130,35 @@ class SerialThread(QThread):
                         
                         # 3. 尝试解析
                         # 情况A: 数据不足10字节 (电压帧需要10字节)
-                        if len(self.buffer) < 10:
+                        if not self.voltage_frames:
+                            if len(self.buffer) < proto_len:
+                                if proto_len > MAX_FRAME_LEN:
+                                    text_buffer.append(self.buffer.pop(0))
+                                    continue
+                                break
+                            parsed_len = self.parse_protocol_frame()
+                            if parsed_len > 0:
+                                self.buffer = self.buffer[parsed_len:]
+                            else:
+                                text_buffer.append(self.buffer.pop(0))
+                            continue
+
+                        if len(self.buffer) < VOLTAGE_FRAME_LEN:
                             # 如果也不足旧协议帧长度，或者旧协议帧长度不合理，则必须等待
                             # (因为可能是电压帧，必须等到10字节才能确认不是)
                             break
                         
                         # 情况B: 数据 >= 10字节
+                        # 批量帧(0x05)/握手帧(0x06)/快照帧(0x09/0x0A)的前10字节也可能碰巧以 0D 0A 结尾，
+                        # 遇到这些命令字节先按协议帧完整校验，数据不够则等待，避免被误认成电压帧
+                        if self.buffer[3] in (CMD_ADC_BATCH, CMD_HELLO, CMD_BULK_INFO, CMD_BULK_DATA):
+                            if len(self.buffer) < proto_len:
+                                break
+                            parsed_len = self.parse_protocol_frame()
+                            if parsed_len > 0:
+                                self.buffer = self.buffer[parsed_len:]
+                                continue
+
                         # 先尝试电压帧 (这是高频数据，优先)
                         parsed_len = self.parse_voltage_frame()
                         if parsed_len > 0:
@@ -104,7 +171,7 @@ class SerialThread(QThread):
                             # 数据不够旧协议帧，等待
                             # (注意：如果 proto_len 很大，可能是垃圾数据导致的，
                             # 但为了安全，我们先等待。可以加个上限保护)
-                            if proto_len > 64: # 假设最大帧长合理值
+                            if proto_len > MAX_FRAME_LEN:
                                 # 长度异常，可能是垃圾数据，丢弃帧头
                                 text_buffer.append(self.buffer.pop(0))
                                 continue
@@ -140,9 +207,36 @@ class SerialThread(QThread):
         if text_buffer:
             self.emit_text(text_buffer)
 
+    def split_cobs_packets(self, text_buffer):
+        """COBS 模式：按 0x00 切包，还原不出命令帧的内容当作文本"""
+        while True:
+            end = self.buffer.find(0)
+            if end < 0:
+                return
+            packet = bytes(self.buffer[:end])
+            del self.buffer[:end + 1]
+            if not packet:
+                continue
+            try:
+                frame = unwrap_cobs(packet)
+            except ValueError:
+                text_buffer.extend(packet)
+                if b'\n' in text_buffer:
+                    self.emit_text(text_buffer)
+                    text_buffer.clear()
+                continue
+            self.emit_frame(bytes(frame[3:4]) + bytes(frame[4:-3]))
+
+    def emit_frame(self, cmd_data):
+        """cmd_data 为 [命令][数据]；帧格式确认帧在此切换解析方式"""
+        cmd, data = cmd_data[0], cmd_data[1:]
+        if cmd == CMD_CONFIG_ACK and len(data) >= 2 and data[0] == CMD_SET_FRAMING:
+            self.cobs = data[1] == FRAMING_COBS
+        self.frame_received.emit(cmd, data, time.time())
+
     def parse_voltage_frame(self):
         """尝试解析10字节的 [头-电压-PGA-尾] 帧, 成功返回帧长度，否则返回0"""
-        FRAME_LEN = 10
+        FRAME_LEN = VOLTAGE_FRAME_LEN
         if self.buffer.startswith(self.FRAME_HEAD) and len(self.buffer) >= FRAME_LEN:
             frame = self.buffer[:FRAME_LEN]
             if frame.endswith(self.FRAME_TAIL):
@@ -164,11 +258,8 @@ class SerialThread(QThread):
             if len(self.buffer) >= frame_len:
                 frame = self.buffer[:frame_len]
                 if frame.endswith(self.FRAME_TAIL) and self.verify_checksum(frame):
-                    cmd = frame[3]
                     data_len = max(0, payload_len - 1)
-                    data = frame[4 : 4 + data_len]
-                    timestamp = time.time()
-                    self.frame_received.emit(cmd, bytes(data), timestamp)
+                    self.emit_frame(bytes(frame[3 : 4 + data_len]))
                     return frame_len
         return 0
         
@@ -220,6 +311,9 @@ class DataAnalysisWindow(QDialog):
         self.cursor_vline = None
         self.cursor_hline = None
         
+        # 自动分段标出的变点竖线
+        self.segment_lines = []
+
         # 缩放相关
         self.zoom_mode = False  # 是否处于缩放模式
         self.zoom_rect = None  # 缩放矩形
@@ -301,6 +395,11 @@ class DataAnalysisWindow(QDialog):
             }
         """)
         btn_layout.addWidget(self.zoom_btn)
+
+        segment_btn = QPushButton("自动分段")
+        segment_btn.setMaximumWidth(100)
+        segment_btn.clicked.connect(self.auto_segment)
+        btn_layout.addWidget(segment_btn)
         
         btn_layout.addStretch()
         
@@ -682,6 +781,31 @@ class DataAnalysisWindow(QDialog):
         
         self.canvas.draw_idle()
     
+    def auto_segment(self):
+        """按阶跃自动分段（PELT，见 changepoint.py），在图上标出变点并列出各段统计"""
+        if len(self.original_data_x) < 10:
+            QMessageBox.information(self, "提示", "数据点太少，无法分段")
+            return
+        try:
+            segments = segment_steps(self.original_data_x, self.original_data_y)
+        except Exception as e:
+            QMessageBox.critical(self, "错误", f"自动分段失败:\n{str(e)}")
+            return
+
+        for line in self.segment_lines:
+            line.remove()
+        self.segment_lines = [
+            self.ax.axvline(seg.start, color='#FF5722', linestyle='--', linewidth=1.0)
+            for seg in segments[1:]
+        ]
+        self.canvas.draw()
+
+        lines = [f"共 {len(segments)} 段", "起点(s)    时长(s)    均值    噪声    阶跃    稳定用时(s)"]
+        for seg in segments:
+            lines.append(f"{seg.start:8.2f}  {seg.end - seg.start:8.2f}  {seg.mean:+.4f}  "
+                         f"{seg.noise:.4f}  {seg.step:+.4f}  {seg.settle:.2f}")
+        QMessageBox.information(self, "自动分段", "\n".join(lines))
+
     def export_data(self):
         """导出分析数据"""
         if not self.data_x or not self.data_y:
@@ -1106,6 +1230,11 @@ class CS1237_GUI(QMainWindow):
         self.is_continuous = False
         self.menu_text_warning_shown = False
         self.show_adc_only = True
+        self.device_caps = None      # 握手帧中的能力位，None 表示旧固件/尚未握手
+        self.pending_baud = None     # 已请求、等待确认的波特率编码
+        self.snapshot = None         # 进行中的快照传输（bulk_transfer.BulkReceiver）
+        self.snapshot_timer = QTimer(self)
+        self.snapshot_timer.timeout.connect(self.poll_snapshot)
         # 仅在文本框显示必要信息（ADC、状态、成功/失败）
         self.allowed_output_categories = {
             "adc",
@@ -1160,7 +1289,8 @@ class CS1237_GUI(QMainWindow):
         self.outlier_threshold = 3.5  # MAD异常值阈值（修正Z分数）
         self.min_data_for_filter = 20  # 至少需要20个数据点才开始统计过滤
         self.recent_values = deque(maxlen=100)  # 保存最近100个值用于计算统计特征（增加窗口大小以提高稳定性）
-        self.outlier_count = 0  # 被过滤的异常值计数
+        self.outlier_count = 0  # 被过滤的异常值计数（含按质量标志跳过的样本）
+        self.last_skipped_flags = 0  # 最近一次跳过样本的质量标志，用于合并提示
         
         # 单点脉冲检测缓冲区（简化为滑动窗口）
         self.spike_buffer = deque(maxlen=5)  # 存储 (time, value)，用于3点脉冲检测
@@ -1200,6 +1330,10 @@ class CS1237_GUI(QMainWindow):
         self.kalman_filter = KalmanFilter(q=0.002, r=1.0) # R值越大越平滑
         self.enable_kalman = False
 
+        # 阶跃检测（加载/卸载时刻与稳定用时，见 changepoint.py）
+        self.step_detector = None
+        self.enable_step_detect = False
+
         self.init_ui()
         self.refresh_ports()
         # 用于检测用户是否手动调整了视图；只有在上次自动设置的范围未被用户改动时才覆盖轴范围
@@ -1367,6 +1501,33 @@ class CS1237_GUI(QMainWindow):
         self.kalman_checkbox.stateChanged.connect(self.toggle_kalman_filter)
         self.kalman_checkbox.setMinimumHeight(25)
         config_layout.addWidget(self.kalman_checkbox, 5, 1, 1, 2)
+
+        # 批量帧样本位宽（STM32/STC 下位机），低位宽可在同样波特率下传更多样本
+        config_layout.addWidget(QLabel("输出位宽:"), 6, 0)
+        bits_layout = QHBoxLayout()
+        bits_layout.setSpacing(6)
+        self.bits_combo = QComboBox()
+        self.bits_combo.addItems([f"{b} bit" for b in BATCH_BITS])
+        self.bits_combo.setMinimumHeight(25)
+        bits_layout.addWidget(self.bits_combo)
+        self.quant_combo = QComboBox()
+        self.quant_combo.addItems(list(QUANT_MODES.values()))
+        self.quant_combo.setMinimumHeight(25)
+        bits_layout.addWidget(self.quant_combo)
+        config_layout.addLayout(bits_layout, 6, 1)
+
+        self.set_bits_btn = QPushButton("设置")
+        self.set_bits_btn.setMaximumWidth(60)
+        self.set_bits_btn.clicked.connect(self.set_batch_bits)
+        config_layout.addWidget(self.set_bits_btn, 6, 2)
+
+        # 阶跃检测开关：实时标出加载/卸载时刻和稳定用时
+        config_layout.addWidget(QLabel("阶跃检测:"), 7, 0)
+        self.step_checkbox = QCheckBox("启用")
+        self.step_checkbox.setChecked(False)
+        self.step_checkbox.stateChanged.connect(self.toggle_step_detect)
+        self.step_checkbox.setMinimumHeight(25)
+        config_layout.addWidget(self.step_checkbox, 7, 1, 1, 2)
         
         config_group.setLayout(config_layout)
         left_layout.addWidget(config_group)
@@ -1385,6 +1546,13 @@ class CS1237_GUI(QMainWindow):
         save_data_btn.setMinimumHeight(35)
         save_data_btn.clicked.connect(self.save_data_manual)
         left_layout.addWidget(save_data_btn)
+
+        # 读取快照按钮：取回下位机 RAM 中最近的一段样本（分块传输，丢块只补丢的）
+        self.snapshot_btn = QPushButton("📥 读取快照")
+        self.snapshot_btn.setMinimumHeight(35)
+        self.snapshot_btn.setEnabled(False)  # 握手帧带 CAP_BULK 才可用
+        self.snapshot_btn.clicked.connect(self.start_snapshot)
+        left_layout.addWidget(self.snapshot_btn)
         
         # 电压校准按钮
         self.calibration_btn = QPushButton("⚡ 电压校准")
@@ -1529,6 +1697,7 @@ class CS1237_GUI(QMainWindow):
             self.serial_thread.frame_received.connect(self.on_frame_received)  # 新增：帧接收
             self.serial_thread.error_occurred.connect(self.on_error)
             self.serial_thread.start()
+            self.request_hello()
 
             # 连接成功后提示校准
             choice = self.show_calibration_dialog()
@@ -1538,6 +1707,23 @@ class CS1237_GUI(QMainWindow):
         except Exception as e:
             QMessageBox.critical(self, "连接错误", f"无法连接串口: {str(e)}")
             
+    def request_hello(self):
+        """连接后查询握手帧；旧固件不应答，超时后沿用帧格式自动识别"""
+        self.device_caps = None
+        self.pending_baud = None
+        self.pending_framing = None
+        self.set_bits_btn.setEnabled(True)
+        try:
+            self.serial_port.write(encode_frame(CMD_HELLO))
+        except Exception as e:
+            self.log_message(f"发送握手查询失败: {str(e)}\n", category="error")
+            return
+        QTimer.singleShot(HELLO_TIMEOUT_MS, self.on_hello_timeout)
+
+    def on_hello_timeout(self):
+        if self.is_connected and self.device_caps is None:
+            self.log_message("ℹ️ 未收到握手帧，按旧固件处理（自动识别帧格式）\n", category="status")
+
     def disconnect_serial(self):
         """断开串口连接"""
         # 停止连续读取
@@ -1546,6 +1732,10 @@ class CS1237_GUI(QMainWindow):
             self.is_continuous = False
             self.continuous_btn.setText("开始连续读取")
         
+        self.snapshot_timer.stop()
+        self.snapshot = None
+        self.snapshot_btn.setEnabled(False)
+
         # 停止串口线程
         if self.serial_thread:
             self.serial_thread.stop()
@@ -1632,21 +1822,46 @@ class CS1237_GUI(QMainWindow):
     def on_frame_received(self, cmd, data, timestamp):
         """处理所有接收到的协议帧"""
         try:
-            if cmd == 0xFF or cmd == 0x01:  # 新的电压帧(0xFF)或旧的ADC帧(0x01)
+            if cmd == 0xFF or cmd == CMD_ADC_DATA:  # 新的电压帧(0xFF)或旧的ADC帧(0x01)
                 self.handle_adc_frame(data, timestamp)
-            elif cmd == 0x03:  # 错误帧
+            elif cmd == CMD_VOLTAGE_PGA:  # COBS 格式下带质量标志的电压帧
+                self.handle_voltage_pga_frame(data, timestamp)
+            elif cmd == CMD_ADC_BATCH:  # 批量ADC帧
+                self.handle_adc_batch_frame(data, timestamp)
+            elif cmd == CMD_ERROR:  # 错误帧
                 self.handle_error_frame(data)
-            elif cmd == 0x04:  # 状态帧
+            elif cmd == CMD_STATUS:  # 状态帧
                 self.handle_status_frame(data)
-            elif cmd == 0xB1:  # 配置确认帧
+            elif cmd == CMD_HELLO:  # 握手帧
+                self.handle_hello_frame(data)
+            elif cmd == CMD_CONFIG_ACK:  # 配置确认帧
                 self.handle_config_ack_frame(data)
+            elif cmd in (CMD_BULK_INFO, CMD_BULK_DATA):  # 快照传输
+                self.handle_snapshot_frame(cmd, data)
             else:
                 print(f"未知命令: 0x{cmd:02X}")
         except Exception as e:
             self.log_message(f"帧处理错误: {str(e)}\n", category="error")
     
-    def handle_adc_frame(self, data, timestamp):
-        """处理两种ADC数据：旧的ADC原始值帧和新的电压值帧 - 带异常值过滤"""
+    def handle_voltage_pga_frame(self, data, timestamp):
+        """带质量标志的电压帧：下位机标为不可用的样本按位测试直接跳过，其余样本不再做前后文异常检测"""
+        if len(data) < VOLTAGE_PGA_FIELDS.itemsize:
+            return
+        flags = int(parse_fields(VOLTAGE_PGA_FIELDS, data)["flags"])
+        if flags & QFLAG_BAD:
+            self.outlier_count += 1
+            # 同样的标志连续出现时只提示一次
+            if flags != self.last_skipped_flags:
+                self.log_message(f"🚩 跳过下位机标记的样本: {', '.join(bit_names(flags, QFLAG_NAMES))}\n",
+                                 category="status")
+            self.last_skipped_flags = flags
+            return
+        self.last_skipped_flags = 0
+        self.handle_adc_frame(bytes(data[:VOLTAGE_FIELDS.itemsize]), timestamp, flagged=True)
+
+    def handle_adc_frame(self, data, timestamp, flagged=False):
+        """处理两种ADC数据：旧的ADC原始值帧和新的电压值帧 - 带异常值过滤
+        flagged 为真表示样本已由下位机标过质量，跳过前后文异常检测"""
         # 🛡️ 过滤掉早于当前开始时间的数据（防止清除输出后残留旧数据）
         # 增加 0.1s 的容差，防止微小的时钟差异导致误判，但对于明显的旧数据（如几秒前的）坚决丢弃
         if timestamp < self.start_time - 0.1:
@@ -1699,10 +1914,11 @@ class CS1237_GUI(QMainWindow):
         relative_time = current_time - self.start_time
 
         # --- 新增：根据数据长度判断是哪种帧 ---
-        if len(data) == 6: # 新的电压+PGA帧 (4+2=6字节)
+        if len(data) == VOLTAGE_FIELDS.itemsize: # 新的电压+PGA帧 (4+2=6字节)
             try:
-                voltage_value = struct.unpack('<f', data[:4])[0]
-                pga_value = struct.unpack('<H', data[4:])[0]
+                fields = parse_fields(VOLTAGE_FIELDS, data)
+                voltage_value = float(fields["voltage"])
+                pga_value = int(fields["pga"])
                 
                 # 更新当前PGA值（从帧中获取）
                 self.current_pga = float(pga_value)
@@ -1742,7 +1958,7 @@ class CS1237_GUI(QMainWindow):
                     
                     self.log_message(f"📊 [{relative_time:7.2f}s] {value_to_plot:+.4f} mV\n", category="adc")
 
-            except struct.error as e:
+            except ValueError as e:
                 print(f"⚠️ 解析电压帧失败: {e}")
                 return
                 
@@ -1824,7 +2040,7 @@ class CS1237_GUI(QMainWindow):
                     next_ctx_list = [v for (_, v) in [self.buffered_points[3], self.buffered_points[4]]]
                     
                     # 有足够的前后文，进行检测
-                    if len(prev_context) >= 2 and len(next_ctx_list) >= 2:
+                    if not flagged and len(prev_context) >= 2 and len(next_ctx_list) >= 2:
                         # 五点：p1, p2, p3(当前), p4, p5
                         # 检测异常（基于电压值 mV）
                         is_outlier_ctx = False
@@ -1882,6 +2098,9 @@ class CS1237_GUI(QMainWindow):
                     # 应用卡尔曼滤波
                     if self.enable_kalman:
                         v_output = self.kalman_filter.update(v_output)
+
+                    if self.enable_step_detect:
+                        self.feed_step_detector(t_rel_output, v_output)
                         
                     self.recent_values.append(v_output)
                     self.plot_data_x.append(t_rel_output)
@@ -1900,34 +2119,43 @@ class CS1237_GUI(QMainWindow):
             self.update_plot()
             self.last_draw_time = now
     
+    def handle_adc_batch_frame(self, data, timestamp):
+        """批量帧拆成逐个ADC值，复用单点处理流程（时间戳按采样率自动平滑展开）"""
+        seq, values = decode_adc_batch(data)
+        expected = getattr(self, 'last_batch_seq', None)
+        if expected is not None and seq != (expected + 1) & 0xFFFF:
+            lost = (seq - expected - 1) & 0xFFFF
+            self.log_message(f"⚠️ 批量帧序号跳变 {expected} → {seq}，丢失约 {lost} 帧\n", category="error")
+        self.last_batch_seq = seq
+        for value in values:
+            self.handle_adc_frame(value.to_bytes(4, 'big', signed=True), timestamp)
+
     def handle_error_frame(self, data):
         """处理错误帧"""
         if len(data) < 1:
             return
         
         error_code = data[0]
-        error_msgs = {
-            0x01: "SPI读取失败",
-            0x02: "数据无效",
-            0x03: "超时",
-            0x04: "测温模式需设置PGA=1"
-        }
-        msg = error_msgs.get(error_code, f"未知错误 (0x{error_code:02X})")
+        msg = ERROR_TEXT.get(error_code, f"未知错误 (0x{error_code:02X})")
         self.log_message(f"⚠️ Arduino报告错误: {msg}\n", category="error")
+        if self.snapshot and self.snapshot.info is None:
+            # 快照请求被拒（还没有记录、正在采集）
+            self.snapshot.fail(f"下位机拒绝快照请求: {msg}")
+            self.finish_snapshot()
     
     def handle_status_frame(self, data):
         """处理状态帧"""
         if len(data) < 5:
             return
 
-        pga_code = data[0]
-        rate_code = data[1]
-        channel_code = data[2]
-
-        remaining_bytes = data[3:]
-        success_count = 0
-        for b in remaining_bytes:
-            success_count = (success_count << 8) | b
+        if len(data) >= STATUS_FIELDS.itemsize:
+            st = parse_fields(STATUS_FIELDS, data)
+            pga_code, rate_code, channel_code = int(st["pga"]), int(st["rate"]), int(st["channel"])
+            success_count = int(st["reads"])
+        else:
+            # 旧固件只发成功次数的低 3 字节
+            pga_code, rate_code, channel_code = data[0], data[1], data[2]
+            success_count = int.from_bytes(data[3:], 'big')
 
         pga_map = {0: 1.0, 1: 2.0, 2: 64.0, 3: 128.0}
         rate_map = {0: "10 Hz", 1: "40 Hz", 2: "640 Hz", 3: "1280 Hz"}
@@ -1966,6 +2194,60 @@ class CS1237_GUI(QMainWindow):
             category="status",
         )
     
+    def handle_hello_frame(self, data):
+        """处理握手帧：记录设备能力，按能力选择解析方式并协商波特率"""
+        if len(data) < HELLO_FIELDS.itemsize:
+            return
+        hello = parse_fields(HELLO_FIELDS, data)
+        caps, fw = int(hello["caps"]), int(hello["fw"])
+        self.device_caps = caps
+        device = DEV_TEXT.get(int(hello["device"]), f"未知设备({int(hello['device'])})")
+        self.log_message(
+            f"🤝 握手: {device} 固件 V{fw >> 8}.{fw & 0xFF}，协议版本 {int(hello['proto'])}，"
+            f"能力 0x{caps:04X}，最高 {BAUD_RATES[min(int(hello['max_baud']), len(BAUD_RATES) - 1)]} baud，"
+            f"批量 {int(hello['batch_max'])} 样本\n",
+            category="status",
+        )
+
+        if self.serial_thread:
+            self.serial_thread.voltage_frames = bool(caps & CAP_VOLTAGE)
+        self.set_bits_btn.setEnabled(bool(caps & CAP_SET_BITS))
+        self.snapshot_btn.setEnabled(bool(caps & CAP_BULK))
+
+        if self.pending_baud is not None or self.pending_framing is not None:
+            return
+        codes = [c for c, b in enumerate(BAUD_RATES) if c <= int(hello["max_baud"]) and b <= HOST_MAX_BAUD]
+        if caps & CAP_SET_BAUD and codes and BAUD_RATES[codes[-1]] > self.serial_port.baudrate:
+            # 先切波特率，确认后再切帧格式，两次确认帧都是 AA 55 帧
+            self.pending_baud = codes[-1]
+            self.serial_port.write(encode_frame(CMD_SET_BAUD, bytes([self.pending_baud])))
+        else:
+            self.request_framing()
+
+    def request_framing(self):
+        """设备支持时请求切换到 COBS 帧格式，串口线程收到确认帧后自行切换"""
+        if not USE_COBS or not (self.device_caps or 0) & CAP_COBS:
+            return
+        if self.serial_thread and self.serial_thread.cobs:
+            return
+        self.pending_framing = FRAMING_COBS
+        try:
+            self.serial_port.write(encode_frame(CMD_SET_FRAMING, bytes([FRAMING_COBS])))
+        except Exception as e:
+            self.pending_framing = None
+            self.log_message(f"发送帧格式切换失败: {str(e)}\n", category="error")
+
+    def switch_baud(self, code):
+        """下位机已按原波特率确认，本端切换到新波特率（下拉框仍是连接时的初始波特率）"""
+        baud = BAUD_RATES[code]
+        try:
+            self.serial_port.baudrate = baud
+        except Exception as e:
+            self.log_message(f"切换波特率失败: {str(e)}\n", category="error")
+            return
+        self.log_message(f"✅ 波特率已切换到 {baud}\n", category="status")
+        self.statusBar().showMessage(f"已连接: {self.serial_port.port} @ {baud} baud")
+
     def handle_config_ack_frame(self, data):
         """处理配置确认帧"""
         if len(data) < 2:
@@ -2005,6 +2287,25 @@ class CS1237_GUI(QMainWindow):
                     self.channel_combo.blockSignals(False)
             except Exception:
                 pass
+        elif config_type == CMD_SET_BITS:  # 批量帧位宽
+            bits, mode = value & 0x1F, value >> 6
+            self.log_message(f"✅ 输出位宽已确认: {bits} bit，{QUANT_MODES.get(mode, mode)}\n",
+                             category="status")
+            try:
+                if bits in BATCH_BITS:
+                    self.bits_combo.setCurrentIndex(BATCH_BITS.index(bits))
+                if mode in QUANT_MODES:
+                    self.quant_combo.setCurrentIndex(mode)
+            except Exception:
+                pass
+        elif config_type == CMD_SET_BAUD:  # 波特率
+            if value == self.pending_baud:
+                self.pending_baud = None
+                self.switch_baud(value)
+                self.request_framing()
+        elif config_type == CMD_SET_FRAMING:  # 帧格式（串口线程已切换解析方式）
+            self.pending_framing = None
+            self.log_message(f"✅ 帧格式已切换: {FRAMING_TEXT.get(value, value)}\n", category="status")
         elif config_type == 0xA4:  # 电源状态
             self.power_down = (value == 1)
             state_text = "已进入Power down" if self.power_down else "已退出Power down"
@@ -2418,12 +2719,97 @@ class CS1237_GUI(QMainWindow):
             except Exception:
                 info_msg = f"数据已保存到:\n{file_path}\n(生成 CSV 失败)"
 
+            # 再写一份会话文件（内存映射读取，带 PGA / 采样率 / 通道 / 校准等元数据，见 session.py）
+            try:
+                session_path = os.path.splitext(file_path)[0] + '.cs1237s'
+                self.export_session(session_path)
+                info_msg += f"\n{session_path}"
+            except Exception as e:
+                info_msg += f"\n(生成会话文件失败: {e})"
+
             QMessageBox.information(self, "成功", info_msg)
             self.log_message(f"✅ 数据已导出: {file_path} (同时导出 CSV)", category="result")
             
         except Exception as e:
             QMessageBox.critical(self, "错误", f"保存文件失败:\n{str(e)}")
 
+    def start_snapshot(self):
+        """冻结下位机快照缓冲中最近的样本并分块取回"""
+        if not self.is_connected or not self.serial_port:
+            QMessageBox.warning(self, "警告", "请先连接串口")
+            return
+        if self.snapshot:
+            return
+        self.snapshot = bulk_transfer.BulkReceiver(self.serial_port.baudrate, BULK_SRC_HISTORY, 0)
+        self.serial_port.write(self.snapshot.open())
+        self.snapshot_btn.setEnabled(False)
+        self.snapshot_timer.start(SNAPSHOT_POLL_MS)
+        self.log_message("📥 请求快照...\n", category="status")
+
+    def handle_snapshot_frame(self, cmd, data):
+        """快照信息帧/数据块交给接收器，回它要发的确认帧"""
+        if not self.snapshot:
+            return
+        for frame in self.snapshot.on_frame(cmd, data):
+            self.serial_port.write(frame)
+        if self.snapshot.done:
+            self.finish_snapshot()
+
+    def poll_snapshot(self):
+        if not self.snapshot or not self.serial_port or not self.serial_port.is_open:
+            self.snapshot_timer.stop()
+            return
+        for frame in self.snapshot.poll():
+            self.serial_port.write(frame)
+        if self.snapshot.done:
+            self.finish_snapshot()
+
+    def finish_snapshot(self):
+        """传输结束：成功则存成会话文件"""
+        rx, self.snapshot = self.snapshot, None
+        self.snapshot_timer.stop()
+        self.snapshot_btn.setEnabled(bool((self.device_caps or 0) & CAP_BULK))
+        if not rx.ok:
+            self.log_message(f"❌ 快照传输失败: {rx.error}\n", category="error")
+            return
+        self.log_message(f"📥 快照: {rx.summary()}\n", category="result")
+        file_path, _ = QFileDialog.getSaveFileName(
+            self,
+            "保存快照",
+            f"Snapshot_{datetime.now().strftime('%Y%m%d_%H%M%S')}.cs1237s",
+            "会话文件 (*.cs1237s);;所有文件 (*.*)"
+        )
+        if not file_path:
+            return
+        try:
+            calibration = {"slope": self.cal_slope, "offset": self.cal_offset}
+            n = rx.to_session(file_path, self.vref, calibration)
+            self.log_message(f"💾 快照已保存: {file_path}（{n} 条）\n", category="result")
+        except OSError as e:
+            QMessageBox.critical(self, "错误", f"保存快照失败: {e}")
+
+    def export_session(self, path):
+        """把当前曲线数据和采集配置写成会话文件（曲线缓冲只有时间和数值，不写 raw / flags 列）"""
+        rate = re.match(r"\s*([\d.]+)", self.current_sample_rate)
+        meta = {
+            "recorded_at": datetime.now().strftime('%Y-%m-%d %H:%M:%S'),
+            "pga": self.current_pga,
+            "rate": float(rate.group(1)) if rate else None,
+            "channel": self.current_channel_code,
+            "channel_label": self.channel_labels.get(self.current_channel_code, '未知'),
+            "unit": "°C" if self.current_channel_code == 2 else "mV",
+            "vref": self.vref,
+            "calibration": {
+                "slope": self.cal_slope,
+                "offset": self.cal_offset,
+                "temp_A": self.temp_calib_A,
+                "temp_Ya": self.temp_calib_Ya
+            },
+            "outliers_replaced": self.outlier_count,
+            "kalman": self.enable_kalman
+        }
+        session.write(path, meta, list(self.plot_data_x), list(self.plot_data_y))
+
     def on_sequence_finished(self, success, message):
         """命令序列执行完成后的回调"""
         self.log_message(f"SEQUENCER: {message}\n", category="result")
@@ -2557,6 +2943,18 @@ class CS1237_GUI(QMainWindow):
             pass
         self.sequencer.start()
             
+    def set_batch_bits(self):
+        """设置批量帧样本位宽和量化方式（二进制命令帧 0xA5）"""
+        if not self.is_connected or not self.serial_port:
+            QMessageBox.warning(self, "警告", "请先连接串口")
+            return
+        bits = BATCH_BITS[self.bits_combo.currentIndex()]
+        mode = self.quant_combo.currentIndex()
+        try:
+            self.serial_port.write(encode_frame(CMD_SET_BITS, bytes([(mode << 6) | bits])))
+        except Exception as e:
+            self.log_message(f"发送命令错误: {str(e)}\n", category="error")
+
     def get_status(self):
         """查询当前配置状态"""
         if not self.is_connected:
@@ -2599,6 +2997,34 @@ class CS1237_GUI(QMainWindow):
             initial_val = self.recent_values[-1] if self.recent_values else 0.0
             self.kalman_filter.x = initial_val
             self.kalman_filter.p = 1.0
+
+    def toggle_step_detect(self, state):
+        """切换阶跃检测；每次启用都从头学习当前平台"""
+        self.enable_step_detect = (state == 2)
+        status = "启用" if self.enable_step_detect else "禁用"
+        self.log_message(f"🔧 阶跃检测已{status}\n", category="status")
+        self.step_detector = None
+
+    def feed_step_detector(self, t_rel, value):
+        """把输出点送入阶跃检测器，变点和稳定事件写入日志"""
+        if self.step_detector is None:
+            rate = re.match(r"\s*([\d.]+)", self.current_sample_rate)
+            self.step_detector = StepDetector(float(rate.group(1)) if rate else 10.0)
+        event = self.step_detector.update(t_rel, value)
+        if event is None:
+            return
+        if event[0] == "change":
+            self.log_message(f"📍 [{event[1]:7.2f}s] 检测到阶跃\n", category="result")
+        else:
+            seg = event[2]
+            if seg.previous is None:
+                self.log_message(f"📍 [{event[1]:7.2f}s] 平台稳定: {self.step_detector.level:+.4f}\n",
+                                 category="result")
+            else:
+                self.log_message(
+                    f"📍 [{event[1]:7.2f}s] 稳定: {self.step_detector.level:+.4f}"
+                    f"（阶跃 {self.step_detector.level - seg.previous:+.4f}，用时 {seg.settle:.2f} s）\n",
+                    category="result")
     
     # def is_outlier(self, value):
     #     """
@@ -3353,6 +3779,9 @@ class CS1237_GUI(QMainWindow):
         # 重置Y轴平滑控制
         self.current_y_min = None
         self.current_y_max = None
+
+        # 新采集重新学习平台
+        self.step_detector = None
         
         # 重置视图跟踪变量，确保下次采集能从0开始
         self._last_auto_xlim = None
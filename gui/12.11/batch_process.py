@@ -0,0 +1,429 @@
+"""
+采集文件批处理：按上位机的滤波链和校准参数离线处理保存的数据，可多线程并行
+
+处理图（依次执行，每级可选）:
+  calibrate  y = x × slope + offset，参数取自上位机的 calibration.json（上位机导出的数据已校准过，只对未校准的数据用）
+  hampel     Hampel 异常值替换：前后各 half_window 点的中位数 ± n_sigma × 1.4826 × MAD 之外的点换成中位数
+             （默认 10 / 3.5，即上位机 MAD 过滤的约 20 点窗口和阈值；五点窗口的 MAD 太不稳，误判约 5%；
+             首尾各 half_window 点不处理）
+  notch      二阶陷波（工频），freq / q
+  kalman     上位机的一维卡尔曼滤波（q / r 同上位机），按稳态增益计算，初值为第一个点
+  decimate   Kaiser 窗 sinc 低通后每 factor 点取一点，时间取所取样本的时间戳
+  统计       点数、均值、标准差、均方根、最小、最大、峰峰值、替换的异常值个数
+  导出       --out-dir 下写同名 CSV（time_s, voltage_mV，与上位机导出一致）或 npy（两列）
+
+每个文件切成 --chunk 个样本一块放进线程池，块边界的状态交接保证结果与整段处理一致:
+  窗口类（hampel / decimate）每块带上前后相邻块的边缘样本；
+  递归类（notch / kalman）都是线性状态空间 s' = A s + B x, y = C s + D x：
+  各块先从零状态并行滤波并算出零状态下的末状态，再按块顺序递推真实的块首状态
+  s_k+1 = A^n s_k + e_k，最后并行加上块首状态引起的零输入响应 C A^i s_k。
+  块内同样分成 BLOCK 点的小段，零状态响应用 FFT 卷积，整段只有逐小段的状态递推在 Python 里循环。
+numpy 的 FFT / 矩阵乘 / 排序都会释放 GIL，线程数可以用满核心；文件也并行读写（--jobs 同时处理的文件数）。
+
+处理图可用 --graph 指定 JSON（{"stages": [{"type": "notch", "freq": 50, "q": 30}, ...]}），
+否则由命令行选项按上面的顺序拼出，默认同上位机：异常值过滤开、卡尔曼关。
+
+输入为会话文件 .cs1237s（见 session.py）、上位机保存的 TXT（时间\t电压）/ CSV（time_s, voltage_mV）或两列 npy。
+
+用法:
+    python batch_process.py ADC_Data_*.txt --notch 50 --decimate 8 --out-dir processed
+    python batch_process.py captures/*.csv --graph graph.json --threads 8 --summary summary.csv
+    python batch_process.py --bench 60           # 1280 Hz × 60 分钟合成数据，比较单线程与多线程
+"""
+import argparse
+import csv
+import json
+import math
+import os
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import numpy as np
+
+import session
+
+CHUNK = 1 << 20        # 线程池任务的块长（样本）
+BLOCK = 4096           # 递归滤波块内的小段长度，零状态响应在小段内用 FFT 卷积
+DECIMATE_TAPS = 8      # 抽取低通单边长度（× factor 个样本）
+KAISER_BETA = 8.0
+ROLLOFF = 0.9          # 抽取低通截止频率占输出奈奎斯特频率的比例
+MAD_SCALE = 1.4826     # 正态分布下 MAD 到标准差的换算
+
+
+# ============================================================
+# 各级处理
+# ============================================================
+class Calibrate:
+    def __init__(self, slope=1.0, offset=0.0):
+        self.slope = float(slope)
+        self.offset = float(offset)
+
+    def run(self, pool, t, x, chunk):
+        return t, x * self.slope + self.offset
+
+
+class Hampel:
+    def __init__(self, half_window=10, n_sigma=3.5):
+        self.k = int(half_window)
+        self.n_sigma = float(n_sigma)
+        self.replaced = 0
+
+    def _chunk(self, x, lo, hi):
+        """处理 x[lo:hi]，前后各带 k 个相邻样本；返回 (结果, 替换数)"""
+        k = self.k
+        a, b = max(lo, k), min(hi, len(x) - k)
+        out = x[lo:hi].copy()
+        if a >= b:
+            return out, 0
+        # 窗口长度为奇数，中位数就是第 k 小的元素，用 partition 比 np.median 快约 3 倍
+        win = np.lib.stride_tricks.sliding_window_view(x[a - k:b + k], 2 * k + 1)
+        med = np.partition(win, k, axis=1)[:, k]
+        dev = np.abs(win - med[:, None])
+        dev.partition(k, axis=1)
+        mad = dev[:, k]
+        centre = x[a:b]
+        bad = np.abs(centre - med) > self.n_sigma * MAD_SCALE * mad
+        out[a - lo:b - lo] = np.where(bad, med, centre)
+        return out, int(bad.sum())
+
+    def run(self, pool, t, x, chunk):
+        parts = list(pool.map(lambda lo: self._chunk(x, lo, min(lo + chunk, len(x))),
+                              range(0, len(x), chunk)))
+        self.replaced += sum(n for _, n in parts)
+        return t, np.concatenate([p for p, _ in parts])
+
+
+class LinearFilter:
+    """线性时不变状态空间滤波器，分块并行，块间交接状态"""
+
+    def __init__(self, A, B, C, D):
+        self.A = np.atleast_2d(np.asarray(A, dtype=np.float64))
+        self.B = np.atleast_1d(np.asarray(B, dtype=np.float64))
+        self.C = np.atleast_1d(np.asarray(C, dtype=np.float64))
+        self.D = float(D)
+        order = len(self.B)
+        # 一个小段内：冲激响应 h、零状态末状态的权 W、单位状态的零输入响应 G
+        powers = np.empty((BLOCK, order, order))
+        powers[0] = np.eye(order)
+        for i in range(1, BLOCK):
+            powers[i] = self.A @ powers[i - 1]
+        self.G = np.einsum("j,ijk->ki", self.C, powers)                  # (order, BLOCK): C A^i
+        self.W = np.einsum("ijk,k->ij", powers, self.B)[::-1]            # (BLOCK, order): A^(BLOCK-1-i) B
+        h = np.empty(BLOCK)
+        h[0] = self.D
+        h[1:] = self.G[:, :-1].T @ self.B
+        self.H = np.fft.rfft(h, 2 * BLOCK)
+        self.A_block = self.A @ powers[-1]                               # A^BLOCK
+
+    def steady_state(self, level):
+        """输入恒为 level 时的稳态状态，作为第一个块的初值（避免开头的阶跃响应）"""
+        order = len(self.B)
+        return np.linalg.solve(np.eye(order) - self.A, self.B * level)
+
+    def _zero_state(self, x):
+        """从零状态滤波，返回 (输出, 各小段首状态, 末状态)；块内逐小段交接"""
+        n = len(x)
+        blocks = np.zeros(((n + BLOCK - 1) // BLOCK, BLOCK))
+        blocks.ravel()[:n] = x
+        y = np.fft.irfft(np.fft.rfft(blocks, 2 * BLOCK, axis=1) * self.H, 2 * BLOCK, axis=1)[:, :BLOCK]
+        ends = blocks @ self.W                       # 各小段从零状态出发的末状态
+        starts = np.zeros((len(blocks), len(self.B)))
+        s = np.zeros(len(self.B))
+        for i in range(len(blocks)):
+            starts[i] = s
+            s = self.A_block @ s + ends[i]
+        y += starts @ self.G
+        # 末小段不满 BLOCK 时，补零部分也推进了状态，末状态改从最后一个真实样本算
+        tail = n - (len(blocks) - 1) * BLOCK
+        if tail < BLOCK:
+            s = np.linalg.matrix_power(self.A, tail) @ starts[-1] + self.W[BLOCK - tail:].T @ blocks[-1, :tail]
+        return y.ravel()[:n], s
+
+    def _zero_input(self, s, n):
+        """初状态 s、输入为零时 n 个点的输出"""
+        count = (n + BLOCK - 1) // BLOCK
+        starts = np.empty((count, len(s)))
+        for i in range(count):
+            starts[i] = s
+            s = self.A_block @ s
+        return (starts @ self.G).ravel()[:n]
+
+    def run(self, pool, t, x, chunk):
+        bounds = [(lo, min(lo + chunk, len(x))) for lo in range(0, len(x), chunk)]
+        parts = list(pool.map(lambda b: self._zero_state(x[b[0]:b[1]]), bounds))
+        # 顺序递推各块真实的块首状态
+        s = self.steady_state(x[0])
+        firsts = []
+        for (lo, hi), (_, end) in zip(bounds, parts):
+            firsts.append(s)
+            s = np.linalg.matrix_power(self.A, hi - lo) @ s + end
+        ys = list(pool.map(lambda i: parts[i][0] + self._zero_input(firsts[i], bounds[i][1] - bounds[i][0]),
+                           range(len(bounds))))
+        return t, np.concatenate(ys)
+
+
+def notch_filter(freq, q, fs):
+    """RBJ 二阶陷波，转置直接 II 型写成状态空间"""
+    w0 = 2 * math.pi * freq / fs
+    alpha = math.sin(w0) / (2 * q)
+    a0 = 1 + alpha
+    b0, b1, b2 = 1 / a0, -2 * math.cos(w0) / a0, 1 / a0
+    a1, a2 = -2 * math.cos(w0) / a0, (1 - alpha) / a0
+    return LinearFilter([[-a1, 1.0], [-a2, 0.0]], [b1 - a1 * b0, b2 - a2 * b0], [1.0, 0.0], b0)
+
+
+def kalman_filter(q, r):
+    """上位机 KalmanFilter 的稳态形式：x = (1 - k) x + k z"""
+    p = q * (1 + math.sqrt(1 + 4 * r / q)) / 2    # 预测误差协方差的稳态解 p² = q (p + r)
+    k = p / (p + r)
+    return LinearFilter([[1 - k]], [k], [1 - k], k)
+
+
+class Decimate:
+    def __init__(self, factor):
+        self.factor = int(factor)
+        m = self.factor
+        half = DECIMATE_TAPS * m
+        n = np.arange(-half, half + 1)
+        cutoff = ROLLOFF * 0.5 / m
+        h = 2 * cutoff * np.sinc(2 * cutoff * n) * np.kaiser(len(n), KAISER_BETA)
+        self.h = h / h.sum()
+        self.half = half
+
+    def _chunk(self, padded, lo, hi):
+        """输出原序号 lo, lo + m, ... < hi 处的值；padded 前后各补了 half 个边缘值"""
+        m = self.factor
+        win = np.lib.stride_tricks.sliding_window_view(padded[lo:hi + 2 * self.half], len(self.h))[::m]
+        return win @ self.h
+
+    def run(self, pool, t, x, chunk):
+        m = self.factor
+        chunk = max(chunk - chunk % m, m)           # 块首对齐到 m 的整数倍，输出点与整段处理相同
+        padded = np.concatenate((np.full(self.half, x[0]), x, np.full(self.half, x[-1])))
+        parts = pool.map(lambda lo: self._chunk(padded, lo, min(lo + chunk, len(x))),
+                         range(0, len(x), chunk))
+        return t[::m], np.concatenate(list(parts))
+
+
+def build_graph(spec, fs):
+    """由 JSON 描述生成各级处理；fs 为输入采样率（Hz）"""
+    stages = []
+    for stage in spec.get("stages", []):
+        kind = stage["type"]
+        if kind == "calibrate":
+            stages.append(Calibrate(stage.get("slope", 1.0), stage.get("offset", 0.0)))
+        elif kind == "hampel":
+            stages.append(Hampel(stage.get("half_window", 10), stage.get("n_sigma", 3.5)))
+        elif kind == "notch":
+            stages.append(notch_filter(stage.get("freq", 50.0), stage.get("q", 30.0), fs))
+        elif kind == "kalman":
+            stages.append(kalman_filter(stage.get("q", 0.002), stage.get("r", 1.0)))
+        elif kind == "decimate":
+            stages.append(Decimate(stage["factor"]))
+            fs /= stage["factor"]
+        else:
+            raise ValueError(f"未知的处理类型: {kind}")
+    return stages
+
+
+def graph_from_args(args):
+    """命令行选项拼出的处理图，缺省与上位机一致"""
+    stages = []
+    if args.calibration:
+        with open(args.calibration, "r") as f:
+            cal = json.load(f)
+        stages.append({"type": "calibrate", "slope": cal.get("slope", 1.0), "offset": cal.get("offset", 0.0)})
+    if args.hampel > 0:
+        stages.append({"type": "hampel", "half_window": args.hampel, "n_sigma": args.n_sigma})
+    if args.notch:
+        stages.append({"type": "notch", "freq": args.notch, "q": args.notch_q})
+    if args.kalman:
+        stages.append({"type": "kalman", "q": 0.002, "r": 1.0})
+    if args.decimate > 1:
+        stages.append({"type": "decimate", "factor": args.decimate})
+    return {"stages": stages}
+
+
+# ============================================================
+# 统计（分块计算再合并）
+# ============================================================
+def chunk_stats(x):
+    mean = float(x.mean())
+    return len(x), mean, float(((x - mean) ** 2).sum()), float(x.min()), float(x.max()), float((x * x).sum())
+
+
+def merge_stats(a, b):
+    """Chan 等人的并行方差合并"""
+    n = a[0] + b[0]
+    delta = b[1] - a[1]
+    return (n, a[1] + delta * b[0] / n, a[2] + b[2] + delta * delta * a[0] * b[0] / n,
+            min(a[3], b[3]), max(a[4], b[4]), a[5] + b[5])
+
+
+def series_stats(pool, x, chunk):
+    parts = pool.map(lambda lo: chunk_stats(x[lo:lo + chunk]), range(0, len(x), chunk))
+    n, mean, m2, lo, hi, sq = _reduce(parts)
+    return {"count": n, "mean": mean, "std": math.sqrt(m2 / n), "rms": math.sqrt(sq / n),
+            "min": lo, "max": hi, "p2p": hi - lo}
+
+
+def _reduce(parts):
+    total = None
+    for p in parts:
+        total = p if total is None else merge_stats(total, p)
+    return total
+
+
+# ============================================================
+# 读写
+# ============================================================
+def read_session(path):
+    """读会话文件（.cs1237s，零拷贝映射）、上位机保存的 TXT / CSV 或两列 npy，返回 (时间, 数值)"""
+    if path.endswith(".npy"):
+        data = np.load(path)
+        t, x = data[:, 0].astype(np.float64), data[:, 1].astype(np.float64)
+    elif path.endswith(".cs1237s"):
+        s = session.open(path)
+        t, x = s.t, s.value
+    else:
+        t, x, _ = session.read_export(path)
+    if len(t) < 2:
+        raise ValueError(f"{path}: 数据点不足")
+    return t, x
+
+
+def write_session(path, t, x):
+    if path.endswith(".npy"):
+        np.save(path, np.column_stack((t, x)))
+        return
+    with open(path, "w", newline="", encoding="utf-8") as f:
+        f.write("time_s,voltage_mV\n")
+        np.savetxt(f, np.column_stack((t, x)), fmt=("%.3f", "%.6f"), delimiter=",")
+
+
+# ============================================================
+# 批处理
+# ============================================================
+def process(t, x, spec, pool, chunk=CHUNK, fs=None):
+    """按处理图处理一段数据，返回 (时间, 数值, 统计)"""
+    if fs is None:
+        # 上位机导出的时间只保留到毫秒，逐点间隔不可靠，用首尾跨度估计
+        fs = (len(t) - 1) / float(t[-1] - t[0])
+    stages = build_graph(spec, fs)
+    for stage in stages:
+        t, x = stage.run(pool, t, x, chunk)
+    stats = series_stats(pool, x, chunk)
+    stats["outliers"] = sum(s.replaced for s in stages if isinstance(s, Hampel))
+    stats["rate"] = fs / math.prod(s.factor for s in stages if isinstance(s, Decimate))
+    return t, x, stats
+
+
+def process_file(path, spec, pool, args):
+    started = time.perf_counter()
+    t, x = read_session(path)
+    t, x, stats = process(t, x, spec, pool, args.chunk, args.rate)
+    if args.out_dir:
+        base = os.path.splitext(os.path.basename(path))[0]
+        write_session(os.path.join(args.out_dir, f"{base}.{args.format}"), t, x)
+    stats["file"] = path
+    stats["seconds"] = time.perf_counter() - started
+    return stats
+
+
+STAT_FIELDS = ["file", "count", "rate", "mean", "std", "rms", "min", "max", "p2p", "outliers", "seconds"]
+
+
+def print_stats(stats):
+    print(f"{stats['file']}: {stats['count']} 点 @ {stats['rate']:.2f} Hz，"
+          f"均值 {stats['mean']:+.4f}，标准差 {stats['std']:.4f}，峰峰值 {stats['p2p']:.4f}，"
+          f"替换异常值 {stats['outliers']}，用时 {stats['seconds']:.2f} s")
+
+
+def bench(minutes, threads, rate=1280.0, seed=1):
+    """合成一段带工频干扰和尖峰的数据，比较单线程与多线程的速度，并核对分块结果与整段一致"""
+    rng = np.random.default_rng(seed)
+    n = int(minutes * 60 * rate)
+    t = np.arange(n) / rate
+    x = 100 + 0.05 * rng.standard_normal(n) + 0.2 * np.sin(2 * np.pi * 50 * t)
+    spikes = rng.choice(n, n // 10000, replace=False)
+    x[spikes] += rng.choice([-1, 1], len(spikes)) * 50
+    spec = {"stages": [{"type": "hampel"}, {"type": "notch", "freq": 50, "q": 30},
+                       {"type": "kalman", "q": 0.002, "r": 1.0}, {"type": "decimate", "factor": 8}]}
+    print(f"合成 {minutes:g} 分钟 @ {rate:g} Hz，共 {n} 个样本")
+    results = {}
+    for workers in sorted({1, threads}):
+        with ThreadPoolExecutor(workers) as pool:
+            started = time.perf_counter()
+            _, y, stats = process(t, x, spec, pool, fs=rate)
+            elapsed = time.perf_counter() - started
+        results[workers] = y
+        print(f"{workers} 线程: {elapsed:.2f} s，{n / elapsed / 1e6:.2f} M 样本/秒，"
+              f"替换异常值 {stats['outliers']}（注入 {len(spikes)}）")
+    with ThreadPoolExecutor(1) as pool:
+        _, whole, _ = process(t, x, spec, pool, chunk=n, fs=rate)
+    print(f"分块与整段处理的最大差 {np.max(np.abs(results[threads] - whole)):.3g}，"
+          f"输出标准差 {results[threads].std():.4f}（输入噪声 0.05，另有 0.2 的 50 Hz 干扰）")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="按上位机滤波链批量处理采集文件")
+    parser.add_argument("files", nargs="*", help="会话文件、上位机保存的 TXT / CSV 或两列 npy")
+    parser.add_argument("--graph", default=None, help="处理图 JSON，给出时忽略下面的各级选项")
+    parser.add_argument("--calibration", default=None,
+                        help="套用的校准参数（上位机的 calibration.json），默认不套用")
+    parser.add_argument("--hampel", type=int, default=10, help="Hampel 单边窗口，0 为关闭")
+    parser.add_argument("--n-sigma", type=float, default=3.5, help="Hampel 阈值（MAD 换算的标准差倍数）")
+    parser.add_argument("--notch", type=float, default=None, help="陷波频率（Hz）")
+    parser.add_argument("--notch-q", type=float, default=30.0, help="陷波品质因数")
+    parser.add_argument("--kalman", action="store_true", help="加上位机的卡尔曼滤波")
+    parser.add_argument("--decimate", type=int, default=1, help="抽取倍数")
+    parser.add_argument("--rate", type=float, default=None, help="输入采样率（Hz），默认由时间列首尾跨度估计")
+    parser.add_argument("--threads", type=int, default=os.cpu_count(), help="线程池大小")
+    parser.add_argument("--jobs", type=int, default=2, help="同时处理的文件数（读写与计算重叠）")
+    parser.add_argument("--chunk", type=int, default=CHUNK, help="分块长度（样本）")
+    parser.add_argument("--out-dir", default=None, help="处理结果输出目录")
+    parser.add_argument("--format", choices=["csv", "npy"], default="csv", help="输出格式")
+    parser.add_argument("--summary", default=None, help="各文件统计写入 CSV")
+    parser.add_argument("--bench", type=float, default=None, metavar="MINUTES", help="用合成数据测试速度")
+    args = parser.parse_args()
+
+    if args.bench:
+        bench(args.bench, max(args.threads, 1))
+        return
+    if not args.files:
+        parser.error("没有输入文件")
+
+    if args.graph:
+        with open(args.graph, "r", encoding="utf-8") as f:
+            spec = json.load(f)
+    else:
+        spec = graph_from_args(args)
+    if args.out_dir:
+        os.makedirs(args.out_dir, exist_ok=True)
+
+    # 文件级任务只做读写和编排，计算都交给共享的线程池，两者分开避免互相等待占满线程
+    failed = False
+    rows = []
+    with ThreadPoolExecutor(max(args.threads, 1)) as pool, ThreadPoolExecutor(max(args.jobs, 1)) as jobs:
+        futures = [(path, jobs.submit(process_file, path, spec, pool, args)) for path in args.files]
+        for path, future in futures:
+            try:
+                stats = future.result()
+            except (OSError, ValueError) as e:
+                print(f"{path}: 处理失败: {e}", file=sys.stderr)
+                failed = True
+                continue
+            print_stats(stats)
+            rows.append(stats)
+
+    if args.summary and rows:
+        with open(args.summary, "w", newline="", encoding="utf-8") as f:
+            writer = csv.DictWriter(f, fieldnames=STAT_FIELDS, extrasaction="ignore")
+            writer.writeheader()
+            writer.writerows(rows)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
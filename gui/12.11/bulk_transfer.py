@@ -0,0 +1,496 @@
+"""
+快照分块传输的上位机端：把下位机 RAM 中冻结的一段样本完整取回，串口出错只补丢的块
+
+协议（帧定义见 protocol/schema.json，说明见 ../协议通讯说明.md）:
+  上位机  BULK_OPEN  [来源 BULK_SRC_*][样本数]
+  下位机  BULK_INFO  传输号、格式、块数、块长、窗口、整个快照的 CRC-32
+  下位机  BULK_DATA  [传输号][块号][CRC-16] + 数据，窗口内连续发出
+  上位机  BULK_ACK   [传输号][base][丢块位图]：base 之前都已收到，位图第 i 位 = 第 base+i 块要重发
+下位机只在 base 之后一个窗口内发块，收到位图只补发其中已发过的块；base 等于块数即结束。
+
+确认策略：串口按顺序到达，比已收到的最大块号小却没收到的块就是丢了。
+块号跳了（出现缺口）立即确认；另外每收到半个窗口的新块、或收到下位机按上次确认能发的最后一块时确认，
+窗口不会发空；链路空闲超过重发超时时把窗口内没收到的块全标成丢失（丢的是尾部时没有后续块来暴露缺口）。
+同一块在一个重发超时内不重复请求。
+
+BulkReceiver 只管状态，不碰串口：GUI 把收到的 0x09 / 0x0A 帧交给 on_frame()，定时调用 poll()，
+两者返回的帧原样写到串口。fetch() 是命令行下直接用 pyserial 的版本。
+
+用法:
+    python bulk_transfer.py fetch COM3 [--baud 921600] [--source history|capture] [--count 2048] [-o snap.cs1237s]
+    python bulk_transfer.py simulate [--baud 921600] [--ber 1e-5] [--samples 2048]
+"""
+import argparse
+import struct
+import sys
+import time
+from datetime import datetime
+
+import numpy as np
+
+from cs1237_proto import (CMD_BULK_OPEN, CMD_BULK_ACK, CMD_BULK_INFO, CMD_BULK_DATA, CMD_ERROR, CMD_HELLO,
+                          BULK_INFO_FIELDS, BULK_DATA_FIELDS, BULK_SRC_HISTORY, BULK_SRC_CAPTURE,
+                          BULK_SRC_RESEND, BULK_FMT_S24, CAP_BULK, HELLO_FIELDS, ERROR_TEXT, FRAME_HEAD,
+                          FRAME_TAIL, encode_frame, parse_fields, unpack_bulk_data, bulk_crc16, bulk_crc32,
+                          checksum)
+import session
+
+RATE_HZ = {0: 10.0, 1: 40.0, 2: 640.0, 3: 1280.0}     # SET_RATE 编码
+PGA_GAIN = {0: 1.0, 1: 2.0, 2: 64.0, 3: 128.0}         # SET_PGA 编码
+SOURCES = {"history": BULK_SRC_HISTORY, "capture": BULK_SRC_CAPTURE}
+
+OPEN_TIMEOUT = 1.0       # 发出 BULK_OPEN 后等 BULK_INFO 的时间，超时发 BULK_SRC_RESEND
+OPEN_RETRIES = 3
+STALL_TIMEOUT = 2.5      # 这么久没收到任何块就放弃（下位机 3 s 收不到确认也会放弃）
+USB_LATENCY = 0.02       # USB 转串口把确认帧送到下位机、下位机调度的余量
+
+
+class BulkReceiver:
+    """一次快照传输的接收状态"""
+
+    def __init__(self, baud=115200, source=BULK_SRC_HISTORY, count=0, clock=time.monotonic):
+        self.baud = baud
+        self.source = source
+        self.count = count
+        self.clock = clock
+        self.info = None
+        self.blocks = {}           # 块号 -> 数据
+        self.base = 0              # 此前的块都已收到
+        self.top = -1              # 已收到的最大块号
+        self.acked = 0             # 上次确认的 base，下位机最多发到 acked + 窗口 - 1
+        self.requested = {}        # 块号 -> 最近一次请求重发的时刻
+        self.new_since_ack = 0
+        self.last_rx = None
+        self.last_tail_ack = -np.inf  # 上次空闲确认的时刻（不算收到数据，不推迟中断判断）
+        self.opened_at = None
+        self.retries = 0
+        self.done = False
+        self.error = None
+        self.data = None
+        self.stats = {"frames": 0, "crc_errors": 0, "duplicates": 0, "acks": 0, "requested": 0}
+
+    # ---------------- 发出 ----------------
+    def open(self):
+        """开始传输，返回要发的 BULK_OPEN 帧"""
+        self.opened_at = self.last_rx = self.clock()
+        return encode_frame(CMD_BULK_OPEN, struct.pack(">BH", self.source, self.count))
+
+    @property
+    def window(self):
+        return int(self.info["window"])
+
+    @property
+    def total_blocks(self):
+        return int(self.info["blocks"])
+
+    @property
+    def frame_time(self):
+        """一个满块数据帧在链路上的时间（10 位/字节）"""
+        size = 7 + BULK_DATA_FIELDS.itemsize + (int(self.info["block_size"]) if self.info is not None else 240)
+        return size * 10.0 / self.baud
+
+    @property
+    def rto(self):
+        """重发超时：请求发出后，下位机发送缓冲里已排着的两帧发完、补发的块到达之前不再请求"""
+        return 4 * self.frame_time + USB_LATENCY
+
+    def ack(self, now, tail=False):
+        """组确认帧；tail 为真时窗口内没收到的块都算丢失，否则只算已收到的最大块号之前的缺口"""
+        missing = 0
+        top = self.base + self.window - 1 if tail else self.top
+        for i in range(min(self.window, self.total_blocks - self.base)):
+            b = self.base + i
+            if b > top:
+                break
+            if b not in self.blocks and now - self.requested.get(b, -np.inf) >= self.rto:
+                missing |= 1 << i
+                self.requested[b] = now
+                self.stats["requested"] += 1
+        self.new_since_ack = 0
+        self.acked = self.base
+        self.stats["acks"] += 1
+        return encode_frame(CMD_BULK_ACK, struct.pack(">BHI", int(self.info["xfer"]), self.base, missing))
+
+    # ---------------- 接收 ----------------
+    def on_frame(self, cmd, data):
+        """处理一帧（命令码 + 数据区），返回要发给下位机的帧列表"""
+        if self.done:
+            return []
+        now = self.clock()
+        if cmd == CMD_BULK_INFO and len(data) >= BULK_INFO_FIELDS.itemsize:
+            return self._on_info(parse_fields(BULK_INFO_FIELDS, data), now)
+        if cmd == CMD_BULK_DATA and self.info is not None:
+            return self._on_data(data, now)
+        return []
+
+    def _on_info(self, info, now):
+        if int(info["format"]) != BULK_FMT_S24 or not 0 < int(info["window"]) <= 32:
+            self.fail(f"不支持的快照格式 {int(info['format'])} / 窗口 {int(info['window'])}")
+            return []
+        # 采样率和 PGA 用于展开时间、换算电压，编码不认识就无法解释数据
+        if int(info["rate"]) not in RATE_HZ or int(info["pga"]) not in PGA_GAIN:
+            self.fail(f"未知的采样率编码 {int(info['rate'])} / PGA 编码 {int(info['pga'])}")
+            return []
+        if self.info is None or int(info["xfer"]) != int(self.info["xfer"]):
+            self.blocks.clear()
+            self.requested.clear()
+            self.base, self.top = 0, -1
+        self.acked = 0  # 同一传输重发 BULK_INFO 时下位机也从头发
+        self.info = info
+        self.last_rx = now
+        self.started = now
+        if self.total_blocks == 0:
+            return self._finish(now)
+        return []
+
+    def _on_data(self, data, now):
+        self.stats["frames"] += 1
+        try:
+            xfer, block, payload = unpack_bulk_data(data)
+        except ValueError:
+            self.stats["crc_errors"] += 1
+            return []
+        if xfer != int(self.info["xfer"]) or block >= self.total_blocks:
+            return []
+        self.last_rx = now
+        if block in self.blocks:
+            self.stats["duplicates"] += 1
+            return []
+        self.blocks[block] = payload
+        self.requested.pop(block, None)
+        gap = block > self.top + 1
+        self.top = max(self.top, block)
+        while self.base in self.blocks:
+            self.base += 1
+        if self.base == self.total_blocks:
+            return self._finish(now)
+        self.new_since_ack += 1
+        last = min(self.acked + self.window, self.total_blocks) - 1  # 下位机在收到下一次确认前发的最后一块
+        if gap or block >= last or self.new_since_ack >= max(self.window // 2, 1):
+            return [self.ack(now)]
+        return []
+
+    def poll(self):
+        """定时调用，处理超时，返回要发的帧"""
+        if self.done or self.opened_at is None:
+            return []
+        now = self.clock()
+        idle = now - self.last_rx
+        if self.info is None:
+            if idle < OPEN_TIMEOUT:
+                return []
+            if self.retries >= OPEN_RETRIES:
+                self.fail("下位机没有回应快照请求")
+                return []
+            # 采集来源要等采满才回，按 RESEND 追问不会打断采集
+            self.retries += 1
+            self.last_rx = now
+            return [encode_frame(CMD_BULK_OPEN, struct.pack(">BH", BULK_SRC_RESEND, self.count))]
+        if idle > STALL_TIMEOUT:
+            self.fail(f"传输中断，已收到 {len(self.blocks)}/{self.total_blocks} 块")
+            return []
+        if idle > self.rto and now - self.last_tail_ack > self.rto:
+            self.last_tail_ack = now  # 下一次空闲确认再隔一个超时
+            return [self.ack(now, tail=True)]
+        return []
+
+    def _finish(self, now):
+        total = int(self.info["total"])
+        data = b"".join(self.blocks[b] for b in range(self.total_blocks))
+        if len(data) != total or bulk_crc32(data) != int(self.info["crc32"]):
+            # 各块 CRC 都对但整体不符：下位机快照在传输中被改写，整段重来
+            self.fail("快照整体 CRC-32 不符")
+            return []
+        self.data = data
+        self.done = True
+        self.elapsed = now - self.started
+        final = encode_frame(CMD_BULK_ACK, struct.pack(">BHI", int(self.info["xfer"]), self.total_blocks, 0))
+        return [final, final]  # 结束确认丢了下位机要等 3 s 才恢复批量帧，多发一次
+
+    def fail(self, message):
+        self.error = message
+        self.done = True
+
+    # ---------------- 结果 ----------------
+    @property
+    def ok(self):
+        return self.done and self.error is None
+
+    @property
+    def rate(self):
+        return RATE_HZ.get(int(self.info["rate"])) if self.info is not None else None
+
+    @property
+    def pga(self):
+        return PGA_GAIN.get(int(self.info["pga"])) if self.info is not None else None
+
+    def codes(self):
+        """快照中的 ADC 码值（int32）"""
+        raw = np.frombuffer(self.data, dtype=np.uint8).reshape(-1, 3).astype(np.int32)
+        codes = (raw[:, 0] << 16) | (raw[:, 1] << 8) | raw[:, 2]
+        return codes - ((codes & 0x800000) << 1)
+
+    def link_time(self):
+        """无差错时的链路极限用时：BULK_INFO + 全部数据帧"""
+        size = int(self.info["total"]) + self.total_blocks * (7 + BULK_DATA_FIELDS.itemsize)
+        return (size + 7 + BULK_INFO_FIELDS.itemsize) * 10.0 / self.baud
+
+    def summary(self):
+        s = self.stats
+        text = (f"{len(self.data) // 3} 个样本，{self.total_blocks} 块，用时 {self.elapsed:.3f} s"
+                f"（链路极限 {self.link_time():.3f} s），CRC 错 {s['crc_errors']} 块，"
+                f"请求重发 {s['requested']} 块，重复 {s['duplicates']} 块，确认 {s['acks']} 次")
+        return text
+
+    def to_session(self, path, vref=5.0, calibration=None):
+        """写成会话文件：时间按采样率展开，数值换算成 mV（套上位机的线性校准）"""
+        codes = self.codes()
+        rate = self.rate
+        cal = calibration or {}
+        mv = codes * (vref / (self.pga * 8388608.0)) * 1000.0
+        value = mv * cal.get("slope", 1.0) + cal.get("offset", 0.0)
+        meta = {
+            "recorded_at": datetime.now().strftime('%Y-%m-%d %H:%M:%S'),
+            "source": "bulk_snapshot",
+            "pga": self.pga,
+            "rate": self.rate,
+            "channel": 0,
+            "unit": "mV",
+            "vref": vref,
+            "calibration": cal,
+        }
+        session.write(path, meta, np.arange(len(codes)) / rate, value, codes)
+        return len(codes)
+
+
+# ============================================================
+# 命令行：pyserial 直接取快照
+# ============================================================
+def split_frames(buf):
+    """从缓冲中切出完整的 AA 55 命令帧，返回 ([(命令, 数据), ...], 剩余字节)"""
+    frames = []
+    i = 0
+    while True:
+        i = buf.find(FRAME_HEAD, i)
+        if i < 0:
+            return frames, buf[-1:] if buf.endswith(FRAME_HEAD[:1]) else b""
+        if len(buf) - i < 3:
+            return frames, buf[i:]
+        end = i + buf[i + 2] + 6
+        if len(buf) < end:
+            return frames, buf[i:]
+        frame = buf[i:end]
+        if buf[i + 2] and frame.endswith(FRAME_TAIL) and checksum(frame[2:-3]) == frame[-3]:
+            frames.append((frame[3], bytes(frame[4:-3])))
+            i = end
+        else:
+            i += 1  # 假帧头或坏帧，从下一个字节重新找
+
+
+def fetch(port, baud, source, count, log=print):
+    import serial
+
+    with serial.Serial(port, baud, timeout=0.005) as ser:
+        ser.reset_input_buffer()
+        ser.write(encode_frame(CMD_HELLO))
+        rx = BulkReceiver(baud, source, count)
+        buf = b""
+        deadline = time.monotonic() + 1.0
+        caps = None
+        while caps is None and time.monotonic() < deadline:
+            frames, buf = split_frames(buf + ser.read(256))
+            for cmd, data in frames:
+                if cmd == CMD_HELLO and len(data) >= HELLO_FIELDS.itemsize:
+                    caps = int(parse_fields(HELLO_FIELDS, data)["caps"])
+        if caps is not None and not caps & CAP_BULK:
+            raise RuntimeError("下位机不支持快照传输（握手帧没有 CAP_BULK）")
+        ser.write(rx.open())
+        while not rx.done:
+            frames, buf = split_frames(buf + ser.read(ser.in_waiting or 1))
+            out = []
+            for cmd, data in frames:
+                if cmd == CMD_ERROR and data:
+                    rx.fail(f"下位机报告错误: {ERROR_TEXT.get(data[0], hex(data[0]))}")
+                out += rx.on_frame(cmd, data)
+            out += rx.poll()
+            for frame in out:
+                ser.write(frame)
+    if rx.error:
+        raise RuntimeError(rx.error)
+    log(rx.summary())
+    return rx
+
+
+# ============================================================
+# 仿真：下位机（同 bulk.c 的逻辑）+ 有误码的串口，估计各误码率下的用时
+# ============================================================
+class SimDevice:
+    """bulk.c 的发送状态机；队列深度模拟两块 DMA 发送缓冲"""
+
+    def __init__(self, data, block_size=240, window=32, rate=3, pga=0):
+        self.data, self.block_size, self.window = data, block_size, window
+        self.blocks = -(-len(data) // block_size)
+        self.rate, self.pga = rate, pga
+        self.xfer = 0
+        self.sending = False
+
+    def open(self):
+        self.xfer = (self.xfer + 1) & 0xFF
+        self.sending = True
+        self.base = self.next = 0
+        self.resend = 0
+        info = struct.pack(">BBBBIHBBI", self.xfer, BULK_FMT_S24, self.rate, self.pga, len(self.data),
+                           self.blocks, self.block_size, self.window, bulk_crc32(self.data))
+        return [encode_frame(CMD_BULK_INFO, info)]
+
+    def ack(self, xfer, base, missing):
+        if not self.sending or xfer != self.xfer or base < self.base or base > self.next:
+            return
+        if base >= self.blocks:
+            self.sending = False
+            return
+        shift = base - self.base
+        self.resend = 0 if shift >= 32 else self.resend >> shift
+        self.base = base
+        shift = self.next - self.base
+        if shift < 32:
+            missing &= (1 << shift) - 1
+        self.resend |= missing
+
+    def block(self, b):
+        payload = self.data[b * self.block_size:(b + 1) * self.block_size]
+        return encode_frame(CMD_BULK_DATA, struct.pack(">BHH", self.xfer, b, bulk_crc16(payload)) + payload)
+
+    def poll(self, room):
+        """发送缓冲还能放 room 帧时调用，返回发出的帧"""
+        out = []
+        while self.sending and self.resend and len(out) < room:
+            i = (self.resend & -self.resend).bit_length() - 1
+            out.append(self.block(self.base + i))
+            self.resend &= ~(1 << i)
+        while self.sending and self.next < self.blocks and self.next - self.base < self.window and len(out) < room:
+            out.append(self.block(self.next))
+            self.next += 1
+        return out
+
+
+def corrupt(frame, ber, rng):
+    """按误码率翻转位；翻了就返回损坏的帧"""
+    nbits = len(frame) * 8
+    flips = rng.binomial(nbits, ber) if ber > 0 else 0
+    if not flips:
+        return frame
+    buf = bytearray(frame)
+    for pos in rng.choice(nbits, flips, replace=False):
+        buf[pos // 8] ^= 1 << (pos % 8)
+    return bytes(buf)
+
+
+def simulate(samples=2048, baud=921600, ber=1e-5, seed=1, host_period=0.01, device_period=0.002, latency=0.002):
+    """事件驱动仿真，返回接收器（含用时统计）"""
+    rng = np.random.default_rng(seed)
+    codes = rng.integers(-(1 << 23), 1 << 23, samples)
+    data = b"".join(int(c).to_bytes(3, "big", signed=True) for c in codes)
+    dev = SimDevice(data)
+    clock = [0.0]
+    rx = BulkReceiver(baud, BULK_SRC_HISTORY, samples, clock=lambda: clock[0])
+    byte_time = 10.0 / baud
+
+    events = []          # (时刻, 序号, 种类, 帧)
+    seq = [0]
+
+    def push(t, kind, frame=None):
+        seq[0] += 1
+        events.append((t, seq[0], kind, frame))
+
+    link_free = 0.0      # 下行链路空闲的时刻
+    queued = 0           # 已交给 DMA 还没发完的帧（两块缓冲）
+
+    def uplink(frames, t):
+        for f in frames:
+            push(t + len(f) * byte_time + latency, "up", corrupt(f, ber, rng))
+
+    def downlink(frames, t):
+        nonlocal link_free, queued
+        for f in frames:
+            start = max(link_free, t)
+            link_free = start + len(f) * byte_time
+            queued += 1
+            push(link_free, "down", corrupt(f, ber, rng))
+
+    uplink([rx.open()], 0.0)
+    push(0.0, "device")
+    push(0.0, "host")
+    while not rx.done and clock[0] < 60:
+        events.sort()
+        t, _, kind, frame = events.pop(0)
+        clock[0] = t
+        if kind == "device":
+            downlink(dev.poll(2 - queued), t)
+            push(t + device_period, "device")
+        elif kind == "host":
+            uplink(rx.poll(), t)
+            push(t + host_period, "host")
+        elif kind == "up":
+            frames, _ = split_frames(frame)
+            for cmd, d in frames:
+                if cmd == CMD_BULK_OPEN:
+                    downlink(dev.open(), t)
+                elif cmd == CMD_BULK_ACK:
+                    dev.ack(*struct.unpack(">BHI", d[:7]))
+        else:
+            queued -= 1
+            frames, _ = split_frames(frame)
+            for cmd, d in frames:
+                uplink(rx.on_frame(cmd, d), t)
+    if rx.ok and not np.array_equal(rx.codes(), codes):
+        rx.fail("仿真结果与原始数据不符")
+    return rx
+
+
+def main():
+    parser = argparse.ArgumentParser(description="从下位机取回 RAM 快照（分块传输，丢块选择重发）")
+    sub = parser.add_subparsers(dest="command", required=True)
+    get = sub.add_parser("fetch", help="经串口取快照并存成会话文件")
+    get.add_argument("port")
+    get.add_argument("--baud", type=int, default=115200, help="下位机当前波特率")
+    get.add_argument("--source", choices=list(SOURCES), default="history",
+                     help="history = 冻结最近的样本，capture = 再采 count 个")
+    get.add_argument("--count", type=int, default=0, help="样本数，0 = 下位机缓冲容量")
+    get.add_argument("--vref", type=float, default=5.0)
+    get.add_argument("-o", "--out", default=None, help="输出会话文件，默认 Snapshot_时间.cs1237s")
+    sim = sub.add_parser("simulate", help="在有误码的仿真链路上跑传输，对比链路极限用时")
+    sim.add_argument("--baud", type=int, default=921600)
+    sim.add_argument("--ber", type=float, nargs="+", default=[0, 1e-6, 1e-5, 1e-4], help="误码率（每位）")
+    sim.add_argument("--samples", type=int, default=2048)
+    sim.add_argument("--runs", type=int, default=5)
+    args = parser.parse_args()
+
+    if args.command == "simulate":
+        for ber in args.ber:
+            ratios, crc, req = [], 0, 0
+            for run in range(args.runs):
+                rx = simulate(args.samples, args.baud, ber, seed=run)
+                if not rx.ok:
+                    print(f"误码率 {ber:g}: 失败 - {rx.error}")
+                    break
+                ratios.append(rx.elapsed / rx.link_time())
+                crc += rx.stats["crc_errors"]
+                req += rx.stats["requested"]
+            else:
+                print(f"误码率 {ber:g}: 用时 / 链路极限 = {np.mean(ratios):.3f}（最大 {max(ratios):.3f}），"
+                      f"平均每次 CRC 拦下 {crc / args.runs:.1f} 块、请求重发 {req / args.runs:.1f} 块")
+        return
+
+    try:
+        rx = fetch(args.port, args.baud, SOURCES[args.source], args.count)
+    except (OSError, RuntimeError) as e:
+        print(f"取快照失败: {e}", file=sys.stderr)
+        sys.exit(1)
+    out = args.out or f"Snapshot_{datetime.now():%Y%m%d_%H%M%S}.cs1237s"
+    n = rx.to_session(out, args.vref)
+    print(f"已写入 {out}（{n} 条，{rx.rate:g} Hz，PGA x{rx.pga:g}）")
+
+
+if __name__ == "__main__":
+    main()
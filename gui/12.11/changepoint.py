@@ -0,0 +1,402 @@
+"""
+阶跃（加载 / 卸载）检测：把一段采集切成平台段，给出每段的均值、噪声和稳定用时
+
+两种方法:
+  pelt    离线，PELT（带剪枝的最优分割）按均值变化找变点，代价为段内平方和。
+          惩罚取 BIC（2 σ² ln n）与「两段各长 min_len、相差 min_step 的阶跃恰好值得切」两者的较大值。
+          先把数据按 block 个样本合成块（只存和与平方和），在块边界上做 PELT，
+          再在每个变点前后各一块内按样本精确重定位，总体约线性时间，1280 Hz 下一小时的记录约一秒切完。
+          之后整理：过渡段并入后一段，边界前移到开始偏离前一平台的时刻，去掉相差不到 min_step 的边界，
+          这样加载后的指数过渡和缓慢漂移不会被切成台阶，变点落在加载开始处。
+  cusum   在线，双侧 CUSUM：偏离参考电平超过 min_step / 2 的量累加超过 h σ 报警，变点取累加量最后一次为 0 处；
+          之后等最近 window 个点前后两半的均值之差在噪声的 settle_k 倍标准差内（不再有趋势）判为稳定，
+          以此为新平台重新布防。
+          参考电平以 window 为时间常数跟随数据，过渡尾巴和漂移不报警。
+          逐点更新，上位机实时曲线上用这个（StepDetector）。
+
+每段的统计:
+  稳定用时   变点到平滑后（window 点滑动平均）最后一次超出 段末电平 ± max(settle_k σ, tol) 的时间
+  均值/噪声  稳定之后那部分的均值和标准差（段太短没稳定时用整段）
+  阶跃      与上一段均值之差
+σ 为噪声标准差，默认由一阶差分的 MAD 估计（不受阶跃影响）；min_step 默认 10 σ。
+量化数据（16 位批量输出、安静的 10 Hz 采集）一半以上的差分为 0、MAD 为 0，此时改用差分的标准差，
+且不低于量化噪声 LSB/√12。
+
+用法:
+    python changepoint.py ADC_Data_xxx.txt
+    python changepoint.py session.cs1237s --min-duration 5 --csv segments.csv
+    python changepoint.py *.cs1237s --method cusum --h 8
+"""
+import argparse
+import csv
+import math
+import sys
+from collections import deque
+
+import numpy as np
+
+MIN_DURATION = 2.0     # 最短段长（秒）
+MIN_STEP = 10.0        # 未给最小阶跃时取几倍 σ
+SETTLE_K = 3.0         # 稳定判据：偏离段末电平不超过几倍 σ
+SETTLE_WINDOW = 0.1    # 稳定判据的滑动平均窗口（秒）
+BLOCKS_PER_MIN = 8     # 自动选块长时，最短段长分成几块（块内的变点位置靠逐样本重定位）
+CUSUM_H = 8.0          # CUSUM 报警门限（σ）；漂移量 k 取最小阶跃的一半
+
+
+def estimate_noise(x):
+    """由一阶差分的 MAD 估计噪声标准差；阶跃只影响极少数差分，不会把它抬高。
+    只有恒定数据返回 0"""
+    d = np.diff(np.asarray(x[:1_000_000], dtype=np.float64))
+    if len(d) == 0:
+        return 0.0
+    mad = float(np.median(np.abs(d - np.median(d))))
+    if mad > 0:
+        return 1.4826 * mad / math.sqrt(2)
+    # 一半以上的差分为 0（量化）：用差分的标准差，先去掉超出 5 倍的差分（阶跃）；
+    # LSB 取最小的非零差分
+    nonzero = np.abs(d[d != 0])
+    if len(nonzero) == 0:
+        return 0.0
+    s = float(np.std(d))
+    s = float(np.std(d[np.abs(d) <= 5 * s]))
+    return max(s / math.sqrt(2), float(nonzero.min()) / math.sqrt(12))
+
+
+# ============================================================
+# PELT
+# ============================================================
+def pelt(s1, s2, count, penalty, min_len):
+    """在 len(s1) - 1 个单元（样本或块）上做 PELT。s1 / s2 / count 为前缀和（首元素 0）。
+    返回变点位置（单元号，不含首尾）"""
+    n = len(s1) - 1
+    best = np.full(n + 1, np.inf)
+    best[0] = -penalty
+    last = np.zeros(n + 1, dtype=np.int64)
+    cands = np.zeros(1, dtype=np.int64)
+    for t in range(min_len, n + 1):
+        w = count[t] - count[cands]
+        a = s1[t] - s1[cands]
+        cost = (s2[t] - s2[cands]) - a * a / w
+        total = best[cands] + cost + penalty
+        i = int(np.argmin(total))
+        best[t] = total[i]
+        last[t] = cands[i]
+        # 剪枝：F(τ) + C(τ, t) 已经大于 F(t) 的候选以后也不会最优
+        cands = cands[total - penalty <= best[t]]
+        new = t - min_len + 1
+        if new >= min_len and np.isfinite(best[new]):
+            cands = np.append(cands, new)
+    points = []
+    t = n
+    while t > 0:
+        t = int(last[t])
+        if t > 0:
+            points.append(t)
+    return points[::-1]
+
+
+def _segment_cost(s1, s2, n):
+    return s2 - s1 * s1 / n
+
+
+def refine(x, bounds, i, radius):
+    """把 bounds[i] 在 ±radius 个样本内移到使左右两段代价之和最小的位置"""
+    a, c, b = bounds[i - 1], bounds[i], bounds[i + 1]
+    lo, hi = max(a + 1, c - radius), min(b - 1, c + radius)
+    if hi <= lo:
+        return c
+    seg = x[a:b]
+    left_s1 = float(seg[:lo - a].sum())
+    left_s2 = float((seg[:lo - a] ** 2).sum())
+    total_s1 = float(seg.sum())
+    total_s2 = float((seg * seg).sum())
+    w = seg[lo - a:hi - a]
+    cs1 = left_s1 + np.concatenate(([0.0], np.cumsum(w)))
+    cs2 = left_s2 + np.concatenate(([0.0], np.cumsum(w * w)))
+    nl = np.arange(lo - a, hi - a + 1, dtype=np.float64)
+    cost = _segment_cost(cs1, cs2, nl) + _segment_cost(total_s1 - cs1, total_s2 - cs2, (b - a) - nl)
+    return lo + int(np.argmin(cost))
+
+
+def detect_pelt(x, rate, min_duration=MIN_DURATION, min_step=None, penalty=None, sigma=None, block=None):
+    """返回段边界（样本号，含 0 和 len(x)）"""
+    n = len(x)
+    sigma = estimate_noise(x) if sigma is None else sigma
+    if min_step is None:
+        min_step = MIN_STEP * sigma
+        if min_step <= 0 and n and np.ptp(x) == 0:
+            return [0, n]   # 恒定数据
+    if min_step <= 0:
+        raise ValueError("最小阶跃必须大于 0")
+    min_samples = max(int(min_duration * rate), 2)
+    if penalty is None:
+        penalty = max(2 * sigma * sigma * math.log(max(n, 2)), min_samples * min_step * min_step / 2)
+    if block is None:
+        block = max(1, min_samples // BLOCKS_PER_MIN)
+    block = max(1, min(block, min_samples // 2))
+    # 减去首值再求和，前缀平方和不因直流偏置丢精度
+    centred = np.asarray(x, dtype=np.float64) - float(x[0])
+    nb = -(-n // block)
+    padded = np.zeros(nb * block)
+    padded[:n] = centred
+    blocks = padded.reshape(nb, block)
+    counts = np.full(nb, block, dtype=np.float64)
+    counts[-1] = n - (nb - 1) * block
+    s1 = np.concatenate(([0.0], np.cumsum(blocks.sum(axis=1))))
+    s2 = np.concatenate(([0.0], np.cumsum((blocks * blocks).sum(axis=1))))
+    cnt = np.concatenate(([0.0], np.cumsum(counts)))
+    points = pelt(s1, s2, cnt, penalty, max(min_samples // block, 1))
+    bounds = [0] + [p * block for p in points] + [n]
+    if block > 1:
+        for i in range(1, len(bounds) - 1):
+            bounds[i] = refine(centred, bounds, i, block)
+    return merge(centred, bounds, min_step, SETTLE_K * sigma)
+
+
+def settled_part(seg, band, w):
+    """段内稳定的起点（相对段首）与段末电平（后半段中位数）：平滑后最后一次超出 电平 ± band 之后"""
+    level = float(np.median(seg[len(seg) // 2:]))
+    smooth = np.convolve(seg, np.full(w, 1.0 / w), mode="valid") if len(seg) > w else seg
+    outside = np.flatnonzero(np.abs(smooth - level) > band)
+    settled = 0 if len(outside) == 0 else min(int(outside[-1]) + 1, len(seg) - 1)
+    return settled, level
+
+
+def merge(x, bounds, min_step, band):
+    """整理 PELT 的边界：
+    1. 过渡段（不到一半的点落在自身中位数 ± band 内）并入后一段，过渡过程算作后一段的稳定过程；
+    2. 边界前移到前一段最后一个落在其电平 ± band 内的点之后，即开始偏离的时刻；
+    3. 去掉两侧稳定电平相差不到 min_step 的边界"""
+    bounds = list(bounds)
+    i = 0
+    while i < len(bounds) - 2:
+        seg = x[bounds[i]:bounds[i + 1]]
+        if np.mean(np.abs(seg - np.median(seg)) <= band) < 0.5:
+            del bounds[i + 1]
+        else:
+            i += 1
+    for i in range(1, len(bounds) - 1):
+        left = x[bounds[i - 1]:bounds[i]]
+        inside = np.flatnonzero(np.abs(left - np.median(left)) <= band)
+        if len(inside):
+            bounds[i] = bounds[i - 1] + int(inside[-1]) + 1
+    i = 1
+    while i < len(bounds) - 1:
+        left = x[bounds[i - 1]:bounds[i]]
+        right = x[bounds[i]:bounds[i + 1]]
+        if abs(np.median(right[len(right) // 2:]) - np.median(left)) < min_step:
+            del bounds[i]
+        else:
+            i += 1
+    return bounds
+
+
+# ============================================================
+# CUSUM（在线）
+# ============================================================
+class StepDetector:
+    """逐点更新的阶跃检测器。update() 返回事件:
+    ("change", 变点时刻, 上一平台均值) 或 ("settled", 稳定时刻, Segment)，其余返回 None"""
+
+    def __init__(self, rate, sigma=None, min_step=None, h=CUSUM_H, settle_k=SETTLE_K,
+                 window=SETTLE_WINDOW, tol=0.0):
+        if min_step is not None and min_step <= 0:
+            raise ValueError("最小阶跃必须大于 0")
+        if sigma is not None and sigma <= 0:
+            raise ValueError("噪声标准差必须大于 0")
+        self.min_step = min_step
+        self.h = h
+        self.settle_k = settle_k
+        self.tol = tol
+        self.window = max(int(window * rate), 4)
+        self.sigma = sigma
+        self.recent = deque(maxlen=self.window)   # 最近 window 个 (t, x)，用于估计噪声和判稳定
+        self.segments = []
+        self.settling = True
+        self.level = None          # 本平台稳定后的均值
+        self.ref = None            # CUSUM 的参考电平
+        self.change_time = None
+        self.g_pos = self.g_neg = 0.0
+        self.zero_pos = self.zero_neg = None
+        self.stats = [0, 0.0, 0.0]   # 稳定后的 Welford 统计：n, 均值, M2
+
+    def update(self, t, x):
+        if self.settling:
+            return self._settle(t, x)
+        z = (x - self.ref) / self.sigma
+        self.g_pos = max(0.0, self.g_pos + z - self.k)
+        self.g_neg = max(0.0, self.g_neg - z - self.k)
+        if self.g_pos == 0.0:
+            self.zero_pos = t
+        if self.g_neg == 0.0:
+            self.zero_neg = t
+        if self.g_pos > self.h or self.g_neg > self.h:
+            start = self.zero_pos if self.g_pos > self.h else self.zero_neg
+            self._close(start)
+            self.settling = True
+            self.change_time = start
+            self.recent.clear()
+            self.recent.append((t, x))
+            return ("change", start, self.level)
+        # 参考电平按 window 个点的时间常数跟随，过渡尾巴和缓慢漂移不会累积成报警，
+        # 不小于 min_step 的阶跃几个点内就报警，参考电平来不及跟上
+        self.ref += (x - self.ref) / self.window
+        n, mean, m2 = self.stats
+        n += 1
+        delta = x - mean
+        mean += delta / n
+        self.stats = [n, mean, m2 + delta * (x - mean)]
+        self.level = mean
+        return None
+
+    def _settle(self, t, x):
+        self.recent.append((t, x))
+        if len(self.recent) < self.window:
+            return None
+        values = np.array([v for _, v in self.recent])
+        if self.sigma is None:
+            sigma = estimate_noise(values)
+            if sigma <= 0:
+                return None   # 窗口内恒定，还估不出噪声，等数据动起来再布防
+            self.sigma = sigma
+        mean = float(values.mean())
+        # 前后半窗均值之差在噪声的 settle_k 倍标准差以内（不再有趋势）
+        half = len(values) // 2
+        drift = abs(values[half:].mean() - values[:half].mean())
+        if drift > max(self.settle_k * self.sigma * 2 / math.sqrt(len(values)), self.tol):
+            return None
+        # 稳定：以窗口均值为新平台重新布防
+        settled_at = self.recent[0][0]
+        start = self.change_time if self.change_time is not None else settled_at
+        segment = Segment(start, settled_at - start)
+        segment.previous = self.level
+        self.segments.append(segment)
+        step = self.min_step if self.min_step is not None else MIN_STEP * self.sigma
+        self.k = step / self.sigma / 2
+        self.settling = False
+        self.level = self.ref = mean
+        self.g_pos = self.g_neg = 0.0
+        self.zero_pos = self.zero_neg = t
+        self.stats = [len(values), mean, float(((values - mean) ** 2).sum())]
+        return ("settled", settled_at, segment)
+
+    def _close(self, end):
+        if not self.segments:
+            return
+        seg = self.segments[-1]
+        n, mean, m2 = self.stats
+        seg.end = end
+        seg.mean = mean
+        seg.noise = math.sqrt(m2 / n) if n > 1 else 0.0
+        seg.step = mean - seg.previous if seg.previous is not None else 0.0
+
+    def finish(self, t):
+        """数据结束，收尾最后一段"""
+        if not self.settling:
+            self._close(t)
+        return self.segments
+
+
+# ============================================================
+# 段统计
+# ============================================================
+class Segment:
+    def __init__(self, start, settle):
+        self.start = start
+        self.end = start
+        self.settle = settle
+        self.mean = self.noise = self.step = 0.0
+        self.previous = None
+
+    def as_row(self):
+        return {"start": self.start, "end": self.end, "duration": self.end - self.start,
+                "mean": self.mean, "noise": self.noise, "step": self.step, "settle": self.settle}
+
+
+def describe(t, x, bounds, rate, sigma=None, settle_k=SETTLE_K, window=SETTLE_WINDOW, tol=0.0):
+    """按段边界计算每段的稳定用时、均值、噪声和阶跃"""
+    sigma = estimate_noise(x) if sigma is None else sigma
+    band = max(settle_k * sigma, tol)
+    w = max(int(window * rate), 1)
+    segments = []
+    previous = None
+    for a, b in zip(bounds[:-1], bounds[1:]):
+        seg = np.asarray(x[a:b], dtype=np.float64)
+        settled, _ = settled_part(seg, band, w)
+        part = seg[settled:] if len(seg) - settled >= w else seg
+        s = Segment(float(t[a]), float(t[a + settled] - t[a]))
+        s.end = float(t[b - 1])
+        s.mean = float(part.mean())
+        s.noise = float(part.std())
+        s.step = s.mean - previous if previous is not None else 0.0
+        previous = s.mean
+        segments.append(s)
+    return segments
+
+
+def segment(t, x, rate=None, method="pelt", **options):
+    """切分一段数据，返回 Segment 列表；t / x 可以是列表"""
+    t = np.asarray(t, dtype=np.float64)
+    x = np.asarray(x, dtype=np.float64)
+    if rate is None:
+        rate = (len(t) - 1) / float(t[-1] - t[0])
+    if method == "pelt":
+        bounds = detect_pelt(x, rate, options.get("min_duration", MIN_DURATION), options.get("min_step"),
+                             options.get("penalty"), options.get("sigma"))
+        return describe(t, x, bounds, rate, options.get("sigma"))
+    detector = StepDetector(rate, options.get("sigma"), options.get("min_step"), options.get("h", CUSUM_H))
+    for ti, xi in zip(t.tolist(), x.tolist()):
+        detector.update(ti, xi)
+    return detector.finish(float(t[-1]))
+
+
+FIELDS = ["file", "start", "end", "duration", "mean", "noise", "step", "settle"]
+
+
+def main():
+    from batch_process import read_session
+
+    parser = argparse.ArgumentParser(description="按阶跃切分采集数据，输出各平台段的均值、噪声和稳定用时")
+    parser.add_argument("files", nargs="+", help="会话文件、上位机保存的 TXT / CSV 或两列 npy")
+    parser.add_argument("--method", choices=["pelt", "cusum"], default="pelt")
+    parser.add_argument("--min-duration", type=float, default=MIN_DURATION, help="最短段长（秒，pelt）")
+    parser.add_argument("--min-step", type=float, default=None, help="最小阶跃（与数据同单位），默认 10σ")
+    parser.add_argument("--penalty", type=float, default=None, help="每个变点的惩罚（pelt），默认由最短段长和最小阶跃推出")
+    parser.add_argument("--sigma", type=float, default=None, help="噪声标准差，默认由数据估计")
+    parser.add_argument("--h", type=float, default=CUSUM_H, help="CUSUM 报警门限（σ）")
+    parser.add_argument("--rate", type=float, default=None, help="采样率（Hz），默认由时间列估计")
+    parser.add_argument("--csv", default=None, help="各段结果写入 CSV")
+    args = parser.parse_args()
+    if args.min_step is not None and args.min_step <= 0:
+        parser.error("--min-step 必须大于 0")
+    if args.sigma is not None and args.sigma <= 0:
+        parser.error("--sigma 必须大于 0")
+
+    rows = []
+    failed = False
+    for path in args.files:
+        try:
+            t, x = read_session(path)
+        except (OSError, ValueError) as e:
+            print(f"{path}: 读取失败: {e}", file=sys.stderr)
+            failed = True
+            continue
+        segments = segment(t, x, args.rate, args.method, min_duration=args.min_duration,
+                           min_step=args.min_step, penalty=args.penalty, sigma=args.sigma, h=args.h)
+        print(f"{path}: {len(segments)} 段")
+        print(f"  {'起点(s)':>10}{'时长(s)':>10}{'均值':>12}{'噪声':>10}{'阶跃':>12}{'稳定用时(s)':>12}")
+        for s in segments:
+            print(f"  {s.start:>10.3f}{s.end - s.start:>10.3f}{s.mean:>12.4f}{s.noise:>10.4f}"
+                  f"{s.step:>+12.4f}{s.settle:>12.3f}")
+            rows.append(dict(s.as_row(), file=path))
+
+    if args.csv and rows:
+        with open(args.csv, "w", newline="", encoding="utf-8") as f:
+            writer = csv.DictWriter(f, fieldnames=FIELDS)
+            writer.writeheader()
+            writer.writerows(rows)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
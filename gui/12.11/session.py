@@ -0,0 +1,303 @@
+"""
+采集会话文件（.cs1237s）的读写：内存映射，各列直接是 NumPy 数组，不解析、不拷贝
+
+文件布局（小端）:
+  文件头   "CS1237S1" + u32 元数据长度 + UTF-8 JSON 元数据，补齐到 64 字节边界
+  记录区   定长记录连续存放，字段由元数据的 "fields" 给出，按 C 结构体规则对齐（默认每条 24 字节）
+           t f8 (秒，相对采集开始)、value f8 (mV，温度通道为 °C，已套校准)、raw i4 (ADC 码)、flags u1 (QFLAG_*)；
+           没有记录 ADC 码或标志的来源（曲线导出、TXT 转换）不建 raw / flags 列
+  块索引   每 BLOCK 条记录的第一个时间 f8（按时间切片时先在这里二分，只碰到目标块所在的页）
+  文件尾   "CS1237IX" + u64 记录数 + u64 块索引偏移 + u32 BLOCK + u32 保留，共 32 字节
+
+元数据包括 PGA、采样率、通道、VREF、校准参数（与 calibration.json 同名字段）、单位、记录开始时间等。
+时间列必须不减（写入时检查）。采集中断没写文件尾时，按文件长度算记录数，块索引从时间列临时抽取。
+
+读取:
+    s = session.open("ADC_Data_20250101_120000.cs1237s")
+    s.meta["pga"], s.rate, s.calibration          # 元数据
+    s.t, s.value, s["flags"]                      # 零拷贝列（np.memmap 上的视图）
+    part = s.between(10.0, 20.0)                  # 按时间切片，仍是零拷贝视图
+
+写入（上位机导出时写一份；也可把旧的 TXT / CSV 导出转过来）:
+    with session.SessionWriter(path, meta) as w:
+        w.append(t, value, raw, flags)
+
+用法:
+    python session.py info FILE.cs1237s
+    python session.py convert ADC_Data_xxx.txt [-o OUT.cs1237s]
+"""
+import argparse
+import builtins
+import json
+import os
+import re
+import struct
+import sys
+
+import numpy as np
+
+MAGIC = b"CS1237S1"
+INDEX_MAGIC = b"CS1237IX"
+HEADER = struct.Struct("<8sI")
+TRAILER = struct.Struct("<8sQQII")
+ALIGN = 64
+BLOCK = 4096           # 块索引的粒度（记录数）
+
+DEFAULT_FIELDS = [["t", "<f8"], ["value", "<f8"], ["raw", "<i4"], ["flags", "u1"]]
+
+# 上位机 channel_labels 的反查，用于从 TXT 文件头恢复通道编码
+CHANNEL_LABELS = {0: "通道A（差分）", 1: "保留", 2: "温度传感器", 3: "内短模式"}
+
+
+# ============================================================
+# 读取
+# ============================================================
+class Session:
+    """一个会话文件或其中一段；列都是内存映射上的视图"""
+
+    def __init__(self, path, meta, records, index, block, base=0):
+        self.path = path
+        self.meta = meta
+        self.records = records     # 结构化 np.memmap（或其切片）
+        self.index = index         # 整个文件的块首时间，index[i] = 文件中第 i * block 条的 t
+        self.block = block
+        self.base = base           # records[0] 在文件中的记录号
+
+    def __len__(self):
+        return len(self.records)
+
+    def __getitem__(self, name):
+        return self.records[name]
+
+    def __repr__(self):
+        span = f"{self.t[0]:.3f} ~ {self.t[-1]:.3f} s" if len(self) else "空"
+        return f"<Session {os.path.basename(self.path)}: {len(self)} 条, {span}>"
+
+    @property
+    def columns(self):
+        return list(self.records.dtype.names)
+
+    @property
+    def t(self):
+        return self.records["t"]
+
+    @property
+    def value(self):
+        return self.records["value"]
+
+    @property
+    def rate(self):
+        return self.meta.get("rate")
+
+    @property
+    def pga(self):
+        return self.meta.get("pga")
+
+    @property
+    def channel(self):
+        return self.meta.get("channel")
+
+    @property
+    def calibration(self):
+        return self.meta.get("calibration", {})
+
+    def find(self, time):
+        """第一条 t >= time 的记录号（相对本段）：块索引定位到块，再在块内二分"""
+        b = max(int(np.searchsorted(self.index, time, side="left")) - 1, 0)
+        n = len(self.records)
+        lo = min(max(b * self.block - self.base, 0), n)
+        hi = min(max((b + 1) * self.block - self.base, 0), n)
+        return lo + int(np.searchsorted(self.records["t"][lo:hi], time, side="left"))
+
+    def between(self, start=None, stop=None):
+        """start <= t < stop 的记录，返回共享同一映射的 Session"""
+        lo = 0 if start is None else self.find(start)
+        hi = len(self.records) if stop is None else max(self.find(stop), lo)
+        return Session(self.path, self.meta, self.records[lo:hi], self.index, self.block, self.base + lo)
+
+
+def open(path):
+    """打开会话文件，只读内存映射；打开时只读文件头、文件尾和块索引"""
+    size = os.path.getsize(path)
+    with builtins.open(path, "rb") as f:
+        magic, meta_len = HEADER.unpack(f.read(HEADER.size))
+        if magic != MAGIC:
+            raise ValueError(f"{path}: 不是会话文件")
+        meta = json.loads(f.read(meta_len).decode("utf-8"))
+        data_offset = _aligned(HEADER.size + meta_len)
+        trailer = None
+        if size >= data_offset + TRAILER.size:
+            f.seek(size - TRAILER.size)
+            trailer = TRAILER.unpack(f.read(TRAILER.size))
+    dtype = _record_dtype(meta.get("fields", DEFAULT_FIELDS))
+
+    if trailer and trailer[0] == INDEX_MAGIC:
+        _, count, index_offset, block, _ = trailer
+        blocks = -(-count // block)
+        index = np.memmap(path, dtype="<f8", mode="r", offset=index_offset, shape=(blocks,)) if blocks else np.empty(0)
+    else:
+        # 采集中断，没有文件尾：按长度截到整条记录
+        count = (size - data_offset) // dtype.itemsize
+        block = BLOCK
+        index = None
+    records = np.memmap(path, dtype=dtype, mode="r", offset=data_offset, shape=(count,)) if count else np.empty(0, dtype)
+    if index is None:
+        index = np.asarray(records["t"][::block])
+    return Session(path, meta, records, index, block)
+
+
+def _aligned(n):
+    return -(-n // ALIGN) * ALIGN
+
+
+def _record_dtype(fields):
+    """按 C 结构体规则对齐，f8 列不跨自然边界，读起来不走非对齐访问"""
+    return np.dtype([tuple(field) for field in fields], align=True)
+
+
+# ============================================================
+# 写入
+# ============================================================
+class SessionWriter:
+    """顺序追加记录，关闭时写块索引和文件尾"""
+
+    def __init__(self, path, meta, fields=DEFAULT_FIELDS):
+        self.meta = dict(meta)
+        self.meta["fields"] = [list(field) for field in fields]
+        self.dtype = _record_dtype(fields)
+        self.f = builtins.open(path, "wb")
+        body = json.dumps(self.meta, ensure_ascii=False).encode("utf-8")
+        self.f.write(HEADER.pack(MAGIC, len(body)) + body)
+        self.f.write(b"\0" * (_aligned(HEADER.size + len(body)) - HEADER.size - len(body)))
+        self.count = 0
+        self.index = []
+        self.last_t = -np.inf
+
+    def append(self, t, value, raw=None, flags=None, **columns):
+        """追加一批记录；没给的列写 0"""
+        t = np.asarray(t, dtype=np.float64)
+        if len(t) == 0:
+            return
+        if t[0] < self.last_t or np.any(np.diff(t) < 0):
+            raise ValueError("时间列必须不减")
+        rec = np.zeros(len(t), dtype=self.dtype)
+        columns.update(t=t, value=value, raw=raw, flags=flags)
+        for name, data in columns.items():
+            if data is not None and name in self.dtype.names:
+                rec[name] = data
+        # 落在本批内的块首
+        first = -(-self.count // BLOCK) * BLOCK - self.count
+        self.index.extend(t[first::BLOCK].tolist())
+        self.f.write(rec.tobytes())
+        self.count += len(t)
+        self.last_t = t[-1]
+
+    def close(self):
+        if self.f.closed:
+            return
+        index_offset = self.f.tell()
+        self.f.write(np.asarray(self.index, dtype="<f8").tobytes())
+        self.f.write(TRAILER.pack(INDEX_MAGIC, self.count, index_offset, BLOCK, 0))
+        self.f.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+def write(path, meta, t, value, raw=None, flags=None):
+    """一次写完整个会话；没给的 raw / flags 不建列（不写成 0，0 也是合法的 ADC 码和标志）"""
+    given = {"raw": raw, "flags": flags}
+    fields = [field for field in DEFAULT_FIELDS if given.get(field[0], True) is not None]
+    with SessionWriter(path, meta, fields) as w:
+        w.append(t, value, raw, flags)
+
+
+# ============================================================
+# 上位机 TXT / CSV 导出
+# ============================================================
+HEADER_PATTERNS = [
+    ("recorded_at", re.compile(r"记录时间:\s*(.+)"), str),
+    ("pga", re.compile(r"PGA增益:\s*x?([\d.]+)"), float),
+    ("rate", re.compile(r"采样率:\s*([\d.]+)\s*Hz"), float),
+    ("channel_label", re.compile(r"输入通道:\s*(.+)"), str),
+]
+
+
+def read_export(path):
+    """读上位机保存的 TXT（# 文件头 + 时间\\t电压）或 CSV（time_s, voltage_mV），返回 (时间, 数值, 元数据)"""
+    meta = {}
+    skip, delimiter, found = 0, None, False
+    with builtins.open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            if line.startswith("#") or not line.strip():
+                for key, pattern, kind in HEADER_PATTERNS:
+                    m = pattern.search(line)
+                    if m:
+                        meta[key] = kind(m.group(1).strip())
+                skip += 1
+                continue
+            delimiter = "," if "," in line else None
+            try:
+                float(line.replace(",", " ").split()[0])
+                found = True
+            except ValueError:
+                skip += 1  # 表头
+                found = f.readline() != ""
+            break
+    if not found:
+        raise ValueError(f"{path}: 没有数据")
+    data = np.loadtxt(path, delimiter=delimiter, comments="#", skiprows=skip, usecols=(0, 1), ndmin=2)
+    if "channel_label" in meta:
+        codes = {label: code for code, label in CHANNEL_LABELS.items()}
+        meta["channel"] = codes.get(meta["channel_label"])
+    meta["unit"] = "°C" if meta.get("channel") == 2 else "mV"
+    return data[:, 0], data[:, 1], meta
+
+
+def convert(src, dst, calibration=None):
+    t, value, meta = read_export(src)
+    if calibration:
+        meta["calibration"] = calibration
+    meta["source"] = os.path.basename(src)
+    write(dst, meta, t, value)
+    return len(t)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="采集会话文件（.cs1237s）查看与转换")
+    sub = parser.add_subparsers(dest="command", required=True)
+    info = sub.add_parser("info", help="显示元数据和时间范围")
+    info.add_argument("file")
+    conv = sub.add_parser("convert", help="把上位机的 TXT / CSV 导出转成会话文件")
+    conv.add_argument("file")
+    conv.add_argument("-o", "--out", default=None, help="输出文件，默认同名 .cs1237s")
+    conv.add_argument("--calibration", default=None, help="记入元数据的 calibration.json")
+    args = parser.parse_args()
+
+    if args.command == "info":
+        s = open(args.file)
+        print(s)
+        for key, val in s.meta.items():
+            print(f"  {key}: {val}")
+        if len(s):
+            print(f"  块索引: {len(s.index)} 块 × {s.block} 条")
+        return
+
+    out = args.out or os.path.splitext(args.file)[0] + ".cs1237s"
+    calibration = None
+    if args.calibration:
+        with builtins.open(args.calibration, "r") as f:
+            calibration = json.load(f)
+    try:
+        n = convert(args.file, out, calibration)
+    except (OSError, ValueError) as e:
+        print(f"转换失败: {e}", file=sys.stderr)
+        sys.exit(1)
+    print(f"已写入 {out}（{n} 条）")
+
+
+if __name__ == "__main__":
+    main()
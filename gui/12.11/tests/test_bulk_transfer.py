@@ -0,0 +1,163 @@
+"""bulk_transfer.BulkReceiver：丢块、CRC 错、尾块丢失和异常的 BULK_INFO"""
+import os
+import struct
+import sys
+
+import numpy as np
+import pytest
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+
+import bulk_transfer as bt
+from cs1237_proto import CMD_BULK_ACK, CMD_BULK_INFO, encode_frame
+
+
+class Link:
+    """接收器与 SimDevice 直连，按块号丢帧或改坏数据（只对第一次发送生效）"""
+
+    def __init__(self, samples=2048, drop=(), corrupt=(), rate=3, pga=0):
+        rng = np.random.default_rng(7)
+        self.codes = rng.integers(-(1 << 23), 1 << 23, samples)
+        data = b"".join(int(c).to_bytes(3, "big", signed=True) for c in self.codes)
+        self.dev = bt.SimDevice(data, rate=rate, pga=pga)
+        self.now = 0.0
+        self.rx = bt.BulkReceiver(921600, bt.BULK_SRC_HISTORY, samples, clock=lambda: self.now)
+        self.drop, self.corrupt = set(drop), set(corrupt)
+        self.sent = []          # 下位机发出的块号（含重发）
+        self.acks = []          # (base, 丢块位图)
+
+    def to_device(self, frames):
+        for cmd, data in bt.split_frames(b"".join(frames))[0]:
+            if cmd == CMD_BULK_ACK:
+                xfer, base, missing = struct.unpack(">BHI", data[:7])
+                self.acks.append((base, missing))
+                self.dev.ack(xfer, base, missing)
+            elif cmd == bt.CMD_BULK_OPEN:
+                self.to_host(self.dev.open())
+
+    def to_host(self, frames):
+        for cmd, data in bt.split_frames(b"".join(frames))[0]:
+            if cmd == bt.CMD_BULK_DATA:
+                block = struct.unpack(">H", data[1:3])[0]
+                self.sent.append(block)
+                if block in self.drop:
+                    self.drop.discard(block)
+                    continue
+                if block in self.corrupt:
+                    self.corrupt.discard(block)
+                    data = data[:-1] + bytes([data[-1] ^ 0x40])
+            self.to_device(self.rx.on_frame(cmd, data))
+
+    def run(self, step=0.001, limit=5.0):
+        self.to_device([self.rx.open()])
+        while not self.rx.done and self.now < limit:
+            self.to_host(self.dev.poll(2))
+            self.to_device(self.rx.poll())
+            self.now += step
+        return self.rx
+
+
+def test_clean_transfer():
+    link = Link()
+    rx = link.run()
+    assert rx.ok, rx.error
+    np.testing.assert_array_equal(rx.codes(), link.codes)
+    assert link.sent == list(range(rx.total_blocks))
+    assert rx.stats["requested"] == 0 and rx.stats["crc_errors"] == 0
+
+
+def test_lost_and_corrupted_blocks_are_resent_once():
+    link = Link(drop={3, 10}, corrupt={5, 6})
+    rx = link.run()
+    assert rx.ok, rx.error
+    np.testing.assert_array_equal(rx.codes(), link.codes)
+    assert rx.stats["crc_errors"] == 2
+    assert rx.stats["duplicates"] == 0
+    # 只补坏掉的块，每块一次
+    resent = sorted(b for b in set(link.sent) if link.sent.count(b) > 1)
+    assert resent == [3, 5, 6, 10] and len(link.sent) == rx.total_blocks + 4
+    assert rx.stats["requested"] == 4
+
+
+def test_lost_tail_block_is_requested_after_idle():
+    # 最后一块丢了没有后续块暴露缺口，靠空闲超时的确认补回
+    link = Link(drop={25})
+    rx = link.run()
+    assert rx.ok, rx.error
+    assert rx.total_blocks == 26
+    assert link.sent[-1] == 25 and link.sent.count(25) == 2
+    assert any(missing for _, missing in link.acks)
+
+
+def test_simulate_with_bit_errors():
+    totals = {"crc_errors": 0, "requested": 0}
+    for seed in range(1, 4):
+        rx = bt.simulate(samples=2048, ber=3e-4, seed=seed)   # 结果与原始数据不符时 simulate 自己判失败
+        assert rx.ok, rx.error
+        assert rx.elapsed >= rx.link_time()
+        for key in totals:
+            totals[key] += rx.stats[key]
+    assert totals["crc_errors"] > 0 and totals["requested"] > 0
+
+
+def test_simulate_without_errors_is_near_link_time():
+    rx = bt.simulate(samples=2048, ber=0)
+    assert rx.ok, rx.error
+    assert rx.stats["requested"] == 0
+    assert rx.elapsed < rx.link_time() * 1.2
+
+
+def info_frame(dev, **override):
+    fields = dict(xfer=dev.xfer, fmt=bt.BULK_FMT_S24, rate=dev.rate, pga=dev.pga, total=len(dev.data),
+                  blocks=dev.blocks, block_size=dev.block_size, window=dev.window, crc=bt.bulk_crc32(dev.data))
+    fields.update(override)
+    return encode_frame(CMD_BULK_INFO, struct.pack(">BBBBIHBBI", *fields.values()))
+
+
+@pytest.mark.parametrize("override, text", [
+    ({"rate": 7}, "采样率编码"),
+    ({"pga": 9}, "PGA 编码"),
+    ({"window": 40}, "窗口"),
+    ({"fmt": 99}, "格式"),
+])
+def test_bad_info_fails(override, text):
+    rx = bt.BulkReceiver(clock=lambda: 0.0)
+    rx.open()
+    dev = bt.SimDevice(bytes(480))
+    for cmd, data in bt.split_frames(info_frame(dev, **override))[0]:
+        assert rx.on_frame(cmd, data) == []
+    assert rx.done and not rx.ok
+    assert text in rx.error
+
+
+def test_whole_snapshot_crc_mismatch_fails():
+    # 各块 CRC-16 都对，但整体 CRC-32 与 BULK_INFO 不符（快照在传输中被改写）
+    link = Link(samples=160)
+    dev_open = link.dev.open
+    link.dev.open = lambda: dev_open() and [info_frame(link.dev, crc=0)]
+    rx = link.run()
+    assert rx.done and not rx.ok
+    assert "CRC-32" in rx.error
+
+
+def test_stalled_transfer_gives_up():
+    # BULK_INFO 之后下位机不再发块：空闲确认照发，但超过 STALL_TIMEOUT 要放弃
+    link = Link()
+    link.dev.poll = lambda room: []
+    rx = link.run(step=0.01)
+    assert rx.done and not rx.ok
+    assert "传输中断" in rx.error
+    assert bt.STALL_TIMEOUT <= link.now < bt.STALL_TIMEOUT + 0.05
+    assert len(link.acks) > 1
+
+
+def test_open_retries_then_gives_up():
+    now = [0.0]
+    rx = bt.BulkReceiver(clock=lambda: now[0])
+    rx.open()
+    sent = 0
+    while not rx.done and now[0] < 10:
+        now[0] += 0.1
+        sent += len(rx.poll())
+    assert sent == bt.OPEN_RETRIES
+    assert not rx.ok and "没有回应" in rx.error
@@ -0,0 +1,107 @@
+"""session 会话文件的写入、打开与按时间切片"""
+import os
+import sys
+
+import numpy as np
+import pytest
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+
+import session
+
+META = {"pga": 128.0, "rate": 1280.0, "channel": 0, "unit": "mV", "vref": 5.0,
+        "calibration": {"slope": 1.01, "offset": -0.2}}
+
+
+def make_columns(n):
+    # 有重复时间戳：between 的边界按 start <= t < stop
+    t = np.repeat(np.arange((n + 1) // 2) / 640.0, 2)[:n]
+    value = np.sin(np.arange(n) / 50.0)
+    raw = np.arange(n, dtype=np.int32) - n // 2
+    flags = (np.arange(n) % 5).astype(np.uint8)
+    return t, value, raw, flags
+
+
+@pytest.fixture
+def written(tmp_path):
+    n = 3 * session.BLOCK + 123     # 跨好几个索引块，最后一块不满
+    cols = make_columns(n)
+    path = str(tmp_path / "s.cs1237s")
+    with session.SessionWriter(path, META) as w:
+        for lo in range(0, n, 1000):         # 分批追加，批次边界与块边界错开
+            w.append(*(c[lo:lo + 1000] for c in cols))
+    return path, cols
+
+
+def test_round_trip(written):
+    path, (t, value, raw, flags) = written
+    s = session.open(path)
+    assert len(s) == len(t)
+    assert s.columns == ["t", "value", "raw", "flags"]
+    assert s.rate == 1280.0 and s.pga == 128.0 and s.channel == 0
+    assert s.calibration == META["calibration"]
+    np.testing.assert_array_equal(s.t, t)
+    np.testing.assert_array_equal(s.value, value)
+    np.testing.assert_array_equal(s["raw"], raw)
+    np.testing.assert_array_equal(s["flags"], flags)
+    assert len(s.index) == -(-len(t) // session.BLOCK)
+
+
+def test_between_matches_mask(written):
+    path, (t, value, _, _) = written
+    s = session.open(path)
+    block_edge = t[session.BLOCK]
+    bounds = [(None, None), (None, 1.0), (1.0, None), (0.5, 0.5), (2.0, 1.0),
+              (block_edge, block_edge + 0.01), (t[0], t[-1]), (-1.0, 100.0), (t[-1], t[-1] + 1)]
+    for start, stop in bounds:
+        part = s.between(start, stop)
+        mask = np.ones(len(t), bool)
+        if start is not None:
+            mask &= t >= start
+        if stop is not None:
+            mask &= t < stop
+        np.testing.assert_array_equal(part.t, t[mask])
+        np.testing.assert_array_equal(part.value, value[mask])
+
+
+def test_between_of_a_slice(written):
+    path, (t, _, _, _) = written
+    part = session.open(path).between(1.0, 8.0).between(3.0, 5.0)
+    np.testing.assert_array_equal(part.t, t[(t >= 3.0) & (t < 5.0)])
+
+
+def test_open_without_trailer(written, tmp_path):
+    # 采集中断：没有块索引和文件尾，按长度截到整条记录
+    path, (t, _, _, _) = written
+    s = session.open(path)
+    end = s.records.offset + 2000 * s.records.dtype.itemsize + 7
+    cut = str(tmp_path / "cut.cs1237s")
+    with open(path, "rb") as src, open(cut, "wb") as dst:
+        dst.write(src.read(end))
+    c = session.open(cut)
+    np.testing.assert_array_equal(c.t, t[:2000])
+    np.testing.assert_array_equal(c.between(1.0, 2.0).t, t[:2000][(t[:2000] >= 1.0) & (t[:2000] < 2.0)])
+
+
+def test_write_omits_columns_not_recorded(tmp_path):
+    path = str(tmp_path / "curve.cs1237s")
+    session.write(path, {"unit": "mV"}, [0.0, 0.1, 0.2], [1.0, 2.0, 3.0])
+    s = session.open(path)
+    assert s.columns == ["t", "value"]
+    np.testing.assert_array_equal(s.value, [1.0, 2.0, 3.0])
+
+
+def test_empty_session(tmp_path):
+    path = str(tmp_path / "empty.cs1237s")
+    session.write(path, META, [], [], [], [])
+    s = session.open(path)
+    assert len(s) == 0 and len(s.between(0.0, 1.0)) == 0
+
+
+def test_time_must_not_decrease(tmp_path):
+    with session.SessionWriter(str(tmp_path / "bad.cs1237s"), META) as w:
+        w.append([0.0, 1.0], [0.0, 0.0])
+        with pytest.raises(ValueError):
+            w.append([0.5], [0.0])
+        with pytest.raises(ValueError):
+            w.append([2.0, 1.5], [0.0, 0.0])
@@ -0,0 +1,337 @@
+// 由 protocol/gen_proto.py 根据 protocol/schema.json 生成，请勿手工修改
+#include "cs1237_proto.hpp"
+#include "cs1237_proto.h"
+
+using namespace cs1237::proto;
+
+extern "C" uint16_t cs1237_cobs_wrap(const uint8_t* frame, uint16_t frame_len, uint8_t* out) {
+    return cobs_wrap(frame, frame_len, out);
+}
+
+extern "C" uint16_t cs1237_cobs_unwrap(const uint8_t* in, uint16_t n, uint8_t* frame, uint16_t cap) {
+    return cobs_unwrap(in, n, frame, cap);
+}
+
+extern "C" uint16_t cs1237_crc16(const uint8_t* p, uint16_t n) {
+    return crc16_ccitt(p, n);
+}
+
+extern "C" uint32_t cs1237_crc32(uint32_t crc, const uint8_t* p, uint32_t n) {
+    return crc32_update(crc, p, n);
+}
+
+extern "C" int cs1237_decode_adc_batch(const uint8_t* in, uint16_t n, cs1237_adc_batch_t* v, const uint8_t** payload) {
+    int len = AdcBatch::check(in, n);
+    if (len < 0) return -1;
+    v->seq = AdcBatch::seq::get(in);
+    v->bits = AdcBatch::bits::get(in);
+    v->count = AdcBatch::count::get(in);
+    *payload = in + AdcBatch::data_offset + AdcBatch::header_len;
+    return len;
+}
+
+extern "C" int cs1237_decode_bulk_data(const uint8_t* in, uint16_t n, cs1237_bulk_data_t* v, const uint8_t** payload) {
+    int len = BulkData::check(in, n);
+    if (len < 0) return -1;
+    v->xfer = BulkData::xfer::get(in);
+    v->block = BulkData::block::get(in);
+    v->crc = BulkData::crc::get(in);
+    *payload = in + BulkData::data_offset + BulkData::header_len;
+    return len;
+}
+
+extern "C" uint8_t cs1237_encode_voltage(uint8_t* out, const cs1237_voltage_t* v) {
+    Voltage::Values x;
+    x.voltage = v->voltage;
+    x.pga = v->pga;
+    return encode<Voltage>(out, x);
+}
+
+extern "C" int cs1237_decode_voltage(const uint8_t* in, cs1237_voltage_t* v) {
+    Voltage::Values x;
+    if (!decode<Voltage>(in, x)) return 0;
+    v->voltage = x.voltage;
+    v->pga = x.pga;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_adc_data(uint8_t* out, const cs1237_adc_data_t* v) {
+    AdcData::Values x;
+    x.pad = v->pad;
+    x.adc = v->adc;
+    return encode<AdcData>(out, x);
+}
+
+extern "C" int cs1237_decode_adc_data(const uint8_t* in, cs1237_adc_data_t* v) {
+    AdcData::Values x;
+    if (!decode<AdcData>(in, x)) return 0;
+    v->pad = x.pad;
+    v->adc = x.adc;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_error(uint8_t* out, const cs1237_error_t* v) {
+    Error::Values x;
+    x.code = v->code;
+    return encode<Error>(out, x);
+}
+
+extern "C" int cs1237_decode_error(const uint8_t* in, cs1237_error_t* v) {
+    Error::Values x;
+    if (!decode<Error>(in, x)) return 0;
+    v->code = x.code;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_status(uint8_t* out, const cs1237_status_t* v) {
+    Status::Values x;
+    x.pga = v->pga;
+    x.rate = v->rate;
+    x.channel = v->channel;
+    x.reads = v->reads;
+    return encode<Status>(out, x);
+}
+
+extern "C" int cs1237_decode_status(const uint8_t* in, cs1237_status_t* v) {
+    Status::Values x;
+    if (!decode<Status>(in, x)) return 0;
+    v->pga = x.pga;
+    v->rate = x.rate;
+    v->channel = x.channel;
+    v->reads = x.reads;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_status_query(uint8_t* out) {
+    StatusQuery::seal(out);
+    return StatusQuery::size;
+}
+
+extern "C" uint8_t cs1237_encode_hello(uint8_t* out, const cs1237_hello_t* v) {
+    Hello::Values x;
+    x.proto = v->proto;
+    x.device = v->device;
+    x.fw = v->fw;
+    x.caps = v->caps;
+    x.max_baud = v->max_baud;
+    x.batch_max = v->batch_max;
+    return encode<Hello>(out, x);
+}
+
+extern "C" int cs1237_decode_hello(const uint8_t* in, cs1237_hello_t* v) {
+    Hello::Values x;
+    if (!decode<Hello>(in, x)) return 0;
+    v->proto = x.proto;
+    v->device = x.device;
+    v->fw = x.fw;
+    v->caps = x.caps;
+    v->max_baud = x.max_baud;
+    v->batch_max = x.batch_max;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_hello_query(uint8_t* out) {
+    HelloQuery::seal(out);
+    return HelloQuery::size;
+}
+
+extern "C" uint8_t cs1237_encode_trace(uint8_t* out, const cs1237_trace_t* v) {
+    Trace::Values x;
+    x.id = v->id;
+    x.adc_us = v->adc_us;
+    x.tx_us = v->tx_us;
+    return encode<Trace>(out, x);
+}
+
+extern "C" int cs1237_decode_trace(const uint8_t* in, cs1237_trace_t* v) {
+    Trace::Values x;
+    if (!decode<Trace>(in, x)) return 0;
+    v->id = x.id;
+    v->adc_us = x.adc_us;
+    v->tx_us = x.tx_us;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_voltage_pga(uint8_t* out, const cs1237_voltage_pga_t* v) {
+    VoltagePga::Values x;
+    x.voltage = v->voltage;
+    x.pga = v->pga;
+    x.flags = v->flags;
+    return encode<VoltagePga>(out, x);
+}
+
+extern "C" int cs1237_decode_voltage_pga(const uint8_t* in, cs1237_voltage_pga_t* v) {
+    VoltagePga::Values x;
+    if (!decode<VoltagePga>(in, x)) return 0;
+    v->voltage = x.voltage;
+    v->pga = x.pga;
+    v->flags = x.flags;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_bulk_info(uint8_t* out, const cs1237_bulk_info_t* v) {
+    BulkInfo::Values x;
+    x.xfer = v->xfer;
+    x.format = v->format;
+    x.rate = v->rate;
+    x.pga = v->pga;
+    x.total = v->total;
+    x.blocks = v->blocks;
+    x.block_size = v->block_size;
+    x.window = v->window;
+    x.crc32 = v->crc32;
+    return encode<BulkInfo>(out, x);
+}
+
+extern "C" int cs1237_decode_bulk_info(const uint8_t* in, cs1237_bulk_info_t* v) {
+    BulkInfo::Values x;
+    if (!decode<BulkInfo>(in, x)) return 0;
+    v->xfer = x.xfer;
+    v->format = x.format;
+    v->rate = x.rate;
+    v->pga = x.pga;
+    v->total = x.total;
+    v->blocks = x.blocks;
+    v->block_size = x.block_size;
+    v->window = x.window;
+    v->crc32 = x.crc32;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_set_pga(uint8_t* out, const cs1237_set_pga_t* v) {
+    SetPga::Values x;
+    x.value = v->value;
+    return encode<SetPga>(out, x);
+}
+
+extern "C" int cs1237_decode_set_pga(const uint8_t* in, cs1237_set_pga_t* v) {
+    SetPga::Values x;
+    if (!decode<SetPga>(in, x)) return 0;
+    v->value = x.value;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_set_rate(uint8_t* out, const cs1237_set_rate_t* v) {
+    SetRate::Values x;
+    x.value = v->value;
+    return encode<SetRate>(out, x);
+}
+
+extern "C" int cs1237_decode_set_rate(const uint8_t* in, cs1237_set_rate_t* v) {
+    SetRate::Values x;
+    if (!decode<SetRate>(in, x)) return 0;
+    v->value = x.value;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_set_channel(uint8_t* out, const cs1237_set_channel_t* v) {
+    SetChannel::Values x;
+    x.value = v->value;
+    return encode<SetChannel>(out, x);
+}
+
+extern "C" int cs1237_decode_set_channel(const uint8_t* in, cs1237_set_channel_t* v) {
+    SetChannel::Values x;
+    if (!decode<SetChannel>(in, x)) return 0;
+    v->value = x.value;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_power_down(uint8_t* out, const cs1237_power_down_t* v) {
+    PowerDown::Values x;
+    x.value = v->value;
+    return encode<PowerDown>(out, x);
+}
+
+extern "C" int cs1237_decode_power_down(const uint8_t* in, cs1237_power_down_t* v) {
+    PowerDown::Values x;
+    if (!decode<PowerDown>(in, x)) return 0;
+    v->value = x.value;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_set_bits(uint8_t* out, const cs1237_set_bits_t* v) {
+    SetBits::Values x;
+    x.value = v->value;
+    return encode<SetBits>(out, x);
+}
+
+extern "C" int cs1237_decode_set_bits(const uint8_t* in, cs1237_set_bits_t* v) {
+    SetBits::Values x;
+    if (!decode<SetBits>(in, x)) return 0;
+    v->value = x.value;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_set_baud(uint8_t* out, const cs1237_set_baud_t* v) {
+    SetBaud::Values x;
+    x.value = v->value;
+    return encode<SetBaud>(out, x);
+}
+
+extern "C" int cs1237_decode_set_baud(const uint8_t* in, cs1237_set_baud_t* v) {
+    SetBaud::Values x;
+    if (!decode<SetBaud>(in, x)) return 0;
+    v->value = x.value;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_set_framing(uint8_t* out, const cs1237_set_framing_t* v) {
+    SetFraming::Values x;
+    x.value = v->value;
+    return encode<SetFraming>(out, x);
+}
+
+extern "C" int cs1237_decode_set_framing(const uint8_t* in, cs1237_set_framing_t* v) {
+    SetFraming::Values x;
+    if (!decode<SetFraming>(in, x)) return 0;
+    v->value = x.value;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_bulk_open(uint8_t* out, const cs1237_bulk_open_t* v) {
+    BulkOpen::Values x;
+    x.source = v->source;
+    x.count = v->count;
+    return encode<BulkOpen>(out, x);
+}
+
+extern "C" int cs1237_decode_bulk_open(const uint8_t* in, cs1237_bulk_open_t* v) {
+    BulkOpen::Values x;
+    if (!decode<BulkOpen>(in, x)) return 0;
+    v->source = x.source;
+    v->count = x.count;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_bulk_ack(uint8_t* out, const cs1237_bulk_ack_t* v) {
+    BulkAck::Values x;
+    x.xfer = v->xfer;
+    x.base = v->base;
+    x.missing = v->missing;
+    return encode<BulkAck>(out, x);
+}
+
+extern "C" int cs1237_decode_bulk_ack(const uint8_t* in, cs1237_bulk_ack_t* v) {
+    BulkAck::Values x;
+    if (!decode<BulkAck>(in, x)) return 0;
+    v->xfer = x.xfer;
+    v->base = x.base;
+    v->missing = x.missing;
+    return 1;
+}
+
+extern "C" uint8_t cs1237_encode_config_ack(uint8_t* out, const cs1237_config_ack_t* v) {
+    ConfigAck::Values x;
+    x.type = v->type;
+    x.value = v->value;
+    return encode<ConfigAck>(out, x);
+}
+
+extern "C" int cs1237_decode_config_ack(const uint8_t* in, cs1237_config_ack_t* v) {
+    ConfigAck::Values x;
+    if (!decode<ConfigAck>(in, x)) return 0;
+    v->type = x.type;
+    v->value = x.value;
+    return 1;
+}
@@ -0,0 +1,306 @@
+/* 由 protocol/gen_proto.py 根据 protocol/schema.json 生成，请勿手工修改 */
+/* C ABI：ESP32 等 C 代码通过这些函数使用 cs1237_proto.hpp 中的帧模板 */
+#ifndef CS1237_PROTO_H
+#define CS1237_PROTO_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 常量加 CS1237_ 前缀，避免与 cs1237_proto_defs.h 的同名宏冲突 */
+#define CS1237_CMD_ADC_DATA 0x01
+#define CS1237_CMD_ERROR 0x03
+#define CS1237_CMD_STATUS 0x04
+#define CS1237_CMD_ADC_BATCH 0x05
+#define CS1237_CMD_HELLO 0x06
+#define CS1237_CMD_TRACE 0x07
+#define CS1237_CMD_VOLTAGE_PGA 0x08
+#define CS1237_CMD_BULK_INFO 0x09
+#define CS1237_CMD_BULK_DATA 0x0A
+#define CS1237_CMD_SET_PGA 0xA1
+#define CS1237_CMD_SET_RATE 0xA2
+#define CS1237_CMD_SET_CHANNEL 0xA3
+#define CS1237_CMD_POWER_DOWN 0xA4
+#define CS1237_CMD_SET_BITS 0xA5
+#define CS1237_CMD_SET_BAUD 0xA6
+#define CS1237_CMD_SET_FRAMING 0xA7
+#define CS1237_CMD_BULK_OPEN 0xA8
+#define CS1237_CMD_BULK_ACK 0xA9
+#define CS1237_CMD_CONFIG_ACK 0xB1
+#define CS1237_ERR_SPI_READ 0x01
+#define CS1237_ERR_DATA_INVALID 0x02
+#define CS1237_ERR_TIMEOUT 0x03
+#define CS1237_ERR_TEMP_PGA 0x04
+#define CS1237_PROTO_VERSION 1
+#define CS1237_DEV_UNO 0x01
+#define CS1237_DEV_STM32 0x02
+#define CS1237_DEV_STC8 0x03
+#define CS1237_DEV_STC15 0x04
+#define CS1237_CAP_VOLTAGE 0x0001
+#define CS1237_CAP_ADC_DATA 0x0002
+#define CS1237_CAP_ADC_BATCH 0x0004
+#define CS1237_CAP_STATUS 0x0008
+#define CS1237_CAP_CONFIG 0x0010
+#define CS1237_CAP_SET_BITS 0x0020
+#define CS1237_CAP_SET_BAUD 0x0040
+#define CS1237_CAP_TIMESTAMP 0x0080
+#define CS1237_CAP_TEXT 0x0100
+#define CS1237_CAP_COBS 0x0200
+#define CS1237_CAP_FLAGS 0x0400
+#define CS1237_CAP_BULK 0x0800
+#define CS1237_FRAMING_AA55 0x00
+#define CS1237_FRAMING_COBS 0x01
+#define CS1237_BULK_SRC_HISTORY 0x00
+#define CS1237_BULK_SRC_CAPTURE 0x01
+#define CS1237_BULK_SRC_RESEND 0x02
+#define CS1237_BULK_FMT_S24 0x00
+#define CS1237_QFLAG_SATURATED 0x01
+#define CS1237_QFLAG_SETTLING 0x02
+#define CS1237_QFLAG_DRDY_TIMEOUT 0x04
+#define CS1237_QFLAG_SPI_GLITCH 0x08
+#define CS1237_QFLAG_DECIMATED 0x10
+#define CS1237_QFLAG_BAD 0x0B
+#define CS1237_BAUD_9600 0
+#define CS1237_BAUD_19200 1
+#define CS1237_BAUD_38400 2
+#define CS1237_BAUD_57600 3
+#define CS1237_BAUD_115200 4
+#define CS1237_BAUD_230400 5
+#define CS1237_BAUD_460800 6
+#define CS1237_BAUD_921600 7
+#define CS1237_BAUD_COUNT 8
+#define CS1237_BAUD_RATES_INIT {9600UL, 19200UL, 38400UL, 57600UL, 115200UL, 230400UL, 460800UL, 921600UL}
+
+/* 上位机查询帧（不带数据）的长度 */
+#define CS1237_QUERY_FRAME_SIZE 7
+
+/* COBS 帧格式 00 [COBS(长度..校验)] 00：命令帧长 -> 包长 */
+#define CS1237_COBS_SIZE(frame_len) ((frame_len) - 4 + ((frame_len) - 4) / 254 + 3)
+/* 完整命令帧 -> COBS 包（含前后两个 0x00），返回包长 */
+uint16_t cs1237_cobs_wrap(const uint8_t *frame, uint16_t frame_len, uint8_t *out);
+/* 两个 0x00 之间的 n 个字节 -> 完整命令帧（容量 cap），长度与校验都对才返回帧长，否则返回 0 */
+uint16_t cs1237_cobs_unwrap(const uint8_t *in, uint16_t n, uint8_t *frame, uint16_t cap);
+
+/* 快照数据块的 CRC-16/CCITT（初值 0xFFFF）、整个快照的 CRC-32（分段累加，首段 crc 传 0） */
+uint16_t cs1237_crc16(const uint8_t *p, uint16_t n);
+uint32_t cs1237_crc32(uint32_t crc, const uint8_t *p, uint32_t n);
+
+#define CS1237_ADC_BATCH_HEADER_SIZE 4
+typedef struct {
+    uint16_t seq;
+    uint8_t bits;
+    uint8_t count;
+} cs1237_adc_batch_t;
+/* 批量ADC值：固定头之后为按位宽紧密排列的样本；
+ * in 为 n 字节的完整帧，校验通过返回数据区长度并填写固定头 v、*payload 指向固定头之后，否则返回 -1 */
+int cs1237_decode_adc_batch(const uint8_t *in, uint16_t n, cs1237_adc_batch_t *v, const uint8_t **payload);
+
+#define CS1237_BULK_DATA_HEADER_SIZE 5
+typedef struct {
+    uint8_t xfer;
+    uint16_t block;
+    uint16_t crc;
+} cs1237_bulk_data_t;
+/* 快照数据块：固定头之后为第 block 块的数据（末块可能较短），crc 为数据的 CRC-16/CCITT；
+ * in 为 n 字节的完整帧，校验通过返回数据区长度并填写固定头 v、*payload 指向固定头之后，否则返回 -1 */
+int cs1237_decode_bulk_data(const uint8_t *in, uint16_t n, cs1237_bulk_data_t *v, const uint8_t **payload);
+
+#define CS1237_VOLTAGE_FRAME_SIZE 10
+typedef struct {
+    float voltage;
+    uint16_t pga;
+} cs1237_voltage_t;
+/* 电压帧（UNO 11.18 起的连续输出）：帧头 + 电压 + PGA + 帧尾，无长度/命令/校验；out 至少 CS1237_VOLTAGE_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_voltage(uint8_t *out, const cs1237_voltage_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_voltage(const uint8_t *in, cs1237_voltage_t *v);
+
+#define CS1237_ADC_DATA_FRAME_SIZE 11
+typedef struct {
+    uint8_t pad;
+    int32_t adc;
+} cs1237_adc_data_t;
+/* 单个ADC值，首字节补 0；out 至少 CS1237_ADC_DATA_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_adc_data(uint8_t *out, const cs1237_adc_data_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_adc_data(const uint8_t *in, cs1237_adc_data_t *v);
+
+#define CS1237_ERROR_FRAME_SIZE 8
+typedef struct {
+    uint8_t code;
+} cs1237_error_t;
+/* 错误报告；out 至少 CS1237_ERROR_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_error(uint8_t *out, const cs1237_error_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_error(const uint8_t *in, cs1237_error_t *v);
+
+#define CS1237_STATUS_FRAME_SIZE 14
+typedef struct {
+    uint8_t pga;
+    uint8_t rate;
+    uint8_t channel;
+    uint32_t reads;
+} cs1237_status_t;
+/* 状态信息；上位机发不带数据的 0x04 帧查询；out 至少 CS1237_STATUS_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_status(uint8_t *out, const cs1237_status_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_status(const uint8_t *in, cs1237_status_t *v);
+/* 查询帧，out 至少 CS1237_QUERY_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_status_query(uint8_t *out);
+
+#define CS1237_HELLO_FRAME_SIZE 15
+typedef struct {
+    uint8_t proto;
+    uint8_t device;
+    uint16_t fw;
+    uint16_t caps;
+    uint8_t max_baud;
+    uint8_t batch_max;
+} cs1237_hello_t;
+/* 握手/能力帧：上电时和收到不带数据的 0x06 查询时发送；out 至少 CS1237_HELLO_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_hello(uint8_t *out, const cs1237_hello_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_hello(const uint8_t *in, cs1237_hello_t *v);
+/* 查询帧，out 至少 CS1237_QUERY_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_hello_query(uint8_t *out);
+
+#define CS1237_TRACE_FRAME_SIZE 17
+typedef struct {
+    uint16_t id;
+    uint32_t adc_us;
+    uint32_t tx_us;
+} cs1237_trace_t;
+/* 追踪帧：紧接其后的电压帧的追踪号，以及该样本读出和开始发送时的下位机时间（微秒）；out 至少 CS1237_TRACE_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_trace(uint8_t *out, const cs1237_trace_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_trace(const uint8_t *in, cs1237_trace_t *v);
+
+#define CS1237_VOLTAGE_PGA_FRAME_SIZE 14
+typedef struct {
+    float voltage;
+    uint16_t pga;
+    uint8_t flags;
+} cs1237_voltage_pga_t;
+/* 电压帧的命令帧形式：COBS 帧格式下代替电压帧，电压和 PGA 与电压帧相同，另带样本质量标志 QFLAG_*；out 至少 CS1237_VOLTAGE_PGA_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_voltage_pga(uint8_t *out, const cs1237_voltage_pga_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_voltage_pga(const uint8_t *in, cs1237_voltage_pga_t *v);
+
+#define CS1237_BULK_INFO_FRAME_SIZE 23
+typedef struct {
+    uint8_t xfer;
+    uint8_t format;
+    uint8_t rate;
+    uint8_t pga;
+    uint32_t total;
+    uint16_t blocks;
+    uint8_t block_size;
+    uint8_t window;
+    uint32_t crc32;
+} cs1237_bulk_info_t;
+/* 快照传输开始：传输号、数据格式 BULK_FMT_*、采集时的速率/PGA 编码、总字节数、块数、块长、窗口块数、整个快照的 CRC-32；out 至少 CS1237_BULK_INFO_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_bulk_info(uint8_t *out, const cs1237_bulk_info_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_bulk_info(const uint8_t *in, cs1237_bulk_info_t *v);
+
+#define CS1237_SET_PGA_FRAME_SIZE 8
+typedef struct {
+    uint8_t value;
+} cs1237_set_pga_t;
+/* 设置PGA：0=1倍, 1=2倍, 2=64倍, 3=128倍；out 至少 CS1237_SET_PGA_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_set_pga(uint8_t *out, const cs1237_set_pga_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_set_pga(const uint8_t *in, cs1237_set_pga_t *v);
+
+#define CS1237_SET_RATE_FRAME_SIZE 8
+typedef struct {
+    uint8_t value;
+} cs1237_set_rate_t;
+/* 设置输出速率：0=10Hz, 1=40Hz, 2=640Hz, 3=1280Hz；out 至少 CS1237_SET_RATE_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_set_rate(uint8_t *out, const cs1237_set_rate_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_set_rate(const uint8_t *in, cs1237_set_rate_t *v);
+
+#define CS1237_SET_CHANNEL_FRAME_SIZE 8
+typedef struct {
+    uint8_t value;
+} cs1237_set_channel_t;
+/* 设置通道：0=A, 1=保留, 2=温度, 3=内短；out 至少 CS1237_SET_CHANNEL_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_set_channel(uint8_t *out, const cs1237_set_channel_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_set_channel(const uint8_t *in, cs1237_set_channel_t *v);
+
+#define CS1237_POWER_DOWN_FRAME_SIZE 8
+typedef struct {
+    uint8_t value;
+} cs1237_power_down_t;
+/* 电源状态：1=进入省电, 0=退出（UNO 只在确认帧中使用）；out 至少 CS1237_POWER_DOWN_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_power_down(uint8_t *out, const cs1237_power_down_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_power_down(const uint8_t *in, cs1237_power_down_t *v);
+
+#define CS1237_SET_BITS_FRAME_SIZE 8
+typedef struct {
+    uint8_t value;
+} cs1237_set_bits_t;
+/* 批量帧样本位宽：bit4-0 位宽，bit7-6 量化方式；out 至少 CS1237_SET_BITS_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_set_bits(uint8_t *out, const cs1237_set_bits_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_set_bits(const uint8_t *in, cs1237_set_bits_t *v);
+
+#define CS1237_SET_BAUD_FRAME_SIZE 8
+typedef struct {
+    uint8_t value;
+} cs1237_set_baud_t;
+/* 切换波特率：BAUD_* 编码；下位机按原波特率回确认帧后切换，上位机收到确认再切换；out 至少 CS1237_SET_BAUD_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_set_baud(uint8_t *out, const cs1237_set_baud_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_set_baud(const uint8_t *in, cs1237_set_baud_t *v);
+
+#define CS1237_SET_FRAMING_FRAME_SIZE 8
+typedef struct {
+    uint8_t value;
+} cs1237_set_framing_t;
+/* 切换下位机发出的帧格式：FRAMING_*；按原格式回确认帧后切换，上位机发出的命令始终是 AA 55 帧；out 至少 CS1237_SET_FRAMING_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_set_framing(uint8_t *out, const cs1237_set_framing_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_set_framing(const uint8_t *in, cs1237_set_framing_t *v);
+
+#define CS1237_BULK_OPEN_FRAME_SIZE 10
+typedef struct {
+    uint8_t source;
+    uint16_t count;
+} cs1237_bulk_open_t;
+/* 冻结/采集快照并开始传输：BULK_SRC_*，样本数（0 = 缓冲容量）；下位机回 0x09 后按窗口发数据块；out 至少 CS1237_BULK_OPEN_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_bulk_open(uint8_t *out, const cs1237_bulk_open_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_bulk_open(const uint8_t *in, cs1237_bulk_open_t *v);
+
+#define CS1237_BULK_ACK_FRAME_SIZE 14
+typedef struct {
+    uint8_t xfer;
+    uint16_t base;
+    uint32_t missing;
+} cs1237_bulk_ack_t;
+/* 快照传输确认：base 之前的块都已收到，missing 的第 i 位表示第 base+i 块丢失需重发；base 等于块数即传输结束；out 至少 CS1237_BULK_ACK_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_bulk_ack(uint8_t *out, const cs1237_bulk_ack_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_bulk_ack(const uint8_t *in, cs1237_bulk_ack_t *v);
+
+#define CS1237_CONFIG_ACK_FRAME_SIZE 9
+typedef struct {
+    uint8_t type;
+    uint8_t value;
+} cs1237_config_ack_t;
+/* 配置确认：配置命令码 + 生效的值；out 至少 CS1237_CONFIG_ACK_FRAME_SIZE 字节，返回帧长 */
+uint8_t cs1237_encode_config_ack(uint8_t *out, const cs1237_config_ack_t *v);
+/* 校验通过返回 1 并填写 v，否则返回 0 */
+int cs1237_decode_config_ack(const uint8_t *in, cs1237_config_ack_t *v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,375 @@
+"""
+CS1237 串口协议定义（由 protocol/gen_proto.py 根据 protocol/schema.json 生成，请勿手工修改）
+"""
+import binascii
+import zlib
+
+import numpy as np
+
+FRAME_HEAD_1 = 0xAA
+FRAME_HEAD_2 = 0x55
+FRAME_TAIL_1 = 0x0D
+FRAME_TAIL_2 = 0x0A
+FRAME_HEAD = bytes([FRAME_HEAD_1, FRAME_HEAD_2])
+FRAME_TAIL = bytes([FRAME_TAIL_1, FRAME_TAIL_2])
+MAX_FRAME_LEN = 7 + 254  # 长度字段 1 字节，含命令最多 255
+
+CMD_ADC_DATA = 0x01  # 单个ADC值，首字节补 0
+CMD_ERROR = 0x03  # 错误报告
+CMD_STATUS = 0x04  # 状态信息；上位机发不带数据的 0x04 帧查询
+CMD_ADC_BATCH = 0x05  # 批量ADC值：固定头之后为按位宽紧密排列的样本
+CMD_HELLO = 0x06  # 握手/能力帧：上电时和收到不带数据的 0x06 查询时发送
+CMD_TRACE = 0x07  # 追踪帧：紧接其后的电压帧的追踪号，以及该样本读出和开始发送时的下位机时间（微秒）
+CMD_VOLTAGE_PGA = 0x08  # 电压帧的命令帧形式：COBS 帧格式下代替电压帧，电压和 PGA 与电压帧相同，另带样本质量标志 QFLAG_*
+CMD_BULK_INFO = 0x09  # 快照传输开始：传输号、数据格式 BULK_FMT_*、采集时的速率/PGA 编码、总字节数、块数、块长、窗口块数、整个快照的 CRC-32
+CMD_BULK_DATA = 0x0A  # 快照数据块：固定头之后为第 block 块的数据（末块可能较短），crc 为数据的 CRC-16/CCITT
+CMD_SET_PGA = 0xA1  # 设置PGA：0=1倍, 1=2倍, 2=64倍, 3=128倍
+CMD_SET_RATE = 0xA2  # 设置输出速率：0=10Hz, 1=40Hz, 2=640Hz, 3=1280Hz
+CMD_SET_CHANNEL = 0xA3  # 设置通道：0=A, 1=保留, 2=温度, 3=内短
+CMD_POWER_DOWN = 0xA4  # 电源状态：1=进入省电, 0=退出（UNO 只在确认帧中使用）
+CMD_SET_BITS = 0xA5  # 批量帧样本位宽：bit4-0 位宽，bit7-6 量化方式
+CMD_SET_BAUD = 0xA6  # 切换波特率：BAUD_* 编码；下位机按原波特率回确认帧后切换，上位机收到确认再切换
+CMD_SET_FRAMING = 0xA7  # 切换下位机发出的帧格式：FRAMING_*；按原格式回确认帧后切换，上位机发出的命令始终是 AA 55 帧
+CMD_BULK_OPEN = 0xA8  # 冻结/采集快照并开始传输：BULK_SRC_*，样本数（0 = 缓冲容量）；下位机回 0x09 后按窗口发数据块
+CMD_BULK_ACK = 0xA9  # 快照传输确认：base 之前的块都已收到，missing 的第 i 位表示第 base+i 块丢失需重发；base 等于块数即传输结束
+CMD_CONFIG_ACK = 0xB1  # 配置确认：配置命令码 + 生效的值
+
+ERR_SPI_READ = 0x01
+ERR_DATA_INVALID = 0x02
+ERR_TIMEOUT = 0x03
+ERR_TEMP_PGA = 0x04
+ERROR_TEXT = {
+    ERR_SPI_READ: "读取失败（数据未就绪）",
+    ERR_DATA_INVALID: "数据或参数无效",
+    ERR_TIMEOUT: "等待芯片超时",
+    ERR_TEMP_PGA: "测温模式需设置PGA=1",
+}
+
+PROTO_VERSION = 1
+
+# 握手帧 device：设备类型
+DEV_UNO = 0x01
+DEV_STM32 = 0x02
+DEV_STC8 = 0x03
+DEV_STC15 = 0x04
+DEV_TEXT = {
+    DEV_UNO: "Arduino UNO（11.18gai）",
+    DEV_STM32: "STM32F103 例程",
+    DEV_STC8: "STC8X 例程",
+    DEV_STC15: "STC15W 例程",
+}
+DEV_NAMES = {
+    DEV_UNO: "UNO",
+    DEV_STM32: "STM32",
+    DEV_STC8: "STC8",
+    DEV_STC15: "STC15",
+}
+
+# 握手帧 caps：支持的帧与功能
+CAP_VOLTAGE = 0x0001
+CAP_ADC_DATA = 0x0002
+CAP_ADC_BATCH = 0x0004
+CAP_STATUS = 0x0008
+CAP_CONFIG = 0x0010
+CAP_SET_BITS = 0x0020
+CAP_SET_BAUD = 0x0040
+CAP_TIMESTAMP = 0x0080
+CAP_TEXT = 0x0100
+CAP_COBS = 0x0200
+CAP_FLAGS = 0x0400
+CAP_BULK = 0x0800
+CAP_NAMES = {
+    CAP_VOLTAGE: "VOLTAGE",
+    CAP_ADC_DATA: "ADC_DATA",
+    CAP_ADC_BATCH: "ADC_BATCH",
+    CAP_STATUS: "STATUS",
+    CAP_CONFIG: "CONFIG",
+    CAP_SET_BITS: "SET_BITS",
+    CAP_SET_BAUD: "SET_BAUD",
+    CAP_TIMESTAMP: "TIMESTAMP",
+    CAP_TEXT: "TEXT",
+    CAP_COBS: "COBS",
+    CAP_FLAGS: "FLAGS",
+    CAP_BULK: "BULK",
+}
+
+# SET_FRAMING 的值：下位机发出的帧格式
+FRAMING_AA55 = 0x00
+FRAMING_COBS = 0x01
+FRAMING_TEXT = {
+    FRAMING_AA55: "AA 55 帧头 + 0D 0A 帧尾（上电默认）",
+    FRAMING_COBS: "00 + COBS(长度..校验) + 00，0x00 是唯一的分隔符",
+}
+FRAMING_NAMES = {
+    FRAMING_AA55: "AA55",
+    FRAMING_COBS: "COBS",
+}
+
+# BULK_OPEN 的 source：快照来源
+BULK_SRC_HISTORY = 0x00
+BULK_SRC_CAPTURE = 0x01
+BULK_SRC_RESEND = 0x02
+BULK_SRC_TEXT = {
+    BULK_SRC_HISTORY: "冻结最近 count 个样本（空闲时下位机一直循环记录）",
+    BULK_SRC_CAPTURE: "采集接下来的 count 个样本后冻结",
+    BULK_SRC_RESEND: "不重新取样，重发 0x09 并从头传当前快照（上位机没收到 0x09 时用）",
+}
+BULK_SRC_NAMES = {
+    BULK_SRC_HISTORY: "HISTORY",
+    BULK_SRC_CAPTURE: "CAPTURE",
+    BULK_SRC_RESEND: "RESEND",
+}
+
+# BULK_INFO 的 format：快照数据格式
+BULK_FMT_S24 = 0x00
+BULK_FMT_TEXT = {
+    BULK_FMT_S24: "每个样本 3 字节大端有符号码值，按时间顺序紧密排列",
+}
+BULK_FMT_NAMES = {
+    BULK_FMT_S24: "S24",
+}
+
+# 0x08 电压帧 flags：样本质量标志，由下位机在读出时判定
+QFLAG_SATURATED = 0x01
+QFLAG_SETTLING = 0x02
+QFLAG_DRDY_TIMEOUT = 0x04
+QFLAG_SPI_GLITCH = 0x08
+QFLAG_DECIMATED = 0x10
+QFLAG_BAD = 0x0B
+QFLAG_TEXT = {
+    QFLAG_SATURATED: "码值到达满量程（0x7FFFFF / 0x800000），输入超出量程",
+    QFLAG_SETTLING: "配置或退出省电后的建立期，数字滤波器尚未稳定",
+    QFLAG_DRDY_TIMEOUT: "此前等待 DRDY 超时，与上一个样本之间有缺口",
+    QFLAG_SPI_GLITCH: "开始移位时 DOUT 已不为低，读出的位可能错位（0xFFF??? 类异常值）",
+    QFLAG_DECIMATED: "与上一个样本之间漏读了读数节拍上的样本（缓冲满、测温等）",
+    QFLAG_BAD: "样本值不可用的标志组合（饱和、建立期、移位异常），下游按位测试跳过",
+}
+QFLAG_NAMES = {
+    QFLAG_SATURATED: "SATURATED",
+    QFLAG_SETTLING: "SETTLING",
+    QFLAG_DRDY_TIMEOUT: "DRDY_TIMEOUT",
+    QFLAG_SPI_GLITCH: "SPI_GLITCH",
+    QFLAG_DECIMATED: "DECIMATED",
+    QFLAG_BAD: "BAD",
+}
+
+# 波特率编码（握手帧 max_baud、SET_BAUD 的值）即 BAUD_RATES 下标
+BAUD_9600 = 0
+BAUD_19200 = 1
+BAUD_38400 = 2
+BAUD_57600 = 3
+BAUD_115200 = 4
+BAUD_230400 = 5
+BAUD_460800 = 6
+BAUD_921600 = 7
+BAUD_RATES = (9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600)
+
+BATCH_BITS = (24, 20, 18, 16)
+
+# <名称>_FIELDS: 数据区 dtype（不含帧头/长度/命令/校验/帧尾）
+# <名称>_FRAME:  整帧 dtype，可直接 np.frombuffer 批量解析
+VOLTAGE_FIELDS = np.dtype([('voltage', '<f4'), ('pga', '<u2')])
+VOLTAGE_FRAME = np.dtype([('head', 'u1', (2,)), ('voltage', '<f4'), ('pga', '<u2'), ('tail', 'u1', (2,))])
+VOLTAGE_FRAME_LEN = 10
+ADC_DATA_FIELDS = np.dtype([('pad', 'u1'), ('adc', 'u1', (3,))])
+ADC_DATA_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('pad', 'u1'), ('adc', 'u1', (3,)), ('sum', 'u1'), ('tail', 'u1', (2,))])
+ADC_DATA_FRAME_LEN = 11
+ERROR_FIELDS = np.dtype([('code', 'u1')])
+ERROR_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('code', 'u1'), ('sum', 'u1'), ('tail', 'u1', (2,))])
+ERROR_FRAME_LEN = 8
+STATUS_FIELDS = np.dtype([('pga', 'u1'), ('rate', 'u1'), ('channel', 'u1'), ('reads', '>u4')])
+STATUS_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('pga', 'u1'), ('rate', 'u1'), ('channel', 'u1'), ('reads', '>u4'), ('sum', 'u1'), ('tail', 'u1', (2,))])
+STATUS_FRAME_LEN = 14
+ADC_BATCH_FIELDS = np.dtype([('seq', '>u2'), ('bits', 'u1'), ('count', 'u1')])
+HELLO_FIELDS = np.dtype([('proto', 'u1'), ('device', 'u1'), ('fw', '>u2'), ('caps', '>u2'), ('max_baud', 'u1'), ('batch_max', 'u1')])
+HELLO_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('proto', 'u1'), ('device', 'u1'), ('fw', '>u2'), ('caps', '>u2'), ('max_baud', 'u1'), ('batch_max', 'u1'), ('sum', 'u1'), ('tail', 'u1', (2,))])
+HELLO_FRAME_LEN = 15
+TRACE_FIELDS = np.dtype([('id', '>u2'), ('adc_us', '>u4'), ('tx_us', '>u4')])
+TRACE_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('id', '>u2'), ('adc_us', '>u4'), ('tx_us', '>u4'), ('sum', 'u1'), ('tail', 'u1', (2,))])
+TRACE_FRAME_LEN = 17
+VOLTAGE_PGA_FIELDS = np.dtype([('voltage', '<f4'), ('pga', '<u2'), ('flags', 'u1')])
+VOLTAGE_PGA_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('voltage', '<f4'), ('pga', '<u2'), ('flags', 'u1'), ('sum', 'u1'), ('tail', 'u1', (2,))])
+VOLTAGE_PGA_FRAME_LEN = 14
+BULK_INFO_FIELDS = np.dtype([('xfer', 'u1'), ('format', 'u1'), ('rate', 'u1'), ('pga', 'u1'), ('total', '>u4'), ('blocks', '>u2'), ('block_size', 'u1'), ('window', 'u1'), ('crc32', '>u4')])
+BULK_INFO_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('xfer', 'u1'), ('format', 'u1'), ('rate', 'u1'), ('pga', 'u1'), ('total', '>u4'), ('blocks', '>u2'), ('block_size', 'u1'), ('window', 'u1'), ('crc32', '>u4'), ('sum', 'u1'), ('tail', 'u1', (2,))])
+BULK_INFO_FRAME_LEN = 23
+BULK_DATA_FIELDS = np.dtype([('xfer', 'u1'), ('block', '>u2'), ('crc', '>u2')])
+SET_PGA_FIELDS = np.dtype([('value', 'u1')])
+SET_PGA_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('value', 'u1'), ('sum', 'u1'), ('tail', 'u1', (2,))])
+SET_PGA_FRAME_LEN = 8
+SET_RATE_FIELDS = np.dtype([('value', 'u1')])
+SET_RATE_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('value', 'u1'), ('sum', 'u1'), ('tail', 'u1', (2,))])
+SET_RATE_FRAME_LEN = 8
+SET_CHANNEL_FIELDS = np.dtype([('value', 'u1')])
+SET_CHANNEL_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('value', 'u1'), ('sum', 'u1'), ('tail', 'u1', (2,))])
+SET_CHANNEL_FRAME_LEN = 8
+POWER_DOWN_FIELDS = np.dtype([('value', 'u1')])
+POWER_DOWN_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('value', 'u1'), ('sum', 'u1'), ('tail', 'u1', (2,))])
+POWER_DOWN_FRAME_LEN = 8
+SET_BITS_FIELDS = np.dtype([('value', 'u1')])
+SET_BITS_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('value', 'u1'), ('sum', 'u1'), ('tail', 'u1', (2,))])
+SET_BITS_FRAME_LEN = 8
+SET_BAUD_FIELDS = np.dtype([('value', 'u1')])
+SET_BAUD_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('value', 'u1'), ('sum', 'u1'), ('tail', 'u1', (2,))])
+SET_BAUD_FRAME_LEN = 8
+SET_FRAMING_FIELDS = np.dtype([('value', 'u1')])
+SET_FRAMING_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('value', 'u1'), ('sum', 'u1'), ('tail', 'u1', (2,))])
+SET_FRAMING_FRAME_LEN = 8
+BULK_OPEN_FIELDS = np.dtype([('source', 'u1'), ('count', '>u2')])
+BULK_OPEN_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('source', 'u1'), ('count', '>u2'), ('sum', 'u1'), ('tail', 'u1', (2,))])
+BULK_OPEN_FRAME_LEN = 10
+BULK_ACK_FIELDS = np.dtype([('xfer', 'u1'), ('base', '>u2'), ('missing', '>u4')])
+BULK_ACK_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('xfer', 'u1'), ('base', '>u2'), ('missing', '>u4'), ('sum', 'u1'), ('tail', 'u1', (2,))])
+BULK_ACK_FRAME_LEN = 14
+CONFIG_ACK_FIELDS = np.dtype([('type', 'u1'), ('value', 'u1')])
+CONFIG_ACK_FRAME = np.dtype([('head', 'u1', (2,)), ('len', 'u1'), ('cmd', 'u1'), ('type', 'u1'), ('value', 'u1'), ('sum', 'u1'), ('tail', 'u1', (2,))])
+CONFIG_ACK_FRAME_LEN = 9
+
+# 定长命令帧的数据区长度（变长帧不在表中）
+DATA_LEN = {
+    CMD_ADC_DATA: 4,
+    CMD_ERROR: 1,
+    CMD_STATUS: 7,
+    CMD_HELLO: 8,
+    CMD_TRACE: 10,
+    CMD_VOLTAGE_PGA: 7,
+    CMD_BULK_INFO: 16,
+    CMD_SET_PGA: 1,
+    CMD_SET_RATE: 1,
+    CMD_SET_CHANNEL: 1,
+    CMD_POWER_DOWN: 1,
+    CMD_SET_BITS: 1,
+    CMD_SET_BAUD: 1,
+    CMD_SET_FRAMING: 1,
+    CMD_BULK_OPEN: 3,
+    CMD_BULK_ACK: 7,
+    CMD_CONFIG_ACK: 2,
+}
+
+def checksum(body):
+    """长度..数据 逐字节异或"""
+    s = 0
+    for b in body:
+        s ^= b
+    return s
+
+
+def encode_frame(cmd, data=b""):
+    """组命令帧: AA 55 [长度] [命令] [数据] [XOR] 0D 0A"""
+    body = bytes([len(data) + 1, cmd]) + bytes(data)
+    return FRAME_HEAD + body + bytes([checksum(body)]) + FRAME_TAIL
+
+
+def cobs_encode(data):
+    """COBS 编码（不含分隔符）"""
+    out = bytearray([0])
+    code_pos, code = 0, 1
+    for b in data:
+        if b == 0:
+            out[code_pos] = code
+            code_pos, code = len(out), 1
+            out.append(0)
+        else:
+            out.append(b)
+            code += 1
+            if code == 0xFF:
+                out[code_pos] = code
+                code_pos, code = len(out), 1
+                out.append(0)
+    out[code_pos] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    """COBS 解码（输入不含分隔符），格式错误时抛出 ValueError"""
+    out = bytearray()
+    i, n = 0, len(data)
+    while i < n:
+        code = data[i]
+        block = data[i + 1:i + code]
+        if code == 0 or len(block) != code - 1 or 0 in block:
+            raise ValueError("COBS 编码错误")
+        out += block
+        i += code
+        if code < 0xFF and i < n:
+            out.append(0)
+    return bytes(out)
+
+
+def wrap_cobs(frame):
+    """完整命令帧 -> COBS 包 00 [COBS(长度..校验)] 00"""
+    return b"\x00" + cobs_encode(frame[2:-2]) + b"\x00"
+
+
+def unwrap_cobs(packet):
+    """两个 0x00 之间的字节 -> 完整命令帧，长度或校验不对时抛出 ValueError"""
+    body = cobs_decode(packet)
+    if len(body) < 3 or body[0] != len(body) - 2:
+        raise ValueError(f"COBS 包长度不符: {len(body)}")
+    if checksum(body) != 0:
+        raise ValueError("COBS 包校验错误")
+    return FRAME_HEAD + body + FRAME_TAIL
+
+
+def bit_names(value, names):
+    """位组合 -> 各个置位的名称（names 为 <前缀>_NAMES，多位的组合项不单列）"""
+    return [name for bit, name in names.items() if bit and bit & (bit - 1) == 0 and value & bit]
+
+
+def parse_fields(dtype, data):
+    """按数据区 dtype 解析，返回 numpy 结构化标量（字段按名访问）"""
+    return np.frombuffer(bytes(data[:dtype.itemsize]), dtype=dtype, count=1)[0]
+
+
+def s24(raw):
+    """3 字节大端有符号数"""
+    return int.from_bytes(bytes(raw), "big", signed=True)
+
+
+def unpack_batch(data):
+    """
+    解析批量帧数据区，返回 (序号, 位宽, [ADC码值, ...])，格式不符时抛出 ValueError。
+    样本按位宽从高位起紧密排列；位宽小于24时还原到24位刻度（左移）。
+    """
+    if len(data) < ADC_BATCH_FIELDS.itemsize:
+        raise ValueError(f"批量帧过短: {len(data)}")
+    hdr = parse_fields(ADC_BATCH_FIELDS, data)
+    seq, bits, count = int(hdr["seq"]), int(hdr["bits"]), int(hdr["count"])
+    if bits not in BATCH_BITS:
+        raise ValueError(f"不支持的样本位宽: {bits}")
+    payload = bytes(data[ADC_BATCH_FIELDS.itemsize:])
+    if len(payload) != (count * bits + 7) // 8:
+        raise ValueError(f"批量帧长度与样本数不符: {len(data)} / {count}")
+    if bits == 24:
+        return seq, bits, [s24(payload[3 * i: 3 * i + 3]) for i in range(count)]
+    stream = int.from_bytes(payload, "big")
+    total = len(payload) * 8
+    mask, sign, shift = (1 << bits) - 1, 1 << (bits - 1), 24 - bits
+    values = []
+    for i in range(count):
+        v = (stream >> (total - (i + 1) * bits)) & mask
+        if v & sign:
+            v -= 1 << bits
+        values.append(v << shift)
+    return seq, bits, values
+
+
+def bulk_crc16(data):
+    """快照数据块的 CRC-16/CCITT（多项式 0x1021，初值 0xFFFF）"""
+    return binascii.crc_hqx(bytes(data), 0xFFFF)
+
+
+def bulk_crc32(data, crc=0):
+    """整个快照的 CRC-32（与下位机 crc32_update 相同，可分段累加）"""
+    return zlib.crc32(bytes(data), crc)
+
+
+def unpack_bulk_data(data):
+    """解析快照数据块的数据区，返回 (传输号, 块号, 数据)；数据 CRC 不符时抛出 ValueError"""
+    if len(data) < BULK_DATA_FIELDS.itemsize:
+        raise ValueError(f"数据块过短: {len(data)}")
+    hdr = parse_fields(BULK_DATA_FIELDS, data)
+    payload = bytes(data[BULK_DATA_FIELDS.itemsize:])
+    if bulk_crc16(payload) != int(hdr["crc"]):
+        raise ValueError(f"数据块 {int(hdr['block'])} CRC 错误")
+    return int(hdr["xfer"]), int(hdr["block"]), payload
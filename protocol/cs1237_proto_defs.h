@@ -0,0 +1,200 @@
+/* 由 protocol/gen_proto.py 根据 protocol/schema.json 生成，请勿手工修改 */
+/* 纯宏定义，不依赖 stdint.h，Keil C51 / ARMCC 都可直接包含 */
+#ifndef CS1237_PROTO_DEFS_H
+#define CS1237_PROTO_DEFS_H
+
+#define FRAME_HEAD_1       0xAA
+#define FRAME_HEAD_2       0x55
+#define FRAME_TAIL_1       0x0D
+#define FRAME_TAIL_2       0x0A
+
+/* 命令帧: AA 55 [长度=1+数据] [命令] [数据] [XOR(长度..数据)] 0D 0A */
+#define CMD_ADC_DATA       0x01	/* 单个ADC值，首字节补 0 */
+#define CMD_ERROR          0x03	/* 错误报告 */
+#define CMD_STATUS         0x04	/* 状态信息；上位机发不带数据的 0x04 帧查询 */
+#define CMD_ADC_BATCH      0x05	/* 批量ADC值：固定头之后为按位宽紧密排列的样本 */
+#define CMD_HELLO          0x06	/* 握手/能力帧：上电时和收到不带数据的 0x06 查询时发送 */
+#define CMD_TRACE          0x07	/* 追踪帧：紧接其后的电压帧的追踪号，以及该样本读出和开始发送时的下位机时间（微秒） */
+#define CMD_VOLTAGE_PGA    0x08	/* 电压帧的命令帧形式：COBS 帧格式下代替电压帧，电压和 PGA 与电压帧相同，另带样本质量标志 QFLAG_* */
+#define CMD_BULK_INFO      0x09	/* 快照传输开始：传输号、数据格式 BULK_FMT_*、采集时的速率/PGA 编码、总字节数、块数、块长、窗口块数、整个快照的 CRC-32 */
+#define CMD_BULK_DATA      0x0A	/* 快照数据块：固定头之后为第 block 块的数据（末块可能较短），crc 为数据的 CRC-16/CCITT */
+#define CMD_SET_PGA        0xA1	/* 设置PGA：0=1倍, 1=2倍, 2=64倍, 3=128倍 */
+#define CMD_SET_RATE       0xA2	/* 设置输出速率：0=10Hz, 1=40Hz, 2=640Hz, 3=1280Hz */
+#define CMD_SET_CHANNEL    0xA3	/* 设置通道：0=A, 1=保留, 2=温度, 3=内短 */
+#define CMD_POWER_DOWN     0xA4	/* 电源状态：1=进入省电, 0=退出（UNO 只在确认帧中使用） */
+#define CMD_SET_BITS       0xA5	/* 批量帧样本位宽：bit4-0 位宽，bit7-6 量化方式 */
+#define CMD_SET_BAUD       0xA6	/* 切换波特率：BAUD_* 编码；下位机按原波特率回确认帧后切换，上位机收到确认再切换 */
+#define CMD_SET_FRAMING    0xA7	/* 切换下位机发出的帧格式：FRAMING_*；按原格式回确认帧后切换，上位机发出的命令始终是 AA 55 帧 */
+#define CMD_BULK_OPEN      0xA8	/* 冻结/采集快照并开始传输：BULK_SRC_*，样本数（0 = 缓冲容量）；下位机回 0x09 后按窗口发数据块 */
+#define CMD_BULK_ACK       0xA9	/* 快照传输确认：base 之前的块都已收到，missing 的第 i 位表示第 base+i 块丢失需重发；base 等于块数即传输结束 */
+#define CMD_CONFIG_ACK     0xB1	/* 配置确认：配置命令码 + 生效的值 */
+
+#define ERR_SPI_READ       0x01	/* 读取失败（数据未就绪） */
+#define ERR_DATA_INVALID   0x02	/* 数据或参数无效 */
+#define ERR_TIMEOUT        0x03	/* 等待芯片超时 */
+#define ERR_TEMP_PGA       0x04	/* 测温模式需设置PGA=1 */
+
+#define PROTO_VERSION      1	/* 握手帧 proto 字段 */
+
+/* 握手帧 device：设备类型 */
+#define DEV_UNO            0x01	/* Arduino UNO（11.18gai） */
+#define DEV_STM32          0x02	/* STM32F103 例程 */
+#define DEV_STC8           0x03	/* STC8X 例程 */
+#define DEV_STC15          0x04	/* STC15W 例程 */
+
+/* 握手帧 caps：支持的帧与功能 */
+#define CAP_VOLTAGE        0x0001	/* 电压帧 */
+#define CAP_ADC_DATA       0x0002	/* 单个ADC帧 0x01 */
+#define CAP_ADC_BATCH      0x0004	/* 批量ADC帧 0x05 */
+#define CAP_STATUS         0x0008	/* 状态查询 0x04 */
+#define CAP_CONFIG         0x0010	/* 二进制配置命令 0xA1-0xA3 */
+#define CAP_SET_BITS       0x0020	/* 批量帧位宽压缩 0xA5 */
+#define CAP_SET_BAUD       0x0040	/* 运行中切换波特率 0xA6 */
+#define CAP_TIMESTAMP      0x0080	/* 追踪帧 0x07：抽样的样本带追踪号和时间戳 */
+#define CAP_TEXT           0x0100	/* 同一串口还输出文本菜单/调试信息 */
+#define CAP_COBS           0x0200	/* 支持 COBS 帧格式 0xA7 */
+#define CAP_FLAGS          0x0400	/* 0x08 电压帧带样本质量标志 */
+#define CAP_BULK           0x0800	/* 快照分块传输 0xA8/0xA9/0x09/0x0A，丢块按位图选择重发 */
+
+/* SET_FRAMING 的值：下位机发出的帧格式 */
+#define FRAMING_AA55       0x00	/* AA 55 帧头 + 0D 0A 帧尾（上电默认） */
+#define FRAMING_COBS       0x01	/* 00 + COBS(长度..校验) + 00，0x00 是唯一的分隔符 */
+
+/* BULK_OPEN 的 source：快照来源 */
+#define BULK_SRC_HISTORY   0x00	/* 冻结最近 count 个样本（空闲时下位机一直循环记录） */
+#define BULK_SRC_CAPTURE   0x01	/* 采集接下来的 count 个样本后冻结 */
+#define BULK_SRC_RESEND    0x02	/* 不重新取样，重发 0x09 并从头传当前快照（上位机没收到 0x09 时用） */
+
+/* BULK_INFO 的 format：快照数据格式 */
+#define BULK_FMT_S24       0x00	/* 每个样本 3 字节大端有符号码值，按时间顺序紧密排列 */
+
+/* 0x08 电压帧 flags：样本质量标志，由下位机在读出时判定 */
+#define QFLAG_SATURATED    0x01	/* 码值到达满量程（0x7FFFFF / 0x800000），输入超出量程 */
+#define QFLAG_SETTLING     0x02	/* 配置或退出省电后的建立期，数字滤波器尚未稳定 */
+#define QFLAG_DRDY_TIMEOUT 0x04	/* 此前等待 DRDY 超时，与上一个样本之间有缺口 */
+#define QFLAG_SPI_GLITCH   0x08	/* 开始移位时 DOUT 已不为低，读出的位可能错位（0xFFF??? 类异常值） */
+#define QFLAG_DECIMATED    0x10	/* 与上一个样本之间漏读了读数节拍上的样本（缓冲满、测温等） */
+#define QFLAG_BAD          0x0B	/* 样本值不可用的标志组合（饱和、建立期、移位异常），下游按位测试跳过 */
+
+/* 波特率编码（握手帧 max_baud、SET_BAUD 的值），BAUD_RATES_INIT 按编码排列 */
+#define BAUD_9600          0
+#define BAUD_19200         1
+#define BAUD_38400         2
+#define BAUD_57600         3
+#define BAUD_115200        4
+#define BAUD_230400        5
+#define BAUD_460800        6
+#define BAUD_921600        7
+#define BAUD_COUNT         8
+#define BAUD_RATES_INIT    {9600UL,19200UL,38400UL,57600UL,115200UL,230400UL,460800UL,921600UL}
+
+/* 各帧数据区长度、整帧长度、字段在整帧中的偏移 */
+#define FRAME_VOLTAGE_DATA_LEN 6
+#define FRAME_VOLTAGE_LEN 10
+#define FRAME_VOLTAGE_OFF_VOLTAGE 2
+#define FRAME_VOLTAGE_OFF_PGA 6
+
+#define FRAME_ADC_DATA_DATA_LEN 4
+#define FRAME_ADC_DATA_LEN 11
+#define FRAME_ADC_DATA_OFF_PAD 4
+#define FRAME_ADC_DATA_OFF_ADC 5
+
+#define FRAME_ERROR_DATA_LEN 1
+#define FRAME_ERROR_LEN 8
+#define FRAME_ERROR_OFF_CODE 4
+
+#define FRAME_STATUS_DATA_LEN 7
+#define FRAME_STATUS_LEN 14
+#define FRAME_STATUS_OFF_PGA 4
+#define FRAME_STATUS_OFF_RATE 5
+#define FRAME_STATUS_OFF_CHANNEL 6
+#define FRAME_STATUS_OFF_READS 7
+
+#define FRAME_ADC_BATCH_HEADER_LEN 4
+#define FRAME_ADC_BATCH_OFF_SEQ 4
+#define FRAME_ADC_BATCH_OFF_BITS 6
+#define FRAME_ADC_BATCH_OFF_COUNT 7
+
+#define FRAME_HELLO_DATA_LEN 8
+#define FRAME_HELLO_LEN 15
+#define FRAME_HELLO_OFF_PROTO 4
+#define FRAME_HELLO_OFF_DEVICE 5
+#define FRAME_HELLO_OFF_FW 6
+#define FRAME_HELLO_OFF_CAPS 8
+#define FRAME_HELLO_OFF_MAX_BAUD 10
+#define FRAME_HELLO_OFF_BATCH_MAX 11
+
+#define FRAME_TRACE_DATA_LEN 10
+#define FRAME_TRACE_LEN 17
+#define FRAME_TRACE_OFF_ID 4
+#define FRAME_TRACE_OFF_ADC_US 6
+#define FRAME_TRACE_OFF_TX_US 10
+
+#define FRAME_VOLTAGE_PGA_DATA_LEN 7
+#define FRAME_VOLTAGE_PGA_LEN 14
+#define FRAME_VOLTAGE_PGA_OFF_VOLTAGE 4
+#define FRAME_VOLTAGE_PGA_OFF_PGA 8
+#define FRAME_VOLTAGE_PGA_OFF_FLAGS 10
+
+#define FRAME_BULK_INFO_DATA_LEN 16
+#define FRAME_BULK_INFO_LEN 23
+#define FRAME_BULK_INFO_OFF_XFER 4
+#define FRAME_BULK_INFO_OFF_FORMAT 5
+#define FRAME_BULK_INFO_OFF_RATE 6
+#define FRAME_BULK_INFO_OFF_PGA 7
+#define FRAME_BULK_INFO_OFF_TOTAL 8
+#define FRAME_BULK_INFO_OFF_BLOCKS 12
+#define FRAME_BULK_INFO_OFF_BLOCK_SIZE 14
+#define FRAME_BULK_INFO_OFF_WINDOW 15
+#define FRAME_BULK_INFO_OFF_CRC32 16
+
+#define FRAME_BULK_DATA_HEADER_LEN 5
+#define FRAME_BULK_DATA_OFF_XFER 4
+#define FRAME_BULK_DATA_OFF_BLOCK 5
+#define FRAME_BULK_DATA_OFF_CRC 7
+
+#define FRAME_SET_PGA_DATA_LEN 1
+#define FRAME_SET_PGA_LEN 8
+#define FRAME_SET_PGA_OFF_VALUE 4
+
+#define FRAME_SET_RATE_DATA_LEN 1
+#define FRAME_SET_RATE_LEN 8
+#define FRAME_SET_RATE_OFF_VALUE 4
+
+#define FRAME_SET_CHANNEL_DATA_LEN 1
+#define FRAME_SET_CHANNEL_LEN 8
+#define FRAME_SET_CHANNEL_OFF_VALUE 4
+
+#define FRAME_POWER_DOWN_DATA_LEN 1
+#define FRAME_POWER_DOWN_LEN 8
+#define FRAME_POWER_DOWN_OFF_VALUE 4
+
+#define FRAME_SET_BITS_DATA_LEN 1
+#define FRAME_SET_BITS_LEN 8
+#define FRAME_SET_BITS_OFF_VALUE 4
+
+#define FRAME_SET_BAUD_DATA_LEN 1
+#define FRAME_SET_BAUD_LEN 8
+#define FRAME_SET_BAUD_OFF_VALUE 4
+
+#define FRAME_SET_FRAMING_DATA_LEN 1
+#define FRAME_SET_FRAMING_LEN 8
+#define FRAME_SET_FRAMING_OFF_VALUE 4
+
+#define FRAME_BULK_OPEN_DATA_LEN 3
+#define FRAME_BULK_OPEN_LEN 10
+#define FRAME_BULK_OPEN_OFF_SOURCE 4
+#define FRAME_BULK_OPEN_OFF_COUNT 5
+
+#define FRAME_BULK_ACK_DATA_LEN 7
+#define FRAME_BULK_ACK_LEN 14
+#define FRAME_BULK_ACK_OFF_XFER 4
+#define FRAME_BULK_ACK_OFF_BASE 5
+#define FRAME_BULK_ACK_OFF_MISSING 7
+
+#define FRAME_CONFIG_ACK_DATA_LEN 2
+#define FRAME_CONFIG_ACK_LEN 9
+#define FRAME_CONFIG_ACK_OFF_TYPE 4
+#define FRAME_CONFIG_ACK_OFF_VALUE 5
+
+#endif
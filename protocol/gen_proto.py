@@ -0,0 +1,793 @@
+"""
+CS1237 串口协议代码生成
+
+schema.json 是协议的唯一定义，本脚本据此生成：
+    cs1237_proto.hpp       C++ constexpr 帧模板（UNO 固件、ESP32 的 C ABI 实现）
+    cs1237_proto_defs.h    纯 C 宏（STM32 / STC8 / STC15 固件，C51 也能编译）
+    cs1237_proto.h/.cpp    C ABI（ESP32 的 main.c 调用）
+    cs1237_proto.py        Python 常量与 NumPy dtype（上位机 GUI、Streamlit 控制台）
+并复制到各固件/上位机目录。各端不再手抄帧常量，字节布局逐字节一致。
+
+用法:
+    python protocol/gen_proto.py           生成并复制
+    python protocol/gen_proto.py --check   只检查已生成的文件是否最新（不一致返回 1）
+"""
+import json
+import os
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(HERE)
+STM32_DIR = os.path.join(ROOT, "CS1237模块资料", "CS1237 24bit ADC模块发客户资料",
+                         "3、STM32 程序", "8、STM32+CS1237", "CS1237 DEMO", "HARDWARE")
+STC_DIRS = [os.path.join(ROOT, "CS1237模块资料", "CS1237 24bit ADC模块发客户资料", d, "user")
+            for d in ("STC8X CS1237 DEMO", "STC15W CS1237 DEMO", "STC15W CS1237 DEMO - 内部基准")]
+
+# 输出文件 -> [(复制目标目录, 编码), ...]；Keil 工程的源文件是 GBK
+COPIES = {
+    "cs1237_proto.hpp": [(os.path.join(ROOT, "uno cs1237", "cs1237", "11.18gai", "11.18gai"), "utf-8")],
+    "cs1237_proto_defs.h": [(STM32_DIR, "gbk")] + [(d, "gbk") for d in STC_DIRS],
+    "cs1237_proto.py": [(os.path.join(ROOT, "gui", "12.11"), "utf-8"), (os.path.join(ROOT, "Streamlit"), "utf-8")],
+}
+
+# 字段类型: 字节数, C++ 编解码器, C 类型, NumPy dtype
+TYPES = {
+    "u8":    (1, "U8",    "uint8_t",  "'u1'"),
+    "u16le": (2, "U16Le", "uint16_t", "'<u2'"),
+    "u16be": (2, "U16Be", "uint16_t", "'>u2'"),
+    "u32be": (4, "U32Be", "uint32_t", "'>u4'"),
+    "s24be": (3, "S24Be", "int32_t",  "'u1', (3,)"),
+    "f32le": (4, "F32Le", "float",    "'<f4'"),
+}
+
+BANNER = "由 protocol/gen_proto.py 根据 protocol/schema.json 生成，请勿手工修改"
+
+
+def load_schema():
+    with open(os.path.join(HERE, "schema.json"), encoding="utf-8") as f:
+        schema = json.load(f)
+    offset_base = {"raw": 2, "cmd": 4}
+    for fr in schema["frames"]:
+        fr["kind"] = fr.get("kind", "cmd")
+        if fr["kind"] == "cmd":
+            fr["code"] = int(fr["cmd"], 0)
+        off = offset_base[fr["kind"]]
+        fields = []
+        for name, typ in fr["fields"]:
+            fields.append((name, typ, off))
+            off += TYPES[typ][0]
+        fr["fields"] = fields
+        fr["data_len"] = off - offset_base[fr["kind"]]
+        # raw: 帧头 2 + 数据 + 帧尾 2；cmd: 帧头 2 + 长度 + 命令 + 数据 + 校验 + 帧尾 2
+        fr["size"] = fr["data_len"] + (4 if fr["kind"] == "raw" else 7)
+        fr["camel"] = "".join(w.capitalize() for w in fr["name"].split("_"))
+        fr["lower"] = fr["name"].lower()
+    schema["head"] = [int(x, 0) for x in schema["head"]]
+    schema["tail"] = [int(x, 0) for x in schema["tail"]]
+    schema["errors"] = [(n, int(c, 0), doc) for n, c, doc in schema["errors"]]
+    for grp in schema["constants"]:
+        grp["values"] = [(n, int(v, 0), doc) for n, v, doc in grp["values"]]
+        grp["hex"] = 2 * TYPES[grp["type"]][0]
+    return schema
+
+
+def baud_codes(schema):
+    """[(名称, 编码, 波特率), ...]，编码即 BAUD_RATES 下标"""
+    return [(f"BAUD_{b}", i, b) for i, b in enumerate(schema["baud_rates"])]
+
+
+def cmd_frames(schema):
+    return [fr for fr in schema["frames"] if fr["kind"] == "cmd"]
+
+
+def fixed_frames(schema):
+    return [fr for fr in schema["frames"] if not fr.get("variable")]
+
+
+# ==========================================
+# C++ constexpr
+# ==========================================
+
+CPP_CORE = r'''
+// ---- 字段编解码：类型决定宽度和字节序 ----
+struct U8 {
+    typedef uint8_t type;
+    static constexpr uint8_t size = 1;
+    static void put(uint8_t* p, type v) { p[0] = v; }
+    static type get(const uint8_t* p) { return p[0]; }
+};
+struct U16Le {
+    typedef uint16_t type;
+    static constexpr uint8_t size = 2;
+    static void put(uint8_t* p, type v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+    static type get(const uint8_t* p) { return (type)(p[0] | ((type)p[1] << 8)); }
+};
+struct U16Be {
+    typedef uint16_t type;
+    static constexpr uint8_t size = 2;
+    static void put(uint8_t* p, type v) { p[0] = (uint8_t)(v >> 8); p[1] = (uint8_t)v; }
+    static type get(const uint8_t* p) { return (type)(((type)p[0] << 8) | p[1]); }
+};
+struct U32Be {
+    typedef uint32_t type;
+    static constexpr uint8_t size = 4;
+    static void put(uint8_t* p, type v) {
+        p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16); p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v;
+    }
+    static type get(const uint8_t* p) {
+        return ((type)p[0] << 24) | ((type)p[1] << 16) | ((type)p[2] << 8) | p[3];
+    }
+};
+struct S24Be {  // 24 位有符号，解码时符号扩展到 32 位
+    typedef int32_t type;
+    static constexpr uint8_t size = 3;
+    static void put(uint8_t* p, type v) { p[0] = (uint8_t)(v >> 16); p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)v; }
+    static type get(const uint8_t* p) {
+        uint32_t u = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+        return (type)((u ^ 0x800000UL) - 0x800000UL);
+    }
+};
+struct F32Le {  // 各端（AVR、ESP32、x86、Cortex-M）都是小端，按内存字节序直接复制
+    typedef float type;
+    static constexpr uint8_t size = 4;
+    static void put(uint8_t* p, type v) { memcpy(p, &v, 4); }
+    static type get(const uint8_t* p) { type v; memcpy(&v, p, 4); return v; }
+};
+
+// 固定偏移的字段：偏移是模板参数，编解码时没有任何长度判断
+template <class T, uint8_t Off>
+struct Field {
+    typedef typename T::type type;
+    static constexpr uint8_t offset = Off;
+    static void put(uint8_t* frame, type v) { T::put(frame + Off, v); }
+    static type get(const uint8_t* frame) { return T::get(frame + Off); }
+};
+
+// frame[From..To) 的异或，编译期展开
+template <uint8_t From, uint8_t To>
+struct Xor {
+    static uint8_t of(const uint8_t* f) { return f[From] ^ Xor<From + 1, To>::of(f); }
+};
+template <uint8_t To>
+struct Xor<To, To> {
+    static uint8_t of(const uint8_t*) { return 0; }
+};
+
+// 命令帧外壳: AA 55 [长度=1+数据] [命令] [数据] [XOR(长度..数据)] 0D 0A
+template <uint8_t Cmd, uint8_t DataLen>
+struct CmdFrame {
+    static constexpr uint8_t cmd = Cmd;
+    static constexpr uint8_t data_len = DataLen;
+    static constexpr uint8_t len_field = DataLen + 1;
+    static constexpr uint8_t data_offset = 4;
+    static constexpr uint8_t sum_offset = 4 + DataLen;
+    static constexpr uint8_t size = DataLen + 7;
+
+    static void seal(uint8_t* f) {
+        f[0] = FRAME_HEAD_1; f[1] = FRAME_HEAD_2;
+        f[2] = len_field;    f[3] = cmd;
+        f[sum_offset] = Xor<2, sum_offset>::of(f);
+        f[size - 2] = FRAME_TAIL_1; f[size - 1] = FRAME_TAIL_2;
+    }
+    static bool check(const uint8_t* f) {
+        return f[0] == FRAME_HEAD_1 && f[1] == FRAME_HEAD_2 && f[2] == len_field && f[3] == cmd &&
+               f[sum_offset] == Xor<2, sum_offset>::of(f) &&
+               f[size - 2] == FRAME_TAIL_1 && f[size - 1] == FRAME_TAIL_2;
+    }
+};
+
+// 裸帧外壳: AA 55 [数据] 0D 0A（电压帧）
+template <uint8_t DataLen>
+struct RawFrame {
+    static constexpr uint8_t data_len = DataLen;
+    static constexpr uint8_t data_offset = 2;
+    static constexpr uint8_t size = DataLen + 4;
+
+    static void seal(uint8_t* f) {
+        f[0] = FRAME_HEAD_1; f[1] = FRAME_HEAD_2;
+        f[size - 2] = FRAME_TAIL_1; f[size - 1] = FRAME_TAIL_2;
+    }
+    static bool check(const uint8_t* f) {
+        return f[0] == FRAME_HEAD_1 && f[1] == FRAME_HEAD_2 &&
+               f[size - 2] == FRAME_TAIL_1 && f[size - 1] == FRAME_TAIL_2;
+    }
+};
+
+// 变长命令帧（批量帧）：只有固定头的字段偏移是编译期常量
+template <uint8_t Cmd, uint8_t HeaderLen>
+struct VarFrame {
+    static constexpr uint8_t cmd = Cmd;
+    static constexpr uint8_t header_len = HeaderLen;
+    static constexpr uint8_t data_offset = 4;
+    static uint16_t size(uint8_t data_len) { return (uint16_t)data_len + 7; }
+
+    static void seal(uint8_t* f, uint8_t data_len) {
+        uint8_t sum;
+        uint16_t i;
+        f[0] = FRAME_HEAD_1; f[1] = FRAME_HEAD_2;
+        f[2] = data_len + 1; f[3] = cmd;
+        sum = 0;
+        for (i = 2; i < 4 + data_len; i++) sum ^= f[i];
+        f[4 + data_len] = sum;
+        f[5 + data_len] = FRAME_TAIL_1; f[6 + data_len] = FRAME_TAIL_2;
+    }
+    // n 字节的完整帧，帧头/长度/命令/校验/帧尾都对且不短于固定头才返回数据区长度，否则返回 -1
+    static int check(const uint8_t* f, uint16_t n) {
+        uint8_t sum = 0;
+        uint16_t i;
+        if (n < 7 + HeaderLen || f[0] != FRAME_HEAD_1 || f[1] != FRAME_HEAD_2 ||
+            f[2] != n - 6 || f[3] != cmd || f[n - 2] != FRAME_TAIL_1 || f[n - 1] != FRAME_TAIL_2) return -1;
+        for (i = 2; i < n - 3; i++) sum ^= f[i];
+        return sum == f[n - 3] ? (int)(n - 7) : -1;
+    }
+};
+'''
+
+CPP_GENERIC = r'''
+// ---- 通用入口：编码整帧返回帧长；解码前校验帧头/长度/命令/校验/帧尾 ----
+template <class F>
+inline uint8_t encode(uint8_t* out, const typename F::Values& v) {
+    F::put_fields(out, v);
+    F::seal(out);
+    return F::size;
+}
+
+template <class F>
+inline bool decode(const uint8_t* in, typename F::Values& v) {
+    if (!F::check(in)) return false;
+    F::get_fields(in, v);
+    return true;
+}
+
+// ---- 快照分块传输的校验 ----
+// CRC-16/CCITT（多项式 0x1021，初值 0xFFFF，不反射）：每个数据块
+inline uint16_t crc16_ccitt(const uint8_t* p, uint16_t n, uint16_t crc = 0xFFFF) {
+    uint8_t k;
+    while (n--) {
+        crc ^= (uint16_t)(*p++) << 8;
+        for (k = 0; k < 8; k++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+// CRC-32（IEEE 802.3，与 zlib.crc32 相同）：整个快照，可分段累加，首段 crc 传 0
+inline uint32_t crc32_update(uint32_t crc, const uint8_t* p, uint32_t n) {
+    uint8_t k;
+    crc = ~crc;
+    while (n--) {
+        crc ^= *p++;
+        for (k = 0; k < 8; k++) crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320UL : crc >> 1;
+    }
+    return ~crc;
+}
+
+// ---- COBS 帧格式: 00 [COBS(长度..校验)] 00 ----
+// 命令帧去掉帧头帧尾后做 COBS 编码，包内不再出现 0x00，收端按 0x00 切包，出错后下一个 0x00 即重新同步。
+// 包前的 0x00 把之前混入的文本隔开，包后的 0x00 让收端不必等下一包就能切出本包。
+
+// 命令帧长 -> COBS 包长
+constexpr uint16_t cobs_size(uint16_t frame_len) {
+    return (frame_len - 4) + (frame_len - 4) / 254 + 1 + 2;
+}
+
+// frame 为完整命令帧，out 至少 cobs_size(frame_len) 字节，返回包长
+inline uint16_t cobs_wrap(const uint8_t* frame, uint16_t frame_len, uint8_t* out) {
+    const uint8_t* in = frame + 2;
+    uint16_t n = frame_len - 4, i, o = 2, code_pos = 1;
+    uint8_t code = 1;
+    out[0] = 0;
+    for (i = 0; i < n; i++) {
+        if (in[i] == 0) {
+            out[code_pos] = code;
+            code_pos = o++;
+            code = 1;
+        } else {
+            out[o++] = in[i];
+            if (++code == 0xFF) {
+                out[code_pos] = code;
+                code_pos = o++;
+                code = 1;
+            }
+        }
+    }
+    out[code_pos] = code;
+    out[o++] = 0;
+    return o;
+}
+
+// in 为两个 0x00 之间的 n 个字节，还原成完整命令帧写入 frame（容量 cap），
+// 长度字段与校验都对才返回帧长，否则返回 0
+inline uint16_t cobs_unwrap(const uint8_t* in, uint16_t n, uint8_t* frame, uint16_t cap) {
+    uint16_t i = 0, o = 2, k;
+    uint8_t code, sum = 0;
+    while (i < n) {
+        code = in[i++];
+        if (code == 0) return 0;
+        for (k = 1; k < code; k++) {
+            if (i >= n || in[i] == 0 || o + 2 >= cap) return 0;
+            frame[o++] = in[i++];
+        }
+        if (code < 0xFF && i < n) {
+            if (o + 2 >= cap) return 0;
+            frame[o++] = 0;
+        }
+    }
+    // o - 2 = 长度 + 命令 + 数据 + 校验 = 长度字段 + 2
+    if (o < 5 || frame[2] != o - 4) return 0;
+    for (k = 2; k < o; k++) sum ^= frame[k];
+    if (sum != 0) return 0;  // 校验字节等于前面各字节的异或
+    frame[0] = FRAME_HEAD_1; frame[1] = FRAME_HEAD_2;
+    frame[o] = FRAME_TAIL_1; frame[o + 1] = FRAME_TAIL_2;
+    return o + 2;
+}
+
+// 定长命令帧直接编码成 COBS 包，out 至少 cobs_size(F::size) 字节
+template <class F>
+inline uint16_t encode_cobs(uint8_t* out, const typename F::Values& v) {
+    uint8_t f[F::size];
+    return cobs_wrap(f, encode<F>(f, v), out);
+}
+'''
+
+
+def gen_hpp(schema):
+    out = [f"// {BANNER}", "#ifndef CS1237_PROTO_HPP", "#define CS1237_PROTO_HPP", "",
+           "#include <stdint.h>", "#include <string.h>", "",
+           "namespace cs1237 {", "namespace proto {", ""]
+    h, t = schema["head"], schema["tail"]
+    out += [f"constexpr uint8_t FRAME_HEAD_1 = 0x{h[0]:02X};",
+            f"constexpr uint8_t FRAME_HEAD_2 = 0x{h[1]:02X};",
+            f"constexpr uint8_t FRAME_TAIL_1 = 0x{t[0]:02X};",
+            f"constexpr uint8_t FRAME_TAIL_2 = 0x{t[1]:02X};", ""]
+    for fr in cmd_frames(schema):
+        out.append(f"constexpr uint8_t CMD_{fr['name']} = 0x{fr['code']:02X};  // {fr['doc']}")
+    out.append("")
+    for name, code, doc in schema["errors"]:
+        out.append(f"constexpr uint8_t ERR_{name} = 0x{code:02X};  // {doc}")
+    out += ["", f"constexpr uint8_t PROTO_VERSION = {schema['version']};  // 握手帧 proto 字段"]
+    for grp in schema["constants"]:
+        ctype = TYPES[grp["type"]][2]
+        out += ["", f"// {grp['doc']}"]
+        for name, v, doc in grp["values"]:
+            out.append(f"constexpr {ctype} {grp['prefix']}_{name} = 0x{v:0{grp['hex']}X};  // {doc}")
+    out += ["", "// 波特率编码（握手帧 max_baud、SET_BAUD 的值）"]
+    for name, code, baud in baud_codes(schema):
+        out.append(f"constexpr uint8_t {name} = {code};")
+    out.append(f"constexpr uint8_t BAUD_COUNT = {len(schema['baud_rates'])};")
+    out.append("constexpr uint32_t BAUD_RATES[BAUD_COUNT] = {" +
+               ", ".join(f"{b}UL" for b in schema["baud_rates"]) + "};")
+    out.append(CPP_CORE)
+    out.append("// ---- 各帧定义 ----")
+    for fr in schema["frames"]:
+        out.append(f"// {fr['doc']}")
+        if fr.get("variable"):
+            base = f"VarFrame<CMD_{fr['name']}, {fr['data_len']}>"
+        elif fr["kind"] == "raw":
+            base = f"RawFrame<{fr['data_len']}>"
+        else:
+            base = f"CmdFrame<CMD_{fr['name']}, {fr['data_len']}>"
+        out.append(f"struct {fr['camel']} : {base} {{")
+        for name, typ, off in fr["fields"]:
+            out.append(f"    typedef Field<{TYPES[typ][1]}, {off}> {name};")
+        if not fr.get("variable"):
+            out.append("    struct Values {")
+            for name, typ, off in fr["fields"]:
+                out.append(f"        {TYPES[typ][2]} {name};")
+            out.append("    };")
+            out.append("    static void put_fields(uint8_t* f, const Values& v) {")
+            for name, typ, off in fr["fields"]:
+                out.append(f"        {name}::put(f, v.{name});")
+            out.append("    }")
+            out.append("    static void get_fields(const uint8_t* f, Values& v) {")
+            for name, typ, off in fr["fields"]:
+                out.append(f"        v.{name} = {name}::get(f);")
+            out.append("    }")
+        out.append("};")
+        if fr.get("query"):
+            out.append(f"typedef CmdFrame<CMD_{fr['name']}, 0> {fr['camel']}Query;  // 上位机查询，无数据")
+        out.append("")
+    out.append(CPP_GENERIC)
+    out += ["}  // namespace proto", "}  // namespace cs1237", "", "#endif  // CS1237_PROTO_HPP", ""]
+    return "\n".join(out)
+
+
+# ==========================================
+# 纯 C 宏
+# ==========================================
+
+def gen_defs(schema):
+    out = [f"/* {BANNER} */",
+           "/* 纯宏定义，不依赖 stdint.h，Keil C51 / ARMCC 都可直接包含 */",
+           "#ifndef CS1237_PROTO_DEFS_H", "#define CS1237_PROTO_DEFS_H", ""]
+    h, t = schema["head"], schema["tail"]
+    out += [f"#define FRAME_HEAD_1       0x{h[0]:02X}",
+            f"#define FRAME_HEAD_2       0x{h[1]:02X}",
+            f"#define FRAME_TAIL_1       0x{t[0]:02X}",
+            f"#define FRAME_TAIL_2       0x{t[1]:02X}", "",
+            "/* 命令帧: AA 55 [长度=1+数据] [命令] [数据] [XOR(长度..数据)] 0D 0A */"]
+    for fr in cmd_frames(schema):
+        out.append(f"#define CMD_{fr['name']:<15}0x{fr['code']:02X}\t/* {fr['doc']} */")
+    out.append("")
+    for name, code, doc in schema["errors"]:
+        out.append(f"#define ERR_{name:<15}0x{code:02X}\t/* {doc} */")
+    out += ["", f"#define PROTO_VERSION      {schema['version']}\t/* 握手帧 proto 字段 */"]
+    for grp in schema["constants"]:
+        out += ["", f"/* {grp['doc']} */"]
+        for name, v, doc in grp["values"]:
+            out.append(f"#define {grp['prefix'] + '_' + name:<19}0x{v:0{grp['hex']}X}\t/* {doc} */")
+    out += ["", "/* 波特率编码（握手帧 max_baud、SET_BAUD 的值），BAUD_RATES_INIT 按编码排列 */"]
+    for name, code, baud in baud_codes(schema):
+        out.append(f"#define {name:<19}{code}")
+    out.append(f"#define BAUD_COUNT         {len(schema['baud_rates'])}")
+    out.append("#define BAUD_RATES_INIT    {" + ",".join(f"{b}UL" for b in schema["baud_rates"]) + "}")
+    out.append("")
+    out.append("/* 各帧数据区长度、整帧长度、字段在整帧中的偏移 */")
+    for fr in schema["frames"]:
+        n = fr["name"]
+        if fr.get("variable"):
+            out.append(f"#define FRAME_{n}_HEADER_LEN {fr['data_len']}")
+        else:
+            out.append(f"#define FRAME_{n}_DATA_LEN {fr['data_len']}")
+            out.append(f"#define FRAME_{n}_LEN {fr['size']}")
+        for name, typ, off in fr["fields"]:
+            out.append(f"#define FRAME_{n}_OFF_{name.upper()} {off}")
+        out.append("")
+    out += ["#endif", ""]
+    return "\n".join(out)
+
+
+# ==========================================
+# C ABI
+# ==========================================
+
+def gen_c_header(schema):
+    out = [f"/* {BANNER} */",
+           "/* C ABI：ESP32 等 C 代码通过这些函数使用 cs1237_proto.hpp 中的帧模板 */",
+           "#ifndef CS1237_PROTO_H", "#define CS1237_PROTO_H", "",
+           "#include <stdint.h>", "", "#ifdef __cplusplus", 'extern "C" {', "#endif", "",
+           "/* 常量加 CS1237_ 前缀，避免与 cs1237_proto_defs.h 的同名宏冲突 */"]
+    for fr in cmd_frames(schema):
+        out.append(f"#define CS1237_CMD_{fr['name']} 0x{fr['code']:02X}")
+    for name, code, doc in schema["errors"]:
+        out.append(f"#define CS1237_ERR_{name} 0x{code:02X}")
+    out.append(f"#define CS1237_PROTO_VERSION {schema['version']}")
+    for grp in schema["constants"]:
+        for name, v, doc in grp["values"]:
+            out.append(f"#define CS1237_{grp['prefix']}_{name} 0x{v:0{grp['hex']}X}")
+    for name, code, baud in baud_codes(schema):
+        out.append(f"#define CS1237_{name} {code}")
+    out.append(f"#define CS1237_BAUD_COUNT {len(schema['baud_rates'])}")
+    out.append("#define CS1237_BAUD_RATES_INIT {" + ", ".join(f"{b}UL" for b in schema["baud_rates"]) + "}")
+    out += ["", "/* 上位机查询帧（不带数据）的长度 */", "#define CS1237_QUERY_FRAME_SIZE 7", "",
+            "/* COBS 帧格式 00 [COBS(长度..校验)] 00：命令帧长 -> 包长 */",
+            "#define CS1237_COBS_SIZE(frame_len) ((frame_len) - 4 + ((frame_len) - 4) / 254 + 3)",
+            "/* 完整命令帧 -> COBS 包（含前后两个 0x00），返回包长 */",
+            "uint16_t cs1237_cobs_wrap(const uint8_t *frame, uint16_t frame_len, uint8_t *out);",
+            "/* 两个 0x00 之间的 n 个字节 -> 完整命令帧（容量 cap），长度与校验都对才返回帧长，否则返回 0 */",
+            "uint16_t cs1237_cobs_unwrap(const uint8_t *in, uint16_t n, uint8_t *frame, uint16_t cap);", "",
+            "/* 快照数据块的 CRC-16/CCITT（初值 0xFFFF）、整个快照的 CRC-32（分段累加，首段 crc 传 0） */",
+            "uint16_t cs1237_crc16(const uint8_t *p, uint16_t n);",
+            "uint32_t cs1237_crc32(uint32_t crc, const uint8_t *p, uint32_t n);", ""]
+    for fr in schema["frames"]:
+        if not fr.get("variable"):
+            continue
+        n, low = fr["name"], fr["lower"]
+        out.append(f"#define CS1237_{n}_HEADER_SIZE {fr['data_len']}")
+        out.append("typedef struct {")
+        for name, typ, off in fr["fields"]:
+            out.append(f"    {TYPES[typ][2]} {name};")
+        out.append(f"}} cs1237_{low}_t;")
+        out.append(f"/* {fr['doc']}；")
+        out.append(" * in 为 n 字节的完整帧，校验通过返回数据区长度并填写固定头 v、*payload 指向固定头之后，否则返回 -1 */")
+        out.append(f"int cs1237_decode_{low}(const uint8_t *in, uint16_t n, cs1237_{low}_t *v, const uint8_t **payload);")
+        out.append("")
+    for fr in fixed_frames(schema):
+        n, low = fr["name"], fr["lower"]
+        out.append(f"#define CS1237_{n}_FRAME_SIZE {fr['size']}")
+        out.append("typedef struct {")
+        for name, typ, off in fr["fields"]:
+            out.append(f"    {TYPES[typ][2]} {name};")
+        out.append(f"}} cs1237_{low}_t;")
+        out.append(f"/* {fr['doc']}；out 至少 CS1237_{n}_FRAME_SIZE 字节，返回帧长 */")
+        out.append(f"uint8_t cs1237_encode_{low}(uint8_t *out, const cs1237_{low}_t *v);")
+        out.append("/* 校验通过返回 1 并填写 v，否则返回 0 */")
+        out.append(f"int cs1237_decode_{low}(const uint8_t *in, cs1237_{low}_t *v);")
+        if fr.get("query"):
+            out.append("/* 查询帧，out 至少 CS1237_QUERY_FRAME_SIZE 字节，返回帧长 */")
+            out.append(f"uint8_t cs1237_encode_{low}_query(uint8_t *out);")
+        out.append("")
+    out += ["#ifdef __cplusplus", "}", "#endif", "", "#endif", ""]
+    return "\n".join(out)
+
+
+def gen_c_impl(schema):
+    out = [f"// {BANNER}", '#include "cs1237_proto.hpp"', '#include "cs1237_proto.h"', "",
+           "using namespace cs1237::proto;", "",
+           'extern "C" uint16_t cs1237_cobs_wrap(const uint8_t* frame, uint16_t frame_len, uint8_t* out) {',
+           "    return cobs_wrap(frame, frame_len, out);",
+           "}", "",
+           'extern "C" uint16_t cs1237_cobs_unwrap(const uint8_t* in, uint16_t n, uint8_t* frame, uint16_t cap) {',
+           "    return cobs_unwrap(in, n, frame, cap);",
+           "}", "",
+           'extern "C" uint16_t cs1237_crc16(const uint8_t* p, uint16_t n) {',
+           "    return crc16_ccitt(p, n);",
+           "}", "",
+           'extern "C" uint32_t cs1237_crc32(uint32_t crc, const uint8_t* p, uint32_t n) {',
+           "    return crc32_update(crc, p, n);",
+           "}", ""]
+    for fr in schema["frames"]:
+        if not fr.get("variable"):
+            continue
+        low, camel = fr["lower"], fr["camel"]
+        out.append(f'extern "C" int cs1237_decode_{low}(const uint8_t* in, uint16_t n, cs1237_{low}_t* v, const uint8_t** payload) {{')
+        out.append(f"    int len = {camel}::check(in, n);")
+        out.append("    if (len < 0) return -1;")
+        for name, typ, off in fr["fields"]:
+            out.append(f"    v->{name} = {camel}::{name}::get(in);")
+        out.append(f"    *payload = in + {camel}::data_offset + {camel}::header_len;")
+        out.append("    return len;")
+        out.append("}")
+        out.append("")
+    for fr in fixed_frames(schema):
+        low, camel = fr["lower"], fr["camel"]
+        out.append(f'extern "C" uint8_t cs1237_encode_{low}(uint8_t* out, const cs1237_{low}_t* v) {{')
+        out.append(f"    {camel}::Values x;")
+        for name, typ, off in fr["fields"]:
+            out.append(f"    x.{name} = v->{name};")
+        out.append(f"    return encode<{camel}>(out, x);")
+        out.append("}")
+        out.append("")
+        out.append(f'extern "C" int cs1237_decode_{low}(const uint8_t* in, cs1237_{low}_t* v) {{')
+        out.append(f"    {camel}::Values x;")
+        out.append(f"    if (!decode<{camel}>(in, x)) return 0;")
+        for name, typ, off in fr["fields"]:
+            out.append(f"    v->{name} = x.{name};")
+        out.append("    return 1;")
+        out.append("}")
+        out.append("")
+        if fr.get("query"):
+            out.append(f'extern "C" uint8_t cs1237_encode_{low}_query(uint8_t* out) {{')
+            out.append(f"    {camel}Query::seal(out);")
+            out.append(f"    return {camel}Query::size;")
+            out.append("}")
+            out.append("")
+    return "\n".join(out)
+
+
+# ==========================================
+# Python / NumPy
+# ==========================================
+
+PY_HELPERS = '''
+
+def checksum(body):
+    """长度..数据 逐字节异或"""
+    s = 0
+    for b in body:
+        s ^= b
+    return s
+
+
+def encode_frame(cmd, data=b""):
+    """组命令帧: AA 55 [长度] [命令] [数据] [XOR] 0D 0A"""
+    body = bytes([len(data) + 1, cmd]) + bytes(data)
+    return FRAME_HEAD + body + bytes([checksum(body)]) + FRAME_TAIL
+
+
+def cobs_encode(data):
+    """COBS 编码（不含分隔符）"""
+    out = bytearray([0])
+    code_pos, code = 0, 1
+    for b in data:
+        if b == 0:
+            out[code_pos] = code
+            code_pos, code = len(out), 1
+            out.append(0)
+        else:
+            out.append(b)
+            code += 1
+            if code == 0xFF:
+                out[code_pos] = code
+                code_pos, code = len(out), 1
+                out.append(0)
+    out[code_pos] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    """COBS 解码（输入不含分隔符），格式错误时抛出 ValueError"""
+    out = bytearray()
+    i, n = 0, len(data)
+    while i < n:
+        code = data[i]
+        block = data[i + 1:i + code]
+        if code == 0 or len(block) != code - 1 or 0 in block:
+            raise ValueError("COBS 编码错误")
+        out += block
+        i += code
+        if code < 0xFF and i < n:
+            out.append(0)
+    return bytes(out)
+
+
+def wrap_cobs(frame):
+    """完整命令帧 -> COBS 包 00 [COBS(长度..校验)] 00"""
+    return b"\\x00" + cobs_encode(frame[2:-2]) + b"\\x00"
+
+
+def unwrap_cobs(packet):
+    """两个 0x00 之间的字节 -> 完整命令帧，长度或校验不对时抛出 ValueError"""
+    body = cobs_decode(packet)
+    if len(body) < 3 or body[0] != len(body) - 2:
+        raise ValueError(f"COBS 包长度不符: {len(body)}")
+    if checksum(body) != 0:
+        raise ValueError("COBS 包校验错误")
+    return FRAME_HEAD + body + FRAME_TAIL
+
+
+def bit_names(value, names):
+    """位组合 -> 各个置位的名称（names 为 <前缀>_NAMES，多位的组合项不单列）"""
+    return [name for bit, name in names.items() if bit and bit & (bit - 1) == 0 and value & bit]
+
+
+def parse_fields(dtype, data):
+    """按数据区 dtype 解析，返回 numpy 结构化标量（字段按名访问）"""
+    return np.frombuffer(bytes(data[:dtype.itemsize]), dtype=dtype, count=1)[0]
+
+
+def s24(raw):
+    """3 字节大端有符号数"""
+    return int.from_bytes(bytes(raw), "big", signed=True)
+
+
+def unpack_batch(data):
+    """
+    解析批量帧数据区，返回 (序号, 位宽, [ADC码值, ...])，格式不符时抛出 ValueError。
+    样本按位宽从高位起紧密排列；位宽小于24时还原到24位刻度（左移）。
+    """
+    if len(data) < ADC_BATCH_FIELDS.itemsize:
+        raise ValueError(f"批量帧过短: {len(data)}")
+    hdr = parse_fields(ADC_BATCH_FIELDS, data)
+    seq, bits, count = int(hdr["seq"]), int(hdr["bits"]), int(hdr["count"])
+    if bits not in BATCH_BITS:
+        raise ValueError(f"不支持的样本位宽: {bits}")
+    payload = bytes(data[ADC_BATCH_FIELDS.itemsize:])
+    if len(payload) != (count * bits + 7) // 8:
+        raise ValueError(f"批量帧长度与样本数不符: {len(data)} / {count}")
+    if bits == 24:
+        return seq, bits, [s24(payload[3 * i: 3 * i + 3]) for i in range(count)]
+    stream = int.from_bytes(payload, "big")
+    total = len(payload) * 8
+    mask, sign, shift = (1 << bits) - 1, 1 << (bits - 1), 24 - bits
+    values = []
+    for i in range(count):
+        v = (stream >> (total - (i + 1) * bits)) & mask
+        if v & sign:
+            v -= 1 << bits
+        values.append(v << shift)
+    return seq, bits, values
+
+
+def bulk_crc16(data):
+    """快照数据块的 CRC-16/CCITT（多项式 0x1021，初值 0xFFFF）"""
+    return binascii.crc_hqx(bytes(data), 0xFFFF)
+
+
+def bulk_crc32(data, crc=0):
+    """整个快照的 CRC-32（与下位机 crc32_update 相同，可分段累加）"""
+    return zlib.crc32(bytes(data), crc)
+
+
+def unpack_bulk_data(data):
+    """解析快照数据块的数据区，返回 (传输号, 块号, 数据)；数据 CRC 不符时抛出 ValueError"""
+    if len(data) < BULK_DATA_FIELDS.itemsize:
+        raise ValueError(f"数据块过短: {len(data)}")
+    hdr = parse_fields(BULK_DATA_FIELDS, data)
+    payload = bytes(data[BULK_DATA_FIELDS.itemsize:])
+    if bulk_crc16(payload) != int(hdr["crc"]):
+        raise ValueError(f"数据块 {int(hdr['block'])} CRC 错误")
+    return int(hdr["xfer"]), int(hdr["block"]), payload
+'''
+
+
+def gen_py(schema):
+    out = ['"""', f"CS1237 串口协议定义（{BANNER}）", '"""', "import binascii", "import zlib", "",
+           "import numpy as np", ""]
+    h, t = schema["head"], schema["tail"]
+    out += [f"FRAME_HEAD_1 = 0x{h[0]:02X}", f"FRAME_HEAD_2 = 0x{h[1]:02X}",
+            f"FRAME_TAIL_1 = 0x{t[0]:02X}", f"FRAME_TAIL_2 = 0x{t[1]:02X}",
+            "FRAME_HEAD = bytes([FRAME_HEAD_1, FRAME_HEAD_2])",
+            "FRAME_TAIL = bytes([FRAME_TAIL_1, FRAME_TAIL_2])",
+            "MAX_FRAME_LEN = 7 + 254  # 长度字段 1 字节，含命令最多 255", ""]
+    for fr in cmd_frames(schema):
+        out.append(f"CMD_{fr['name']} = 0x{fr['code']:02X}  # {fr['doc']}")
+    out.append("")
+    for name, code, doc in schema["errors"]:
+        out.append(f"ERR_{name} = 0x{code:02X}")
+    out.append("ERROR_TEXT = {")
+    for name, code, doc in schema["errors"]:
+        out.append(f"    ERR_{name}: \"{doc}\",")
+    out.append("}")
+    out += ["", f"PROTO_VERSION = {schema['version']}"]
+    for grp in schema["constants"]:
+        out += ["", f"# {grp['doc']}"]
+        for name, v, doc in grp["values"]:
+            out.append(f"{grp['prefix']}_{name} = 0x{v:0{grp['hex']}X}")
+        # 值 -> 说明 / 名称；与本组常量同名的表（如 CAP_TEXT）不生成，以免覆盖常量
+        names = {name for name, v, doc in grp["values"]}
+        for suffix, col in (("TEXT", 2), ("NAMES", 0)):
+            if suffix in names:
+                continue
+            out.append(f"{grp['prefix']}_{suffix} = {{")
+            for entry in grp["values"]:
+                out.append(f"    {grp['prefix']}_{entry[0]}: \"{entry[col]}\",")
+            out.append("}")
+    out += ["", "# 波特率编码（握手帧 max_baud、SET_BAUD 的值）即 BAUD_RATES 下标"]
+    for name, code, baud in baud_codes(schema):
+        out.append(f"{name} = {code}")
+    out.append("BAUD_RATES = (" + ", ".join(str(b) for b in schema["baud_rates"]) + ")")
+    out += ["", "BATCH_BITS = (24, 20, 18, 16)", "",
+            "# <名称>_FIELDS: 数据区 dtype（不含帧头/长度/命令/校验/帧尾）",
+            "# <名称>_FRAME:  整帧 dtype，可直接 np.frombuffer 批量解析"]
+    for fr in schema["frames"]:
+        n = fr["name"]
+        fields = [f"('{name}', {TYPES[typ][3]})" for name, typ, off in fr["fields"]]
+        out.append(f"{n}_FIELDS = np.dtype([{', '.join(fields)}])")
+        if fr.get("variable"):
+            continue
+        if fr["kind"] == "raw":
+            full = ["('head', 'u1', (2,))"] + fields + ["('tail', 'u1', (2,))"]
+        else:
+            full = ["('head', 'u1', (2,))", "('len', 'u1')", "('cmd', 'u1')"] + fields + \
+                   ["('sum', 'u1')", "('tail', 'u1', (2,))"]
+        out.append(f"{n}_FRAME = np.dtype([{', '.join(full)}])")
+        out.append(f"{n}_FRAME_LEN = {fr['size']}")
+    out.append("")
+    out.append("# 定长命令帧的数据区长度（变长帧不在表中）")
+    out.append("DATA_LEN = {")
+    for fr in cmd_frames(schema):
+        if not fr.get("variable"):
+            out.append(f"    CMD_{fr['name']}: {fr['data_len']},")
+    out.append("}")
+    return "\n".join(out) + PY_HELPERS
+
+
+# ==========================================
+
+def outputs(schema):
+    return {
+        "cs1237_proto.hpp": gen_hpp(schema),
+        "cs1237_proto_defs.h": gen_defs(schema),
+        "cs1237_proto.h": gen_c_header(schema),
+        "cs1237_proto.cpp": gen_c_impl(schema),
+        "cs1237_proto.py": gen_py(schema),
+    }
+
+
+def main(argv):
+    check = "--check" in argv
+    stale = []
+    for name, text in outputs(load_schema()).items():
+        targets = [(HERE, "utf-8")] + COPIES.get(name, [])
+        for directory, encoding in targets:
+            path = os.path.join(directory, name)
+            data = text.encode(encoding)
+            old = open(path, "rb").read() if os.path.exists(path) else None
+            if old == data:
+                continue
+            if check:
+                stale.append(path)
+            else:
+                with open(path, "wb") as f:
+                    f.write(data)
+                print(f"写入 {os.path.relpath(path, ROOT)}")
+    if stale:
+        print("以下文件与 schema.json 不一致，请运行 python protocol/gen_proto.py:")
+        for path in stale:
+            print("  " + os.path.relpath(path, ROOT))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
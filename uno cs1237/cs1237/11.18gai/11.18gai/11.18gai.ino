@@ -8,6 +8,9 @@
  * 1. 数据帧格式: [帧头(2B)] + [电压(4B float)] + [PGA(2B uint16)] + [帧尾(2B)]
  * 2. 快速配置响应（减少超时时间）
  * 3. 立即发送配置确认帧
+ * 4. 可选硬件 SPI 读数据段（CS1237_READ_HWSPI，需按 SCK/MISO 接线）
+ * 5. 编译期功能档 FW_PROFILE（无界面/交互/调试），样本先入采样缓冲再发帧
+ * 6. 可选温漂补偿：定时切到内部温度通道测芯片温度，按 PGA 档的温度系数定点修正通道 A 样本
  * ===================================================================================
  */
 
@@ -15,9 +18,25 @@
 #define VDD 5.0f          // 实际供电电压（5V或3.3V，需与硬件一致）
 #define DEFAULT_CHANNEL 0 // 默认通道：0=通道A，1=保留，2=温度，3=内短
 
-// ========== 引脚定义 ==========
-const int CS1237_SCLK = 11;
-const int CS1237_DOUT_DRDY = 10;
+// ========== 读数据方式与引脚 ==========
+// CS1237_READ_HWSPI = 1：24 位数据段用 ATmega328P 的硬件 SPI 移出（1 MHz，约 30 µs，位操作约 400 µs），
+// 必须接 SCLK->D13(SCK)、DOUT->D12(MISO)，D10(SS) 被设为输出、不能再作输入用；
+// 等 DRDY、配置读写的额外时钟仍按普通 IO 操作。为 0 时全部用位操作（原接法，可改引脚）
+#define CS1237_READ_HWSPI 0
+
+#if CS1237_READ_HWSPI
+const int CS1237_SCLK = 13;       // SCK
+const int CS1237_DOUT_DRDY = 12;  // MISO
+#else
+#ifndef CS1237_SCLK_PIN
+#define CS1237_SCLK_PIN 11
+#endif
+#ifndef CS1237_DOUT_PIN
+#define CS1237_DOUT_PIN 10
+#endif
+const int CS1237_SCLK = CS1237_SCLK_PIN;
+const int CS1237_DOUT_DRDY = CS1237_DOUT_PIN;
+#endif
 
 // ========== 全局变量 ==========
 float pga_gain = 128.0f;
@@ -49,47 +68,118 @@ float vref = VDD;
 #define CS1237_REFO_OFF    0x40
 
 // ========== 通讯协议定义 ==========
-const byte FRAME_HEAD_1 = 0xAA;
-const byte FRAME_HEAD_2 = 0x55;
-const byte FRAME_TAIL_1 = 0x0D;
-const byte FRAME_TAIL_2 = 0x0A;
-const byte CMD_ADC_DATA = 0x01;
-const byte CMD_ERROR = 0x03;
-const byte CMD_STATUS = 0x04;
-const byte CMD_SET_PGA = 0xA1;
-const byte CMD_SET_RATE = 0xA2;
-const byte CMD_SET_CHANNEL = 0xA3;
-const byte CMD_POWER_DOWN = 0xA4;
-const byte CMD_CONFIG_ACK = 0xB1;
-const byte ERR_SPI_READ = 0x01;
-const byte ERR_DATA_INVALID = 0x02;
-const byte ERR_TIMEOUT = 0x03;
-const byte ERR_TEMP_PGA = 0x04;
+// 帧格式与命令码由 protocol/gen_proto.py 生成，改协议请改 protocol/schema.json
+#include "cs1237_proto.hpp"
+using namespace cs1237::proto;
+
+#define FW_VERSION   0x0300       // 握手帧中的固件版本 V3.0（高字节主版本）
+#define UNO_MAX_BAUD BAUD_115200  // 16MHz 下 115200 误差约 2%，再高不可靠
+#define CMD_FRAME_TIMEOUT_MS 50   // 收到 0xAA 后等待命令帧其余字节的时间
+
+// ========== 固件功能档（编译期选择） ==========
+// FW_PROFILE_HEADLESS     只走二进制协议（接 ESP32 / 上位机）：不带文本菜单、提示和帮助，
+//                         单字符命令照常响应（ESP32 仍按 A / S / C 1 x / F x 配置），省下的 SRAM 给采样缓冲
+// FW_PROFILE_INTERACTIVE  完整中文文本菜单（默认，与原版行为一致）
+// FW_PROFILE_DEBUG        交互档 + 追踪帧 + 每秒一行运行统计
+// IDE 中直接改下面的默认值；arduino-cli 加 --build-property build.extra_flags=-DFW_PROFILE=0，
+// ../profile_sizes.py 逐档编译并报告 flash / SRAM 占用。
+// 各档不用的分支写成 if (kTextUi) / if (kDebug)，常量为假时连同其中的 F() 字符串一起被编译器去掉
+#define FW_PROFILE_HEADLESS    0
+#define FW_PROFILE_INTERACTIVE 1
+#define FW_PROFILE_DEBUG       2
+#ifndef FW_PROFILE
+#define FW_PROFILE FW_PROFILE_INTERACTIVE
+#endif
+constexpr bool kTextUi = FW_PROFILE != FW_PROFILE_HEADLESS;
+constexpr bool kDebug  = FW_PROFILE == FW_PROFILE_DEBUG;
+// 采样缓冲深度（样本数，每个 9 字节）：无界面档 864 字节，交互档 288 字节，调试档留出统计输出的栈。
+// 全局变量合计（含 Arduino 核心约 184 字节）约为 无界面 1175 / 交互 600 / 调试 455 字节（共 2048），
+// 最深调用链（连续读取中处理命令帧再发帧）加中断约 260 字节栈；换板型或加缓冲后用 profile_sizes.py 复核
+constexpr byte kCaptureDepth = !kTextUi ? 96 : kDebug ? 16 : 32;
+
+#if FW_PROFILE == FW_PROFILE_DEBUG
+#define TRACE_EVERY  10           // 每 N 个样本在电压帧前发一个追踪帧（延迟分析用），0 = 不发
+#else
+#define TRACE_EVERY  0
+#endif
+#define DEBUG_STATS_MS 1000       // 调试档统计行的间隔
 
 // ========== 统计信息 ==========
 unsigned long totalReads = 0;
 unsigned long successfulReads = 0;
 unsigned long errorCount = 0;
+uint16_t traceId = 0;
+byte framing = FRAMING_AA55;  // 上位机用 0xA7 切换，复位后回到 AA 55 帧
 
-// =================================================================
-// === Union 用于 float 和 byte 数组转换 ===
-// =================================================================
-union FloatUnion {
-  float floatValue;
-  byte byteValue[4];
+// ========== 样本质量标志（QFLAG_*，随 COBS 格式的 0x08 电压帧发出） ==========
+byte pendingFlags = 0;          // 发生在下一个样本之前的事件（DRDY 超时、移位异常）
+bool settling = false;          // 改配置后的建立期内读出的样本标 QFLAG_SETTLING
+unsigned long settleUntilMicros = 0;
+unsigned long lastAdcMicros = 0;
+
+// ========== 采样缓冲 ==========
+// 读出的样本先入缓冲，串口发送缓冲有空位时再发帧，发帧不再卡住读数节拍；
+// 缓冲满时丢弃新样本，下一个入缓冲的样本带 QFLAG_DECIMATED
+struct CaptureSample {
+  long code;                    // 已符号扩展的码值
+  unsigned long adcMicros;      // 读出时间（追踪帧用）
+  byte flags;
 };
+CaptureSample captureBuf[kCaptureDepth];
+#if defined(__AVR__)
+// 缓冲超过 1 KB 时，其余全局变量和最深的栈加起来就没有余量了
+static_assert(sizeof(captureBuf) <= 1024, "采样缓冲超出 UNO 的 SRAM 预算");
+#endif
+byte captureHead = 0;
+byte captureCount = 0;
+byte captureHighWater = 0;
+unsigned long captureDrops = 0;
+unsigned long lastReadUs = 0;   // 最近一次读出耗时（含等待 DRDY），调试档统计用
+
+// ========== 温漂补偿 ==========
+// 连续读取时每隔 TEMP_PROBE_PERIOD_MS 切到温度通道（PGA=1）读一次再切回，切换造成的缺口和
+// 建立期由随后样本的 QFLAG_DECIMATED / QFLAG_SETTLING 标出；10Hz 下每次约占 0.5 s
+#define TEMP_PROBE_PERIOD_MS 0     // 0 = 不测温、不补偿
+#define TEMP_CALIB_C    25.0f      // 标定温度（℃）
+#define TEMP_CALIB_CODE 0          // 标定温度下温度通道的码值，0 = 取上电时的码值（视上电时为标定温度）
+// 各 PGA 档（编码 0~3）的温度系数：增益 ppm/℃，零点 1/256 码值/℃；
+// 按板子实测填写（同一输入在两个温度下的读数差 / 温差），默认 0 即只测温不修正
+const int16_t TEMPCO_GAIN_PPM[4]  = {0, 0, 0, 0};
+const int16_t TEMPCO_OFFSET_Q8[4] = {0, 0, 0, 0};
+constexpr long kCalibKelvinQ8 = (long)((273.15f + TEMP_CALIB_C) * 256.0f + 0.5f);
+long tempRefCode = TEMP_CALIB_CODE;
+long tempCode = 0;              // 最近一次温度通道码值
+long tempDeltaQ8 = 0;           // 相对标定温度的温差，1/256 ℃
+long driftOffset = 0;           // 当前温差和 PGA 下的零点修正（码值）
+long driftGainQ24 = 0;          // 当前温差和 PGA 下的增益修正，2^-24
+unsigned long lastTempProbe = 0;
 
 // =================================================================
 // ========== 函数原型 ==========
 // =================================================================
 void processCommand(char command);
-byte calculateChecksum(byte* data, int len);
-void sendVoltagePGAFrame(long adcValue);
+void sendVoltagePGAFrame(long adcValue, byte flags);
 void sendErrorFrame(byte errorCode);
 void sendStatusFrame();
 void sendConfigAck(byte configType, byte value);
+void sendHelloFrame();
+void sendTraceFrame(unsigned long adcMicros);
+void handleCommandFrame();
+byte takeSampleFlags(long rawCode, unsigned long adcMicros);
+unsigned long conversionPeriodUs(int rate_code);
+unsigned long readIntervalMs(int rate_code);
+void probeTemperature();
+void updateDriftCorrection();
+long compensateDrift(long code);
+void setFraming(byte code);
+void setBaudRate(byte code);
+void applyConfigCommand(void (*apply)(int), byte code);
 void readAndDisplayData();
+bool captureSample();
+void drainCapture(bool all);
+void printDebugStats();
 void continuousRead();
+char readMenuChoice(unsigned long timeout_ms);
 void configurationMode();
 void setPGAMenu();
 void setSampleRateMenu();
@@ -111,6 +201,10 @@ void parseConfig(uint8_t config);
 bool writeCS1237Config(uint8_t config);
 uint8_t readCS1237Register();
 long readCS1237ADC();
+long readDataBitBang();
+#if CS1237_READ_HWSPI
+long readDataHwSpi();
+#endif
 float convertADCToVoltage(long adcValue);
 float convertADCToTemp(long adcValue, float calibTemp = 25.0f, long calibCode = 0);
 
@@ -118,23 +212,35 @@ float convertADCToTemp(long adcValue, float calibTemp = 25.0f, long calibCode =
 // ========== 初始化与主循环 ==========
 // =================================================================
 void setup() {
-  Serial.begin(9600);
+  Serial.begin(BAUD_RATES[BAUD_9600]);
+  Serial.setTimeout(CMD_FRAME_TIMEOUT_MS);
   pinMode(CS1237_SCLK, OUTPUT);
   pinMode(CS1237_DOUT_DRDY, INPUT);
   digitalWrite(CS1237_SCLK, LOW);
+#if CS1237_READ_HWSPI
+  pinMode(SS, OUTPUT);  // SS 为输入且被拉低时主机模式会被打断
+#endif
   
   delay(500);
   initCS1237();
+  if (TEMP_PROBE_PERIOD_MS > 0) probeTemperature();  // 没有标定码值时以此为参考
   
-  Serial.println(F("\nCS1237 ADC - Firmware V3.0 (Voltage+PGA Frame)"));
-  Serial.print(F("当前供电电压配置: ")); Serial.print(VDD); Serial.println(F("V"));
-  printCurrentConfig();
-  showHelp();
+  if (kTextUi) {
+    Serial.println(F("\nCS1237 ADC - Firmware V3.0 (Voltage+PGA Frame)"));
+    Serial.print(F("当前供电电压配置: ")); Serial.print(VDD); Serial.println(F("V"));
+    printCurrentConfig();
+    showHelp();
+  }
+  sendHelloFrame();  // 上位机/ESP32 据此选择协议和波特率
 }
 
 void loop() {
   if (Serial.available() > 0) {
     char command = Serial.read();
+    if ((byte)command == FRAME_HEAD_1) {  // 二进制命令帧
+      handleCommandFrame();
+      return;
+    }
     while (Serial.available()) Serial.read();
     processCommand(command);
   }
@@ -148,252 +254,447 @@ void processCommand(char command) {
     case 'R': case 'r': readAndDisplayData(); break;
     case 'A': case 'a': continuousRead(); break;
     case 'C': case 'c': configurationMode(); break;
-    case 'S': case 's': printCurrentConfig(); sendStatusFrame(); break;
+    case 'S': case 's': if (kTextUi) printCurrentConfig(); sendStatusFrame(); break;
     case 'P': case 'p': quickSetPGA(); break;
     case 'F': case 'f': quickSetRate(); break;
     case 'H': case 'h': quickSetChannel(); break;
     case 'D': case 'd': enterPowerDownMode(); break;
     case 'U': case 'u': exitPowerDownMode(); break;
-    default: if (command != '\n' && command != '\r') { showHelp(); }
+    default: if (kTextUi && command != '\n' && command != '\r') { showHelp(); }
   }
 }
 
-byte calculateChecksum(byte* data, int len) {
-  byte checksum = 0;
-  for (int i = 0; i < len; i++) { checksum ^= data[i]; }
-  return checksum;
+// 按当前帧格式发送命令帧
+template <class F>
+void sendFrame(const typename F::Values& v) {
+  if (framing == FRAMING_COBS) {
+    byte packet[cobs_size(F::size)];
+    Serial.write(packet, encode_cobs<F>(packet, v));
+  } else {
+    byte frame[F::size];
+    Serial.write(frame, encode<F>(frame, v));
+  }
 }
 
-void sendVoltagePGAFrame(long adcValue) {
-  // 1. 将ADC值转换为电压
+void sendVoltagePGAFrame(long adcValue, byte flags) {
   float voltage = convertADCToVoltage(adcValue);
 
-  // 2. 使用 union 将 float 转换为字节
-  FloatUnion voltageData;
-  voltageData.floatValue = voltage;
-
-  // 3. PGA转换为uint16
-  uint16_t pga_int = (uint16_t)pga_gain;
-
-  // 4. 构建10字节帧
-  byte frame[10];
-  int idx = 0;
-  
-  frame[idx++] = FRAME_HEAD_1;
-  frame[idx++] = FRAME_HEAD_2;
-
-  // 电压值 (4字节小端序)
-  frame[idx++] = voltageData.byteValue[0];
-  frame[idx++] = voltageData.byteValue[1];
-  frame[idx++] = voltageData.byteValue[2];
-  frame[idx++] = voltageData.byteValue[3];
-
-  // PGA值 (2字节小端序)
-  frame[idx++] = pga_int & 0xFF;
-  frame[idx++] = (pga_int >> 8) & 0xFF;
-
-  frame[idx++] = FRAME_TAIL_1;
-  frame[idx++] = FRAME_TAIL_2;
+  if (framing == FRAMING_COBS) {
+    // COBS 格式下电压帧也带长度和校验（0x08），并带上样本质量标志
+    VoltagePga::Values v;
+    v.voltage = voltage;
+    v.pga = (uint16_t)pga_gain;
+    v.flags = flags;
+    sendFrame<VoltagePga>(v);
+    return;
+  }
+  Voltage::Values v;
+  v.voltage = voltage;
+  v.pga = (uint16_t)pga_gain;
 
-  Serial.write(frame, sizeof(frame));
+  byte frame[Voltage::size];
+  Serial.write(frame, encode<Voltage>(frame, v));
 }
 
 void sendErrorFrame(byte errorCode) {
-  byte frame[8];
-  int idx = 0;
-  frame[idx++] = FRAME_HEAD_1;
-  frame[idx++] = FRAME_HEAD_2;
-  frame[idx++] = 0x02;
-  frame[idx++] = CMD_ERROR;
-  frame[idx++] = errorCode;
-  frame[idx++] = calculateChecksum(&frame[2], 3);
-  frame[idx++] = FRAME_TAIL_1;
-  frame[idx++] = FRAME_TAIL_2;
-  Serial.write(frame, idx);
+  Error::Values v;
+  v.code = errorCode;
+
+  sendFrame<Error>(v);
   errorCount++;
 }
 
 void sendStatusFrame() {
-  byte frame[12];
-  int idx = 0;
-  frame[idx++] = FRAME_HEAD_1;
-  frame[idx++] = FRAME_HEAD_2;
-  frame[idx++] = 0x06;
-  frame[idx++] = CMD_STATUS;
-  byte pga_code = (pga_gain == 1.0f) ? 0 : (pga_gain == 2.0f) ? 1 : (pga_gain == 64.0f) ? 2 : 3;
-  frame[idx++] = pga_code;
-  frame[idx++] = sample_rate_code;
-  frame[idx++] = current_channel;
-  frame[idx++] = (successfulReads >> 16) & 0xFF;
-  frame[idx++] = successfulReads & 0xFF;
-  frame[idx++] = calculateChecksum(&frame[2], 7);
-  frame[idx++] = FRAME_TAIL_1;
-  frame[idx++] = FRAME_TAIL_2;
-  Serial.write(frame, idx);
+  Status::Values v;
+  v.pga = (pga_gain == 1.0f) ? 0 : (pga_gain == 2.0f) ? 1 : (pga_gain == 64.0f) ? 2 : 3;
+  v.rate = sample_rate_code;
+  v.channel = current_channel;
+  v.reads = successfulReads;  // 成功读取次数，4 字节大端
+
+  sendFrame<Status>(v);
 }
 
 void sendConfigAck(byte configType, byte value) {
-  byte frame[9];
-  int idx = 0;
-  frame[idx++] = FRAME_HEAD_1;
-  frame[idx++] = FRAME_HEAD_2;
-  frame[idx++] = 0x03;
-  frame[idx++] = CMD_CONFIG_ACK;
-  frame[idx++] = configType;
-  frame[idx++] = value;
-  frame[idx++] = calculateChecksum(&frame[2], 4);
-  frame[idx++] = FRAME_TAIL_1;
-  frame[idx++] = FRAME_TAIL_2;
-  Serial.write(frame, idx);
+  ConfigAck::Values v;
+  v.type = configType;
+  v.value = value;
+
+  sendFrame<ConfigAck>(v);
   Serial.flush(); // 确保立即发送
 }
 
+void sendHelloFrame() {
+  Hello::Values v;
+  v.proto = PROTO_VERSION;
+  v.device = DEV_UNO;
+  v.fw = FW_VERSION;
+  v.caps = CAP_VOLTAGE | CAP_STATUS | CAP_CONFIG | CAP_SET_BAUD | CAP_COBS | CAP_FLAGS;
+  if (kTextUi) v.caps |= CAP_TEXT;
+  if (TRACE_EVERY > 0) v.caps |= CAP_TIMESTAMP;
+  v.max_baud = UNO_MAX_BAUD;
+  v.batch_max = 0;
+
+  sendFrame<Hello>(v);
+}
+
+// 追踪帧在对应的电压帧之前发出，ESP32 收到电压帧时已知道它的追踪号
+void sendTraceFrame(unsigned long adcMicros) {
+  Trace::Values v;
+  v.id = ++traceId;
+  v.adc_us = adcMicros;
+  v.tx_us = micros();
+
+  sendFrame<Trace>(v);
+}
+
+// 已读到帧头 0xAA，读完其余字节后处理；支持握手/状态查询、PGA/采样率/通道配置、波特率和帧格式切换
+// （上位机的命令在两种帧格式下都用 AA 55 帧）
+void handleCommandFrame() {
+  byte frame[SetBaud::size];  // 支持的命令帧中最长的（与 SetFraming 一样长）
+  frame[0] = FRAME_HEAD_1;
+  if (Serial.readBytes(&frame[1], 2) != 2 || frame[1] != FRAME_HEAD_2) return;
+  if (frame[2] == 0 || frame[2] > SetBaud::len_field) return;
+  byte rest = frame[2] + 3;  // 命令+数据、校验、帧尾
+  if (Serial.readBytes(&frame[3], rest) != rest) return;
+
+  SetPga::Values pga;
+  SetRate::Values rate;
+  SetChannel::Values channel;
+  SetBaud::Values baud;
+  SetFraming::Values framingReq;
+  if (HelloQuery::check(frame)) {
+    sendHelloFrame();
+  } else if (StatusQuery::check(frame)) {
+    sendStatusFrame();
+  } else if (decode<SetPga>(frame, pga)) {
+    applyConfigCommand(setPGAHardware, pga.value);
+  } else if (decode<SetRate>(frame, rate)) {
+    applyConfigCommand(setSampleRateHardware, rate.value);
+  } else if (decode<SetChannel>(frame, channel)) {
+    applyConfigCommand(setChannelHardware, channel.value);
+  } else if (decode<SetBaud>(frame, baud)) {
+    setBaudRate(baud.value);
+  } else if (decode<SetFraming>(frame, framingReq)) {
+    setFraming(framingReq.value);
+  }
+}
+
+// 缓冲中的样本按读出时的 PGA 换算，先发完再改配置；编码超出 0~3 回错误帧
+void applyConfigCommand(void (*apply)(int), byte code) {
+  drainCapture(true);
+  if (code > 3) {
+    sendErrorFrame(ERR_DATA_INVALID);
+    return;
+  }
+  apply(code);
+}
+
+void setFraming(byte code) {
+  if (code > FRAMING_COBS) {
+    sendErrorFrame(ERR_DATA_INVALID);
+    return;
+  }
+  sendConfigAck(CMD_SET_FRAMING, code);  // 按原格式发完确认帧再切换
+  framing = code;
+}
+
+void setBaudRate(byte code) {
+  if (code > UNO_MAX_BAUD) {
+    sendErrorFrame(ERR_DATA_INVALID);
+    return;
+  }
+  sendConfigAck(CMD_SET_BAUD, code);  // 按原波特率发完确认帧再切换
+  Serial.end();
+  Serial.begin(BAUD_RATES[code]);
+}
+
 // =================================================================
 // ========== 数据读取与显示 ==========
 // =================================================================
+// 单次读取：读一个样本并立即发出
 void readAndDisplayData() {
+  lastAdcMicros = 0;  // 单次读取不是连续的数据流，不判缺口
+  if (captureSample()) drainCapture(true);
+}
+
+// 读一个样本放入采样缓冲；等待芯片超时返回 false（已发错误帧）
+bool captureSample() {
   totalReads++;
   if (digitalRead(CS1237_SCLK) == HIGH) {
     exitPowerDownMode();
     delay(10);
   }
   
+  unsigned long startMicros = micros();
   long adcValue = readCS1237ADC();
+  unsigned long adcMicros = micros();
+  lastReadUs = adcMicros - startMicros;
   if (adcValue == -1) {
+    pendingFlags |= QFLAG_DRDY_TIMEOUT;
     sendErrorFrame(ERR_TIMEOUT);
-    return;
+    return false;
   }
   
   successfulReads++;
+  byte flags = takeSampleFlags(adcValue, adcMicros);
   
   if (adcValue & 0x800000) {
     adcValue |= 0xFF000000;
   }
+  if (TEMP_PROBE_PERIOD_MS > 0 && current_channel == 0 && !(flags & QFLAG_SATURATED)) {
+    adcValue = compensateDrift(adcValue);
+  }
+  
+  if (captureCount == kCaptureDepth) {
+    captureDrops++;
+    pendingFlags |= QFLAG_DECIMATED | (flags & QFLAG_DRDY_TIMEOUT);
+    return true;
+  }
+  byte tail = captureHead + captureCount;
+  if (tail >= kCaptureDepth) tail -= kCaptureDepth;
+  captureBuf[tail].code = adcValue;
+  captureBuf[tail].adcMicros = adcMicros;
+  captureBuf[tail].flags = flags;
+  if (++captureCount > captureHighWater) captureHighWater = captureCount;
+  return true;
+}
+
+// 发出缓冲中的样本：all 为假时只发到串口发送缓冲放不下一个样本为止，不阻塞
+void drainCapture(bool all) {
+  // 一个样本最多占的字节：COBS 格式的追踪帧 + 0x08 电压帧
+  const int sampleBytes = cobs_size(Trace::size) + cobs_size(VoltagePga::size);
+  static unsigned int untilTrace = TRACE_EVERY;
   
-  sendVoltagePGAFrame(adcValue);
+  while (captureCount > 0) {
+    if (!all && Serial.availableForWrite() < sampleBytes) return;
+    const CaptureSample& s = captureBuf[captureHead];
+    if (TRACE_EVERY > 0 && --untilTrace == 0) {
+      untilTrace = TRACE_EVERY;
+      sendTraceFrame(s.adcMicros);
+    }
+    sendVoltagePGAFrame(s.code, s.flags);
+    if (++captureHead == kCaptureDepth) captureHead = 0;
+    captureCount--;
+  }
+}
+
+// 判定刚读出样本（符号扩展前的 24 位码值）的质量标志，并清掉已带出的事件
+byte takeSampleFlags(long rawCode, unsigned long adcMicros) {
+  byte flags = pendingFlags;
+  pendingFlags = 0;
+  if (rawCode == 0x7FFFFFL || rawCode == 0x800000L) flags |= QFLAG_SATURATED;
+  // 配置函数写完寄存器后已等过建立时间，按时间判定，只标在那之前读出的样本
+  if (settling) {
+    if ((long)(adcMicros - settleUntilMicros) < 0) flags |= QFLAG_SETTLING;
+    else settling = false;
+  }
+  // 连续读取按 readIntervalMs 的节拍读，到点后最多再等一个转换周期；相隔超过 1.5 个节拍加一个转换周期
+  // 说明漏了节拍上的样本（缓冲满、测温等）。640/1280Hz 节拍之间按设计不读的输出不算
+  if (lastAdcMicros != 0 && adcMicros - lastAdcMicros >
+      readIntervalMs(sample_rate_code) * 1500UL + conversionPeriodUs(sample_rate_code)) {
+    flags |= QFLAG_DECIMATED;
+  }
+  lastAdcMicros = adcMicros;
+  return flags;
+}
+
+unsigned long conversionPeriodUs(int rate_code) {
+  return rate_code == 0 ? 100000UL : rate_code == 1 ? 25000UL :
+         rate_code == 2 ? 1563UL : 781UL;
+}
+
+// 连续读取的节拍：一次读完后隔这么久再读（10/40Hz 100 ms，640/1280Hz 10 ms）
+unsigned long readIntervalMs(int rate_code) {
+  return rate_code <= 1 ? 100UL : 10UL;
+}
+
+// 切到温度通道（PGA=1）读一个建立后的码值再恢复原配置；只改寄存器，pga_gain 等换算用的配置不变
+void probeTemperature() {
+  const uint8_t saved = cs1237_config;
+  const byte savedFlags = pendingFlags;
+  long code = -1;
+  
+  if (writeCS1237Config((saved & ~(CS1237_PGA_MASK | CS1237_CH_MASK)) | CS1237_PGA_1 | CS1237_CH_TEMP)) {
+    do {  // 建立期内的输出丢掉
+      code = readCS1237ADC();
+    } while (code != -1 && (long)(micros() - settleUntilMicros) < 0);
+  }
+  writeCS1237Config(saved);
+  pendingFlags = savedFlags | QFLAG_DECIMATED;  // 测温期间的通道 A 输出没有读
+  lastTempProbe = millis();
+  if (code == -1) return;
+  
+  if (code & 0x800000) code |= 0xFF000000;
+  tempCode = code;
+  if (tempRefCode == 0) tempRefCode = code;
+  if (tempRefCode <= 0) return;
+  // 温度通道码值与绝对温度成正比：ΔT = (273.15 + 标定温度) * (code - 参考码值) / 参考码值
+  tempDeltaQ8 = (long)((int64_t)(code - tempRefCode) * kCalibKelvinQ8 / tempRefCode);
+  updateDriftCorrection();
+}
+
+// 按当前温差和 PGA 档算出修正量，每次测温和改 PGA 后调用（除法只在这里做）
+void updateDriftCorrection() {
+  byte i = (pga_gain == 1.0f) ? 0 : (pga_gain == 2.0f) ? 1 : (pga_gain == 64.0f) ? 2 : 3;
+  driftOffset = ((long)TEMPCO_OFFSET_Q8[i] * tempDeltaQ8) >> 16;
+  driftGainQ24 = -(long)((int64_t)TEMPCO_GAIN_PPM[i] * tempDeltaQ8 * 65536 / 1000000L);
+}
+
+// 通道 A 样本的温漂修正：先减零点漂移，再乘 (1 + 增益修正)
+long compensateDrift(long code) {
+  code -= driftOffset;
+  return code + (long)(((int64_t)code * driftGainQ24) >> 24);
+}
+
+// 调试档每 DEBUG_STATS_MS 输出一行运行统计（与数据帧混在同一串口）
+void printDebugStats() {
+  static unsigned long lastStats = 0;
+  if (millis() - lastStats < DEBUG_STATS_MS) return;
+  lastStats = millis();
+  
+  extern int __heap_start, *__brkval;
+  int top;
+  int freeRam = (char*)&top - (__brkval == 0 ? (char*)&__heap_start : (char*)__brkval);
+  
+  Serial.print(F("\n[DBG] 成功=")); Serial.print(successfulReads);
+  Serial.print(F(" 错误=")); Serial.print(errorCount);
+  Serial.print(F(" 缓冲=")); Serial.print(captureCount);
+  Serial.print('/'); Serial.print(captureHighWater);
+  Serial.print('/'); Serial.print(kCaptureDepth);
+  Serial.print(F(" 丢弃=")); Serial.print(captureDrops);
+  Serial.print(F(" 读出us=")); Serial.print(lastReadUs);
+  Serial.print(F(" 空闲SRAM=")); Serial.print(freeRam);
+  if (TEMP_PROBE_PERIOD_MS > 0) {
+    Serial.print(F(" 温度=")); Serial.print(convertADCToTemp(tempCode));
+    Serial.print(F(" 零点修正=")); Serial.print(driftOffset);
+    Serial.print(F(" 增益修正Q24=")); Serial.print(driftGainQ24);
+  }
+  Serial.println();
 }
 
 void continuousRead() {
-  Serial.println(F("\n开始连续读取... 发送 'S' 停止"));
+  if (kTextUi) Serial.println(F("\n开始连续读取... 发送 'S' 停止"));
+  // 读数节拍与原来一致：一次读完后隔 100 ms（10/40Hz）或 10 ms（640/1280Hz）再读，
+  // 间隔内继续发缓冲中的样本
+  unsigned long lastRead = millis();
+  bool first = true;
+  lastAdcMicros = 0;  // 与上一次连续读取之间的停顿不算缺口
   while (true) {
     if (Serial.available() > 0) {
       char stopChar = Serial.read();
-      if (stopChar == 's' || stopChar == 'S') {
-        Serial.println(F("停止连续读取"));
+      if ((byte)stopChar == FRAME_HEAD_1) {
+        handleCommandFrame();
+      } else if (stopChar == 's' || stopChar == 'S') {
+        drainCapture(true);
+        if (kTextUi) Serial.println(F("停止连续读取"));
         sendStatusFrame();
         break;
       }
     }
-    readAndDisplayData();
-    delay(sample_rate_code <= 1 ? 100 : 10);
+    if (TEMP_PROBE_PERIOD_MS > 0 && current_channel == 0 && millis() - lastTempProbe >= TEMP_PROBE_PERIOD_MS) {
+      drainCapture(true);
+      probeTemperature();
+    }
+    if (first || millis() - lastRead >= readIntervalMs(sample_rate_code)) {
+      captureSample();
+      lastRead = millis();
+      first = false;
+    }
+    drainCapture(false);
+    if (kDebug) printDebugStats();
   }
 }
 
 // =================================================================
 // ========== 配置菜单函数（快速响应版本） ==========
 // =================================================================
-void configurationMode() {
-  Serial.println(F("\n=== CS1237 配置模式 ==="));
-  Serial.println(F("1. 设置 PGA 增益"));
-  Serial.println(F("2. 设置 采样率"));
-  Serial.println(F("3. 设置 通道"));
-  Serial.println(F("4. 返回主菜单"));
-  Serial.print(F("请输入选择 [1-4]: "));
-  
-  long startTime = millis();
+// 等待菜单输入的一个字符并清掉其余输入，超时返回 0
+char readMenuChoice(unsigned long timeout_ms) {
+  unsigned long startTime = millis();
   while (!Serial.available()) {
-    if (millis() - startTime > 10000) { // 减少到10秒超时
-      Serial.println(F("\n超时，返回主菜单"));
-      return;
+    if (millis() - startTime > timeout_ms) {
+      if (kTextUi) Serial.println(F("\n超时"));
+      return 0;
     }
   }
   
-  char choice = Serial.read();
+  char c = Serial.read();
   while (Serial.available()) Serial.read();
+  return c;
+}
+
+void configurationMode() {
+  if (kTextUi) {
+    Serial.println(F("\n=== CS1237 配置模式 ==="));
+    Serial.println(F("1. 设置 PGA 增益"));
+    Serial.println(F("2. 设置 采样率"));
+    Serial.println(F("3. 设置 通道"));
+    Serial.println(F("4. 返回主菜单"));
+    Serial.print(F("请输入选择 [1-4]: "));
+  }
   
-  switch (choice) {
+  switch (readMenuChoice(10000)) { // 减少到10秒超时
     case '1': setPGAMenu(); break;
     case '2': setSampleRateMenu(); break;
     case '3': setChannelMenu(); break;
-    case '4': return;
-    default: Serial.println(F("无效选择")); return;
+    case 0: case '4': return;
+    default: if (kTextUi) Serial.println(F("无效选择")); return;
   }
   
-  printCurrentConfig();
+  if (kTextUi) printCurrentConfig();
   sendStatusFrame();
 }
 
 void setPGAMenu() {
-  Serial.println(F("\n--- PGA 增益设置 ---"));
-  Serial.println(F("0: PGA = 1"));
-  Serial.println(F("1: PGA = 2"));
-  Serial.println(F("2: PGA = 64"));
-  Serial.println(F("3: PGA = 128"));
-  Serial.print(F("请选择 PGA [0-3]: "));
-  
-  long startTime = millis();
-  while (!Serial.available()) {
-    if (millis() - startTime > 8000) { // 8秒超时
-      Serial.println(F("\n超时"));
-      return;
-    }
+  if (kTextUi) {
+    Serial.println(F("\n--- PGA 增益设置 ---"));
+    Serial.println(F("0: PGA = 1"));
+    Serial.println(F("1: PGA = 2"));
+    Serial.println(F("2: PGA = 64"));
+    Serial.println(F("3: PGA = 128"));
+    Serial.print(F("请选择 PGA [0-3]: "));
   }
   
-  char c = Serial.read();
-  while (Serial.available()) Serial.read();
+  char c = readMenuChoice(8000); // 8秒超时
   if (c >= '0' && c <= '3') {
     setPGAHardware(c - '0');
-  } else {
+  } else if (c != 0 && kTextUi) {
     Serial.println(F("无效输入"));
   }
 }
 
 void setSampleRateMenu() {
-  Serial.println(F("\n--- 采样率设置 ---"));
-  Serial.println(F("0: 10 Hz"));
-  Serial.println(F("1: 40 Hz"));
-  Serial.println(F("2: 640 Hz"));
-  Serial.println(F("3: 1280 Hz"));
-  Serial.print(F("请选择采样率 [0-3]: "));
-  
-  long startTime = millis();
-  while (!Serial.available()) {
-    if (millis() - startTime > 8000) {
-      Serial.println(F("\n超时"));
-      return;
-    }
+  if (kTextUi) {
+    Serial.println(F("\n--- 采样率设置 ---"));
+    Serial.println(F("0: 10 Hz"));
+    Serial.println(F("1: 40 Hz"));
+    Serial.println(F("2: 640 Hz"));
+    Serial.println(F("3: 1280 Hz"));
+    Serial.print(F("请选择采样率 [0-3]: "));
   }
   
-  char c = Serial.read();
-  while (Serial.available()) Serial.read();
+  char c = readMenuChoice(8000);
   if (c >= '0' && c <= '3') {
     setSampleRateHardware(c - '0');
-  } else {
+  } else if (c != 0 && kTextUi) {
     Serial.println(F("无效输入"));
   }
 }
 
 void setChannelMenu() {
-  Serial.println(F("\n--- 通道设置 ---"));
-  Serial.println(F("0: 通道A（差分输入）"));
-  Serial.println(F("1: 保留"));
-  Serial.println(F("2: 温度传感器"));
-  Serial.println(F("3: 内短模式"));
-  Serial.print(F("请选择通道 [0-3]: "));
-  
-  long startTime = millis();
-  while (!Serial.available()) {
-    if (millis() - startTime > 8000) {
-      Serial.println(F("\n超时"));
-      return;
-    }
+  if (kTextUi) {
+    Serial.println(F("\n--- 通道设置 ---"));
+    Serial.println(F("0: 通道A（差分输入）"));
+    Serial.println(F("1: 保留"));
+    Serial.println(F("2: 温度传感器"));
+    Serial.println(F("3: 内短模式"));
+    Serial.print(F("请选择通道 [0-3]: "));
   }
   
-  char c = Serial.read();
-  while (Serial.available()) Serial.read();
+  char c = readMenuChoice(8000);
   if (c >= '0' && c <= '3') {
     setChannelHardware(c - '0');
-  } else {
+  } else if (c != 0 && kTextUi) {
     Serial.println(F("无效输入"));
   }
 }
@@ -439,6 +740,9 @@ void printCurrentConfig() {
   }
   Serial.print(F("4. 配置寄存器: 0x")); Serial.println(cs1237_config, HEX);
   Serial.print(F("5. 参考电压: ")); Serial.print(vref); Serial.println(F("V"));
+  if (TEMP_PROBE_PERIOD_MS > 0) {
+    Serial.print(F("   芯片温度: ")); Serial.print(convertADCToTemp(tempCode, TEMP_CALIB_C)); Serial.println(F("℃"));
+  }
   Serial.print(F("6. 统计: 总=")); Serial.print(totalReads);
   Serial.print(F(" 成功=")); Serial.print(successfulReads);
   Serial.print(F(" 错误=")); Serial.println(errorCount);
@@ -488,7 +792,7 @@ void setPGAHardware(int pga_code) {
   
   cs1237_config = (cs1237_config & ~CS1237_PGA_MASK) | pga_bits;
   
-  Serial.print(F("\n写入PGA配置... "));
+  if (kTextUi) Serial.print(F("\n写入PGA配置... "));
 
   if (writeCS1237Config(cs1237_config)) {
     if (waitForChipReady()) {
@@ -498,10 +802,11 @@ void setPGAHardware(int pga_code) {
       
       uint8_t verify = readCS1237Register();
       if (verify == cs1237_config) {
-        Serial.println(F("成功"));
+        if (kTextUi) Serial.println(F("成功"));
+        updateDriftCorrection();
         sendConfigAck(CMD_SET_PGA, pga_code);
       } else {
-        Serial.println(F("失败"));
+        if (kTextUi) Serial.println(F("失败"));
       }
     }
   }
@@ -520,7 +825,7 @@ void setSampleRateHardware(int rate_code) {
   sample_rate_code = rate_code;
   cs1237_config = (cs1237_config & ~CS1237_SPEED_MASK) | speed_bits;
   
-  Serial.print(F("\n写入采样率配置... "));
+  if (kTextUi) Serial.print(F("\n写入采样率配置... "));
 
   if (writeCS1237Config(cs1237_config)) {
     if (waitForChipReady()) {
@@ -530,10 +835,10 @@ void setSampleRateHardware(int rate_code) {
       
       uint8_t verify = readCS1237Register();
       if (verify == cs1237_config) {
-        Serial.println(F("成功"));
+        if (kTextUi) Serial.println(F("成功"));
         sendConfigAck(CMD_SET_RATE, rate_code);
       } else {
-        Serial.println(F("失败"));
+        if (kTextUi) Serial.println(F("失败"));
       }
     }
   }
@@ -541,7 +846,7 @@ void setSampleRateHardware(int rate_code) {
 
 void setChannelHardware(int ch_code) {
   if (ch_code == 2 && pga_gain != 1.0f) {
-    Serial.println(F("\n温度模式需PGA=1，自动切换"));
+    if (kTextUi) Serial.println(F("\n温度模式需PGA=1，自动切换"));
     setPGAHardware(0);
     delay(100);
   }
@@ -558,7 +863,7 @@ void setChannelHardware(int ch_code) {
   current_channel = ch_code;
   cs1237_config = (cs1237_config & ~CS1237_CH_MASK) | ch_bits;
   
-  Serial.print(F("\n写入通道配置... "));
+  if (kTextUi) Serial.print(F("\n写入通道配置... "));
 
   if (writeCS1237Config(cs1237_config)) {
     if (waitForChipReady()) {
@@ -569,31 +874,31 @@ void setChannelHardware(int ch_code) {
       
       uint8_t verify = readCS1237Register();
       if (verify == cs1237_config) {
-        Serial.println(F("成功"));
+        if (kTextUi) Serial.println(F("成功"));
         sendConfigAck(CMD_SET_CHANNEL, ch_code);
       } else {
-        Serial.println(F("失败"));
+        if (kTextUi) Serial.println(F("失败"));
       }
     }
   }
 }
 
 void initCS1237() {
-  Serial.print(F("初始化 CS1237... "));
+  if (kTextUi) Serial.print(F("初始化 CS1237... "));
   uint8_t currentConfig = readCS1237Register();
   
   if (currentConfig != 0xFF) {
     cs1237_config = currentConfig;
     parseConfig(currentConfig);
-    Serial.println(F("成功（读取现有配置）"));
+    if (kTextUi) Serial.println(F("成功（读取现有配置）"));
   } else {
-    Serial.println(F("读取失败，写入默认配置..."));
+    if (kTextUi) Serial.println(F("读取失败，写入默认配置..."));
     if (writeCS1237Config(cs1237_config)) {
       if (waitForChipReady()) {
         delay(300);
         uint8_t verify = readCS1237Register();
         if (verify == cs1237_config) {
-          Serial.println(F("默认配置写入成功"));
+          if (kTextUi) Serial.println(F("默认配置写入成功"));
           parseConfig(verify);
         }
       }
@@ -651,6 +956,11 @@ bool writeCS1237Config(uint8_t config) {
   clockCycle();
   
   digitalWrite(CS1237_SCLK, LOW);
+  // 新配置的前几个转换周期输出还在建立（与退出省电的等待一致：10/40Hz 3 个周期，640/1280Hz 4 个）
+  int rate_code = (config & CS1237_SPEED_MASK) >> 4;
+  settleUntilMicros = micros() + conversionPeriodUs(rate_code) * (rate_code <= 1 ? 3 : 4);
+  settling = true;
+  lastAdcMicros = 0;
   return true;
 }
 
@@ -684,7 +994,23 @@ uint8_t readCS1237Register() {
 
 long readCS1237ADC() {
   if (!waitForChipReady(200)) return -1;
+  // 等到 DRDY 后被中断耽搁、错过了数据窗口时 DOUT 已回到高电平，移出的位会错位
+  if (digitalRead(CS1237_DOUT_DRDY) == HIGH) pendingFlags |= QFLAG_SPI_GLITCH;
+
+#if CS1237_READ_HWSPI
+  long value = readDataHwSpi();
+#else
+  long value = readDataBitBang();
+#endif
+  
+  clockCycle();
+  clockCycle();
+  
+  return value;
+}
 
+// 位操作移出 24 位数据（任意引脚，每位约 17 µs）
+long readDataBitBang() {
   long value = 0;
   for (int i = 0; i < 24; i++) {
     digitalWrite(CS1237_SCLK, HIGH);
@@ -693,23 +1019,35 @@ long readCS1237ADC() {
     digitalWrite(CS1237_SCLK, LOW);
     delayMicroseconds(5);
   }
-  
-  clockCycle();
-  clockCycle();
-  
   return value;
 }
 
+#if CS1237_READ_HWSPI
+// 硬件 SPI 移出 24 位数据：CS1237 在 SCLK 上升沿更新 DOUT，主机在下降沿采样，即 SPI 模式 1；
+// 只在这 3 个字节期间打开 SPI，结束后 D13 回到普通 IO（SCLK 保持低电平）
+long readDataHwSpi() {
+  long value = 0;
+  SPCR = _BV(SPE) | _BV(MSTR) | _BV(CPHA) | _BV(SPR0);  // 主机、模式 1、fosc/16 = 1 MHz
+  SPSR = 0;                                             // 不倍频
+  for (byte i = 0; i < 3; i++) {
+    SPDR = 0;
+    while (!(SPSR & _BV(SPIF))) {}
+    value = (value << 8) | SPDR;
+  }
+  SPCR = 0;
+  return value;
+}
+#endif
+
 float convertADCToVoltage(long adcValue) {
   // 按照手册精确公式：满幅输入 = ±0.5 * VREF / PGA
   const float scale = (0.2475f * vref) / (pga_gain * 8388607.0f);
   return (float)adcValue * scale;
 }
 
+// 温度通道码值与绝对温度成正比；calibCode 为 0 时用上电时测得的参考码值，仍没有参考时返回 NAN
 float convertADCToTemp(long adcValue, float calibTemp, long calibCode) {
-  
-    
-    
-return (float)adcValue * (273.15f + calibTemp) / (float)calibCode - 273.15f;
-  
+  if (calibCode <= 0) calibCode = tempRefCode;
+  if (calibCode <= 0) return NAN;
+  return (float)adcValue * (273.15f + calibTemp) / (float)calibCode - 273.15f;
 }
@@ -0,0 +1,709 @@
+// 由 protocol/gen_proto.py 根据 protocol/schema.json 生成，请勿手工修改
+#ifndef CS1237_PROTO_HPP
+#define CS1237_PROTO_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+namespace cs1237 {
+namespace proto {
+
+constexpr uint8_t FRAME_HEAD_1 = 0xAA;
+constexpr uint8_t FRAME_HEAD_2 = 0x55;
+constexpr uint8_t FRAME_TAIL_1 = 0x0D;
+constexpr uint8_t FRAME_TAIL_2 = 0x0A;
+
+constexpr uint8_t CMD_ADC_DATA = 0x01;  // 单个ADC值，首字节补 0
+constexpr uint8_t CMD_ERROR = 0x03;  // 错误报告
+constexpr uint8_t CMD_STATUS = 0x04;  // 状态信息；上位机发不带数据的 0x04 帧查询
+constexpr uint8_t CMD_ADC_BATCH = 0x05;  // 批量ADC值：固定头之后为按位宽紧密排列的样本
+constexpr uint8_t CMD_HELLO = 0x06;  // 握手/能力帧：上电时和收到不带数据的 0x06 查询时发送
+constexpr uint8_t CMD_TRACE = 0x07;  // 追踪帧：紧接其后的电压帧的追踪号，以及该样本读出和开始发送时的下位机时间（微秒）
+constexpr uint8_t CMD_VOLTAGE_PGA = 0x08;  // 电压帧的命令帧形式：COBS 帧格式下代替电压帧，电压和 PGA 与电压帧相同，另带样本质量标志 QFLAG_*
+constexpr uint8_t CMD_BULK_INFO = 0x09;  // 快照传输开始：传输号、数据格式 BULK_FMT_*、采集时的速率/PGA 编码、总字节数、块数、块长、窗口块数、整个快照的 CRC-32
+constexpr uint8_t CMD_BULK_DATA = 0x0A;  // 快照数据块：固定头之后为第 block 块的数据（末块可能较短），crc 为数据的 CRC-16/CCITT
+constexpr uint8_t CMD_SET_PGA = 0xA1;  // 设置PGA：0=1倍, 1=2倍, 2=64倍, 3=128倍
+constexpr uint8_t CMD_SET_RATE = 0xA2;  // 设置输出速率：0=10Hz, 1=40Hz, 2=640Hz, 3=1280Hz
+constexpr uint8_t CMD_SET_CHANNEL = 0xA3;  // 设置通道：0=A, 1=保留, 2=温度, 3=内短
+constexpr uint8_t CMD_POWER_DOWN = 0xA4;  // 电源状态：1=进入省电, 0=退出（UNO 只在确认帧中使用）
+constexpr uint8_t CMD_SET_BITS = 0xA5;  // 批量帧样本位宽：bit4-0 位宽，bit7-6 量化方式
+constexpr uint8_t CMD_SET_BAUD = 0xA6;  // 切换波特率：BAUD_* 编码；下位机按原波特率回确认帧后切换，上位机收到确认再切换
+constexpr uint8_t CMD_SET_FRAMING = 0xA7;  // 切换下位机发出的帧格式：FRAMING_*；按原格式回确认帧后切换，上位机发出的命令始终是 AA 55 帧
+constexpr uint8_t CMD_BULK_OPEN = 0xA8;  // 冻结/采集快照并开始传输：BULK_SRC_*，样本数（0 = 缓冲容量）；下位机回 0x09 后按窗口发数据块
+constexpr uint8_t CMD_BULK_ACK = 0xA9;  // 快照传输确认：base 之前的块都已收到，missing 的第 i 位表示第 base+i 块丢失需重发；base 等于块数即传输结束
+constexpr uint8_t CMD_CONFIG_ACK = 0xB1;  // 配置确认：配置命令码 + 生效的值
+
+constexpr uint8_t ERR_SPI_READ = 0x01;  // 读取失败（数据未就绪）
+constexpr uint8_t ERR_DATA_INVALID = 0x02;  // 数据或参数无效
+constexpr uint8_t ERR_TIMEOUT = 0x03;  // 等待芯片超时
+constexpr uint8_t ERR_TEMP_PGA = 0x04;  // 测温模式需设置PGA=1
+
+constexpr uint8_t PROTO_VERSION = 1;  // 握手帧 proto 字段
+
+// 握手帧 device：设备类型
+constexpr uint8_t DEV_UNO = 0x01;  // Arduino UNO（11.18gai）
+constexpr uint8_t DEV_STM32 = 0x02;  // STM32F103 例程
+constexpr uint8_t DEV_STC8 = 0x03;  // STC8X 例程
+constexpr uint8_t DEV_STC15 = 0x04;  // STC15W 例程
+
+// 握手帧 caps：支持的帧与功能
+constexpr uint16_t CAP_VOLTAGE = 0x0001;  // 电压帧
+constexpr uint16_t CAP_ADC_DATA = 0x0002;  // 单个ADC帧 0x01
+constexpr uint16_t CAP_ADC_BATCH = 0x0004;  // 批量ADC帧 0x05
+constexpr uint16_t CAP_STATUS = 0x0008;  // 状态查询 0x04
+constexpr uint16_t CAP_CONFIG = 0x0010;  // 二进制配置命令 0xA1-0xA3
+constexpr uint16_t CAP_SET_BITS = 0x0020;  // 批量帧位宽压缩 0xA5
+constexpr uint16_t CAP_SET_BAUD = 0x0040;  // 运行中切换波特率 0xA6
+constexpr uint16_t CAP_TIMESTAMP = 0x0080;  // 追踪帧 0x07：抽样的样本带追踪号和时间戳
+constexpr uint16_t CAP_TEXT = 0x0100;  // 同一串口还输出文本菜单/调试信息
+constexpr uint16_t CAP_COBS = 0x0200;  // 支持 COBS 帧格式 0xA7
+constexpr uint16_t CAP_FLAGS = 0x0400;  // 0x08 电压帧带样本质量标志
+constexpr uint16_t CAP_BULK = 0x0800;  // 快照分块传输 0xA8/0xA9/0x09/0x0A，丢块按位图选择重发
+
+// SET_FRAMING 的值：下位机发出的帧格式
+constexpr uint8_t FRAMING_AA55 = 0x00;  // AA 55 帧头 + 0D 0A 帧尾（上电默认）
+constexpr uint8_t FRAMING_COBS = 0x01;  // 00 + COBS(长度..校验) + 00，0x00 是唯一的分隔符
+
+// BULK_OPEN 的 source：快照来源
+constexpr uint8_t BULK_SRC_HISTORY = 0x00;  // 冻结最近 count 个样本（空闲时下位机一直循环记录）
+constexpr uint8_t BULK_SRC_CAPTURE = 0x01;  // 采集接下来的 count 个样本后冻结
+constexpr uint8_t BULK_SRC_RESEND = 0x02;  // 不重新取样，重发 0x09 并从头传当前快照（上位机没收到 0x09 时用）
+
+// BULK_INFO 的 format：快照数据格式
+constexpr uint8_t BULK_FMT_S24 = 0x00;  // 每个样本 3 字节大端有符号码值，按时间顺序紧密排列
+
+// 0x08 电压帧 flags：样本质量标志，由下位机在读出时判定
+constexpr uint8_t QFLAG_SATURATED = 0x01;  // 码值到达满量程（0x7FFFFF / 0x800000），输入超出量程
+constexpr uint8_t QFLAG_SETTLING = 0x02;  // 配置或退出省电后的建立期，数字滤波器尚未稳定
+constexpr uint8_t QFLAG_DRDY_TIMEOUT = 0x04;  // 此前等待 DRDY 超时，与上一个样本之间有缺口
+constexpr uint8_t QFLAG_SPI_GLITCH = 0x08;  // 开始移位时 DOUT 已不为低，读出的位可能错位（0xFFF??? 类异常值）
+constexpr uint8_t QFLAG_DECIMATED = 0x10;  // 与上一个样本之间漏读了读数节拍上的样本（缓冲满、测温等）
+constexpr uint8_t QFLAG_BAD = 0x0B;  // 样本值不可用的标志组合（饱和、建立期、移位异常），下游按位测试跳过
+
+// 波特率编码（握手帧 max_baud、SET_BAUD 的值）
+constexpr uint8_t BAUD_9600 = 0;
+constexpr uint8_t BAUD_19200 = 1;
+constexpr uint8_t BAUD_38400 = 2;
+constexpr uint8_t BAUD_57600 = 3;
+constexpr uint8_t BAUD_115200 = 4;
+constexpr uint8_t BAUD_230400 = 5;
+constexpr uint8_t BAUD_460800 = 6;
+constexpr uint8_t BAUD_921600 = 7;
+constexpr uint8_t BAUD_COUNT = 8;
+constexpr uint32_t BAUD_RATES[BAUD_COUNT] = {9600UL, 19200UL, 38400UL, 57600UL, 115200UL, 230400UL, 460800UL, 921600UL};
+
+// ---- 字段编解码：类型决定宽度和字节序 ----
+struct U8 {
+    typedef uint8_t type;
+    static constexpr uint8_t size = 1;
+    static void put(uint8_t* p, type v) { p[0] = v; }
+    static type get(const uint8_t* p) { return p[0]; }
+};
+struct U16Le {
+    typedef uint16_t type;
+    static constexpr uint8_t size = 2;
+    static void put(uint8_t* p, type v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+    static type get(const uint8_t* p) { return (type)(p[0] | ((type)p[1] << 8)); }
+};
+struct U16Be {
+    typedef uint16_t type;
+    static constexpr uint8_t size = 2;
+    static void put(uint8_t* p, type v) { p[0] = (uint8_t)(v >> 8); p[1] = (uint8_t)v; }
+    static type get(const uint8_t* p) { return (type)(((type)p[0] << 8) | p[1]); }
+};
+struct U32Be {
+    typedef uint32_t type;
+    static constexpr uint8_t size = 4;
+    static void put(uint8_t* p, type v) {
+        p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16); p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v;
+    }
+    static type get(const uint8_t* p) {
+        return ((type)p[0] << 24) | ((type)p[1] << 16) | ((type)p[2] << 8) | p[3];
+    }
+};
+struct S24Be {  // 24 位有符号，解码时符号扩展到 32 位
+    typedef int32_t type;
+    static constexpr uint8_t size = 3;
+    static void put(uint8_t* p, type v) { p[0] = (uint8_t)(v >> 16); p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)v; }
+    static type get(const uint8_t* p) {
+        uint32_t u = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+        return (type)((u ^ 0x800000UL) - 0x800000UL);
+    }
+};
+struct F32Le {  // 各端（AVR、ESP32、x86、Cortex-M）都是小端，按内存字节序直接复制
+    typedef float type;
+    static constexpr uint8_t size = 4;
+    static void put(uint8_t* p, type v) { memcpy(p, &v, 4); }
+    static type get(const uint8_t* p) { type v; memcpy(&v, p, 4); return v; }
+};
+
+// 固定偏移的字段：偏移是模板参数，编解码时没有任何长度判断
+template <class T, uint8_t Off>
+struct Field {
+    typedef typename T::type type;
+    static constexpr uint8_t offset = Off;
+    static void put(uint8_t* frame, type v) { T::put(frame + Off, v); }
+    static type get(const uint8_t* frame) { return T::get(frame + Off); }
+};
+
+// frame[From..To) 的异或，编译期展开
+template <uint8_t From, uint8_t To>
+struct Xor {
+    static uint8_t of(const uint8_t* f) { return f[From] ^ Xor<From + 1, To>::of(f); }
+};
+template <uint8_t To>
+struct Xor<To, To> {
+    static uint8_t of(const uint8_t*) { return 0; }
+};
+
+// 命令帧外壳: AA 55 [长度=1+数据] [命令] [数据] [XOR(长度..数据)] 0D 0A
+template <uint8_t Cmd, uint8_t DataLen>
+struct CmdFrame {
+    static constexpr uint8_t cmd = Cmd;
+    static constexpr uint8_t data_len = DataLen;
+    static constexpr uint8_t len_field = DataLen + 1;
+    static constexpr uint8_t data_offset = 4;
+    static constexpr uint8_t sum_offset = 4 + DataLen;
+    static constexpr uint8_t size = DataLen + 7;
+
+    static void seal(uint8_t* f) {
+        f[0] = FRAME_HEAD_1; f[1] = FRAME_HEAD_2;
+        f[2] = len_field;    f[3] = cmd;
+        f[sum_offset] = Xor<2, sum_offset>::of(f);
+        f[size - 2] = FRAME_TAIL_1; f[size - 1] = FRAME_TAIL_2;
+    }
+    static bool check(const uint8_t* f) {
+        return f[0] == FRAME_HEAD_1 && f[1] == FRAME_HEAD_2 && f[2] == len_field && f[3] == cmd &&
+               f[sum_offset] == Xor<2, sum_offset>::of(f) &&
+               f[size - 2] == FRAME_TAIL_1 && f[size - 1] == FRAME_TAIL_2;
+    }
+};
+
+// 裸帧外壳: AA 55 [数据] 0D 0A（电压帧）
+template <uint8_t DataLen>
+struct RawFrame {
+    static constexpr uint8_t data_len = DataLen;
+    static constexpr uint8_t data_offset = 2;
+    static constexpr uint8_t size = DataLen + 4;
+
+    static void seal(uint8_t* f) {
+        f[0] = FRAME_HEAD_1; f[1] = FRAME_HEAD_2;
+        f[size - 2] = FRAME_TAIL_1; f[size - 1] = FRAME_TAIL_2;
+    }
+    static bool check(const uint8_t* f) {
+        return f[0] == FRAME_HEAD_1 && f[1] == FRAME_HEAD_2 &&
+               f[size - 2] == FRAME_TAIL_1 && f[size - 1] == FRAME_TAIL_2;
+    }
+};
+
+// 变长命令帧（批量帧）：只有固定头的字段偏移是编译期常量
+template <uint8_t Cmd, uint8_t HeaderLen>
+struct VarFrame {
+    static constexpr uint8_t cmd = Cmd;
+    static constexpr uint8_t header_len = HeaderLen;
+    static constexpr uint8_t data_offset = 4;
+    static uint16_t size(uint8_t data_len) { return (uint16_t)data_len + 7; }
+
+    static void seal(uint8_t* f, uint8_t data_len) {
+        uint8_t sum;
+        uint16_t i;
+        f[0] = FRAME_HEAD_1; f[1] = FRAME_HEAD_2;
+        f[2] = data_len + 1; f[3] = cmd;
+        sum = 0;
+        for (i = 2; i < 4 + data_len; i++) sum ^= f[i];
+        f[4 + data_len] = sum;
+        f[5 + data_len] = FRAME_TAIL_1; f[6 + data_len] = FRAME_TAIL_2;
+    }
+    // n 字节的完整帧，帧头/长度/命令/校验/帧尾都对且不短于固定头才返回数据区长度，否则返回 -1
+    static int check(const uint8_t* f, uint16_t n) {
+        uint8_t sum = 0;
+        uint16_t i;
+        if (n < 7 + HeaderLen || f[0] != FRAME_HEAD_1 || f[1] != FRAME_HEAD_2 ||
+            f[2] != n - 6 || f[3] != cmd || f[n - 2] != FRAME_TAIL_1 || f[n - 1] != FRAME_TAIL_2) return -1;
+        for (i = 2; i < n - 3; i++) sum ^= f[i];
+        return sum == f[n - 3] ? (int)(n - 7) : -1;
+    }
+};
+
+// ---- 各帧定义 ----
+// 电压帧（UNO 11.18 起的连续输出）：帧头 + 电压 + PGA + 帧尾，无长度/命令/校验
+struct Voltage : RawFrame<6> {
+    typedef Field<F32Le, 2> voltage;
+    typedef Field<U16Le, 6> pga;
+    struct Values {
+        float voltage;
+        uint16_t pga;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        voltage::put(f, v.voltage);
+        pga::put(f, v.pga);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.voltage = voltage::get(f);
+        v.pga = pga::get(f);
+    }
+};
+
+// 单个ADC值，首字节补 0
+struct AdcData : CmdFrame<CMD_ADC_DATA, 4> {
+    typedef Field<U8, 4> pad;
+    typedef Field<S24Be, 5> adc;
+    struct Values {
+        uint8_t pad;
+        int32_t adc;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        pad::put(f, v.pad);
+        adc::put(f, v.adc);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.pad = pad::get(f);
+        v.adc = adc::get(f);
+    }
+};
+
+// 错误报告
+struct Error : CmdFrame<CMD_ERROR, 1> {
+    typedef Field<U8, 4> code;
+    struct Values {
+        uint8_t code;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        code::put(f, v.code);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.code = code::get(f);
+    }
+};
+
+// 状态信息；上位机发不带数据的 0x04 帧查询
+struct Status : CmdFrame<CMD_STATUS, 7> {
+    typedef Field<U8, 4> pga;
+    typedef Field<U8, 5> rate;
+    typedef Field<U8, 6> channel;
+    typedef Field<U32Be, 7> reads;
+    struct Values {
+        uint8_t pga;
+        uint8_t rate;
+        uint8_t channel;
+        uint32_t reads;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        pga::put(f, v.pga);
+        rate::put(f, v.rate);
+        channel::put(f, v.channel);
+        reads::put(f, v.reads);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.pga = pga::get(f);
+        v.rate = rate::get(f);
+        v.channel = channel::get(f);
+        v.reads = reads::get(f);
+    }
+};
+typedef CmdFrame<CMD_STATUS, 0> StatusQuery;  // 上位机查询，无数据
+
+// 批量ADC值：固定头之后为按位宽紧密排列的样本
+struct AdcBatch : VarFrame<CMD_ADC_BATCH, 4> {
+    typedef Field<U16Be, 4> seq;
+    typedef Field<U8, 6> bits;
+    typedef Field<U8, 7> count;
+};
+
+// 握手/能力帧：上电时和收到不带数据的 0x06 查询时发送
+struct Hello : CmdFrame<CMD_HELLO, 8> {
+    typedef Field<U8, 4> proto;
+    typedef Field<U8, 5> device;
+    typedef Field<U16Be, 6> fw;
+    typedef Field<U16Be, 8> caps;
+    typedef Field<U8, 10> max_baud;
+    typedef Field<U8, 11> batch_max;
+    struct Values {
+        uint8_t proto;
+        uint8_t device;
+        uint16_t fw;
+        uint16_t caps;
+        uint8_t max_baud;
+        uint8_t batch_max;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        proto::put(f, v.proto);
+        device::put(f, v.device);
+        fw::put(f, v.fw);
+        caps::put(f, v.caps);
+        max_baud::put(f, v.max_baud);
+        batch_max::put(f, v.batch_max);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.proto = proto::get(f);
+        v.device = device::get(f);
+        v.fw = fw::get(f);
+        v.caps = caps::get(f);
+        v.max_baud = max_baud::get(f);
+        v.batch_max = batch_max::get(f);
+    }
+};
+typedef CmdFrame<CMD_HELLO, 0> HelloQuery;  // 上位机查询，无数据
+
+// 追踪帧：紧接其后的电压帧的追踪号，以及该样本读出和开始发送时的下位机时间（微秒）
+struct Trace : CmdFrame<CMD_TRACE, 10> {
+    typedef Field<U16Be, 4> id;
+    typedef Field<U32Be, 6> adc_us;
+    typedef Field<U32Be, 10> tx_us;
+    struct Values {
+        uint16_t id;
+        uint32_t adc_us;
+        uint32_t tx_us;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        id::put(f, v.id);
+        adc_us::put(f, v.adc_us);
+        tx_us::put(f, v.tx_us);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.id = id::get(f);
+        v.adc_us = adc_us::get(f);
+        v.tx_us = tx_us::get(f);
+    }
+};
+
+// 电压帧的命令帧形式：COBS 帧格式下代替电压帧，电压和 PGA 与电压帧相同，另带样本质量标志 QFLAG_*
+struct VoltagePga : CmdFrame<CMD_VOLTAGE_PGA, 7> {
+    typedef Field<F32Le, 4> voltage;
+    typedef Field<U16Le, 8> pga;
+    typedef Field<U8, 10> flags;
+    struct Values {
+        float voltage;
+        uint16_t pga;
+        uint8_t flags;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        voltage::put(f, v.voltage);
+        pga::put(f, v.pga);
+        flags::put(f, v.flags);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.voltage = voltage::get(f);
+        v.pga = pga::get(f);
+        v.flags = flags::get(f);
+    }
+};
+
+// 快照传输开始：传输号、数据格式 BULK_FMT_*、采集时的速率/PGA 编码、总字节数、块数、块长、窗口块数、整个快照的 CRC-32
+struct BulkInfo : CmdFrame<CMD_BULK_INFO, 16> {
+    typedef Field<U8, 4> xfer;
+    typedef Field<U8, 5> format;
+    typedef Field<U8, 6> rate;
+    typedef Field<U8, 7> pga;
+    typedef Field<U32Be, 8> total;
+    typedef Field<U16Be, 12> blocks;
+    typedef Field<U8, 14> block_size;
+    typedef Field<U8, 15> window;
+    typedef Field<U32Be, 16> crc32;
+    struct Values {
+        uint8_t xfer;
+        uint8_t format;
+        uint8_t rate;
+        uint8_t pga;
+        uint32_t total;
+        uint16_t blocks;
+        uint8_t block_size;
+        uint8_t window;
+        uint32_t crc32;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        xfer::put(f, v.xfer);
+        format::put(f, v.format);
+        rate::put(f, v.rate);
+        pga::put(f, v.pga);
+        total::put(f, v.total);
+        blocks::put(f, v.blocks);
+        block_size::put(f, v.block_size);
+        window::put(f, v.window);
+        crc32::put(f, v.crc32);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.xfer = xfer::get(f);
+        v.format = format::get(f);
+        v.rate = rate::get(f);
+        v.pga = pga::get(f);
+        v.total = total::get(f);
+        v.blocks = blocks::get(f);
+        v.block_size = block_size::get(f);
+        v.window = window::get(f);
+        v.crc32 = crc32::get(f);
+    }
+};
+
+// 快照数据块：固定头之后为第 block 块的数据（末块可能较短），crc 为数据的 CRC-16/CCITT
+struct BulkData : VarFrame<CMD_BULK_DATA, 5> {
+    typedef Field<U8, 4> xfer;
+    typedef Field<U16Be, 5> block;
+    typedef Field<U16Be, 7> crc;
+};
+
+// 设置PGA：0=1倍, 1=2倍, 2=64倍, 3=128倍
+struct SetPga : CmdFrame<CMD_SET_PGA, 1> {
+    typedef Field<U8, 4> value;
+    struct Values {
+        uint8_t value;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        value::put(f, v.value);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.value = value::get(f);
+    }
+};
+
+// 设置输出速率：0=10Hz, 1=40Hz, 2=640Hz, 3=1280Hz
+struct SetRate : CmdFrame<CMD_SET_RATE, 1> {
+    typedef Field<U8, 4> value;
+    struct Values {
+        uint8_t value;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        value::put(f, v.value);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.value = value::get(f);
+    }
+};
+
+// 设置通道：0=A, 1=保留, 2=温度, 3=内短
+struct SetChannel : CmdFrame<CMD_SET_CHANNEL, 1> {
+    typedef Field<U8, 4> value;
+    struct Values {
+        uint8_t value;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        value::put(f, v.value);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.value = value::get(f);
+    }
+};
+
+// 电源状态：1=进入省电, 0=退出（UNO 只在确认帧中使用）
+struct PowerDown : CmdFrame<CMD_POWER_DOWN, 1> {
+    typedef Field<U8, 4> value;
+    struct Values {
+        uint8_t value;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        value::put(f, v.value);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.value = value::get(f);
+    }
+};
+
+// 批量帧样本位宽：bit4-0 位宽，bit7-6 量化方式
+struct SetBits : CmdFrame<CMD_SET_BITS, 1> {
+    typedef Field<U8, 4> value;
+    struct Values {
+        uint8_t value;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        value::put(f, v.value);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.value = value::get(f);
+    }
+};
+
+// 切换波特率：BAUD_* 编码；下位机按原波特率回确认帧后切换，上位机收到确认再切换
+struct SetBaud : CmdFrame<CMD_SET_BAUD, 1> {
+    typedef Field<U8, 4> value;
+    struct Values {
+        uint8_t value;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        value::put(f, v.value);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.value = value::get(f);
+    }
+};
+
+// 切换下位机发出的帧格式：FRAMING_*；按原格式回确认帧后切换，上位机发出的命令始终是 AA 55 帧
+struct SetFraming : CmdFrame<CMD_SET_FRAMING, 1> {
+    typedef Field<U8, 4> value;
+    struct Values {
+        uint8_t value;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        value::put(f, v.value);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.value = value::get(f);
+    }
+};
+
+// 冻结/采集快照并开始传输：BULK_SRC_*，样本数（0 = 缓冲容量）；下位机回 0x09 后按窗口发数据块
+struct BulkOpen : CmdFrame<CMD_BULK_OPEN, 3> {
+    typedef Field<U8, 4> source;
+    typedef Field<U16Be, 5> count;
+    struct Values {
+        uint8_t source;
+        uint16_t count;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        source::put(f, v.source);
+        count::put(f, v.count);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.source = source::get(f);
+        v.count = count::get(f);
+    }
+};
+
+// 快照传输确认：base 之前的块都已收到，missing 的第 i 位表示第 base+i 块丢失需重发；base 等于块数即传输结束
+struct BulkAck : CmdFrame<CMD_BULK_ACK, 7> {
+    typedef Field<U8, 4> xfer;
+    typedef Field<U16Be, 5> base;
+    typedef Field<U32Be, 7> missing;
+    struct Values {
+        uint8_t xfer;
+        uint16_t base;
+        uint32_t missing;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        xfer::put(f, v.xfer);
+        base::put(f, v.base);
+        missing::put(f, v.missing);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.xfer = xfer::get(f);
+        v.base = base::get(f);
+        v.missing = missing::get(f);
+    }
+};
+
+// 配置确认：配置命令码 + 生效的值
+struct ConfigAck : CmdFrame<CMD_CONFIG_ACK, 2> {
+    typedef Field<U8, 4> type;
+    typedef Field<U8, 5> value;
+    struct Values {
+        uint8_t type;
+        uint8_t value;
+    };
+    static void put_fields(uint8_t* f, const Values& v) {
+        type::put(f, v.type);
+        value::put(f, v.value);
+    }
+    static void get_fields(const uint8_t* f, Values& v) {
+        v.type = type::get(f);
+        v.value = value::get(f);
+    }
+};
+
+
+// ---- 通用入口：编码整帧返回帧长；解码前校验帧头/长度/命令/校验/帧尾 ----
+template <class F>
+inline uint8_t encode(uint8_t* out, const typename F::Values& v) {
+    F::put_fields(out, v);
+    F::seal(out);
+    return F::size;
+}
+
+template <class F>
+inline bool decode(const uint8_t* in, typename F::Values& v) {
+    if (!F::check(in)) return false;
+    F::get_fields(in, v);
+    return true;
+}
+
+// ---- 快照分块传输的校验 ----
+// CRC-16/CCITT（多项式 0x1021，初值 0xFFFF，不反射）：每个数据块
+inline uint16_t crc16_ccitt(const uint8_t* p, uint16_t n, uint16_t crc = 0xFFFF) {
+    uint8_t k;
+    while (n--) {
+        crc ^= (uint16_t)(*p++) << 8;
+        for (k = 0; k < 8; k++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+// CRC-32（IEEE 802.3，与 zlib.crc32 相同）：整个快照，可分段累加，首段 crc 传 0
+inline uint32_t crc32_update(uint32_t crc, const uint8_t* p, uint32_t n) {
+    uint8_t k;
+    crc = ~crc;
+    while (n--) {
+        crc ^= *p++;
+        for (k = 0; k < 8; k++) crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320UL : crc >> 1;
+    }
+    return ~crc;
+}
+
+// ---- COBS 帧格式: 00 [COBS(长度..校验)] 00 ----
+// 命令帧去掉帧头帧尾后做 COBS 编码，包内不再出现 0x00，收端按 0x00 切包，出错后下一个 0x00 即重新同步。
+// 包前的 0x00 把之前混入的文本隔开，包后的 0x00 让收端不必等下一包就能切出本包。
+
+// 命令帧长 -> COBS 包长
+constexpr uint16_t cobs_size(uint16_t frame_len) {
+    return (frame_len - 4) + (frame_len - 4) / 254 + 1 + 2;
+}
+
+// frame 为完整命令帧，out 至少 cobs_size(frame_len) 字节，返回包长
+inline uint16_t cobs_wrap(const uint8_t* frame, uint16_t frame_len, uint8_t* out) {
+    const uint8_t* in = frame + 2;
+    uint16_t n = frame_len - 4, i, o = 2, code_pos = 1;
+    uint8_t code = 1;
+    out[0] = 0;
+    for (i = 0; i < n; i++) {
+        if (in[i] == 0) {
+            out[code_pos] = code;
+            code_pos = o++;
+            code = 1;
+        } else {
+            out[o++] = in[i];
+            if (++code == 0xFF) {
+                out[code_pos] = code;
+                code_pos = o++;
+                code = 1;
+            }
+        }
+    }
+    out[code_pos] = code;
+    out[o++] = 0;
+    return o;
+}
+
+// in 为两个 0x00 之间的 n 个字节，还原成完整命令帧写入 frame（容量 cap），
+// 长度字段与校验都对才返回帧长，否则返回 0
+inline uint16_t cobs_unwrap(const uint8_t* in, uint16_t n, uint8_t* frame, uint16_t cap) {
+    uint16_t i = 0, o = 2, k;
+    uint8_t code, sum = 0;
+    while (i < n) {
+        code = in[i++];
+        if (code == 0) return 0;
+        for (k = 1; k < code; k++) {
+            if (i >= n || in[i] == 0 || o + 2 >= cap) return 0;
+            frame[o++] = in[i++];
+        }
+        if (code < 0xFF && i < n) {
+            if (o + 2 >= cap) return 0;
+            frame[o++] = 0;
+        }
+    }
+    // o - 2 = 长度 + 命令 + 数据 + 校验 = 长度字段 + 2
+    if (o < 5 || frame[2] != o - 4) return 0;
+    for (k = 2; k < o; k++) sum ^= frame[k];
+    if (sum != 0) return 0;  // 校验字节等于前面各字节的异或
+    frame[0] = FRAME_HEAD_1; frame[1] = FRAME_HEAD_2;
+    frame[o] = FRAME_TAIL_1; frame[o + 1] = FRAME_TAIL_2;
+    return o + 2;
+}
+
+// 定长命令帧直接编码成 COBS 包，out 至少 cobs_size(F::size) 字节
+template <class F>
+inline uint16_t encode_cobs(uint8_t* out, const typename F::Values& v) {
+    uint8_t f[F::size];
+    return cobs_wrap(f, encode<F>(f, v), out);
+}
+
+}  // namespace proto
+}  // namespace cs1237
+
+#endif  // CS1237_PROTO_HPP
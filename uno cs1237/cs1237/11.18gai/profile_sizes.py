@@ -0,0 +1,66 @@
+"""
+逐个功能档编译 11.18gai 草图，报告各档的 flash / SRAM 占用
+
+需要 arduino-cli 和 arduino:avr 核心（arduino-cli core install arduino:avr）。
+SRAM 为全局变量占用（含采样缓冲），剩下的给栈；UNO 共 32256 字节 flash、2048 字节 SRAM。
+
+用法:
+    python profile_sizes.py
+    python profile_sizes.py --fqbn arduino:avr:nano --cli /path/to/arduino-cli
+"""
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+SKETCH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "11.18gai")
+
+# (FW_PROFILE 值, 名称)，与 11.18gai.ino 中的 FW_PROFILE_* 一致
+PROFILES = [
+    (0, "headless"),
+    (1, "interactive"),
+    (2, "debug"),
+]
+
+FLASH_LINE = re.compile(r"Sketch uses (\d+) bytes \((\d+)%\).*?Maximum is (\d+) bytes")
+SRAM_LINE = re.compile(r"Global variables use (\d+) bytes \((\d+)%\).*?leaving (\d+) bytes.*?Maximum is (\d+) bytes")
+
+
+def compile_profile(cli, fqbn, profile):
+    """编译一个功能档，返回 (flash, flash_max, sram, sram_max)"""
+    cmd = [cli, "compile", "--fqbn", fqbn, "--clean",
+           "--build-property", f"build.extra_flags=-DFW_PROFILE={profile}", SKETCH]
+    result = subprocess.run(cmd, capture_output=True, text=True)
+    output = result.stdout + result.stderr
+    if result.returncode != 0:
+        raise RuntimeError(output.strip())
+    flash = FLASH_LINE.search(output)
+    sram = SRAM_LINE.search(output)
+    if not flash or not sram:
+        raise RuntimeError("无法解析编译输出:\n" + output.strip())
+    return int(flash.group(1)), int(flash.group(3)), int(sram.group(1)), int(sram.group(4))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="报告 11.18gai 各功能档的 flash / SRAM 占用")
+    parser.add_argument("--cli", default="arduino-cli", help="arduino-cli 路径")
+    parser.add_argument("--fqbn", default="arduino:avr:uno", help="板型")
+    args = parser.parse_args()
+
+    print(f"{'功能档':<14}{'flash':>8}{'占比':>7}{'SRAM':>8}{'占比':>7}{'剩余SRAM':>10}")
+    failed = False
+    for profile, name in PROFILES:
+        try:
+            flash, flash_max, sram, sram_max = compile_profile(args.cli, args.fqbn, profile)
+        except (OSError, RuntimeError) as e:
+            print(f"{name:<14}编译失败: {e}", file=sys.stderr)
+            failed = True
+            continue
+        print(f"{name:<14}{flash:>8}{flash * 100 // flash_max:>6}%"
+              f"{sram:>8}{sram * 100 // sram_max:>6}%{sram_max - sram:>10}")
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()